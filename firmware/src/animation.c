@@ -17,6 +17,12 @@ the LED brightness state variables. Each animation program runs in a loop. Instr
 the following format:
   [ LED brightness array -- signed integer ] [ Opcode ] [ Opcode specific operand ]
 
+Besides the built-in animations in gasAnimations, animations can be uploaded into the
+EEPROM (see upload.c), one per page, called slot. The EEPROM can be read with MOVC too, so
+the instructions of a slot are played in place, just like the built-in ones: only the
+descriptor of the animation being played (gsAnimation) is different. The header of a slot
+is checked when it's loaded; erased or half-written slots are skipped.
+
 ----------------------------------------------------------------------------------------*/
 
 /***************************************< Includes >**************************************/
@@ -28,30 +34,19 @@ the following format:
 #include "led.h"
 #include "rgbled.h"
 #include "util.h"
+#include "hal.h"
+#include "iap.h"
 #include "animation.h"
 #include "persist.h"
 
 
 /***************************************< Definitions >**************************************/
 #define RIGHT_LEDS_START    (6u)  //!< Index of the first LED on the right side of the board
+#define NO_ANIMATION     (0xFFu)  //!< gu8LoadedIndex: nothing is loaded
+#define MINUS( u8Step )  ( (U8)( 0u - ( u8Step ) ) )  //!< Negative step of an ADD instruction: the U8 brightness wraps around
 
 
 /***************************************< Types >**************************************/
-//! \brief Opcode bits used in animation virtual machine
-typedef enum
-{
-  LOAD      = 0x00u,  //!< Loads the LED brightness array to the PWM driver
-  ADD       = 0x01u,  //!< Adds the LED brightness array elements to the current brightness level; if overflows, it sets to zero
-  RSHIFT    = 0x02u,  //!< Shifts all the current LED brightness levels clockwise
-  LSHIFT    = 0x04u,  //!< Shifts all the current LED brightness levels anticlockwise
-//  UMOVE     = 0x04u,  //!< Moves some of the values upwards. Uses saturation logic. Doesn't roll over.
-//  DMOVE     = 0x08u,  //!< Moves some of the values downwards. Uses saturation logic. Doesn't roll over.
-  DIV       = 0x10u,  //!< Divides the the current LED brightness levels by the given number
-  USOURCE   = 0x20u,  //!< Add values to the brightness and if it overflows/underflows then it will be added to the upwards next value. If it overflows/underflows then it will do the same until it reaches the uppper or lower end.
-  DSOURCE   = 0x40u,  //!< Add values to the brightness and if it overflows/underflows then it will be added to the downwards next value. If it overflows/underflows then it will do the same until it reaches the uppper or lower end.
-  REPEAT    = 0x80u   //!< Do the instruction and repeat by (operand)-times
-} E_ANIMATION_OPCODE;
-
 //! \brief Instruction used by the animation state machine -- for normal LEDs
 typedef struct
 {
@@ -117,14 +112,14 @@ CODE const S_ANIMATION_INSTRUCTION_NORMAL gasAnimation2[ 13u ] =
 {
   {  115u, {  0,  0,  0,  0,  0,  0,  0 }, LOAD,  0u },
   {  115u, {  3,  3,  3,  3,  3,  3,  3 }, ADD | REPEAT,  4u },
-  {  115u, { -3, -3, -3, -3, -3, -3, -3 }, ADD | REPEAT,  4u },
+  {  115u, { MINUS( 3 ), MINUS( 3 ), MINUS( 3 ), MINUS( 3 ), MINUS( 3 ), MINUS( 3 ), MINUS( 3 ) }, ADD | REPEAT,  4u },
 };
 //! \brief KITT animation -- RGB LED
 CODE const S_ANIMATION_INSTRUCTION_RGB gasAnimation2RGB[ 6u ] = 
 {
   {  115u, {  0,  0,  0,  0}, LOAD,         0u },
   {  115u, {  3,  3,  3,  3}, ADD | REPEAT, 4u },
-  {  115u, { -3, -3, -3, -3}, ADD | REPEAT, 4u },
+  {  115u, { MINUS( 3 ), MINUS( 3 ), MINUS( 3 ), MINUS( 3 )}, ADD | REPEAT, 4u },
 };
 
 //--------------------------------------------------------
@@ -132,7 +127,7 @@ CODE const S_ANIMATION_INSTRUCTION_RGB gasAnimation2RGB[ 6u ] =
 CODE const S_ANIMATION_INSTRUCTION_NORMAL gasAnimation3[ 4u ] = 
 {
   {  70u, { 15, 15, 15, 15, 15, 15, 15 }, LOAD,           0u },
-  {  70u, { -1, -1, -1, -1, -1, -1, -1 }, ADD | REPEAT,  14u },
+  {  70u, { MINUS( 1 ), MINUS( 1 ), MINUS( 1 ), MINUS( 1 ), MINUS( 1 ), MINUS( 1 ), MINUS( 1 ) }, ADD | REPEAT,  14u },
   {  70u, {  0,  0,  0,  0,  0,  0,  0 }, LOAD,           0u },
   {  70u, {  1,  1,  1,  1,  1,  1,  1 }, ADD | REPEAT,  14u },
 };
@@ -140,9 +135,9 @@ CODE const S_ANIMATION_INSTRUCTION_NORMAL gasAnimation3[ 4u ] =
 CODE const S_ANIMATION_INSTRUCTION_RGB gasAnimation3RGB[ 4u ] = 
 {
   {  70u, { 15, 15,  0,  0}, LOAD,          0u },
-  {  70u, { -1, -1,  1,  1}, ADD | REPEAT, 14u },
+  {  70u, { MINUS( 1 ), MINUS( 1 ),  1,  1}, ADD | REPEAT, 14u },
   {  70u, {  0,  0, 15, 15}, LOAD,          0u },
-  {  70u, {  1,  1, -1, -1}, ADD | REPEAT, 14u },
+  {  70u, {  1,  1, MINUS( 1 ), MINUS( 1 )}, ADD | REPEAT, 14u },
 };
 
 
@@ -160,7 +155,7 @@ CODE const S_ANIMATION_INSTRUCTION_NORMAL gasAnimation4[ 14u ] =
   {  125u, { 15, 15, 12, 15, 15, 12,  9 }, LOAD,  0u },
   {  125u, { 15, 12,  9, 12, 15, 15, 12 }, LOAD,  0u },
   {  125u, { 12,  9,  6,  9, 12, 15, 15 }, LOAD,  0u },
-  {  125u, { -3, -3, -3, -3, -3, -3, -3 }, ADD | REPEAT,  1u},
+  {  125u, { MINUS( 3 ), MINUS( 3 ), MINUS( 3 ), MINUS( 3 ), MINUS( 3 ), MINUS( 3 ), MINUS( 3 ) }, ADD | REPEAT,  1u},
   {  125u, {  3,  0,  0,  0,  3,  6,  9 }, LOAD,  0u },
   {  125u, {  0,  0,  0,  0,  0,  3,  6 }, LOAD,  0u },
   {  125u, {  0,  0,  0,  0,  0,  0,  3 }, LOAD,  0u },
@@ -175,7 +170,7 @@ CODE const S_ANIMATION_INSTRUCTION_RGB gasAnimation4RGB[ 10u ] =
   {  125u, { 12, 15, 15, 8}, LOAD,         0u },
   {  125u, { 15, 15, 12, 8}, LOAD,         0u },
   {  125u, { 15, 12,  9, 8}, LOAD,         0u },
-  {  125u, { -3, -3, -3, -2}, ADD | REPEAT, 2u },
+  {  125u, { MINUS( 3 ), MINUS( 3 ), MINUS( 3 ), MINUS( 2 )}, ADD | REPEAT, 2u },
   {  125u, {  3,  0,  0,  0}, LOAD,         0u },
   { 250u, {  0,  0,  0,  0}, LOAD,         0u },
 };
@@ -186,7 +181,7 @@ CODE const S_ANIMATION_INSTRUCTION_NORMAL gasAnimation5[ 4u ] =
 {
   {1525u, {  0,  0,  0,  0,  0,  0,  0 }, LOAD,  0u },
   {  75u, {  3,  3,  3,  3,  3,  3,  3 }, ADD | REPEAT,  4u },
-  {  75u, { -3, -3, -3, -3, -3, -3, -3 }, ADD | REPEAT,  4u },
+  {  75u, { MINUS( 3 ), MINUS( 3 ), MINUS( 3 ), MINUS( 3 ), MINUS( 3 ), MINUS( 3 ), MINUS( 3 ) }, ADD | REPEAT,  4u },
   { 450u, {  0,  0,  0,  0,  0,  0,  0 }, LOAD,  0u },
 };
 //! \brief KITT animation -- RGB LED
@@ -194,9 +189,9 @@ CODE const S_ANIMATION_INSTRUCTION_RGB gasAnimation5RGB[ 7u ] =
 {
   {  75u, {  0,  0,  0,  0}, LOAD,         0u },
   {  75u, {  3,  0,  0,  0}, ADD | REPEAT, 4u },
-  {  75u, { -3,  0,  0,  0}, ADD | REPEAT, 4u },
+  {  75u, { MINUS( 3 ),  0,  0,  0}, ADD | REPEAT, 4u },
   {  75u, {  0,  3,  0,  0}, ADD | REPEAT, 4u },
-  {  75u, {  0, -3,  0,  0}, ADD | REPEAT, 4u },
+  {  75u, {  0, MINUS( 3 ),  0,  0}, ADD | REPEAT, 4u },
   { 750u, {  0,  0,  0,  0}, LOAD,         0u },
   { 450u, {  0,  0, 15, 15}, LOAD,         0u },
 };
@@ -247,10 +242,10 @@ CODE const S_ANIMATION_INSTRUCTION_NORMAL gasAnimation7[ 7u ] =
 CODE const S_ANIMATION_INSTRUCTION_RGB gasAnimation7RGB[ 6u ] = 
 {
   { 110u, { 15,  0,  0, 15}, LOAD,         0u },
-	{ 110u, {  0,  5,  0, -5}, ADD | REPEAT, 2u },
-  { 110u, { -5,  0,  5,  0}, ADD | REPEAT, 2u },
-  { 110u, {  0, -5,  0,  5}, ADD | REPEAT, 2u },
-  { 110u, {  5,  0, -5,  0}, ADD | REPEAT, 2u },
+	{ 110u, {  0,  5,  0, MINUS( 5 )}, ADD | REPEAT, 2u },
+  { 110u, { MINUS( 5 ),  0,  5,  0}, ADD | REPEAT, 2u },
+  { 110u, {  0, MINUS( 5 ),  0,  5}, ADD | REPEAT, 2u },
+  { 110u, {  5,  0, MINUS( 5 ),  0}, ADD | REPEAT, 2u },
 };
 
 //--------------------------------------------------------
@@ -284,7 +279,7 @@ CODE const S_ANIMATION gasAnimations[ NUM_ANIMATIONS ] =
   {sizeof(gasAnimation7)/sizeof(S_ANIMATION_INSTRUCTION_NORMAL),             gasAnimation7,             sizeof(gasAnimation7RGB)/sizeof(S_ANIMATION_INSTRUCTION_RGB),             gasAnimation7RGB },
 
   // Last animation, don't change its location
-  {sizeof(gasBlackness)/sizeof(S_ANIMATION_INSTRUCTION_NORMAL),        gasBlackness,        sizeof(gasBlacknessRGB)/sizeof(S_ANIMATION_INSTRUCTION_RGB),        gasBlackness }
+  {sizeof(gasBlackness)/sizeof(S_ANIMATION_INSTRUCTION_NORMAL),        gasBlackness,        sizeof(gasBlacknessRGB)/sizeof(S_ANIMATION_INSTRUCTION_RGB),        gasBlacknessRGB }
 };
 
 
@@ -297,10 +292,16 @@ static IDATA U8 u8LastState = 0xFFu;          //!< Previously executed instructi
 static IDATA U8 u8RepetitionCounter = 0u;     //!< Instruction repetition counter for normal LEDs
 static IDATA U8 u8LastStateRGB = 0xFFu;       //!< Previously executed instruction index for RGB LED
 static IDATA U8 u8RepetitionCounterRGB = 0u;  //!< Instruction repetition counter for RGB LED
+static IDATA U16 gu16IdleGapMs = 0u;          //!< Time until the next instruction changes the LEDs
+static IDATA S_ANIMATION gsAnimation;         //!< Descriptor of the animation being played, built-in or uploaded
+static IDATA U8 gu8LoadedIndex = NO_ANIMATION;  //!< Index of the animation in gsAnimation
+static IDATA U8 gu8PlayedIndex = NO_ANIMATION;  //!< Index of the animation to play; differs from the saved one e.g. for the blackness
 
 
 /***************************************< Static function definitions >**************************************/
 static I8 SaturateBrightness( U8* pu8BrightnessVariable );
+static BOOL ReadSlotHeader( U8 u8Slot, U8* pu8Header );
+static BOOL LoadAnimation( U8 u8AnimationIndex );
 
 
 /***************************************< Private functions >**************************************/
@@ -327,6 +328,67 @@ static I8 SaturateBrightness( U8* pu8BrightnessVariable )
   return i8Return;
 }
 
+//----------------------------------------------------------------------------
+//! \brief  Reads and checks the header of an EEPROM slot
+//! \param  u8Slot: index of the slot
+//! \param  pu8Header: the header is read here (ANIMATION_SLOT_HEADER_LENGTH bytes)
+//! \return TRUE if the slot holds a complete animation
+//! \global -
+//-----------------------------------------------------------------------------
+static BOOL ReadSlotHeader( U8 u8Slot, U8* pu8Header )
+{
+  BOOL bValid = FALSE;
+  U16  u16CRC;
+  U16  u16Length;
+
+  IAP_Read( ANIMATION_SLOT_ADDRESS( u8Slot ), pu8Header, ANIMATION_SLOT_HEADER_LENGTH );
+  u16CRC = ( (U16)pu8Header[ ANIMATION_SLOT_OFS_CRC ] << 8u ) | pu8Header[ ANIMATION_SLOT_OFS_CRC + 1u ];
+  u16Length = ( (U16)pu8Header[ ANIMATION_SLOT_OFS_LENGTH_NORMAL ] * ANIMATION_INSTRUCTION_NORMAL_LENGTH )
+            + ( (U16)pu8Header[ ANIMATION_SLOT_OFS_LENGTH_RGB ] * ANIMATION_INSTRUCTION_RGB_LENGTH );
+  if( ( ANIMATION_SLOT_MAGIC == pu8Header[ ANIMATION_SLOT_OFS_MAGIC ] )
+   && ( ANIMATION_SLOT_FORMAT == pu8Header[ ANIMATION_SLOT_OFS_FORMAT ] )
+   && ( u16CRC == Util_CRC16( pu8Header, ANIMATION_SLOT_OFS_CRC ) )
+   && ( 0u != pu8Header[ ANIMATION_SLOT_OFS_LENGTH_NORMAL ] )
+   && ( 0u != pu8Header[ ANIMATION_SLOT_OFS_LENGTH_RGB ] )
+   && ( u16Length <= ANIMATION_SLOT_IMAGE_MAX ) )
+  {
+    bValid = TRUE;
+  }
+  return bValid;
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Sets up the descriptor of an animation for playing
+//! \param  u8AnimationIndex: index of the animation; built-in ones first, then the slots
+//! \return TRUE if the animation exists
+//! \global gsAnimation
+//! \note   The instructions of a slot are not copied, the descriptor points into the EEPROM.
+//-----------------------------------------------------------------------------
+static BOOL LoadAnimation( U8 u8AnimationIndex )
+{
+  BOOL bLoaded = FALSE;
+  U8   au8Header[ ANIMATION_SLOT_HEADER_LENGTH ];
+  U16  u16Address;
+
+  if( u8AnimationIndex < NUM_ANIMATIONS )
+  {
+    memcpy( &gsAnimation, (void*)&gasAnimations[ u8AnimationIndex ], sizeof( S_ANIMATION ) );
+    bLoaded = TRUE;
+  }
+  else if( ( u8AnimationIndex < ( ANIMATION_FIRST_SLOT + ANIMATION_SLOTS_NUM ) )
+        && ( TRUE == ReadSlotHeader( u8AnimationIndex - ANIMATION_FIRST_SLOT, au8Header ) ) )
+  {
+    u16Address = ANIMATION_SLOT_ADDRESS( u8AnimationIndex - ANIMATION_FIRST_SLOT ) + ANIMATION_SLOT_HEADER_LENGTH;
+    gsAnimation.u8AnimationLengthNormal = au8Header[ ANIMATION_SLOT_OFS_LENGTH_NORMAL ];
+    gsAnimation.psInstructionsNormal = (const S_ANIMATION_INSTRUCTION_NORMAL CODE*)HAL_EEPROM_POINTER( u16Address );
+    u16Address += (U16)au8Header[ ANIMATION_SLOT_OFS_LENGTH_NORMAL ] * ANIMATION_INSTRUCTION_NORMAL_LENGTH;
+    gsAnimation.u8AnimationLengthRGB = au8Header[ ANIMATION_SLOT_OFS_LENGTH_RGB ];
+    gsAnimation.psInstructionsRGB = (const S_ANIMATION_INSTRUCTION_RGB CODE*)HAL_EEPROM_POINTER( u16Address );
+    bLoaded = TRUE;
+  }
+  return bLoaded;
+}
+
 
 /***************************************< Public functions >**************************************/
 //----------------------------------------------------------------------------
@@ -341,20 +403,22 @@ void Animation_Init( void )
   gu16NormalTimer = 0u;
   gu16RGBTimer = 0u;
   gu16LastCall = Util_GetTimerMs();
+  gu8LoadedIndex = NO_ANIMATION;  // The index is known after Persist_Init()
+  gu8PlayedIndex = NO_ANIMATION;
 }
 
 //----------------------------------------------------------------------------
 //! \brief  Check timer and update LED brightnesses based on the animation.
 //! \param  -
-//! \return -
+//! \return Idle gap: milliseconds until the next instruction changes the LEDs
 //! \global -
 //! \note   Should be called from main cycle.
 //-----------------------------------------------------------------------------
-void Animation_Cycle( void )
+U16 Animation_Cycle( void )
 {
   U8  u8AnimationState;
   U16 u16StateTimer = 0u;
-  U16 u16TimeNow = Util_GetTimerMs();
+  U16 u16TimeNow = gu16TimeSnapshotMs;
   U8  u8Index, u8InnerIndex;
   U8  u8OpCode;
   U8  u8Temp;
@@ -364,43 +428,55 @@ void Animation_Cycle( void )
   if( u16TimeNow != gu16LastCall )
   {
     // Increase the synchronized timer with the difference
-    DISABLE_IT;
     gu16NormalTimer += ( u16TimeNow - gu16LastCall );
     gu16RGBTimer += ( u16TimeNow - gu16LastCall );
-    ENABLE_IT;
 
-    // Make sure not to overindex arrays
-    if( gsPersistentData.u8AnimationIndex >= NUM_ANIMATIONS )
+    // Until the first Animation_Set() the saved animation is played
+    if( NO_ANIMATION == gu8PlayedIndex )
     {
-      gsPersistentData.u8AnimationIndex = 0u;
+      gu8PlayedIndex = gsPersistentData.u8AnimationIndex;
+    }
+    // Load the selected animation; fall back to the first one if it doesn't exist (e.g. an erased slot)
+    if( gu8PlayedIndex != gu8LoadedIndex )
+    {
+      if( FALSE == LoadAnimation( gu8PlayedIndex ) )
+      {
+        if( gsPersistentData.u8AnimationIndex == gu8PlayedIndex )
+        {
+          gsPersistentData.u8AnimationIndex = 0u;
+        }
+        gu8PlayedIndex = 0u;
+        LoadAnimation( 0u );
+      }
+      gu8LoadedIndex = gu8PlayedIndex;
     }
     
     // --------------------------------------< For the normal LEDs
     // Calculate the state of the animation
-    for( u8AnimationState = 0u; u8AnimationState < gasAnimations[ gsPersistentData.u8AnimationIndex ].u8AnimationLengthNormal; u8AnimationState++ )
+    for( u8AnimationState = 0u; u8AnimationState < gsAnimation.u8AnimationLengthNormal; u8AnimationState++ )
     {
-      u16StateTimer += gasAnimations[ gsPersistentData.u8AnimationIndex ].psInstructionsNormal[ u8AnimationState ].u16TimingMs;
+      u16StateTimer += gsAnimation.psInstructionsNormal[ u8AnimationState ].u16TimingMs;
       if( u16StateTimer > gu16NormalTimer )
       {
         break;
       }
     }
-    if( u8AnimationState >= gasAnimations[ gsPersistentData.u8AnimationIndex ].u8AnimationLengthNormal )
+    if( u8AnimationState >= gsAnimation.u8AnimationLengthNormal )
     {
       // restart animation
       u8AnimationState = 0u;
-      DISABLE_IT;
+      u16StateTimer = gsAnimation.psInstructionsNormal[ 0u ].u16TimingMs;
       gu16NormalTimer = 0u;
       gu16RGBTimer = 0u;
-      ENABLE_IT;
     }
+    gu16IdleGapMs = u16StateTimer - gu16NormalTimer;
     if( u8LastState != u8AnimationState )  // next instruction
     {
-      u8OpCode = gasAnimations[ gsPersistentData.u8AnimationIndex ].psInstructionsNormal[ u8AnimationState ].u8AnimationOpcode;
+      u8OpCode = gsAnimation.psInstructionsNormal[ u8AnimationState ].u8AnimationOpcode;
       // Just a load instruction, nothing more
       if( LOAD == u8OpCode )
       {
-        memcpy( gau8LEDBrightness, (void*)gasAnimations[ gsPersistentData.u8AnimationIndex ].psInstructionsNormal[ u8AnimationState ].au8LEDBrightness, LEDS_NUM );
+        memcpy( gau8LEDBrightness, (void*)gsAnimation.psInstructionsNormal[ u8AnimationState ].au8LEDBrightness, LEDS_NUM );
         u8LastState = u8AnimationState;
       }
       else  // Other opcodes -- IMPORTANT: the order of operations are fixed!
@@ -410,7 +486,7 @@ void Animation_Cycle( void )
         {
           for( u8Index = 0u; u8Index < LEDS_NUM; u8Index++ )
           {
-            gau8LEDBrightness[ u8Index ] += gasAnimations[ gsPersistentData.u8AnimationIndex ].psInstructionsNormal[ u8AnimationState ].au8LEDBrightness[ u8Index ];
+            gau8LEDBrightness[ u8Index ] += gsAnimation.psInstructionsNormal[ u8AnimationState ].au8LEDBrightness[ u8Index ];
             if( gau8LEDBrightness[ u8Index ] > 15u )  // overflow/underflow happened
             {
               gau8LEDBrightness[ u8Index ] = 0u;
@@ -444,7 +520,7 @@ void Animation_Cycle( void )
           // Left side
           for( u8Index = 0u; u8Index < (RIGHT_LEDS_START - 1u); u8Index++ )
           {
-            i8Change = gasAnimations[ gsPersistentData.u8AnimationIndex ].psInstructionsNormal[ u8AnimationState ].au8LEDBrightness[ u8Index ];
+            i8Change = gsAnimation.psInstructionsNormal[ u8AnimationState ].au8LEDBrightness[ u8Index ];
             gau8LEDBrightness[ u8Index ] -= i8Change;
             for( u8InnerIndex = u8Index; u8InnerIndex < (RIGHT_LEDS_START - 1u); u8InnerIndex++ )
             {
@@ -453,13 +529,13 @@ void Animation_Cycle( void )
               i8Change = SaturateBrightness( &gau8LEDBrightness[ u8InnerIndex + 1u ] );
             }
           }
-          i8Change = gasAnimations[ gsPersistentData.u8AnimationIndex ].psInstructionsNormal[ u8AnimationState ].au8LEDBrightness[ RIGHT_LEDS_START - 1u ];
+          i8Change = gsAnimation.psInstructionsNormal[ u8AnimationState ].au8LEDBrightness[ RIGHT_LEDS_START - 1u ];
           gau8LEDBrightness[ RIGHT_LEDS_START - 1u ] -= i8Change;
           SaturateBrightness( &gau8LEDBrightness[ RIGHT_LEDS_START - 1u ] );
           // Right side
           for( u8Index = LEDS_NUM - 1u; u8Index > RIGHT_LEDS_START; u8Index-- )
           {
-            i8Change = gasAnimations[ gsPersistentData.u8AnimationIndex ].psInstructionsNormal[ u8AnimationState ].au8LEDBrightness[ u8Index ];
+            i8Change = gsAnimation.psInstructionsNormal[ u8AnimationState ].au8LEDBrightness[ u8Index ];
             if( (I8)gau8LEDBrightness[ u8Index ] - i8Change < 0u )  // saturation downwards
             {
               gau8LEDBrightness[ u8Index - 1u ] += gau8LEDBrightness[ u8Index ];
@@ -472,7 +548,7 @@ void Animation_Cycle( void )
             SaturateBrightness( &gau8LEDBrightness[ u8Index ] );
             SaturateBrightness( &gau8LEDBrightness[ u8Index - 1u ] );  // saturate the next LED too
           }
-          i8Change = gasAnimations[ gsPersistentData.u8AnimationIndex ].psInstructionsNormal[ u8AnimationState ].au8LEDBrightness[ RIGHT_LEDS_START ];
+          i8Change = gsAnimation.psInstructionsNormal[ u8AnimationState ].au8LEDBrightness[ RIGHT_LEDS_START ];
           gau8LEDBrightness[ RIGHT_LEDS_START ] -= i8Change;
           SaturateBrightness( &gau8LEDBrightness[ RIGHT_LEDS_START ] );
         }
@@ -483,7 +559,7 @@ void Animation_Cycle( void )
           // Left side
           for( u8Index = (RIGHT_LEDS_START - 1u); u8Index > 0u ; u8Index-- )
           {
-            i8Change = gasAnimations[ gsPersistentData.u8AnimationIndex ].psInstructionsNormal[ u8AnimationState ].au8LEDBrightness[ u8Index ];
+            i8Change = gsAnimation.psInstructionsNormal[ u8AnimationState ].au8LEDBrightness[ u8Index ];
             if( (I8)gau8LEDBrightness[ u8Index ] - i8Change < 0u )  // saturation downwards
             {
               gau8LEDBrightness[ u8Index - 1u ] += gau8LEDBrightness[ u8Index ];
@@ -496,13 +572,13 @@ void Animation_Cycle( void )
             SaturateBrightness( &gau8LEDBrightness[ u8Index ] );
             SaturateBrightness( &gau8LEDBrightness[ u8Index - 1u ] );  // saturate the next LED too
           }
-          i8Change = gasAnimations[ gsPersistentData.u8AnimationIndex ].psInstructionsNormal[ u8AnimationState ].au8LEDBrightness[ 0u ];
+          i8Change = gsAnimation.psInstructionsNormal[ u8AnimationState ].au8LEDBrightness[ 0u ];
           gau8LEDBrightness[ 0u ] -= i8Change;
           SaturateBrightness( &gau8LEDBrightness[ 0u ] );
           // Right side
           for( u8Index = RIGHT_LEDS_START; u8Index < (LEDS_NUM - 1u); u8Index++ )
           {
-            i8Change = gasAnimations[ gsPersistentData.u8AnimationIndex ].psInstructionsNormal[ u8AnimationState ].au8LEDBrightness[ u8Index ];
+            i8Change = gsAnimation.psInstructionsNormal[ u8AnimationState ].au8LEDBrightness[ u8Index ];
             if( (I8)gau8LEDBrightness[ u8Index ] - i8Change < 0u )  // saturation downwards
             {
               gau8LEDBrightness[ u8Index + 1u ] += gau8LEDBrightness[ u8Index ];
@@ -515,7 +591,7 @@ void Animation_Cycle( void )
             SaturateBrightness( &gau8LEDBrightness[ u8Index ] );
             SaturateBrightness( &gau8LEDBrightness[ u8Index + 1u ] );  // saturate the next LED too
           }
-          i8Change = gasAnimations[ gsPersistentData.u8AnimationIndex ].psInstructionsNormal[ u8AnimationState ].au8LEDBrightness[ LEDS_NUM - 1u ];
+          i8Change = gsAnimation.psInstructionsNormal[ u8AnimationState ].au8LEDBrightness[ LEDS_NUM - 1u ];
           gau8LEDBrightness[ LEDS_NUM - 1u ] -= i8Change;
           SaturateBrightness( &gau8LEDBrightness[ LEDS_NUM - 1u ] );
         }
@@ -526,27 +602,27 @@ void Animation_Cycle( void )
           // Left side
           for( u8Index = 0u; u8Index < (RIGHT_LEDS_START - 1u); u8Index++ )
           {
-            i8Change = gasAnimations[ gsPersistentData.u8AnimationIndex ].psInstructionsNormal[ u8AnimationState ].au8LEDBrightness[ u8Index ];
+            i8Change = gsAnimation.psInstructionsNormal[ u8AnimationState ].au8LEDBrightness[ u8Index ];
             gau8LEDBrightness[ u8Index ] += i8Change;
             for( u8InnerIndex = u8Index; u8InnerIndex < (RIGHT_LEDS_START - 1u); u8InnerIndex++ )
             {
               gau8LEDBrightness[ u8InnerIndex + 1u ] += SaturateBrightness( &gau8LEDBrightness[ u8InnerIndex ] );
             }
           }
-          i8Change = gasAnimations[ gsPersistentData.u8AnimationIndex ].psInstructionsNormal[ u8AnimationState ].au8LEDBrightness[ RIGHT_LEDS_START - 1u ];
+          i8Change = gsAnimation.psInstructionsNormal[ u8AnimationState ].au8LEDBrightness[ RIGHT_LEDS_START - 1u ];
           gau8LEDBrightness[ RIGHT_LEDS_START - 1u ] += i8Change;
           SaturateBrightness( &gau8LEDBrightness[ RIGHT_LEDS_START - 1u ] );
           // Right side
           for( u8Index = LEDS_NUM - 1u; u8Index > RIGHT_LEDS_START; u8Index-- )
           {
-            i8Change = gasAnimations[ gsPersistentData.u8AnimationIndex ].psInstructionsNormal[ u8AnimationState ].au8LEDBrightness[ u8Index ];
+            i8Change = gsAnimation.psInstructionsNormal[ u8AnimationState ].au8LEDBrightness[ u8Index ];
             gau8LEDBrightness[ u8Index ] += i8Change;
             for( u8InnerIndex = LEDS_NUM - 1u; u8InnerIndex > RIGHT_LEDS_START; u8InnerIndex-- )
             {
               gau8LEDBrightness[ u8InnerIndex - 1u ] += SaturateBrightness( &gau8LEDBrightness[ u8InnerIndex ] );
             }
           }
-          i8Change = gasAnimations[ gsPersistentData.u8AnimationIndex ].psInstructionsNormal[ u8AnimationState ].au8LEDBrightness[ RIGHT_LEDS_START ];
+          i8Change = gsAnimation.psInstructionsNormal[ u8AnimationState ].au8LEDBrightness[ RIGHT_LEDS_START ];
           gau8LEDBrightness[ RIGHT_LEDS_START ] += i8Change;
           SaturateBrightness( &gau8LEDBrightness[ RIGHT_LEDS_START ] );
         }
@@ -556,27 +632,27 @@ void Animation_Cycle( void )
           // Left side
           for( u8Index = (RIGHT_LEDS_START - 1u); u8Index > 0u; u8Index-- )
           {
-            i8Change = gasAnimations[ gsPersistentData.u8AnimationIndex ].psInstructionsNormal[ u8AnimationState ].au8LEDBrightness[ u8Index ];
+            i8Change = gsAnimation.psInstructionsNormal[ u8AnimationState ].au8LEDBrightness[ u8Index ];
             gau8LEDBrightness[ u8Index ] += i8Change;
             for( u8InnerIndex = u8Index; u8InnerIndex > 0u; u8InnerIndex-- )
             {
               gau8LEDBrightness[ u8InnerIndex - 1u ] += SaturateBrightness( &gau8LEDBrightness[ u8InnerIndex ] );
             }
           }
-          i8Change = gasAnimations[ gsPersistentData.u8AnimationIndex ].psInstructionsNormal[ u8AnimationState ].au8LEDBrightness[ 0u ];
+          i8Change = gsAnimation.psInstructionsNormal[ u8AnimationState ].au8LEDBrightness[ 0u ];
           gau8LEDBrightness[ 0u ] += i8Change;
           SaturateBrightness( &gau8LEDBrightness[ 0u ] );
           // Right side
           for( u8Index = RIGHT_LEDS_START; u8Index < (LEDS_NUM - 1u); u8Index++ )
           {
-            i8Change = gasAnimations[ gsPersistentData.u8AnimationIndex ].psInstructionsNormal[ u8AnimationState ].au8LEDBrightness[ u8Index ];
+            i8Change = gsAnimation.psInstructionsNormal[ u8AnimationState ].au8LEDBrightness[ u8Index ];
             gau8LEDBrightness[ u8Index ] += i8Change;
             for( u8InnerIndex = RIGHT_LEDS_START; u8InnerIndex < (LEDS_NUM - 1u); u8InnerIndex++ )
             {
               gau8LEDBrightness[ u8InnerIndex + 1u ] += SaturateBrightness( &gau8LEDBrightness[ u8InnerIndex ] );
             }
           }
-          i8Change = gasAnimations[ gsPersistentData.u8AnimationIndex ].psInstructionsNormal[ u8AnimationState ].au8LEDBrightness[ LEDS_NUM - 1u ];
+          i8Change = gsAnimation.psInstructionsNormal[ u8AnimationState ].au8LEDBrightness[ LEDS_NUM - 1u ];
           gau8LEDBrightness[ LEDS_NUM - 1u ] += i8Change;
           SaturateBrightness( &gau8LEDBrightness[ LEDS_NUM - 1u ] );
         }
@@ -585,7 +661,7 @@ void Animation_Cycle( void )
         {
           for( u8Index = 0u; u8Index < LEDS_NUM; u8Index++ )
           {
-            u8Temp = gasAnimations[ gsPersistentData.u8AnimationIndex ].psInstructionsNormal[ u8AnimationState ].au8LEDBrightness[ u8Index ];
+            u8Temp = gsAnimation.psInstructionsNormal[ u8AnimationState ].au8LEDBrightness[ u8Index ];
             if( u8Temp != 0u )
             {
               gau8LEDBrightness[ u8Index ] /= u8Temp;
@@ -598,9 +674,9 @@ void Animation_Cycle( void )
           // If we're here the first time
           if( 0u == u8RepetitionCounter )
           {
-            u8RepetitionCounter = gasAnimations[ gsPersistentData.u8AnimationIndex ].psInstructionsNormal[ u8AnimationState ].u8AnimationOperand;
+            u8RepetitionCounter = gsAnimation.psInstructionsNormal[ u8AnimationState ].u8AnimationOperand;
             // Step back in time
-            gu16NormalTimer -= gasAnimations[ gsPersistentData.u8AnimationIndex ].psInstructionsNormal[ u8AnimationState ].u16TimingMs;
+            gu16NormalTimer -= gsAnimation.psInstructionsNormal[ u8AnimationState ].u16TimingMs;
           }
           else  // We're already repeating...
           {
@@ -608,7 +684,7 @@ void Animation_Cycle( void )
             if( 0u != u8RepetitionCounter )
             {
               // Step back in time
-              gu16NormalTimer -= gasAnimations[ gsPersistentData.u8AnimationIndex ].psInstructionsNormal[ u8AnimationState ].u16TimingMs;
+              gu16NormalTimer -= gsAnimation.psInstructionsNormal[ u8AnimationState ].u16TimingMs;
             }
             else  // No more repeating
             {
@@ -626,16 +702,16 @@ void Animation_Cycle( void )
     // --------------------------------------< For the RGB LED
     // Calculate the state of the animation
     u16StateTimer = 0u;
-    for( u8AnimationState = 0u; u8AnimationState < gasAnimations[ gsPersistentData.u8AnimationIndex ].u8AnimationLengthRGB; u8AnimationState++ )
+    for( u8AnimationState = 0u; u8AnimationState < gsAnimation.u8AnimationLengthRGB; u8AnimationState++ )
     {
-      u16StateTimer += gasAnimations[ gsPersistentData.u8AnimationIndex ].psInstructionsRGB[ u8AnimationState ].u16TimingMs;
+      u16StateTimer += gsAnimation.psInstructionsRGB[ u8AnimationState ].u16TimingMs;
       if( u16StateTimer > gu16RGBTimer )
       {
         break;
       }
     }
 /*
-    if( u8AnimationState >= gasAnimations[ gsPersistentData.u8AnimationIndex ].u8AnimationLengthRGB )
+    if( u8AnimationState >= gsAnimation.u8AnimationLengthRGB )
     {
       // restart animation
       u8AnimationState = 0u;
@@ -644,13 +720,21 @@ void Animation_Cycle( void )
       ENABLE_IT;
     }
 */
+    if( u8AnimationState < gsAnimation.u8AnimationLengthRGB )
+    {
+      u16StateTimer -= gu16RGBTimer;
+      if( u16StateTimer < gu16IdleGapMs )
+      {
+        gu16IdleGapMs = u16StateTimer;
+      }
+    }
     if( u8LastStateRGB != u8AnimationState )  // next instruction
     {
-      u8OpCode = gasAnimations[ gsPersistentData.u8AnimationIndex ].psInstructionsRGB[ u8AnimationState ].u8AnimationOpcode;
+      u8OpCode = gsAnimation.psInstructionsRGB[ u8AnimationState ].u8AnimationOpcode;
       // Just a load instruction, nothing more
       if( LOAD == u8OpCode )
       {
-        memcpy( gau8RGBLEDs, (void*)gasAnimations[ gsPersistentData.u8AnimationIndex ].psInstructionsRGB[ u8AnimationState ].au8RGBLEDBrightness, NUM_RGBLED_COLORS );
+        memcpy( (void*)gau8RGBLEDs, (void*)gsAnimation.psInstructionsRGB[ u8AnimationState ].au8RGBLEDBrightness, NUM_RGBLED_COLORS );
         u8LastStateRGB = u8AnimationState;
       }
       else  // Other opcodes -- IMPORTANT: the order of operations are fixed!
@@ -660,7 +744,7 @@ void Animation_Cycle( void )
         {
           for( u8Index = 0u; u8Index < NUM_RGBLED_COLORS; u8Index++ )
           {
-            gau8RGBLEDs[ u8Index ] += gasAnimations[ gsPersistentData.u8AnimationIndex ].psInstructionsRGB[ u8AnimationState ].au8RGBLEDBrightness[ u8Index ];
+            gau8RGBLEDs[ u8Index ] += gsAnimation.psInstructionsRGB[ u8AnimationState ].au8RGBLEDBrightness[ u8Index ];
             if( gau8RGBLEDs[ u8Index ] > 15u )  // overflow/underflow happened
             {
               gau8RGBLEDs[ u8Index ] = 0u;
@@ -701,7 +785,7 @@ void Animation_Cycle( void )
         {
           for( u8Index = 0u; u8Index < NUM_RGBLED_COLORS; u8Index++ )
           {
-            u8Temp = gasAnimations[ gsPersistentData.u8AnimationIndex ].psInstructionsRGB[ u8AnimationState ].au8RGBLEDBrightness[ u8Index ];
+            u8Temp = gsAnimation.psInstructionsRGB[ u8AnimationState ].au8RGBLEDBrightness[ u8Index ];
             if( u8Temp != 0u )
             {
               gau8RGBLEDs[ u8Index ] /= u8Temp;
@@ -714,9 +798,9 @@ void Animation_Cycle( void )
           // If we're here the first time
           if( 0u == u8RepetitionCounterRGB )
           {
-            u8RepetitionCounterRGB = gasAnimations[ gsPersistentData.u8AnimationIndex ].psInstructionsRGB[ u8AnimationState ].u8AnimationOperand;
+            u8RepetitionCounterRGB = gsAnimation.psInstructionsRGB[ u8AnimationState ].u8AnimationOperand;
             // Step back in time
-            gu16RGBTimer -= gasAnimations[ gsPersistentData.u8AnimationIndex ].psInstructionsRGB[ u8AnimationState ].u16TimingMs;
+            gu16RGBTimer -= gsAnimation.psInstructionsRGB[ u8AnimationState ].u16TimingMs;
           }
           else  // We're already repeating...
           {
@@ -724,7 +808,7 @@ void Animation_Cycle( void )
             if( 0u != u8RepetitionCounterRGB )
             {
               // Step back in time
-              gu16RGBTimer -= gasAnimations[ gsPersistentData.u8AnimationIndex ].psInstructionsRGB[ u8AnimationState ].u16TimingMs;
+              gu16RGBTimer -= gsAnimation.psInstructionsRGB[ u8AnimationState ].u16TimingMs;
             }
             else  // No more repeating
             {
@@ -738,33 +822,149 @@ void Animation_Cycle( void )
         }
       }
     }    
+    // Repeated instructions change the LEDs at every call
+    if( ( 0u != u8RepetitionCounter ) || ( 0u != u8RepetitionCounterRGB ) )
+    {
+      gu16IdleGapMs = 0u;
+    }
     // Store the timestamp
     gu16LastCall = u16TimeNow;
   }
+  
+  return gu16IdleGapMs;
 }
 
 //----------------------------------------------------------------------------
-//! \brief  Set the new animation
+//! \brief  Check if the current animation frame is completely dark
 //! \param  -
-//! \return -
+//! \return TRUE if all LEDs and all RGB LED colors are turned off
+//! \global gau8LEDBrightness[], gau8RGBLEDs[]
+//! \note   Used for scheduling CPU-stalling work when it can't be seen.
+//-----------------------------------------------------------------------------
+BOOL Animation_IsDark( void )
+{
+  BOOL bDark = TRUE;
+  U8   u8Index;
+  
+  for( u8Index = 0u; u8Index < LEDS_NUM; u8Index++ )
+  {
+    if( 0u != gau8LEDBrightness[ u8Index ] )
+    {
+      bDark = FALSE;
+    }
+  }
+  for( u8Index = 0u; u8Index < NUM_RGBLED_COLORS; u8Index++ )
+  {
+    if( 0u != gau8RGBLEDs[ u8Index ] )
+    {
+      bDark = FALSE;
+    }
+  }
+  return bDark;
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Gives the index of the current instruction of the normal LED animation
+//! \param  -
+//! \return Instruction index, 0xFF before the first one
+//! \global u8LastState
+//-----------------------------------------------------------------------------
+U8 Animation_GetInstruction( void )
+{
+  return u8LastState;
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Gives the index of the current instruction of the RGB LED animation
+//! \param  -
+//! \return Instruction index, 0xFF before the first one
+//! \global u8LastStateRGB
+//-----------------------------------------------------------------------------
+U8 Animation_GetInstructionRGB( void )
+{
+  return u8LastStateRGB;
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Checks if an EEPROM slot holds an animation
+//! \param  u8Slot: index of the slot
+//! \return TRUE if the animation of the slot can be played
 //! \global -
-//! \note   Should be called from main cycle only!
 //-----------------------------------------------------------------------------
-void Animation_Set( U8 u8AnimationIndex )
+BOOL Animation_IsSlotValid( U8 u8Slot )
 {
-  if( u8AnimationIndex < NUM_ANIMATIONS )
+  U8 au8Header[ ANIMATION_SLOT_HEADER_LENGTH ];
+
+  return ReadSlotHeader( u8Slot, au8Header );
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Gives the animation after the given one, for the button
+//! \param  u8AnimationIndex: index of the current animation
+//! \return Index of the next animation: the built-in ones, then the valid slots, then again
+//! \global -
+//! \note   The blackness is left out; after it the first animation comes.
+//-----------------------------------------------------------------------------
+U8 Animation_Next( U8 u8AnimationIndex )
+{
+  U8 u8Next = 0u;
+
+  if( ANIMATION_BLACKNESS != u8AnimationIndex )
   {
-    gsPersistentData.u8AnimationIndex = u8AnimationIndex;
-    DISABLE_IT;
+    u8Next = u8AnimationIndex;
+    do
+    {
+      u8Next++;
+      if( ANIMATION_BLACKNESS == u8Next )
+      {
+        u8Next = ANIMATION_FIRST_SLOT;
+      }
+      if( u8Next >= ( ANIMATION_FIRST_SLOT + ANIMATION_SLOTS_NUM ) )
+      {
+        u8Next = 0u;
+      }
+    } while( ( u8Next >= ANIMATION_FIRST_SLOT ) && ( FALSE == Animation_IsSlotValid( u8Next - ANIMATION_FIRST_SLOT ) ) );
+  }
+  return u8Next;
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Set the new animation
+//! \param  u8AnimationIndex: index of the animation; built-in ones first, then the slots
+//! \param  bPersist: TRUE: it's also the animation of the persistent data, played after the next
+//!                   power-up; FALSE: only played (e.g. the blackness before turning off)
+//! \return -
+//! \global gsPersistentData.u8AnimationIndex
+//! \note   Should be called from main cycle only! The animation is loaded again, even if it's the
+//!         same index, as the slot may have been rewritten. Missing slots fall back to the first one.
+//-----------------------------------------------------------------------------
+void Animation_Set( U8 u8AnimationIndex, BOOL bPersist )
+{
+  if( u8AnimationIndex < ( ANIMATION_FIRST_SLOT + ANIMATION_SLOTS_NUM ) )
+  {
+    if( TRUE == bPersist )
+    {
+      gsPersistentData.u8AnimationIndex = u8AnimationIndex;
+    }
+    gu8PlayedIndex = u8AnimationIndex;
+    gu8LoadedIndex = NO_ANIMATION;
     gu16NormalTimer = 0u;
     gu16RGBTimer = 0u;
-    ENABLE_IT;
     u8LastState = 0xFFu;
     u8RepetitionCounter = 0u;
     u8LastStateRGB = 0xFFu;
     u8RepetitionCounterRGB = 0u;
+    gu16IdleGapMs = 0u;
   }
 }
 
 
+/***************************************< Static assertions >**************************************/
+// Uploaded instructions are read in place, so their layout must match the structures
+#ifndef HOST_BUILD  // The host aligns and orders the bytes differently; it plays the built-in animations only
+STATIC_ASSERT( ( sizeof( S_ANIMATION_INSTRUCTION_NORMAL ) == ANIMATION_INSTRUCTION_NORMAL_LENGTH )
+            && ( sizeof( S_ANIMATION_INSTRUCTION_RGB ) == ANIMATION_INSTRUCTION_RGB_LENGTH ) );
+#endif
+
+
 /***************************************< End of file >**************************************/
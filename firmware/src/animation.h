@@ -12,13 +12,50 @@
 #define ANIMATION_H
 
 /***************************************< Includes >**************************************/
+#include "types.h"
+#include "iap.h"
 
 
 /***************************************< Definitions >**************************************/
-#define NUM_ANIMATIONS        (8u)  //!< Number of animations implemented
+#define NUM_ANIMATIONS        (8u)  //!< Number of built-in animations, including the blackness
+#define ANIMATION_BLACKNESS   ( NUM_ANIMATIONS - 1u )  //!< Index of the completely dark animation, shown before turning off
+#define ANIMATION_SLOTS_NUM   EEPROM_ANIMATION_PAGES  //!< Number of uploaded animations (slots) in the EEPROM
+#define ANIMATION_FIRST_SLOT  NUM_ANIMATIONS  //!< Animation index of the first slot
+
+// An uploaded animation takes a whole EEPROM page (slot):
+//   [ Header ] [ Normal LED instructions ] [ RGB LED instructions ]
+// The instructions are in the memory layout of Keil C51, so they are read with MOVC in place:
+//   [ Timing (U16, big-endian) ] [ Brightness array ] [ Opcode ] [ Operand ]
+#define ANIMATION_SLOT_MAGIC             (0x4Bu)  //!< First byte of a valid slot; programmed last
+#define ANIMATION_SLOT_FORMAT               (1u)  //!< Version of the slot format
+#define ANIMATION_SLOT_OFS_MAGIC            (0u)  //!< U8: ANIMATION_SLOT_MAGIC
+#define ANIMATION_SLOT_OFS_FORMAT           (1u)  //!< U8: ANIMATION_SLOT_FORMAT
+#define ANIMATION_SLOT_OFS_LENGTH_NORMAL    (2u)  //!< U8: number of normal LED instructions, at least 1
+#define ANIMATION_SLOT_OFS_LENGTH_RGB       (3u)  //!< U8: number of RGB LED instructions, at least 1
+#define ANIMATION_SLOT_OFS_CRC              (6u)  //!< U16: CRC-16F/3 of the previous bytes of the header (big-endian); bytes 4 and 5 are 0xFF
+#define ANIMATION_SLOT_HEADER_LENGTH        (8u)  //!< Length of the header
+#define ANIMATION_SLOT_IMAGE_MAX  ( EEPROM_PAGE_SIZE - ANIMATION_SLOT_HEADER_LENGTH )  //!< Space of the instructions
+#define ANIMATION_INSTRUCTION_NORMAL_LENGTH  (11u)  //!< Bytes of a normal LED instruction
+#define ANIMATION_INSTRUCTION_RGB_LENGTH      (8u)  //!< Bytes of an RGB LED instruction
+//! \brief IAP/MOVC address of a given slot
+#define ANIMATION_SLOT_ADDRESS(u8Slot)  EEPROM_PAGE_ADDRESS( EEPROM_ANIMATION_FIRST_PAGE + (u8Slot) )
 
 
 /***************************************< Types >**************************************/
+//! \brief Opcode bits used in animation virtual machine
+typedef enum
+{
+  LOAD      = 0x00u,  //!< Loads the LED brightness array to the PWM driver
+  ADD       = 0x01u,  //!< Adds the LED brightness array elements to the current brightness level; if overflows, it sets to zero
+  RSHIFT    = 0x02u,  //!< Shifts all the current LED brightness levels clockwise
+  LSHIFT    = 0x04u,  //!< Shifts all the current LED brightness levels anticlockwise
+//  UMOVE     = 0x04u,  //!< Moves some of the values upwards. Uses saturation logic. Doesn't roll over.
+//  DMOVE     = 0x08u,  //!< Moves some of the values downwards. Uses saturation logic. Doesn't roll over.
+  DIV       = 0x10u,  //!< Divides the the current LED brightness levels by the given number
+  USOURCE   = 0x20u,  //!< Add values to the brightness and if it overflows/underflows then it will be added to the upwards next value. If it overflows/underflows then it will do the same until it reaches the uppper or lower end.
+  DSOURCE   = 0x40u,  //!< Add values to the brightness and if it overflows/underflows then it will be added to the downwards next value. If it overflows/underflows then it will do the same until it reaches the uppper or lower end.
+  REPEAT    = 0x80u   //!< Do the instruction and repeat by (operand)-times
+} E_ANIMATION_OPCODE;
 
 
 /***************************************< Constants >**************************************/
@@ -29,8 +66,13 @@
 
 /***************************************< Public functions >**************************************/
 void Animation_Init( void );
-void Animation_Cycle( void );
-void Animation_Set( U8 u8AnimationIndex );
+U16 Animation_Cycle( void );
+void Animation_Set( U8 u8AnimationIndex, BOOL bPersist );
+BOOL Animation_IsDark( void );
+U8 Animation_GetInstruction( void );
+U8 Animation_GetInstructionRGB( void );
+BOOL Animation_IsSlotValid( U8 u8Slot );
+U8 Animation_Next( U8 u8AnimationIndex );
 
 
 #endif /* ANIMATION_H */
@@ -3,7 +3,7 @@
 *
 * \file batterylevel.c
 *
-* \brief Battery level indicator subprogram
+* \brief Battery level indicator subprogram, background battery monitor and ambient light sensor
 *
 * \author Hekk_Elek
 *
@@ -12,44 +12,391 @@
 /***************************************< Includes >**************************************/
 #include <string.h>  // For memset
 // Own includes
-#include "stc8g.h"
+#include "hal.h"
 #include "types.h"
 #include "led.h"
 #include "rgbled.h"
 #include "util.h"
+#include "animation.h"
+#include "persist.h"
 #include "batterylevel.h"
 
 
 /***************************************< Definitions >**************************************/
+#define STARTUP_STEP_MS     (150u)  //!< Time between lighting up the LEDs one by one at startup
+#define SETTLE_TIME_MS      (200u)  //!< Time to let the battery voltage settle under load before measuring
+#define DISPLAY_TIME_MS    (2000u)  //!< Time the charge level is shown, so the user can read it
+
+// Background monitoring
+#define SAMPLE_PERIOD_MS   (2000u)  //!< Time between two battery measurements while the animation runs
+#define ADC_POWERUP_MS        (2u)  //!< Time for the ADC to power up before the first conversion
+#define OVERSAMPLING_SHIFT    (3u)  //!< log2 of the number of conversions averaged in one measurement
+#define OVERSAMPLING          ( 1u << OVERSAMPLING_SHIFT )  //!< Number of conversions averaged in one measurement
+
+// Voltage conversion
+// NOTE: the ADC measures the 1.19V reference against the battery, so a higher ADC value means a lower voltage:
+//       BatteryVoltage = 1.19V * 1024 / ADC value
+//       All the conversions are done by the compiler into CODE tables, no division is done at runtime.
+#define VOLTAGE_CODE( u16Voltage10mV )  ( (U16)( 121856UL / (u16Voltage10mV) ) )  //!< Highest ADC value of a voltage (in 10 mV)
+#define VOLTAGE_MIN_10MV    (200u)  //!< Lowest voltage in the voltage table: 2.00V
+#define VOLTAGE_MAX_10MV    (330u)  //!< Highest voltage in the voltage table: 3.30V
+#define VOLTAGE_TABLE_SIZE  ( VOLTAGE_MAX_10MV - VOLTAGE_MIN_10MV + 1u )  //!< One entry per 10 mV
+//! \brief Voltage table entry: highest ADC value of the voltage, relative to the one of the highest voltage
+#define VOLTAGE_ENTRY( u16Voltage10mV )     (U8)( VOLTAGE_CODE( u16Voltage10mV ) - VOLTAGE_CODE( VOLTAGE_MAX_10MV ) )
+//! \brief 10 consecutive voltage table entries
+#define VOLTAGE_ENTRIES_10( u16Voltage10mV ) \
+  VOLTAGE_ENTRY( (u16Voltage10mV) + 0u ), VOLTAGE_ENTRY( (u16Voltage10mV) + 1u ), VOLTAGE_ENTRY( (u16Voltage10mV) + 2u ), \
+  VOLTAGE_ENTRY( (u16Voltage10mV) + 3u ), VOLTAGE_ENTRY( (u16Voltage10mV) + 4u ), VOLTAGE_ENTRY( (u16Voltage10mV) + 5u ), \
+  VOLTAGE_ENTRY( (u16Voltage10mV) + 6u ), VOLTAGE_ENTRY( (u16Voltage10mV) + 7u ), VOLTAGE_ENTRY( (u16Voltage10mV) + 8u ), \
+  VOLTAGE_ENTRY( (u16Voltage10mV) + 9u )
+#define CHARGE_LEVELS_NUM     (7u)  //!< Number of charge levels above "depleted"
+//! \brief Highest ADC value of a charge level: ( ( 42650 / ADC value ) - 70 ) / 4 >= level
+#define CHARGE_LEVEL_CODE( u8Level )    ( (U16)( 42650u / ( 70u + ( 4u * (u8Level) ) ) ) )
+
+// Brightness governor
+#define GOVERNOR_STEPS        (5u)  //!< Number of drive strengths
+#define GOVERNOR_HYSTERESIS   (4u)  //!< ADC units the voltage must recover above a threshold to step back
+#define GOVERNOR_LED_DIVIDER_MIN  (3u)  //!< Soft-PWM divider of the strongest drive
+#define GOVERNOR_RGB_CYCLE_MIN   (10u)  //!< RGB pulse cycle of the strongest drive
+#define LOW_VOLTAGE_LEVEL   ( VOLTAGE_CODE( 200u ) + 1u )  //!< Below 2.0V the LEDs can be barely seen, the battery is depleted
+#define LOW_VOLTAGE_COUNT     (3u)  //!< Consecutive low measurements needed to report a depleted battery
+
+// Ambient light
+// NOTE: the ADC measures the floating cathode of LED2 against the supply; the photocurrent pulls it down
+//       from the supply (ADC_FULL_SCALE) during LIGHT_DISCHARGE_MS, so the drop is the light level.
+#if ( AMBIENT_LIGHT_ENABLED == 1 )
+#define LIGHT_DIM_STEPS       (2u)  //!< Drive strengths below the softest one of the governor, used in the dark
+#else
+#define LIGHT_DIM_STEPS       (0u)  //!< Drive strengths below the softest one of the governor, used in the dark
+#endif
+#define LIGHT_DISCHARGE_MS    (8u)  //!< Time the photocurrent discharges the sensor LED; the ADC powers up meanwhile
+#define ADC_FULL_SCALE     (1023u)  //!< ADC value of the supply voltage
+#define LIGHT_HYSTERESIS      (8u)  //!< ADC units the light must fall below a threshold to dim one more step
+#define DRIVE_STEPS  ( LIGHT_DIM_STEPS + GOVERNOR_STEPS )  //!< Number of entries of the drive strength tables
 
 
 /***************************************< Types >**************************************/
 
 
 /***************************************< Constants >**************************************/
+//! \brief Voltage table: ADC values belonging to VOLTAGE_MIN_10MV..VOLTAGE_MAX_10MV (decreasing)
+static CODE const U8 gcau8VoltageTable[ VOLTAGE_TABLE_SIZE ] =
+{
+  VOLTAGE_ENTRIES_10( 200u ), VOLTAGE_ENTRIES_10( 210u ), VOLTAGE_ENTRIES_10( 220u ), VOLTAGE_ENTRIES_10( 230u ),
+  VOLTAGE_ENTRIES_10( 240u ), VOLTAGE_ENTRIES_10( 250u ), VOLTAGE_ENTRIES_10( 260u ), VOLTAGE_ENTRIES_10( 270u ),
+  VOLTAGE_ENTRIES_10( 280u ), VOLTAGE_ENTRIES_10( 290u ), VOLTAGE_ENTRIES_10( 300u ), VOLTAGE_ENTRIES_10( 310u ),
+  VOLTAGE_ENTRIES_10( 320u ), VOLTAGE_ENTRY( 330u )
+};
+//! \brief Highest ADC values of the charge levels 1..7 (decreasing)
+static CODE const U16 gcau16ChargeLevelTable[ CHARGE_LEVELS_NUM ] =
+{
+  CHARGE_LEVEL_CODE( 1u ), CHARGE_LEVEL_CODE( 2u ), CHARGE_LEVEL_CODE( 3u ), CHARGE_LEVEL_CODE( 4u ),
+  CHARGE_LEVEL_CODE( 5u ), CHARGE_LEVEL_CODE( 6u ), CHARGE_LEVEL_CODE( 7u )
+};
+//! \brief ADC values where the governor steps to a stronger drive: 2.9V, 2.75V, 2.6V and 2.4V
+static CODE const U16 gcau16GovernorThresholds[ GOVERNOR_STEPS - 1u ] =
+{
+  VOLTAGE_CODE( 290u ) + 1u, VOLTAGE_CODE( 275u ) + 1u, VOLTAGE_CODE( 260u ) + 1u, VOLTAGE_CODE( 240u ) + 1u
+};
+//! \brief Interrupts per soft-PWM step of the normal LEDs in each drive strength (nominal at 2.6..2.75V)
+//! \note  The first LIGHT_DIM_STEPS entries are only used in the dark: the PWM is still above 60 Hz.
+static CODE const U8 gcau8GovernorLEDDivider[ DRIVE_STEPS ] =
+{
+#if ( AMBIENT_LIGHT_ENABLED == 1 )
+  9u, 8u,
+#endif
+  7u, 6u, LED_DRIVE_DIVIDER, 4u, GOVERNOR_LED_DIVIDER_MIN
+};
+//! \brief Pulse cycle length of the RGB LED in each drive strength, the same relative gain as for the normal LEDs
+static CODE const U8 gcau8GovernorRGBCycle[ DRIVE_STEPS ] =
+{
+#if ( AMBIENT_LIGHT_ENABLED == 1 )
+  28u, 25u,
+#endif
+  22u, 19u, RGBLED_COLOR_LEVELS, 13u, GOVERNOR_RGB_CYCLE_MIN
+};
+#if ( AMBIENT_LIGHT_ENABLED == 1 )
+//! \brief Light levels (drop of the sensor LED, ADC units) below which the LEDs are driven one more step softer
+static CODE const U16 gcau16LightThresholds[ LIGHT_DIM_STEPS ] = { 96u, 24u };
+#endif
 
 
 /***************************************< Global variables >**************************************/
+//! \brief State machine of the battery level indicator
+static enum
+{
+  BATTERYLEVEL_IDLE,       //!< Not started yet
+  BATTERYLEVEL_STARTUP,    //!< LEDs are lit up one by one
+  BATTERYLEVEL_SETTLING,   //!< All LEDs are lit, waiting for the battery voltage to settle
+  BATTERYLEVEL_MEASURING,  //!< ADC conversion in progress
+  BATTERYLEVEL_DISPLAY,    //!< Charge level is shown
+  BATTERYLEVEL_MONITOR,    //!< Gauge finished, waiting for the next background measurement
+  BATTERYLEVEL_POWERUP,    //!< ADC is powering up for a background measurement
+  BATTERYLEVEL_SAMPLING,   //!< Background measurement in progress
+  BATTERYLEVEL_DISCHARGE,  //!< The photocurrent discharges the floating sensor LED, the ADC is powering up
+  BATTERYLEVEL_LIGHT       //!< Ambient light measurement in progress
+} geBatteryLevelState;
+
+static U8  gu8LitLEDs;              //!< Number of LEDs lit as a gauge
+static U16 gu16FilteredLevel;       //!< Low-pass filtered battery measurement (ADC value)
+static U8  gu8GovernorStep;         //!< Current drive strength, index of the governor tables
+static U8  gu8LowVoltageCount;      //!< Number of consecutive measurements below LOW_VOLTAGE_LEVEL
+#if ( AMBIENT_LIGHT_ENABLED == 1 )
+static U16 gu16FilteredLight;       //!< Low-pass filtered ambient light level (drop of the sensor LED, ADC units)
+static U8  gu8LightDim;             //!< Drive strengths taken off for dim surroundings: 0..LIGHT_DIM_STEPS
+#endif
+static volatile U16  gu16SampleSum;      //!< Sum of the conversions of the current measurement
+static volatile U8   gu8SamplesLeft;     //!< Conversions still to be done in the current measurement
+static volatile BOOL gbConversionDone;   //!< Set by the ADC interrupt when all the conversions are done
 
 
 /***************************************< Static function definitions >**************************************/
-void Delay( U16 u16DelayMs );
+static void ShowGauge( void );
+static U8 CalculateChargeLevel( U16 u16MeasuredLevel );
+static U16 CalculateVoltage( U16 u16MeasuredLevel );
+static void StartMeasurement( void );
+static U16 FinishMeasurement( void );
+static void UpdateGovernor( U16 u16MeasuredLevel );
+static void ApplyDrive( void );
+#if ( AMBIENT_LIGHT_ENABLED == 1 )
+static void UpdateLight( U16 u16MeasuredLevel );
+#endif
 
 
 /***************************************< Private functions >**************************************/
 //----------------------------------------------------------------------------
-//! \brief  Waits for the given number of milliseconds
-//! \param  u16DelayMs: wait time
+//! \brief  Lights the first gu8LitLEDs LEDs at full brightness, turns off the others
+//! \param  -
 //! \return -
+//! \global gu8LitLEDs, gau8LEDBrightness
+//-----------------------------------------------------------------------------
+static void ShowGauge( void )
+{
+  U8 u8Index;
+
+  for( u8Index = 0u; u8Index < LEDS_NUM; u8Index++ )
+  {
+    if( u8Index < gu8LitLEDs )
+    {
+      gau8LEDBrightness[ u8Index ] = 15u;
+    }
+    else
+    {
+      gau8LEDBrightness[ u8Index ] = 0u;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Calculates the charge level from the ADC result
+//! \param  u16MeasuredLevel: ADC result of the internal 1.19V reference
+//! \return Charge level (0..7)
 //! \global -
-//! \note   Should be called from init block
+//! \note   Looks up gcau16ChargeLevelTable, at most 7 comparisons.
+//-----------------------------------------------------------------------------
+static U8 CalculateChargeLevel( U16 u16MeasuredLevel )
+{
+  U8 u8ChargeLevel = 0u;
+
+  // Charge level formula:
+  // As CR2032 batteries quickly drop to 2.8V under load, we assume that 2.8V means full charge
+  // And since at 2.0V our LEDs can be barely seen, at 2.0V we assume that our battery is completely depleted
+  // As we have 7 LED levels, we divide this range to 7 levels
+  // A floating-point based implementation would be: u8ChargeLevel = round( 7.0f*( f32BatteryVoltage - 2.0f )/0.8f );
+  // After simplification, the formula for charge level would be: u8ChargeLevel = round( ( 10662.4f / u16MeasuredLevel ) - 17.5f )
+  // Its fixed-point version, ( ( 42650u / u16MeasuredLevel ) - 70u )>>2u, is evaluated by the compiler for each level
+  while( ( u8ChargeLevel < CHARGE_LEVELS_NUM ) && ( u16MeasuredLevel <= gcau16ChargeLevelTable[ u8ChargeLevel ] ) )
+  {
+    u8ChargeLevel++;
+  }
+
+  return u8ChargeLevel;
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Converts an ADC result to battery voltage
+//! \param  u16MeasuredLevel: ADC result of the internal 1.19V reference
+//! \return Battery voltage in 10 mV units, VOLTAGE_MIN_10MV-1 if it's lower than VOLTAGE_MIN_10MV
+//! \global -
+//! \note   Binary search in gcau8VoltageTable, 8 comparisons.
+//-----------------------------------------------------------------------------
+static U16 CalculateVoltage( U16 u16MeasuredLevel )
+{
+  U8 u8Low = 0u;
+  U8 u8High = VOLTAGE_TABLE_SIZE;
+  U8 u8Middle;
+  U8 u8Entry;
+
+  if( u16MeasuredLevel < VOLTAGE_CODE( VOLTAGE_MAX_10MV ) )
+  {
+    u8Low = VOLTAGE_TABLE_SIZE;  // Clamp to the highest voltage
+  }
+  else if( u16MeasuredLevel <= VOLTAGE_CODE( VOLTAGE_MIN_10MV ) )
+  {
+    u8Entry = (U8)( u16MeasuredLevel - VOLTAGE_CODE( VOLTAGE_MAX_10MV ) );
+    // Count the voltages reached by the measurement: they are at the beginning of the table
+    while( u8Low < u8High )
+    {
+      u8Middle = ( u8Low + u8High ) >> 1u;
+      if( u8Entry <= gcau8VoltageTable[ u8Middle ] )
+      {
+        u8Low = u8Middle + 1u;
+      }
+      else
+      {
+        u8High = u8Middle;
+      }
+    }
+  }
+  else
+  {
+    // Below the lowest voltage, u8Low stays 0
+  }
+
+  return ( VOLTAGE_MIN_10MV - 1u + u8Low );
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Starts an oversampled measurement of the battery voltage
+//! \param  -
+//! \return -
+//! \global gu16SampleSum, gu8SamplesLeft, gbConversionDone
+//! \note   The ADC must be powered up. The ADC interrupt chains the conversions.
+//-----------------------------------------------------------------------------
+static void StartMeasurement( void )
+{
+  gbConversionDone = FALSE;
+  gu16SampleSum = 0u;
+  gu8SamplesLeft = OVERSAMPLING;
+  HAL_ADC_ACK();    // Clear completion flag
+  EADC = 1;         // Enable ADC interrupt
+  HAL_ADC_START();  // Start conversion
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Powers down the ADC and returns the average of the finished measurement
+//! \param  -
+//! \return Averaged ADC value
+//! \global gu16SampleSum
+//! \note   Should be called only if gbConversionDone is set.
+//-----------------------------------------------------------------------------
+static U16 FinishMeasurement( void )
+{
+  EADC = 0;
+  // Disable ADC to save power
+  HAL_ADC_POWER_DOWN();
+  return ( gu16SampleSum >> OVERSAMPLING_SHIFT );
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Filters the measurement and sets the drive strength of the LEDs accordingly
+//! \param  u16MeasuredLevel: averaged ADC value
+//! \return -
+//! \global gu16FilteredLevel, gu8GovernorStep, gu8LowVoltageCount
+//! \note   As the battery sags, the LEDs are driven harder to keep their brightness steady.
+//!         While the battery is fresh, they are driven softer to save charge.
+//-----------------------------------------------------------------------------
+static void UpdateGovernor( U16 u16MeasuredLevel )
+{
+  U8 u8Step = 0u;
+
+  // First order low-pass filter: 3/4 of the old value, 1/4 of the new one
+  gu16FilteredLevel = ( ( gu16FilteredLevel << 1u ) + gu16FilteredLevel + u16MeasuredLevel ) >> 2u;
+
+  // Depleted battery detection
+  if( gu16FilteredLevel >= LOW_VOLTAGE_LEVEL )
+  {
+    if( gu8LowVoltageCount < LOW_VOLTAGE_COUNT )
+    {
+      gu8LowVoltageCount++;
+    }
+  }
+  else
+  {
+    gu8LowVoltageCount = 0u;
+  }
+
+  // Look up the drive strength for the filtered voltage
+  while( ( u8Step < ( GOVERNOR_STEPS - 1u ) ) && ( gu16FilteredLevel >= gcau16GovernorThresholds[ u8Step ] ) )
+  {
+    u8Step++;
+  }
+  if( u8Step > gu8GovernorStep )  // Voltage dropped: drive harder right away
+  {
+    gu8GovernorStep = u8Step;
+  }
+  else if( ( u8Step < gu8GovernorStep )
+        && ( ( gu16FilteredLevel + GOVERNOR_HYSTERESIS ) < gcau16GovernorThresholds[ gu8GovernorStep - 1u ] ) )
+  {
+    // Voltage recovered clearly (e.g. after a bright animation): drive one step softer
+    gu8GovernorStep--;
+  }
+  else
+  {
+    // Keep the current drive strength
+  }
+
+  ApplyDrive();
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Sets the drive strength of the LEDs from the governor step and the ambient light
+//! \param  -
+//! \return -
+//! \global gu8GovernorStep, gu8LightDim, gu8LEDDriveDivider, gu8RGBLEDCycleLength
 //-----------------------------------------------------------------------------
-void Delay( U16 u16DelayMs )
+static void ApplyDrive( void )
 {
-  U16 u16DelayEnd = Util_GetTimerMs() + u16DelayMs;
-  while( Util_GetTimerMs() < u16DelayEnd );
+#if ( AMBIENT_LIGHT_ENABLED == 1 )
+  U8 u8Drive = ( LIGHT_DIM_STEPS - gu8LightDim ) + gu8GovernorStep;
+#else
+  U8 u8Drive = gu8GovernorStep;
+#endif
+
+  // Single byte writes, the interrupt routines always see a consistent value
+  gu8LEDDriveDivider = gcau8GovernorLEDDivider[ u8Drive ];
+  gu8RGBLEDCycleLength = gcau8GovernorRGBCycle[ u8Drive ];
 }
 
+#if ( AMBIENT_LIGHT_ENABLED == 1 )
+//----------------------------------------------------------------------------
+//! \brief  Filters the ambient light measurement and dims the LEDs in dim surroundings
+//! \param  u16MeasuredLevel: averaged ADC value of the sensor LED
+//! \return -
+//! \global gu16FilteredLight, gu8LightDim
+//! \note   More light means full drive right away (e.g. stepping outside); less light dims by one step
+//!         per measurement, and only below the threshold by LIGHT_HYSTERESIS.
+//-----------------------------------------------------------------------------
+static void UpdateLight( U16 u16MeasuredLevel )
+{
+  U8 u8Dim = 0u;
+
+  // First order low-pass filter of the drop below the supply: 3/4 of the old value, 1/4 of the new one
+  gu16FilteredLight = ( ( gu16FilteredLight << 1u ) + gu16FilteredLight + ( ADC_FULL_SCALE - u16MeasuredLevel ) ) >> 2u;
+
+  while( ( u8Dim < LIGHT_DIM_STEPS ) && ( gu16FilteredLight < gcau16LightThresholds[ u8Dim ] ) )
+  {
+    u8Dim++;
+  }
+  if( u8Dim < gu8LightDim )  // Brighter: full drive right away
+  {
+    gu8LightDim = u8Dim;
+  }
+  else if( ( u8Dim > gu8LightDim )
+        && ( ( gu16FilteredLight + LIGHT_HYSTERESIS ) < gcau16LightThresholds[ gu8LightDim ] ) )
+  {
+    // Clearly darker: one step softer
+    gu8LightDim++;
+  }
+  else
+  {
+    // Keep the current dimming
+  }
+
+  ApplyDrive();
+}
+#endif
+
 
 /***************************************< Public functions >**************************************/
 //----------------------------------------------------------------------------
@@ -61,76 +408,251 @@ void Delay( U16 u16DelayMs )
 //-----------------------------------------------------------------------------
 void BatteryLevel_Init( void )
 {
-  ADCTIM = 0x3Fu;      // 32 clock sampling time, 2 clocks channel selection hold time
-  ADCCFG = 0x2Fu;      // Right-aligned results registers, slowest conversion
-  ADC_CONTR = 0x80u;   // Enable ADC
-  ADC_CONTR |= 0x0Fu;  // Select internal 1.19V reference
+  // 32 clock sampling time, 2 clocks channel selection hold time; right-aligned results registers, slowest conversion
+  HAL_ADC_SETUP( 0x3Fu, 0x2Fu );
+  HAL_ADC_POWER_UP( HAL_ADC_VREF_CHANNEL );  // Enable ADC, select internal 1.19V reference
+  geBatteryLevelState = BATTERYLEVEL_IDLE;
+  gbConversionDone = FALSE;
+  gu8GovernorStep = 2u;  // Nominal drive strength until the first measurement
+  gu16FilteredLevel = 0u;
+  gu8LowVoltageCount = 0u;
+#if ( AMBIENT_LIGHT_ENABLED == 1 )
+  gu16FilteredLight = ADC_FULL_SCALE;  // Bright until measured: the filter settles in about half a minute
+  gu8LightDim = 0u;
+#endif
 }
 
 //----------------------------------------------------------------------------
-//! \brief  Shows battery level on LEDs as a gauge
+//! \brief  Starts showing the battery level on LEDs as a gauge
 //! \param  -
 //! \return -
-//! \global -
-//! \note   Should be called only once! Blocking function! Deinitializes ADC.
+//! \global geBatteryLevelState, gu8LitLEDs
+//! \note   Should be called only once! Non-blocking, BatteryLevel_Task() does the work.
 //-----------------------------------------------------------------------------
 void BatteryLevel_Show( void )
 {
-  U16 u16MeasuredLevel;
-  U8  u8ChargeLevel;
-  U8  u8Index;
-  
+#if ( BATTERYLEVEL_FAST_BOOT == 0 )
   // Startup animation
   // After it, all LED brightness will be set to maximum, to ensure a significant current draw during measurement
   memset( gau8RGBLEDs, 15, sizeof( gau8RGBLEDs ) );
-  memset( gau8LEDBrightness, 0, sizeof( gau8LEDBrightness ) );
-  for( u8Index = 0u; u8Index < LEDS_NUM; u8Index++ )
+  gu8LitLEDs = 1u;
+  Util_TimerStart( UTIL_TIMER_BATTERYLEVEL, STARTUP_STEP_MS, STARTUP_STEP_MS );
+  geBatteryLevelState = BATTERYLEVEL_STARTUP;
+#else
+  // The RGB LED is left to the animation, all LEDs are lit at once for the current draw
+  gu8LitLEDs = LEDS_NUM;
+  Util_TimerStart( UTIL_TIMER_BATTERYLEVEL, SETTLE_TIME_MS, 0u );
+  geBatteryLevelState = BATTERYLEVEL_SETTLING;
+#endif
+  ShowGauge();
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Advances the battery level indicator
+//! \param  -
+//! \return -
+//! \global geBatteryLevelState, gu8LitLEDs
+//! \note   Should be called from main cycle, after Animation_Cycle(). Deinitializes ADC when the
+//!         measurement is done.
+//-----------------------------------------------------------------------------
+void BatteryLevel_Task( void )
+{
+  switch( geBatteryLevelState )
   {
-    gau8LEDBrightness[ u8Index ] = 15u;
-    Delay( 150u );
+    case BATTERYLEVEL_STARTUP:    // LEDs are lit up one by one
+      if( Util_TimerExpired( UTIL_TIMER_BATTERYLEVEL ) )
+      {
+        if( gu8LitLEDs < LEDS_NUM )
+        {
+          gu8LitLEDs++;
+        }
+        else
+        {
+          Util_TimerStart( UTIL_TIMER_BATTERYLEVEL, SETTLE_TIME_MS, 0u );
+          geBatteryLevelState = BATTERYLEVEL_SETTLING;
+        }
+      }
+      break;
+
+    case BATTERYLEVEL_SETTLING:   // All LEDs are lit, waiting for the battery voltage to settle
+      if( Util_TimerExpired( UTIL_TIMER_BATTERYLEVEL ) )
+      {
+        // Measure battery voltage
+        StartMeasurement();
+        geBatteryLevelState = BATTERYLEVEL_MEASURING;
+      }
+      break;
+
+    case BATTERYLEVEL_MEASURING:  // ADC conversion in progress
+      if( gbConversionDone )
+      {
+        // The gauge measurement also starts the filter of the background monitoring
+        gu16FilteredLevel = FinishMeasurement();
+        UpdateGovernor( gu16FilteredLevel );
+        // Display the charge level on the LEDs
+        gu8LitLEDs = CalculateChargeLevel( gu16FilteredLevel ) + 1u;
+#if ( BATTERYLEVEL_FAST_BOOT == 0 )
+        memset( gau8RGBLEDs, 0, sizeof( gau8RGBLEDs ) );
+#endif
+        Util_TimerStart( UTIL_TIMER_BATTERYLEVEL, DISPLAY_TIME_MS, 0u );
+        geBatteryLevelState = BATTERYLEVEL_DISPLAY;
+      }
+      break;
+
+    case BATTERYLEVEL_DISPLAY:    // Charge level is shown
+      // Wait, so the user can read the battery charge level
+      if( Util_TimerExpired( UTIL_TIMER_BATTERYLEVEL ) )
+      {
+        Util_TimerStart( UTIL_TIMER_BATTERYLEVEL, SAMPLE_PERIOD_MS, 0u );
+        geBatteryLevelState = BATTERYLEVEL_MONITOR;
+        // Hand the LEDs over to the animation from its beginning
+        Animation_Set( gsPersistentData.u8AnimationIndex, FALSE );
+      }
+      break;
+
+    case BATTERYLEVEL_MONITOR:    // Waiting for the next background measurement
+      if( Util_TimerExpired( UTIL_TIMER_BATTERYLEVEL ) )
+      {
+        HAL_ADC_POWER_UP( HAL_ADC_VREF_CHANNEL );  // Power up the ADC
+        Util_TimerStart( UTIL_TIMER_BATTERYLEVEL, ADC_POWERUP_MS, 0u );
+        geBatteryLevelState = BATTERYLEVEL_POWERUP;
+      }
+      break;
+
+    case BATTERYLEVEL_POWERUP:    // ADC is powering up
+      if( Util_TimerExpired( UTIL_TIMER_BATTERYLEVEL ) )
+      {
+        StartMeasurement();
+        geBatteryLevelState = BATTERYLEVEL_SAMPLING;
+      }
+      break;
+
+    case BATTERYLEVEL_SAMPLING:   // Background measurement in progress
+      if( gbConversionDone )
+      {
+        UpdateGovernor( FinishMeasurement() );
+#if ( AMBIENT_LIGHT_ENABLED == 1 )
+        // Ambient light: LED2 is dark and floating for a few milliseconds, the ADC is powered up on its pin
+        LED_SenseStart();
+        HAL_ADC_POWER_UP( LED_SENSE_ADC_CHANNEL );
+        Util_TimerStart( UTIL_TIMER_BATTERYLEVEL, LIGHT_DISCHARGE_MS, 0u );
+        geBatteryLevelState = BATTERYLEVEL_DISCHARGE;
+#else
+        Util_TimerStart( UTIL_TIMER_BATTERYLEVEL, SAMPLE_PERIOD_MS, 0u );
+        geBatteryLevelState = BATTERYLEVEL_MONITOR;
+#endif
+      }
+      break;
+
+#if ( AMBIENT_LIGHT_ENABLED == 1 )
+    case BATTERYLEVEL_DISCHARGE:  // The photocurrent discharges the sensor LED
+      if( Util_TimerExpired( UTIL_TIMER_BATTERYLEVEL ) )
+      {
+        StartMeasurement();
+        geBatteryLevelState = BATTERYLEVEL_LIGHT;
+      }
+      break;
+
+    case BATTERYLEVEL_LIGHT:      // Ambient light measurement in progress
+      if( gbConversionDone )
+      {
+        UpdateLight( FinishMeasurement() );
+        LED_SenseEnd();
+        Util_TimerStart( UTIL_TIMER_BATTERYLEVEL, SAMPLE_PERIOD_MS, 0u );
+        geBatteryLevelState = BATTERYLEVEL_MONITOR;
+      }
+      break;
+#endif
+
+    default:  // BATTERYLEVEL_IDLE
+      break;
   }
-  Delay( 200u );
-  // Measure battery voltage
-  ADC_CONTR |= 0x40u;  // Start conversion
-  _nop_();
-  _nop_();
-  while( !( ADC_CONTR & 0x20u ) );  // Wait for completion flag
-  u16MeasuredLevel = ADC_RES<<8u | ADC_RESL;
-  // Disable ADC to save power
-  ADC_CONTR = 0x00u;
-  // Calculate battery voltage
-  // The voltage can be calculated using this formula: BatteryVoltage = 1.19/( u16MeasuredLevel / ADC_MAX_VALUE )
-  // So the floating-point implementation would be: f32BatteryVoltage = 1.19f/( (float)u16MeasuredLevel/1024.0f );
-  // But since floating point calculations are expensive in terms of program memory(!), here we use fixed-point arithmetic...
-  // Charge level formula:
-  // As CR2032 batteries quickly drop to 2.8V under load, we assume that 2.8V means full charge
-  // And since at 2.0V our LEDs can be barely seen, at 2.0V we assume that our battery is completely depleted
-  // As we have 7 LED levels, we divide this range to 7 levels
-  // A floating-point based implementation would be: u8ChargeLevel = round( 7.0f*( f32BatteryVoltage - 2.0f )/0.8f );
-  // After simplification, the formula for charge level would be: u8ChargeLevel = round( ( 10662.4f / u16MeasuredLevel ) - 17.5f )
-  if( u16MeasuredLevel >= 610u )  // If the voltage is below 2.0V
+
+  // The gauge is redrawn every time, as the animation may run in parallel
+  if( TRUE == BatteryLevel_Busy() )
   {
-    u8ChargeLevel = 0u;
+    ShowGauge();
   }
-  else
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Tells whether the battery level is being shown
+//! \param  -
+//! \return TRUE, if the gauge owns the LEDs
+//! \global geBatteryLevelState
+//-----------------------------------------------------------------------------
+BOOL BatteryLevel_Busy( void )
+{
+  return ( ( BATTERYLEVEL_IDLE != geBatteryLevelState ) && ( geBatteryLevelState <= BATTERYLEVEL_DISPLAY ) );
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Gives the raw battery measurement
+//! \param  -
+//! \return Filtered ADC value of the internal reference (the lower, the higher the battery voltage), 0 before the first measurement
+//! \global gu16FilteredLevel
+//-----------------------------------------------------------------------------
+U16 BatteryLevel_GetADC( void )
+{
+  return gu16FilteredLevel;
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Gives the battery voltage measured in the background
+//! \param  -
+//! \return Filtered battery voltage in 10 mV units (199 means below 2.00V), 0 before the first measurement
+//! \global gu16FilteredLevel
+//-----------------------------------------------------------------------------
+U16 BatteryLevel_GetVoltage( void )
+{
+  U16 u16Voltage = 0u;
+
+  if( 0u != gu16FilteredLevel )
   {
-    u8ChargeLevel = ( ( 42650u / u16MeasuredLevel ) - 70u )>>2u;
+    u16Voltage = CalculateVoltage( gu16FilteredLevel );
   }
-  // Display the charge level on the LEDs
-  for( u8Index = 0u; u8Index < LEDS_NUM; u8Index++ )
+
+  return u16Voltage;
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Tells whether the battery is depleted
+//! \param  -
+//! \return TRUE, if the filtered battery voltage has been below 2.0V for several measurements
+//! \global gu8LowVoltageCount
+//-----------------------------------------------------------------------------
+BOOL BatteryLevel_IsLow( void )
+{
+  return ( gu8LowVoltageCount >= LOW_VOLTAGE_COUNT );
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Accumulates the result of the ADC conversion and starts the next one
+//! \param  -
+//! \return -
+//! \global gu16SampleSum, gu8SamplesLeft, gbConversionDone
+//! \note   Should be called from the ADC interrupt routine.
+//-----------------------------------------------------------------------------
+void BatteryLevel_Interrupt( void )
+{
+  HAL_ADC_ACK();  // Clear completion flag
+  gu16SampleSum += HAL_ADC_RESULT();
+  gu8SamplesLeft--;
+  if( 0u != gu8SamplesLeft )
   {
-    if( u8ChargeLevel >= u8Index )
-    {
-      gau8LEDBrightness[ u8Index ] = 15u;
-    }
-    else
-    {
-      gau8LEDBrightness[ u8Index ] = 0u;
-    }
+    HAL_ADC_START();  // Start next conversion
+  }
+  else
+  {
+    gbConversionDone = TRUE;
   }
-  memset( gau8RGBLEDs, 0, sizeof( gau8RGBLEDs ) );
-  // Wait, so the user can read the battery charge level
-  Delay( 2000u );
 }
 
+
+/***************************************< Static assertions >**************************************/
+// The staggered LEDs and RGB colors must fit in the shortest soft-PWM step and pulse cycle
+STATIC_ASSERT( ( LED_PHASES_NUM <= GOVERNOR_LED_DIVIDER_MIN )
+            && ( RGBLED_PHASE( NUM_RGBLED_COLORS - 1u ) < GOVERNOR_RGB_CYCLE_MIN ) );
+
+
 /***************************************< End of file >**************************************/
@@ -12,6 +12,8 @@
 #define BATTERYLEVEL_H
 
 /***************************************< Includes >**************************************/
+#include "types.h"
+#include "config.h"
 
 /***************************************< Definitions >**************************************/
 
@@ -24,6 +26,12 @@
 /***************************************< Public functions >**************************************/
 void BatteryLevel_Init( void );
 void BatteryLevel_Show( void );
+void BatteryLevel_Task( void );
+BOOL BatteryLevel_Busy( void );
+BOOL BatteryLevel_IsLow( void );
+U16 BatteryLevel_GetVoltage( void );
+U16 BatteryLevel_GetADC( void );
+void BatteryLevel_Interrupt( void );
 
 
 #endif /* BATTERYLEVEL_H */
@@ -0,0 +1,257 @@
+/*! *******************************************************************************************************
+* Copyright (c) 2022 Hekk_Elek
+*
+* \file button.c
+*
+* \brief Interrupt-driven pushbutton driver
+*
+* \author Hekk_Elek
+*
+**********************************************************************************************************/
+
+/*----------------------------------------------------------------------------------------
+How it works
+============
+The button is on P3.6, which is also the INT2 pin. INT2 is triggered by falling edges, i.e.
+by presses (and the bounces). The interrupt routine puts the time of each edge to a small
+queue. While the button is not touched, the main cycle only checks that the queue is empty,
+so the MCU may sleep as deep as it wants. After a press, the debouncing state machine reads
+the pin only when the UTIL_TIMER_BUTTON software timer expires, so the MCU may also sleep
+until that deadline while bouncing. Only a debounced press needs polling, as the release
+has no interrupt. A slow main cycle delays an event, but never loses it.
+----------------------------------------------------------------------------------------*/
+
+/***************************************< Includes >**************************************/
+// Own includes
+#include "hal.h"
+#include "types.h"
+#include "util.h"
+#include "button.h"
+
+
+/***************************************< Definitions >**************************************/
+#define BUTTON_PIN            (P36)  //!< Button for selecting animation and turning it off and on
+#define EDGE_QUEUE_SIZE         (4u)  //!< Size of the edge queue, must be a power of 2
+#define INTCLKO_EX2          (0x10u)  //!< INT2 interrupt enable bit
+#define AUXINTIF_INT2IF      (0x10u)  //!< INT2 interrupt flag
+#define POWERUP_RELEASE_MS    (100u)  //!< The button must be released this long at power up
+
+
+/***************************************< Types >**************************************/
+
+
+/***************************************< Constants >**************************************/
+
+
+/***************************************< Global variables >**************************************/
+//! \brief State machine for button debouncing
+static enum
+{
+  BUTTON_UNPRESSED,  //!< The button is not pressed
+  BUTTON_BOUNCING,   //!< The button just got pressed and it's currently bouncing
+  BUTTON_PRESSED,    //!< The button got debounced
+  BUTTON_LONGPRESS,  //!< The button has been pressed for long
+  BUTTON_RELEASING   //!< The button just got released and it's currently bouncing
+} geButtonState;
+
+static U16 gu16PressTime;       //!< Time of the edge that started the current press (ms)
+static BIT gbLongPress;         //!< The current press has already been reported as long
+
+static volatile U16 gau16EdgeTimes[ EDGE_QUEUE_SIZE ];  //!< Times of the falling edges (ms)
+static volatile U8  gu8EdgeWrite;  //!< Queue write index, incremented by the interrupt only
+static volatile U8  gu8EdgeRead;   //!< Queue read index, incremented by the main cycle only
+
+
+/***************************************< Static function definitions >**************************************/
+
+
+/***************************************< Private functions >**************************************/
+
+
+/***************************************< Public functions >**************************************/
+//----------------------------------------------------------------------------
+//! \brief  Initializes the button pin and its interrupt
+//! \param  -
+//! \return -
+//! \global All globals in this module
+//! \note   Should be called from init block
+//-----------------------------------------------------------------------------
+void Button_Init( void )
+{
+  // Pushbutton @ P3.6 --> bidirectional with pullup
+  // NOTE: this might not the best in terms of power consumption, but the input mode with pullup was not enough
+  HAL_PINS_BIDIRECTIONAL( 3, 1u<<6u );
+  HAL_PINS_PULLUP( 3, 1u<<6u );
+
+  geButtonState = BUTTON_UNPRESSED;
+  gu16PressTime = 0u;
+  gbLongPress = FALSE;
+  gu8EdgeWrite = 0u;
+  gu8EdgeRead = 0u;
+
+  // INT2 is always enabled: it reports presses, and wakes up from power-down
+  AUXINTIF &= ~AUXINTIF_INT2IF;
+  INTCLKO |= INTCLKO_EX2;
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Waits until the button is released
+//! \param  -
+//! \return -
+//! \global gu8EdgeRead
+//! \note   Blocking! Should be called at power up, to avoid changing animation on power on.
+//-----------------------------------------------------------------------------
+void Button_WaitForRelease( void )
+{
+  // Already expired, unless the button is pressed
+  Util_TimerSetDeadline( UTIL_TIMER_BUTTON, Util_TakeTimeSnapshot(), 0u );
+  do
+  {
+    (void)Util_TakeTimeSnapshot();
+    if( 0 == BUTTON_PIN )  // Pressed (or bouncing): restart waiting
+    {
+      Util_TimerStart( UTIL_TIMER_BUTTON, POWERUP_RELEASE_MS, 0u );
+    }
+  } while( FALSE == Util_TimerExpired( UTIL_TIMER_BUTTON ) );
+  // Forget the edges of this press
+  gu8EdgeRead = gu8EdgeWrite;
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Debounces the button and detects short and long presses
+//! \param  -
+//! \return Button event (E_BUTTON_EVENT)
+//! \global All globals in this module
+//! \note   Should be called from main cycle.
+//-----------------------------------------------------------------------------
+E_BUTTON_EVENT Button_Task( void )
+{
+  E_BUTTON_EVENT eEvent = BUTTON_EVENT_NONE;
+  BOOL bEdge = FALSE;
+  U16  u16EdgeTime = 0u;
+
+  // Take the oldest edge; later ones are bounces or presses that come too early
+  while( gu8EdgeRead != gu8EdgeWrite )
+  {
+    if( FALSE == bEdge )
+    {
+      u16EdgeTime = gau16EdgeTimes[ gu8EdgeRead ];
+      bEdge = TRUE;
+    }
+    gu8EdgeRead = ( gu8EdgeRead + 1u ) & ( EDGE_QUEUE_SIZE - 1u );
+  }
+
+  switch( geButtonState )
+  {
+    case BUTTON_BOUNCING:   // The button just got pressed and it's currently bouncing
+      if( TRUE == Util_TimerExpired( UTIL_TIMER_BUTTON ) )  // the debounce time is over
+      {
+        if( 0 == BUTTON_PIN )  // if the button is still pressed
+        {
+          // Long press is measured from the edge
+          Util_TimerSetDeadline( UTIL_TIMER_BUTTON, gu16PressTime + BUTTON_LONGPRESS_MS, 0u );
+          geButtonState = BUTTON_PRESSED;
+        }
+        else  // not pressed anymore
+        {
+          geButtonState = BUTTON_UNPRESSED;
+        }
+      }
+      break;
+
+    case BUTTON_PRESSED:    // The button got debounced
+      if( 1 == BUTTON_PIN )  // just got released
+      {
+        Util_TimerStart( UTIL_TIMER_BUTTON, BUTTON_DEBOUNCE_MS, 0u );
+        geButtonState = BUTTON_RELEASING;
+        eEvent = BUTTON_EVENT_SHORT;
+      }
+      else if( TRUE == Util_TimerExpired( UTIL_TIMER_BUTTON ) )  // the long press time is over
+      {
+        geButtonState = BUTTON_LONGPRESS;
+        gbLongPress = TRUE;
+        eEvent = BUTTON_EVENT_LONG;
+      }
+      break;
+
+    case BUTTON_LONGPRESS:  // The button has been pressed for long
+      if( 1 == BUTTON_PIN )  // just got released
+      {
+        Util_TimerStart( UTIL_TIMER_BUTTON, BUTTON_DEBOUNCE_MS, 0u );
+        geButtonState = BUTTON_RELEASING;
+      }
+      break;
+
+    case BUTTON_RELEASING:  // The button just got released and it's currently bouncing
+      if( TRUE == Util_TimerExpired( UTIL_TIMER_BUTTON ) )  // the debounce time is over
+      {
+        if( 1 == BUTTON_PIN )  // if the button is released
+        {
+          geButtonState = BUTTON_UNPRESSED;
+          if( TRUE == gbLongPress )
+          {
+            gbLongPress = FALSE;
+            eEvent = BUTTON_EVENT_LONG_RELEASED;
+          }
+        }
+        else  // still pushed
+        {
+          Util_TimerStart( UTIL_TIMER_BUTTON, BUTTON_DEBOUNCE_MS, 0u );
+        }
+      }
+      break;
+
+    default:  // BUTTON_UNPRESSED -- The button is not pressed
+      if( TRUE == bEdge )  // the button has just got pressed
+      {
+        gu16PressTime = u16EdgeTime;
+        Util_TimerSetDeadline( UTIL_TIMER_BUTTON, u16EdgeTime + BUTTON_DEBOUNCE_MS, 0u );
+        geButtonState = BUTTON_BOUNCING;
+      }
+      break;
+  }
+
+  return eEvent;
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Tells whether the button needs the main cycle
+//! \param  -
+//! \return TRUE, if no edge is waiting and the pin doesn't have to be polled (only the button timer is running)
+//! \global geButtonState, gu8EdgeRead, gu8EdgeWrite
+//! \note   An edge whose interrupt is not served yet (e.g. interrupts masked) counts as waiting.
+//-----------------------------------------------------------------------------
+BOOL Button_Idle( void )
+{
+  return ( ( BUTTON_PRESSED != geButtonState ) && ( BUTTON_LONGPRESS != geButtonState )
+        && ( gu8EdgeRead == gu8EdgeWrite ) && ( 0u == ( AUXINTIF & AUXINTIF_INT2IF ) ) );
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Stores the time of a falling edge on the button pin
+//! \param  -
+//! \return -
+//! \global gau16EdgeTimes, gu8EdgeWrite, gu16TimerMS
+//! \note   Should be called from the INT2 interrupt routine. The timer is read inline: the
+//!         locals of Util_GetTimerMs() are overlaid, it can't be called from here and main too.
+//-----------------------------------------------------------------------------
+void Button_Interrupt( void )
+{
+  U16 u16Time;
+  U8  u8Next = ( gu8EdgeWrite + 1u ) & ( EDGE_QUEUE_SIZE - 1u );
+
+  // The timer interrupt has higher priority: read again if it changed the bytes in between
+  do
+  {
+    u16Time = gu16TimerMS;
+  } while( u16Time != gu16TimerMS );
+
+  if( u8Next != gu8EdgeRead )  // If the queue is full, the edge is dropped
+  {
+    gau16EdgeTimes[ gu8EdgeWrite ] = u16Time;
+    gu8EdgeWrite = u8Next;
+  }
+}
+
+
+/***************************************< End of file >**************************************/
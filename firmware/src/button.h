@@ -0,0 +1,50 @@
+/*! *******************************************************************************************************
+* Copyright (c) 2022 Hekk_Elek
+*
+* \file button.h
+*
+* \brief Interrupt-driven pushbutton driver
+*
+* \author Hekk_Elek
+*
+**********************************************************************************************************/
+#ifndef BUTTON_H
+#define BUTTON_H
+
+/***************************************< Includes >**************************************/
+#include "types.h"
+
+
+/***************************************< Definitions >**************************************/
+#define BUTTON_DEBOUNCE_MS      (50u)  //!< Debounce time of presses and releases
+#define BUTTON_LONGPRESS_MS   (2000u)  //!< A press longer than this is a long press
+
+
+/***************************************< Types >**************************************/
+//! \brief Debounced button events
+typedef enum
+{
+  BUTTON_EVENT_NONE,          //!< Nothing happened
+  BUTTON_EVENT_SHORT,         //!< The button was released before BUTTON_LONGPRESS_MS
+  BUTTON_EVENT_LONG,          //!< The button has been held for BUTTON_LONGPRESS_MS
+  BUTTON_EVENT_LONG_RELEASED  //!< The button was released after a long press
+} E_BUTTON_EVENT;
+
+
+/***************************************< Constants >**************************************/
+
+
+/***************************************< Global variables >**************************************/
+
+
+/***************************************< Public functions >**************************************/
+void Button_Init( void );
+void Button_WaitForRelease( void );
+E_BUTTON_EVENT Button_Task( void );
+BOOL Button_Idle( void );
+void Button_Interrupt( void );
+
+
+#endif /* BUTTON_H */
+
+/***************************************< End of file >**************************************/
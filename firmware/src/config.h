@@ -0,0 +1,84 @@
+/*! *******************************************************************************************************
+* Copyright (c) 2022 Hekk_Elek
+*
+* \file config.h
+*
+* \brief Compile-time configuration of the firmware
+*
+* \author Hekk_Elek
+*
+**********************************************************************************************************/
+#ifndef CONFIG_H
+#define CONFIG_H
+
+// NOTE: Only preprocessor definitions here, this file is included by assembly sources too!
+
+/***************************************< Definitions >**************************************/
+// System clock
+#ifndef SYSTEM_CLOCK_HZ
+#define SYSTEM_CLOCK_HZ    (24000000UL)  //!< Frequency of the internal RC oscillator, as set by the ISP tool
+#endif
+#define SYSTEM_CLOCK_MHZ   ( SYSTEM_CLOCK_HZ / 1000000UL )  //!< System clock in MHz, rounded down to integers
+
+// Clock governor
+#ifndef CLOCK_SHIFT_LOW
+#define CLOCK_SHIFT_LOW    (2u)  //!< Clock divided by 2^CLOCK_SHIFT_LOW while only LED PWM runs; 0 disables scaling
+#endif
+#define CLOCK_SHIFT_MAX    (3u)  //!< Highest supported clock divider: 2^3
+
+// CRC-16F/3 implementations
+#define CRC16_TABLE256        (0)  //!< C, 256-entry table: one lookup per byte, 512 bytes of table
+#define CRC16_NIBBLE          (1)  //!< C, 16-entry table: two lookups per byte, 32 bytes of table
+#define CRC16_ASM             (2)  //!< Hand-written assembly loop on the 256-entry table (crc16.A51)
+
+// The C implementations are not measured yet ("make crc-bench"), see util.c
+#ifndef CRC16_IMPLEMENTATION
+#define CRC16_IMPLEMENTATION  CRC16_TABLE256  //!< Selected CRC-16F/3 implementation
+#endif
+
+// Timer 0 interrupt (both handlers are measured side by side by "make isr-fast")
+// The flattened handler stays off until an SDCC build has shown it's faster (vector 1 min/avg/max)
+#ifndef TIMER0_ISR_FAST
+#define TIMER0_ISR_FAST  (0)  //!< 1: flattened handlers on register bank 1; 0: calls to the module handlers
+#endif
+
+// Runtime instrumentation (profile.c)
+#ifndef PROFILE_ENABLED
+#define PROFILE_ENABLED  (0)  //!< 1: measures the timer 0 interrupt, the main cycle and the stack; uses timer 1
+#endif
+
+// UART telemetry (telemetry.c)
+#ifndef TELEMETRY_ENABLED
+#define TELEMETRY_ENABLED  (0)  //!< 1: streams telemetry frames on the ISP UART (P3.1); uses timer 2
+#endif
+
+// Animation upload into the EEPROM (upload.c)
+#ifndef ANIMATION_UPLOAD_ENABLED
+#define ANIMATION_UPLOAD_ENABLED  (0)  //!< 1: animations can be uploaded on the ISP UART (P3.0); needs TELEMETRY_ENABLED
+#endif
+#if ( ANIMATION_UPLOAD_ENABLED == 1 ) && ( TELEMETRY_ENABLED != 1 )
+#error "ANIMATION_UPLOAD_ENABLED needs the UART set up by TELEMETRY_ENABLED"
+#endif
+
+// Peak current limiter (led.h, rgbled.h)
+#ifndef LED_MAX_ON
+#define LED_MAX_ON  (3u)  //!< Normal LEDs lit in the same tick, the others in the next ticks of the PWM step; 7: no limit
+#endif
+#ifndef RGBLED_PHASE_STEP
+#define RGBLED_PHASE_STEP  (2u)  //!< Shift between the pulse windows of the RGB colors (ticks); 0: all start together
+#endif
+
+// Battery level indicator at power up
+#ifndef BATTERYLEVEL_FAST_BOOT
+#define BATTERYLEVEL_FAST_BOOT  (0)  //!< 1: the gauge is shown while the animation starts on the RGB LED
+#endif
+
+// Ambient light sensing (batterylevel.c)
+#ifndef AMBIENT_LIGHT_ENABLED
+#define AMBIENT_LIGHT_ENABLED  (1)  //!< 1: LED2 measures the ambient light after each battery measurement, the LEDs are driven softer in the dark
+#endif
+
+
+#endif /* CONFIG_H */
+
+/***************************************< End of file >**************************************/
@@ -0,0 +1,228 @@
+/*! *******************************************************************************************************
+* Copyright (c) 2022 Hekk_Elek
+*
+* \file hal.h
+*
+* \brief Hardware abstraction: register access macros of the STC8G, the STC8H and the host simulation
+*
+* \author Hekk_Elek
+*
+**********************************************************************************************************/
+#ifndef HAL_H
+#define HAL_H
+
+/*----------------------------------------------------------------------------------------
+How it works
+============
+The modules touch the peripherals only through these macros. Each one expands to exactly
+the register accesses that used to be written out in the modules, so nothing is called on
+the 8051. The only intended difference is the extended SFR window that the pull-up and ADC
+setup now open (Button_Init(), BatteryLevel_Init()). "make compare" builds the firmware
+before and after this header and prints the memory and the timer 0 interrupt cycles of both.
+
+The backend is selected at compile time:
+- MCU_STC8G (platform.h): the STC8G1K08 of the board.
+- MCU_STC8H (platform.h): the STC8H1K08 has the same registers for everything below, and
+  adds the PWMA/PWMB timers (HAL_HARDWARE_PWM); led.c and rgbled.c drive some LEDs with them.
+- HOST_BUILD: the registers are the C++ objects of tools/host, which simulate the side effects
+  (IAP, ADC). The extended SFRs are plain memory there, and the busy-waits are left out.
+
+The pins themselves are named by the drivers (led.h, rgbled.h); a pin is an sbit on the
+targets and a HostSbit on the host, so assigning it works on every backend.
+----------------------------------------------------------------------------------------*/
+
+/***************************************< Includes >**************************************/
+#include "stc8g.h"  // Registers of the selected target, see MCU_TYPE in platform.h
+#include "types.h"
+
+
+/***************************************< Definitions >**************************************/
+#if ( MCU_TYPE == MCU_STC8H ) && !defined( HOST_BUILD )
+#define HAL_HARDWARE_PWM  (1)  //!< 1: the PWMA/PWMB timers are available
+#else
+#define HAL_HARDWARE_PWM  (0)  //!< 1: the PWMA/PWMB timers are available
+#endif
+
+// IAP commands, written to IAP_CMD
+#define HAL_IAP_READ           (0x01u)  //!< Read one byte into IAP_DATA
+#define HAL_IAP_PROGRAM        (0x02u)  //!< Program one byte from IAP_DATA
+#define HAL_IAP_ERASE          (0x03u)  //!< Erase the page of the address
+
+#define HAL_ADC_VREF_CHANNEL   (0x0Fu)  //!< ADC channel of the internal 1.19V reference
+
+// EEPROM read in place: the EEPROM follows the program in the code space, so MOVC reads it
+#ifdef HOST_BUILD
+#define HAL_EEPROM_POINTER( u16Address )  ( &gau8HostEeprom[ (u16Address) & ( HOST_EEPROM_SIZE - 1u ) ] )  // The simulated EEPROM
+#else
+#define HAL_EEPROM_POINTER( u16Address )  ( (const U8 CODE*)(u16Address) )  //!< Readable pointer to an IAP/MOVC address
+#endif
+
+#if ( HAL_HARDWARE_PWM == 1 )
+// Hardware PWM register values
+#define HAL_PWM_MODE1          (0x68u)  //!< PWMx_CCMRn: active while the counter is below the compare value, OCxPE preload
+#define HAL_PWM_MODE2          (0x78u)  //!< PWMx_CCMRn: active from the compare value to the end of the period, OCxPE preload
+#define HAL_PWM_MOE            (0x80u)  //!< PWMx_BKR: main output enable
+#define HAL_PWM_RUN            (0x81u)  //!< PWMx_CR1: ARPE (the period changes at the end of a period), CEN
+#endif
+
+
+/***************************************< Macros >**************************************/
+// Port pin modes (PxM0, PxM1); u8Port is the number of the port
+//! \brief Sets the pins of a port in the mask to push-pull output
+#define HAL_PINS_PUSHPULL( u8Port, u8Mask ) \
+  do \
+  { \
+    P##u8Port##M0 |= (U8)(u8Mask); \
+    P##u8Port##M1 &= (U8)~(u8Mask); \
+  } while( 0 )
+
+//! \brief Sets the pins of a port in the mask to bidirectional (quasi-bidirectional, weak pull-up)
+#define HAL_PINS_BIDIRECTIONAL( u8Port, u8Mask ) \
+  do \
+  { \
+    P##u8Port##M0 &= (U8)~(u8Mask); \
+    P##u8Port##M1 &= (U8)~(u8Mask); \
+  } while( 0 )
+
+//! \brief Sets the pins of a port in the mask to high-impedance input (needed by the ADC)
+#define HAL_PINS_INPUT( u8Port, u8Mask ) \
+  do \
+  { \
+    P##u8Port##M0 &= (U8)~(u8Mask); \
+    P##u8Port##M1 |= (U8)(u8Mask); \
+  } while( 0 )
+
+//! \brief Connects the internal 4 kOhm pull-up resistors of the pins of a port in the mask
+#define HAL_PINS_PULLUP( u8Port, u8Mask ) \
+  do \
+  { \
+    HAL_XSFR_BEGIN(); \
+    P##u8Port##PU |= (U8)(u8Mask); \
+    HAL_XSFR_END(); \
+  } while( 0 )
+
+// Extended SFRs (0xFE00..0xFEFF of XDATA): they can be reached only while P_SW2.EAXFR is set
+#ifdef HOST_BUILD
+#define HAL_XSFR_BEGIN()                // The host has no XDATA bus to switch
+#define HAL_XSFR_END()
+#else
+#define HAL_XSFR_BEGIN()  P_SW2 |= 0x80u         //!< Enables the access to the extended SFRs
+#define HAL_XSFR_END()    P_SW2 &= (U8)~0x80u    //!< Maps the XDATA back to the RAM
+#endif
+
+//! \brief Divides the system clock (1, 2, 4, ...)
+#define HAL_CLOCK_DIVIDER( u8Divider ) \
+  do \
+  { \
+    HAL_XSFR_BEGIN(); \
+    CLKDIV = (U8)(u8Divider); \
+    HAL_XSFR_END(); \
+  } while( 0 )
+
+// Timer 0
+//! \brief Sets timer 0 to a 1T, 16-bit auto-reload timer; it must be stopped
+#define HAL_TIMER0_MODE() \
+  do \
+  { \
+    AUXR |= 0x80u;  /* 1T mode */ \
+    TMOD &= 0xF0u;  /* Mode 0: 16-bit auto-reload */ \
+  } while( 0 )
+
+//! \brief Sets the reload value; while the timer runs, it's used from the next overflow
+#define HAL_TIMER0_RELOAD( u16Reload ) \
+  do \
+  { \
+    TL0 = (U8)(u16Reload); \
+    TH0 = (U8)( (u16Reload) >> 8u ); \
+  } while( 0 )
+
+#define HAL_TIMER0_START()  TR0 = 1  //!< Starts timer 0
+#define HAL_TIMER0_STOP()   TR0 = 0  //!< Stops timer 0
+#define HAL_TIMER0_ACK()    TF0 = 0  //!< Clears the overflow flag of timer 0
+
+// EEPROM through the IAP registers
+//! \brief Enables the IAP and sets up the command for the current system clock
+#define HAL_IAP_OPEN( u8Command ) \
+  do \
+  { \
+    IAP_CONTR = 0x80u;  /* EEPROM is enabled */ \
+    IAP_TPS = CURRENT_CLOCK_MHZ;  /* Needs util.h */ \
+    IAP_CMD = (u8Command); \
+  } while( 0 )
+
+//! \brief Sets the EEPROM address of the command; only the lower 12 bits are used
+#define HAL_IAP_ADDRESS( u16Address ) \
+  do \
+  { \
+    IAP_ADDRL = (U8)(u16Address); \
+    IAP_ADDRH = (U8)( ( (u16Address) >> 8u ) & 0x0Fu ); \
+  } while( 0 )
+
+//! \brief Runs the command with the magic sequence; the CPU is stalled until it's done
+#define HAL_IAP_TRIGGER() \
+  do \
+  { \
+    IAP_TRIG = 0x5Au; \
+    IAP_TRIG = 0xA5u; \
+    NOP(); \
+    NOP(); \
+  } while( 0 )
+
+#define HAL_IAP_DATA  IAP_DATA  //!< Data register of the read and program commands
+
+//! \brief Clears the flags and the command, disables the IAP
+#define HAL_IAP_CLOSE() \
+  do \
+  { \
+    IAP_CONTR = 0x00u; \
+    IAP_CMD   = 0u; \
+    IAP_TRIG  = 0u; \
+  } while( 0 )
+
+// ADC
+//! \brief Sets the timing of the ADC: ADCTIM (sampling and hold time) and ADCCFG (result format, speed)
+#define HAL_ADC_SETUP( u8Timing, u8Config ) \
+  do \
+  { \
+    HAL_XSFR_BEGIN(); \
+    ADCTIM = (u8Timing); \
+    HAL_XSFR_END(); \
+    ADCCFG = (u8Config); \
+  } while( 0 )
+
+#define HAL_ADC_POWER_UP( u8Channel )  ADC_CONTR = (U8)( 0x80u | (u8Channel) )  //!< Powers the ADC, selects the channel
+#define HAL_ADC_POWER_DOWN()  ADC_CONTR = 0x00u         //!< Powers down the ADC
+#define HAL_ADC_POWERED()     ( 0u != ( ADC_CONTR & 0x80u ) )  //!< TRUE while the ADC is powered
+#define HAL_ADC_START()       ADC_CONTR |= 0x40u        //!< Starts a conversion
+#define HAL_ADC_ACK()         ADC_CONTR &= (U8)~0x20u   //!< Clears the completion flag
+#define HAL_ADC_RESULT()      ( (U16)ADC_RES << 8u | ADC_RESL )  //!< Right-aligned result of the last conversion
+
+// Power modes
+#define HAL_IDLE()            PCON |= 0x01u             //!< Idle until the next interrupt
+#define HAL_POWER_DOWN()      PCON |= 0x02u             //!< Power-down until a wake-up source
+#define HAL_SOFTWARE_RESET()  IAP_CONTR |= 0x20u        //!< Restarts from the user program
+
+// Busy-wait
+#ifdef HOST_BUILD
+#define HAL_DELAY_LOOP( u8Counter )  ( (void)(u8Counter) )  // Time isn't spent on the host, see tools/host/isr_model.h
+#else
+//! \brief Counts an 8-bit variable down to 0, 3 cycles per iteration (DJNZ)
+#define HAL_DELAY_LOOP( u8Counter )  while( --(u8Counter) )
+#endif
+
+
+/***************************************< Types >**************************************/
+
+
+/***************************************< Constants >**************************************/
+
+
+/***************************************< Global variables >**************************************/
+
+
+/***************************************< Public functions >**************************************/
+
+
+#endif /* HAL_H */
+
+/***************************************< End of file >**************************************/
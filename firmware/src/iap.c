@@ -0,0 +1,128 @@
+/*! *******************************************************************************************************
+* Copyright (c) 2021-2022 Hekk_Elek
+*
+* \file iap.c
+*
+* \brief EEPROM access through the IAP registers
+*
+* \author Hekk_Elek
+*
+**********************************************************************************************************/
+
+/*----------------------------------------------------------------------------------------
+How it works
+============
+The EEPROM is a part of the flash, so programming and erasing stall the CPU. The IAP
+registers take 12-bit addresses, relative to the start of the EEPROM; the upper bits of the
+addresses given to these functions are discarded, so EEPROM_BASEADDRESS based addresses can
+be used. The same addresses can be read with MOVC as well, which is faster, but works only
+on the target.
+
+A page erase stalls the CPU for milliseconds with the interrupts disabled, so the timer 0
+ticks of that time are lost. The ms timer is advanced by IAP_ERASE_MS afterwards, the same
+way as after a power-down. The erase time isn't measured, only the typical one is added:
+the ms timer can still fall behind by up to 2 ms per erase on a slow page (6 ms in the
+datasheet), and the soft-PWM and the RGB pulses stand still during the erase.
+
+The EEPROM is shared by several modules; its partitions are defined in iap.h.
+----------------------------------------------------------------------------------------*/
+
+/***************************************< Includes >**************************************/
+// Own includes
+#include "types.h"
+#include "util.h"
+#include "hal.h"
+#include "iap.h"
+
+
+/***************************************< Definitions >**************************************/
+
+
+/***************************************< Types >**************************************/
+
+
+/***************************************< Constants >**************************************/
+
+
+/***************************************< Global variables >**************************************/
+
+
+/***************************************< Static function definitions >**************************************/
+
+
+/***************************************< Private functions >**************************************/
+
+
+/***************************************< Public functions >**************************************/
+//----------------------------------------------------------------------------
+//! \brief  Programs one byte of the EEPROM
+//! \param  u16Address: Address to be written. Only lower 12 bits are used.
+//! \param  u8Data: byte to be written
+//! \return -
+//! \global -
+//! \note   Stalls the CPU for a single byte program only, interrupts are disabled just for that.
+//-----------------------------------------------------------------------------
+void IAP_WriteByte( U16 u16Address, U8 u8Data )
+{
+  DISABLE_IT;
+  
+  HAL_IAP_OPEN( HAL_IAP_PROGRAM );
+  HAL_IAP_ADDRESS( u16Address );
+  HAL_IAP_DATA = u8Data;
+  HAL_IAP_TRIGGER();
+  HAL_IAP_CLOSE();
+
+  ENABLE_IT;
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Erases one page in EEPROM
+//! \param  u16Address: Address of page, the lower 9 bits are discarded
+//! \return -
+//! \global Global timer (ms)
+//! \note   Stalls the CPU for IAP_ERASE_MS, the ms timer is advanced by it.
+//-----------------------------------------------------------------------------
+void IAP_Erase( U16 u16Address )
+{
+  DISABLE_IT;
+  
+  HAL_IAP_OPEN( HAL_IAP_ERASE );
+  HAL_IAP_ADDRESS( u16Address );  // NOTE: lower 9 bits are automatically discarded
+  HAL_IAP_TRIGGER();
+  HAL_IAP_CLOSE();
+  Util_AdvanceTimerMs( IAP_ERASE_MS );  // Timer 0 ticks were lost meanwhile
+  
+  ENABLE_IT;
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Reads given number of bytes from EEPROM
+//! \param  u16Address: Start address to be read. Only lower 12 bits are used.
+//! \param  pu8Data: data read from EEPROM are written here
+//! \param  u8DataLength: read length
+//! \return -
+//! \global -
+//! \note   Stalls the CPU.
+//-----------------------------------------------------------------------------
+void IAP_Read( U16 u16Address, U8* pu8Data, U8 u8DataLength )
+{
+  U8 u8Index;
+
+  DISABLE_IT;
+  
+  HAL_IAP_OPEN( HAL_IAP_READ );
+  for( u8Index = 0u; u8Index < u8DataLength; u8Index++ )
+  {
+    HAL_IAP_ADDRESS( u16Address );
+    HAL_IAP_TRIGGER();
+    // Output
+    pu8Data[ u8Index ] = HAL_IAP_DATA;
+    u16Address++;
+  }
+  HAL_IAP_CLOSE();
+
+  ENABLE_IT;
+}
+
+
+/***************************************< End of file >**************************************/
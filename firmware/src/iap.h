@@ -0,0 +1,52 @@
+/*! *******************************************************************************************************
+* Copyright (c) 2022 Hekk_Elek
+*
+* \file iap.h
+*
+* \brief EEPROM access through the IAP registers, and the partitioning of the EEPROM
+*
+* \author Hekk_Elek
+*
+**********************************************************************************************************/
+#ifndef IAP_H
+#define IAP_H
+
+/***************************************< Includes >**************************************/
+#include "types.h"
+
+
+/***************************************< Definitions >**************************************/
+#define EEPROM_SIZE           (4096u)  //!< Number of bytes present as EEPROM memory
+#define EEPROM_BASEADDRESS  (0x2000u)  //!< Base address of EEPROM in STC8G1K08; also its MOVC address, right after the program
+#define EEPROM_PAGE_SIZE      (512u)  //!< Size of an erasable EEPROM page
+#define EEPROM_PAGES_NUM      ( EEPROM_SIZE / EEPROM_PAGE_SIZE )  //!< Number of pages of the whole EEPROM
+#define IAP_ERASE_MS            (4u)  //!< Typical CPU stall of a page erase (datasheet: 4..6 ms), the ms timer is advanced by it
+
+// Partitions; never change them, the data of the devices in the field would be lost
+#define EEPROM_PERSIST_FIRST_PAGE    (0u)  //!< First page of the persistent data log (persist.c)
+#define EEPROM_PERSIST_PAGES         (4u)  //!< Number of pages of the persistent data log
+#define EEPROM_ANIMATION_FIRST_PAGE  (4u)  //!< First page of the uploaded animations, one per page (animation.c)
+#define EEPROM_ANIMATION_PAGES       (4u)  //!< Number of pages of the uploaded animations
+
+//! \brief Address of a given EEPROM page, for IAP and MOVC
+#define EEPROM_PAGE_ADDRESS(u8Page)  ( EEPROM_BASEADDRESS + ( (U16)(u8Page) << 9u ) )
+
+
+/***************************************< Types >**************************************/
+
+
+/***************************************< Constants >**************************************/
+
+
+/***************************************< Global variables >**************************************/
+
+
+/***************************************< Public functions >**************************************/
+void IAP_WriteByte( U16 u16Address, U8 u8Data );
+void IAP_Erase( U16 u16Address );
+void IAP_Read( U16 u16Address, U8* pu8Data, U8 u8DataLength );
+
+
+#endif /* IAP_H */
+
+/***************************************< End of file >**************************************/
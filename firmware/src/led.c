@@ -3,7 +3,7 @@
 *
 * \file led.c
 *
-* \brief Soft-PWM LED driver
+* \brief Soft-PWM LED driver, with the hardware PWM on the STC8H
 *
 * \author Hekk_Elek
 *
@@ -11,34 +11,39 @@
 
 /***************************************< Includes >**************************************/
 // Own includes
-#include "stc8g.h"
+#include "hal.h"
 #include "types.h"
+#include "util.h"
 #include "led.h"
 
 
 /***************************************< Definitions >**************************************/
-#define PWM_LEVELS      (16u)  //!< PWM levels implemented: [0; PWM_LEVELS)
-
-// Pin definitions
-#define LED0            (P17)  //!< Pin of LED0
-#define LED1            (P16)  //!< Pin of LED1
-#define LED2            (P11)  //!< Pin of LED2
-#define LED3            (P10)  //!< Pin of LED3
-#define LED4            (P35)  //!< Pin of LED4
-#define LED5            (P34)  //!< Pin of LED5
-#define LED6            (P32)  //!< Pin of LED6
+#define PWM_LEDS_NUM  (4u)  //!< Number of LEDs on hardware PWM outputs
 
 
 /***************************************< Types >**************************************/
 
 
 /***************************************< Constants >**************************************/
+#if ( HAL_HARDWARE_PWM == 1 )
+//! \brief LEDs on hardware PWM outputs, in the order of LED_Update()
+static CODE const U8 gcau8PWMLEDs[ PWM_LEDS_NUM ] = { 0u, 1u, 3u, 5u };
+#endif
 
 
 /***************************************< Global variables >**************************************/
 DATA U8 gau8LEDBrightness[ LEDS_NUM ];  //!< Array for storing individual brightness levels
 DATA U8 gu8PWMCounter;                  //!< Counter for the base of soft-PWM
-DATA BIT gbitSide;                      //!< Stores which side of the panel is active
+BIT gbitSide;                           //!< Stores which side of the panel is active
+DATA U8 gu8LEDDriveDivider;             //!< Interrupts per soft-PWM step, LEDs are driven in one of them
+DATA U8 gu8LEDDriveCounter;             //!< Counts the interrupts of the current soft-PWM step
+#if ( HAL_HARDWARE_PWM == 1 )
+// What the hardware PWM was last set from, LED_Update() writes the registers only on a change
+static IDATA U8  gau8PWMBrightness[ PWM_LEDS_NUM ];  //!< Brightness levels in the compare registers
+static IDATA U8  gu8PWMDriveDivider;                 //!< gu8LEDDriveDivider of the period and the step
+static IDATA U8  gu8PWMClockShift;                   //!< gu8ClockShift of the period and the step
+static IDATA U16 gu16PWMStep;                        //!< Compare counts of a brightness level
+#endif
 
 
 /***************************************< Static function definitions >**************************************/
@@ -61,6 +66,8 @@ void LED_Init( void )
   
   // Init globals
   gu8PWMCounter = 0;
+  gu8LEDDriveDivider = LED_DRIVE_DIVIDER;
+  gu8LEDDriveCounter = 0u;
   for( u8Index = 0; u8Index < LEDS_NUM; u8Index++ )
   {
     gau8LEDBrightness[ u8Index ] = 0;
@@ -78,102 +85,155 @@ void LED_Init( void )
 	//          1  |   1  | Open-drain
 	// ------------+------+---------------
   // P3.2, P3.4, P3.5
-  P3M0 |= (1u<<2u) | (1u<<4u) | (1u<<5u);  // push-pull
-  P3M1 &= ~(1u<<2u) & ~(1u<<4u) & ~(1u<<5u);
+  HAL_PINS_PUSHPULL( 3, (1u<<2u) | (1u<<4u) | (1u<<5u) );
   // P1.0, P1.1, P1.6, P1.7
-  P1M0 |= (1u<<0u) | (1u<<1u) | (1u<<6u) | 1u<<7u;  // push-pull
-  P1M1 &= ~(1u<<0u) & ~(1u<<1u) & ~(1u<<6u) & ~(1u<<7u);
+  HAL_PINS_PUSHPULL( 1, (1u<<0u) | (1u<<1u) | (1u<<6u) | (1u<<7u) );
+
+#if ( HAL_HARDWARE_PWM == 1 )
+  for( u8Index = 0u; u8Index < PWM_LEDS_NUM; u8Index++ )
+  {
+    gau8PWMBrightness[ u8Index ] = 0u;
+  }
+  gu8PWMDriveDivider = 0u;  // No such divider, the first LED_Update() sets the period
+  gu8PWMClockShift = 0u;
+  gu16PWMStep = 0u;
+  
+  // Hardware PWM, the outputs are active low like the pins; the compare registers are 0 (dark) after reset
+  HAL_XSFR_BEGIN();
+  // PWMA: LED3 on PWM1P (P1.0), LED1 on PWM4P (P1.6)
+  PWMA_CCER1 = 0x00u;  // Channels must be off while their mode is set
+  PWMA_CCER2 = 0x00u;
+  PWMA_CCMR1 = HAL_PWM_MODE1;
+  PWMA_CCMR4 = HAL_PWM_MODE1;
+  PWMA_CCER1 = 0x03u;  // CC1E, CC1P: enabled, active low
+  PWMA_CCER2 = 0x30u;  // CC4E, CC4P
+  PWMA_PS    = 0x00u;  // PWM1P on P1.0, PWM4P on P1.6
+  PWMA_ENO   = 0x41u;  // ENO1P, ENO4P; P1.1 and P1.7 (the N outputs) stay GPIO
+  PWMA_ARR   = LED_PWM_PERIOD - 1u;
+  PWMA_BKR   = HAL_PWM_MOE;
+  PWMA_CR1   = HAL_PWM_RUN;
+  // PWMB: LED0 on PWM5 (P1.7), LED5 on PWM8 (P3.4); RGBLED_Init() adds PWM6 and PWM7
+  PWMB_CCER1 = 0x00u;
+  PWMB_CCER2 = 0x00u;
+  PWMB_CCMR1 = HAL_PWM_MODE1;
+  PWMB_CCMR4 = HAL_PWM_MODE1;
+  PWMB_CCER1 = 0x03u;  // CC5E, CC5P
+  PWMB_CCER2 = 0x30u;  // CC8E, CC8P
+  PWMB_PS    = 0x41u;  // PWM5 on P1.7, PWM8 on P3.4
+  PWMB_ENO   = 0x41u;  // ENO5P, ENO8P
+  PWMB_ARR   = LED_PWM_PERIOD - 1u;
+  PWMB_CNTR  = LED_PWM_PERIOD / 2u;  // Half a period apart from PWMA, so the two pairs aren't lit together
+  PWMB_BKR   = HAL_PWM_MOE;
+  PWMB_CR1   = HAL_PWM_RUN;
+  HAL_XSFR_END();
+#endif
 }
 
 //----------------------------------------------------------------------------
 //! \brief  Interrupt routine to implement soft-PWM
 //! \param  -
 //! \return -
-//! \global gau8LEDBrightness[], gu8PWMCounter
+//! \global gau8LEDBrightness[], gu8PWMCounter, gu8LEDDriveDivider, gu8LEDDriveCounter
 //! \note   Should be called from periodic timer interrupt routine.
 //-----------------------------------------------------------------------------
 void LED_Interrupt( void )
 {
-  static BIT bDrive = 0;
-  static U8   u8DriveCounter = 0u;
+  LED_INTERRUPT_BODY();
+}
+
+#if ( HAL_HARDWARE_PWM == 1 )
+//----------------------------------------------------------------------------
+//! \brief  Copies the brightness levels of the LEDs on hardware PWM outputs into the compare registers
+//! \param  -
+//! \return -
+//! \global gau8LEDBrightness[], gu8LEDDriveDivider, gu8ClockShift, gau8PWMBrightness[], gu8PWMDriveDivider,
+//!         gu8PWMClockShift, gu16PWMStep
+//! \note   Should be called from the main loop, after the animation, the brightness governor and the clock
+//!         governor. The duty is the same as with soft-PWM: brightness / ( PWM_LEVELS * gu8LEDDriveDivider ),
+//!         but with a resolution of LED_PWM_PERIOD counts instead of PWM_LEVELS steps.
+//!         Nothing is computed or written if none of these changed since the last call. The new values are
+//!         preloaded, they take effect together at the end of the current period.
+//-----------------------------------------------------------------------------
+void LED_Update( void )
+{
+  U16  u16Period;
+  U8   u8Index;
+  BOOL bChanged = FALSE;
   
-  u8DriveCounter++;
-  if( u8DriveCounter == 5u )
-  {
-    bDrive = 1;
-    u8DriveCounter = 0u;
-  }
-  else
+  if( ( gu8LEDDriveDivider != gu8PWMDriveDivider ) || ( gu8ClockShift != gu8PWMClockShift ) )
   {
-    bDrive = 0;
+    gu8PWMDriveDivider = gu8LEDDriveDivider;
+    gu8PWMClockShift = gu8ClockShift;
+    u16Period = (U16)( LED_PWM_PERIOD >> gu8ClockShift );  // The PWM counts the divided system clock
+    gu16PWMStep = u16Period / (U16)( PWM_LEVELS * gu8LEDDriveDivider );
+    HAL_XSFR_BEGIN();
+    PWMA_ARR = u16Period - 1u;
+    PWMB_ARR = u16Period - 1u;
+    HAL_XSFR_END();
+    bChanged = TRUE;
   }
-  
-  if( ( 1 == bDrive ) )
+  for( u8Index = 0u; u8Index < PWM_LEDS_NUM; u8Index++ )
   {
-    gu8PWMCounter++;
-    if( gu8PWMCounter == PWM_LEVELS )
+    if( gau8LEDBrightness[ gcau8PWMLEDs[ u8Index ] ] != gau8PWMBrightness[ u8Index ] )
     {
-      gu8PWMCounter = 0;
+      gau8PWMBrightness[ u8Index ] = gau8LEDBrightness[ gcau8PWMLEDs[ u8Index ] ];
+      bChanged = TRUE;
     }
   }
-  //NOTE: unfortunately SFRs cannot be put in an array, so this cannot be implented as a for cycle
-  if( ( 1 == bDrive ) && gau8LEDBrightness[ 0u ] > gu8PWMCounter )  // D??
-  {
-    LED0 = 0;
-  }
-  else
-  {
-    LED0 = 1;
-  }
-  if( ( 1 == bDrive ) && gau8LEDBrightness[ 1u ] > gu8PWMCounter )  // D??
-  {
-    LED1 = 0;
-  }
-  else
-  {
-    LED1 = 1;
-  }
-  if( ( 1 == bDrive ) && gau8LEDBrightness[ 2u ] > gu8PWMCounter )  // D??
-  {
-    LED2 = 0;
-  }
-  else
-  {
-    LED2 = 1;
-  }
-  if( ( 1 == bDrive ) && gau8LEDBrightness[ 3u ] > gu8PWMCounter )  // D??
-  {
-    LED3 = 0;
-  }
-  else
-  {
-    LED3 = 1;
-  }
-  if( ( 1 == bDrive ) && gau8LEDBrightness[ 4u ] > gu8PWMCounter )  // D??
-  {
-    LED4 = 0;
-  }
-  else
-  {
-    LED4 = 1;
-  }
-  if( ( 1 == bDrive ) && gau8LEDBrightness[ 5u ] > gu8PWMCounter )  // D??
-  {
-    LED5 = 0;
-  }
-  else
-  {
-    LED5 = 1;
-  }
-  if( ( 1 == bDrive ) && gau8LEDBrightness[ 6u ] > gu8PWMCounter )  // D??
-  {
-    LED6 = 0;
-  }
-  else
+  
+  if( TRUE == bChanged )
   {
-    LED6 = 1;
+    HAL_XSFR_BEGIN();
+    PWMB_CCR5 = gau8PWMBrightness[ 0 ] * gu16PWMStep;  // LED0
+    PWMA_CCR4 = gau8PWMBrightness[ 1 ] * gu16PWMStep;  // LED1
+    PWMA_CCR1 = gau8PWMBrightness[ 2 ] * gu16PWMStep;  // LED3
+    PWMB_CCR8 = gau8PWMBrightness[ 3 ] * gu16PWMStep;  // LED5
+    HAL_XSFR_END();
   }
 }
 
+//----------------------------------------------------------------------------
+//! \brief  Disconnects the hardware PWM from the pins, the LEDs and the RGB LEDs follow the GPIO latches
+//! \param  -
+//! \return -
+//! \note   Should be called before a power-down, when the PWM counters stop wherever they are.
+//-----------------------------------------------------------------------------
+void LED_Stop( void )
+{
+  HAL_XSFR_BEGIN();
+  PWMA_ENO = 0x00u;
+  PWMB_ENO = 0x00u;
+  HAL_XSFR_END();
+}
+#endif
+
+#if ( AMBIENT_LIGHT_ENABLED == 1 )
+//----------------------------------------------------------------------------
+//! \brief  Turns LED2 into a light sensor: its cathode is charged to the supply, then left floating
+//! \param  -
+//! \return -
+//! \note   The anode is tied to the supply through R8, so the LED isn't biased at all; the photocurrent
+//!         pulls the floating cathode down, the brighter the light, the faster. The LED stays dark until
+//!         LED_SenseEnd(), the soft-PWM writes only the latch of the input pin.
+//-----------------------------------------------------------------------------
+void LED_SenseStart( void )
+{
+  ET0 = 0;  // The soft-PWM must not light it between the two steps
+  LED2 = 1;
+  HAL_PINS_INPUT( 1, (1u<<1u) );  // P1.1
+  ET0 = 1;
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Hands LED2 back to the soft-PWM
+//! \param  -
+//! \return -
+//-----------------------------------------------------------------------------
+void LED_SenseEnd( void )
+{
+  HAL_PINS_PUSHPULL( 1, (1u<<1u) );  // P1.1
+}
+#endif
+
 
 /***************************************< End of file >**************************************/
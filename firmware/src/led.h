@@ -3,7 +3,7 @@
 *
 * \file led.h
 *
-* \brief Soft-PWM LED driver
+* \brief Soft-PWM LED driver, with the hardware PWM on the STC8H
 *
 * \author Hekk_Elek
 *
@@ -12,10 +12,99 @@
 #define LED_H
 
 /***************************************< Includes >**************************************/
+#include "types.h"
+#include "config.h"
+#include "hal.h"
 
 
 /***************************************< Definitions >**************************************/
 #define LEDS_NUM               (7u)  //!< Number of LEDs driven by this driver
+#define LED_DRIVE_DIVIDER      (5u)  //!< Nominal number of interrupts per soft-PWM step
+#ifndef PWM_LEVELS  // May be overridden by the host tools, e.g. tools/sim_farm
+#define PWM_LEVELS            (16u)  //!< PWM levels implemented: [0; PWM_LEVELS)
+#endif
+#define LED_PHASES_NUM  ( ( LEDS_NUM + LED_MAX_ON - 1u ) / LED_MAX_ON )  //!< Ticks of a soft-PWM step the LEDs are spread over
+
+// Pin definitions
+#define LED0                  (P17)  //!< Pin of LED0
+#define LED1                  (P16)  //!< Pin of LED1
+#define LED2                  (P11)  //!< Pin of LED2
+#define LED3                  (P10)  //!< Pin of LED3
+#define LED4                  (P35)  //!< Pin of LED4
+#define LED5                  (P34)  //!< Pin of LED5
+#define LED6                  (P32)  //!< Pin of LED6
+
+#if ( AMBIENT_LIGHT_ENABLED == 1 )
+// Light sensor (batterylevel.c): LED2 is alone on its pin, and on soft-PWM with both targets
+#define LED_SENSE_ADC_CHANNEL  (1u)  //!< ADC channel of P1.1, the cathode of LED2
+#endif
+
+#if ( HAL_HARDWARE_PWM == 1 )
+// Hardware PWM: LED3 on PWM1P (P1.0), LED1 on PWM4P (P1.6), LED0 on PWM5 (P1.7), LED5 on PWM8 (P3.4).
+// LED2 (P1.1) would be PWM1N, the complement of LED3, so it stays on soft-PWM with LED4 and LED6.
+#define LED_PWM_HZ        (10000u)  //!< Frequency of the hardware PWM
+#define LED_PWM_PERIOD  ( (U16)( SYSTEM_CLOCK_HZ / LED_PWM_HZ ) )  //!< Counts of a PWM period at full system clock
+#endif
+
+
+/***************************************< Macros >**************************************/
+//! \brief Tick of the soft-PWM step in which the given LED is driven; LED_MAX_ON LEDs share a tick
+#define LED_PHASE( u8Index )  ( (U8)( (u8Index) / LED_MAX_ON ) )
+
+//! \brief Drives an LED: lit (pin low) in its own tick of the step, while its brightness is above the PWM counter
+#define LED_DRIVE( pin, u8Index ) \
+  pin = ( ( LED_PHASE( u8Index ) != gu8LEDDriveCounter ) || ( gau8LEDBrightness[ u8Index ] <= gu8PWMCounter ) )
+
+#if ( HAL_HARDWARE_PWM == 1 )
+//! \brief Drives the LEDs without a hardware PWM output, see LED_Update() for the others
+#define LED_SOFT_DRIVE() \
+  do \
+  { \
+    LED_DRIVE( LED2, 2u ); \
+    LED_DRIVE( LED4, 4u ); \
+    LED_DRIVE( LED6, 6u ); \
+  } while( 0 )
+
+#define LED_UPDATE()  LED_Update()  //!< Hook: copies the brightness levels into the hardware PWM
+#define LED_STOP()    LED_Stop()    //!< Hook: hands the PWM pins back to the GPIO latches
+#else
+//! \brief Drives all LEDs
+#define LED_SOFT_DRIVE() \
+  do \
+  { \
+    LED_DRIVE( LED0, 0u ); \
+    LED_DRIVE( LED1, 1u ); \
+    LED_DRIVE( LED2, 2u ); \
+    LED_DRIVE( LED3, 3u ); \
+    LED_DRIVE( LED4, 4u ); \
+    LED_DRIVE( LED5, 5u ); \
+    LED_DRIVE( LED6, 6u ); \
+  } while( 0 )
+
+#define LED_UPDATE()  // Hook: the soft-PWM reads the brightness levels itself
+#define LED_STOP()    // Hook: nothing to stop
+#endif
+
+//! \brief Timer 0 interrupt work of this module, expanded in place in the flattened interrupt routine
+//! \note  Each LED is driven in one interrupt of each soft-PWM step. The LEDs are spread over the first
+//!        LED_PHASES_NUM interrupts of the step, so at most LED_MAX_ON of them are lit at the same time;
+//!        the light output doesn't change, only the peak current.
+//NOTE: unfortunately SFRs cannot be put in an array, so this cannot be implented as a for cycle
+#define LED_INTERRUPT_BODY() \
+  do \
+  { \
+    gu8LEDDriveCounter++; \
+    if( gu8LEDDriveCounter >= gu8LEDDriveDivider )  /* The divider may be lowered by the brightness governor */ \
+    { \
+      gu8LEDDriveCounter = 0u; \
+      gu8PWMCounter++; \
+      if( gu8PWMCounter == PWM_LEVELS ) \
+      { \
+        gu8PWMCounter = 0u; \
+      } \
+    } \
+    LED_SOFT_DRIVE(); \
+  } while( 0 )
 
 
 /***************************************< Types >**************************************/
@@ -26,11 +115,22 @@
 
 /***************************************< Global variables >**************************************/
 extern DATA U8 gau8LEDBrightness[ LEDS_NUM ];
+extern DATA U8 gu8LEDDriveDivider;
+extern DATA U8 gu8LEDDriveCounter;
+extern DATA U8 gu8PWMCounter;
 
 
 /***************************************< Public functions >**************************************/
 void LED_Init( void );
 void LED_Interrupt( void );
+#if ( HAL_HARDWARE_PWM == 1 )
+void LED_Update( void );
+void LED_Stop( void );
+#endif
+#if ( AMBIENT_LIGHT_ENABLED == 1 )
+void LED_SenseStart( void );
+void LED_SenseEnd( void );
+#endif
 
 
 #endif /* LED_H */
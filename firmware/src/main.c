@@ -14,7 +14,7 @@
 #include <string.h>
 
 // Own includes
-#include "stc8g.h"
+#include "hal.h"
 #include "types.h"
 #include "util.h"
 #include "led.h"
@@ -22,10 +22,14 @@
 #include "animation.h"
 #include "persist.h"
 #include "batterylevel.h"
+#include "power.h"
+#include "button.h"
+#include "profile.h"
+#include "telemetry.h"
+#include "upload.h"
 
 
 /***************************************< Definitions >**************************************/
-#define BUTTON_PIN     (P36)  //!< Button for selecting animation and turning it off and on
 
 
 /***************************************< Types >**************************************/
@@ -35,17 +39,6 @@
 
 
 /***************************************< Global variables >**************************************/
-//! \brief State machine for button debouncing
-static enum
-{
-  BUTTON_UNPRESSED,  //!< The button is not pressed
-  BUTTON_BOUNCING,   //!< The button just got pressed and it's currently bouncing
-  BUTTON_PRESSED,    //!< The button got debounced
-  BUTTON_LONGPRESS,  //!< The button has been pressed for long
-  BUTTON_RELEASING   //!< The button just got released and it's currently bouncing
-} geButtonState;
-
-static U16 gu16ButtonPressTimer;  //!< Timer for the button debouncing state machine
 
 
 /***************************************< Static function definitions >**************************************/
@@ -57,17 +50,15 @@ static void Timer0Init( void );
 //! \brief  Timer 0 initialization (100 us interrupt period)
 //! \param  -
 //! \return -
-//! \note   Assumes 24 MHz system clock. Generated using STC-ISP tool.
+//! \note   Reload value is calculated from SYSTEM_CLOCK_HZ. Generated using STC-ISP tool.
 //-----------------------------------------------------------------------------
 static void Timer0Init( void )
 {
-  TR0 = 0;       //Timer0 stop run
-  AUXR |= 0x80;  //Timer clock is 1T mode
-  TMOD &= 0xF0;  //Set timer work mode
-  TL0 = 0xA0;    //Initial timer value
-  TH0 = 0xF6;    //Initial timer value
-  TF0 = 0;       //Clear TF0 flag
-  TR0 = 1;       //Timer0 start run
+  HAL_TIMER0_STOP();
+  HAL_TIMER0_MODE();
+  HAL_TIMER0_RELOAD( TIMER0_RELOAD( 0u ) );  //Initial timer value
+  HAL_TIMER0_ACK();
+  HAL_TIMER0_START();
 }
 
 
@@ -81,27 +72,22 @@ void main( void )
 {
   U32  u32UptimeCounter = 0u;
   U16  u16LastCall = 0u;
-  U8   u8CurrentAnimation = 0u;
-  BOOL bPressedLong = FALSE;
+  U16  u16IdleGapMs = 0u;
+  U16  u16SleepMs;
+  U16  u16Now;
 
   // Initialize modules
+  Power_Init();
   Util_Init();
   LED_Init();
   RGBLED_Init();
   Animation_Init();
   Persist_Init();
   BatteryLevel_Init();
-
-  // Pushbutton @ P3.6 --> bidirectional with pullup
-  // NOTE: this might not the best in terms of power consumption, but the input mode with pullup was not enough
-  P3M0 &= ~(1u<<6u);  // 0
-  P3M1 &= ~(1u<<6u);  // 0
-  P3PU |= 1u<<6u;
-  
-  // Init global variables in this module
-  geButtonState = BUTTON_UNPRESSED;
-  gu16ButtonPressTimer = 0u;
-  u8CurrentAnimation = gsPersistentData.u8AnimationIndex;
+  Button_Init();
+  TELEMETRY_INIT();
+  UPLOAD_INIT();
+  PROFILE_INIT();  // After Power_Init(), which reads the factory data from the end of the RAM
   
   // Init timer and start interrupts
   Timer0Init();  
@@ -112,147 +98,82 @@ void main( void )
 
   // Wait if the button is pressed on power up
   // This is necessary, to avoid changing animation on power on
-  while( 0 == BUTTON_PIN )
-  {
-    gu16ButtonPressTimer = Util_GetTimerMs() + 100u;  // 1 ms wait
-    while( gu16ButtonPressTimer > Util_GetTimerMs() );
-  }
+  Button_WaitForRelease();
 
-  // Measure and show battery level
+  // Measure and show battery level, done by BatteryLevel_Task() in the main loop
   BatteryLevel_Show();
-    
+
+
   // Main loop
   while( TRUE )
   {
-    // Increment uptime counter
-    if( Util_GetTimerMs() < u16LastCall )
-    {
-      u32UptimeCounter += (U32)( 65535u - u16LastCall + Util_GetTimerMs() + 1u );
-    }
-    else
-    {
-      u32UptimeCounter += (U32)( Util_GetTimerMs() - u16LastCall );
-    }
-    u16LastCall = Util_GetTimerMs();
-    if( u32UptimeCounter >= 18000000u )  // turn off after 5 hours = 5*60*60*1000 msec
+    // One time snapshot for the whole cycle
+    u16Now = Util_TakeTimeSnapshot();
+    // Increment uptime counter (the unsigned difference handles the wrap-around)
+    u32UptimeCounter += (U16)( u16Now - u16LastCall );
+    u16LastCall = u16Now;
+    // Turn off after 5 hours = 5*60*60*1000 msec, or when the battery is depleted
+    if( ( u32UptimeCounter >= 18000000u ) || ( TRUE == BatteryLevel_IsLow() ) )
     {
       // Go to power-down sleep
-      EA = 0;   // Disable all interrupts
-      TR0 = 0;  // Stop Timer 0
-      ET0 = 0;  // Disable Timer 0 interrupt
-      INTCLKO |= (1u<<4u);  // Enable INT2 interrupt (EX2)
-      P1 = 0xFFu;  // Set all pins to 1
-      P3 = 0xFFu;
-      P5 = 0x3Fu;
-      P1M0 = 0x00u;  // All pins must be bidirectional
-      P1M1 = 0x00u;
-      P3M0 = 0x00u;
-      P3M1 = 0x00u;
-      P5M0 = 0x00u;
-      P5M0 = 0x00u;
-      EA = 1;  // Enable all interrupts
-      PCON |= 0x02u;  // PD bit
+      gsPersistentData.u32RuntimeMs += u32UptimeCounter;  // Store accumulated runtime
+      PROFILE_REPORT();
+      Persist_Save();
+      Persist_Flush();  // Finish EEPROM work first
+      Power_Off();
     }
     
-    // Debounce button in a nonblocking way
-    switch( geButtonState )
+    // Handle the debounced button events
+    switch( Button_Task() )
     {
-      case BUTTON_BOUNCING:   // The button just got pressed and it's currently bouncing
-        if( Util_GetTimerMs() == gu16ButtonPressTimer )  // the debounce timer has just went off
-        {
-          if( 0 == BUTTON_PIN )  // if the button is still pressed
-          {
-            gu16ButtonPressTimer = Util_GetTimerMs() + 2000u;  // 2 sec long press
-            geButtonState = BUTTON_PRESSED;
-          }
-          else  // not pressed anymore
-          {
-            geButtonState = BUTTON_UNPRESSED;
-          }
-        }
-        break;
-      
-      case BUTTON_PRESSED:    // The button got debounced
-        if( 1 == BUTTON_PIN )  // just got released
-        {
-          gu16ButtonPressTimer = Util_GetTimerMs() + 50u;  // 50 ms debounce time
-          geButtonState = BUTTON_RELEASING;
-          // Actions for short button press
-          u8CurrentAnimation++;
-          if( u8CurrentAnimation >= NUM_ANIMATIONS-1u )
-          {
-            u8CurrentAnimation = 0u;
-          }
-          Animation_Set( u8CurrentAnimation );
-          // Save it
-          Persist_Save();
-        }
-        else if( Util_GetTimerMs() == gu16ButtonPressTimer )  // the long press timer has just went off
-        {
-          geButtonState = BUTTON_LONGPRESS;
-          // Actions for long button press
-          // Signal that it will be shut down by setting a completely black animation
-          u8CurrentAnimation = NUM_ANIMATIONS-1u;
-          Animation_Set( u8CurrentAnimation );
-          bPressedLong = TRUE;
-        }
+      case BUTTON_EVENT_SHORT:          // Short press: next animation
+        // The current one is taken from the persistent data, as an upload may have changed it
+        Animation_Set( Animation_Next( gsPersistentData.u8AnimationIndex ), TRUE );
+        // Save it
+        Persist_Save();
         break;
       
-      case BUTTON_LONGPRESS:  // The button has been pressed for long
-        if( 1 == BUTTON_PIN )  // just got released
-        {
-          gu16ButtonPressTimer = Util_GetTimerMs() + 50u;  // 50 ms debounce time
-          geButtonState = BUTTON_RELEASING;
-        }
+      case BUTTON_EVENT_LONG:           // Long press: getting ready to turn off
+        // Signal that it will be shut down by playing a completely black animation; it isn't saved,
+        // the one played before comes back at the next power-up
+        Animation_Set( ANIMATION_BLACKNESS, FALSE );
         break;
       
-      case BUTTON_RELEASING:  // The button just got released and it's currently bouncing
-        if( Util_GetTimerMs() == gu16ButtonPressTimer )  // the debounce timer has just went off
-        {
-          if( 1 == BUTTON_PIN )  // if the button is released
-          {
-            gu16ButtonPressTimer = Util_GetTimerMs() + 2000u;  // 2 sec long press
-            geButtonState = BUTTON_UNPRESSED;
-            
-            if( TRUE == bPressedLong )
-            {
-              // Go to power-down sleep
-              EA = 0;   // Disable all interrupts
-              TR0 = 0;  // Stop Timer 0
-              ET0 = 0;  // Disable Timer 0 interrupt
-              INTCLKO |= (1u<<4u);  // Enable INT2 interrupt (EX2)
-              P1 = 0xFFu;  // Set all pins to 1
-              P3 = 0xFFu;
-              P5 = 0x3Fu;
-              P1M0 = 0x00u;  // All pins must be bidirectional
-              P1M1 = 0x00u;
-              P3M0 = 0x00u;
-              P3M1 = 0x00u;
-              P5M0 = 0x00u;
-              P5M0 = 0x00u;
-              EA = 1;  // Enable all interrupts
-              PCON |= 0x02u;  // PD bit
-              bPressedLong = FALSE;  // This should not be reached...
-            }
-          }
-          else  // still pushed
-          {
-            gu16ButtonPressTimer = Util_GetTimerMs() + 50u;  // 50 ms debounce time
-          }
-        }
+      case BUTTON_EVENT_LONG_RELEASED:  // Released after a long press: turn off
+        // Go to power-down sleep
+        gsPersistentData.u32RuntimeMs += u32UptimeCounter;  // Store accumulated runtime
+        PROFILE_REPORT();
+        Persist_Save();
+        Persist_Flush();  // Finish EEPROM work first
+        Power_Off();
         break;
       
-      default:  // BUTTON_UNPRESSED -- The button is not pressed
-        if( 0 == BUTTON_PIN )  // if the button has just got pressed
-        {
-          gu16ButtonPressTimer = Util_GetTimerMs() + 50u;  // 50 ms debounce time
-          geButtonState = BUTTON_BOUNCING;
-        }
+      default:  // BUTTON_EVENT_NONE
         break;
     }
-    Animation_Cycle();
-    // Sleep until next interrupt
-    PCON |= 0x01u;  // IDL bit
+    // The animation waits for the battery level gauge, unless they run in parallel
+    if( ( FALSE == BatteryLevel_Busy() ) || BATTERYLEVEL_FAST_BOOT )
+    {
+      u16IdleGapMs = Animation_Cycle();
+    }
+    BatteryLevel_Task();
+    UPLOAD_TASK();
+    TELEMETRY_TASK();
+    // Incremental EEPROM writer; page erases when nothing is lit, or if that takes long, when nothing changes for a while
+    Persist_Task( Animation_IsDark(), ( u16IdleGapMs >= PERSIST_ERASE_GAP_MS ) );
+    // Run at a divided clock if there's nothing heavy to do
+    Power_ClockGovernor();
+    // Brightness levels into the hardware PWM, if any (after the clock governor, the period follows the clock)
+    LED_UPDATE();
+    RGBLED_UPDATE();
+    // Sleep until next interrupt, or power down until the next deadline if nothing is lit
+    u16SleepMs = Util_TimerNextDeadline();
+    if( u16IdleGapMs < u16SleepMs )
+    {
+      u16SleepMs = u16IdleGapMs;
+    }
+    PROFILE_LOOP_END();
+    Power_Sleep( u16SleepMs, ( Button_Idle() && ( FALSE == TELEMETRY_BUSY() ) ) );
   }
 }
 
@@ -265,12 +186,62 @@ void main( void )
 #pragma vector=0x0053
 IT_PRE void INT2_ISR( void ) ITVECTOR10
 {
-  // Normally, only after waking up from power down mode should lead to here
-  // Perform software reset
-  IAP_CONTR |= 0x20u;
-  while( 1 );  // This should not be reached
+  if( TRUE == Power_Interrupt() )
+  {
+    // Woken up from power down mode (turned off)
+    // Perform software reset
+    HAL_SOFTWARE_RESET();
+    while( 1 );  // This should not be reached
+  }
+  Button_Interrupt();  // Button press, may have woken up from a tickless power-down
 }
 
+#if ( TELEMETRY_ENABLED == 1 )
+//----------------------------------------------------------------------------
+//! \brief  UART1 interrupt handler
+//! \param  -
+//! \return -
+//! \note   Should be placed at 0x0023 (==IT vector 4).
+//-----------------------------------------------------------------------------
+#pragma vector=0x0023
+IT_PRE void UART1_ISR( void ) ITVECTOR4
+{
+  Telemetry_Interrupt();  // Telemetry transmitter
+}
+#endif
+
+//----------------------------------------------------------------------------
+//! \brief  ADC interrupt handler
+//! \param  -
+//! \return -
+//! \note   Should be placed at 0x002B (==IT vector 5).
+//-----------------------------------------------------------------------------
+#pragma vector=0x002B
+IT_PRE void ADC_ISR( void ) ITVECTOR5
+{
+  BatteryLevel_Interrupt();  // Battery voltage measurement
+}
+
+#if ( TIMER0_ISR_FAST == 1 )
+//----------------------------------------------------------------------------
+//! \brief  Timer 0 interrupt handler, flattened
+//! \param  -
+//! \return -
+//! \note   Should be placed at 0x000B (==IT vector 1). Has its own register bank, so the working
+//!         registers are not saved; it must not call functions, they would use bank 0.
+//-----------------------------------------------------------------------------
+#pragma vector=0x000B
+IT_PRE void timer0_isr( void ) ITVECTOR1 REGBANK1
+{
+  PROFILE_ISR_ENTRY();
+  UTIL_INTERRUPT_BODY();    // Housekeeping, e.g. ms delay timer
+  LED_INTERRUPT_BODY();     // Soft-PWM LED driver (the LEDs without a hardware PWM output)
+  RGBLED_INTERRUPT_BODY();  // RGB LED driver
+  PROFILE_ISR_EXIT();
+  // End of interrupt
+  HAL_TIMER0_ACK();  // clear Timer0 IT flag
+}
+#else
 //----------------------------------------------------------------------------
 //! \brief  Timer 0 interrupt handler
 //! \param  -
@@ -280,12 +251,15 @@ IT_PRE void INT2_ISR( void ) ITVECTOR10
 #pragma vector=0x000B
 IT_PRE void timer0_isr( void ) ITVECTOR1
 {
+  PROFILE_ISR_ENTRY();
   Util_Interrupt();  // Housekeeping, e.g. ms delay timer
   LED_Interrupt();  // Soft-PWM LED driver
   RGBLED_Interrupt();  // RGB LED driver
+  PROFILE_ISR_EXIT();
   // End of interrupt
-  TF0 = 0;  // clear Timer0 IT flag
+  HAL_TIMER0_ACK();  // clear Timer0 IT flag
 }
+#endif
 
 
 /***************************************< End of file >**************************************/
@@ -9,57 +9,193 @@
 *
 **********************************************************************************************************/
 
+/*----------------------------------------------------------------------------------------
+How it works
+============
+The persistent data partition of the EEPROM (see iap.h) is a ring of pages, used as a log
+of tagged key-value records. Every record is
+  [ 32-bit value ] [ Key ] [ Schema version ] [ CRC16 ]
+so 64 records fit a page exactly. The first record of each page is a page header, which
+holds the sequence number of the page instead of a value; the newest page is the one with
+the highest sequence number. When saving, only the keys which changed are appended.
+At boot the headers are read first, then the pages are replayed from the oldest to the
+newest, and the latest value of every key is kept in a RAM index.
+The page after the one being written is always erased ahead. Before erasing it, the keys
+whose latest record lives there are carried forward to the current page.
+An erase stalls the CPU with the interrupts disabled; IAP_Erase() advances the ms timer by
+the typical erase time, so the timing of the animations doesn't slip. What's left: the ms
+timer may still lag by the difference to the real erase time (at most 2 ms per erase), and
+the LEDs stand still during it. So an erase waits for a dark frame, where nothing can be
+seen. Only if none comes for PERSIST_ERASE_WAIT_MS, it falls back to an idle gap of the
+animation: then the soft-PWM freezes for one erase time, a lit LED stays fully on or off
+for ~5 ms, seen as a single flicker.
+----------------------------------------------------------------------------------------*/
+
 /***************************************< Includes >**************************************/
 // Standard C libraries
 #include <string.h>
+#include <stddef.h>
 
 // Own includes
 #include "types.h"
 #include "util.h"
+#include "hal.h"
+#include "iap.h"
 #include "persist.h"
 
 
 /***************************************< Definitions >**************************************/
-#define EEPROM_SIZE           (4096u)  //!< Number of bytes present as EEPROM memory
-#define EEPROM_BASEADDRESS  (0x2000u)  //!< Base address of EEPROM in STC8G1K08
+#define PERSIST_PAGES_NUM     EEPROM_PERSIST_PAGES  //!< Number of pages in the ring
+#define SLOTS_PER_PAGE        ( EEPROM_PAGE_SIZE / sizeof( S_PERSIST_RECORD ) )  //!< Records per page, including the header
+#define PAGE_HEADER_KEY       (0x5Au)  //!< Key of the page header records
+#define NO_PAGE               (0xFFu)  //!< Page index of keys which have no record yet
+
+//! \brief Address of a given record slot in a given page
+#define RECORD_ADDRESS(u8Page, u8Slot)  ( EEPROM_PAGE_ADDRESS( EEPROM_PERSIST_FIRST_PAGE + (u8Page) ) + ( (U16)(u8Slot) << 3u ) )
 
 
 /***************************************< Types >**************************************/
+//! \brief Description of a key: where its value lives in the persistent data structure
+typedef struct
+{
+  U8 u8Offset;  //!< Offset of the field in S_PERSIST
+  U8 u8Size;    //!< Size of the field in bytes (1, 2 or 4)
+} S_PERSIST_KEY;
 
 
 /***************************************< Constants >**************************************/
+//! \brief Table of keys, indexed by E_PERSIST_KEY
+CODE const S_PERSIST_KEY gcasPersistKeys[ PERSIST_KEYS_NUM ] =
+{
+  { offsetof( S_PERSIST, u8AnimationIndex ), sizeof( U8 )  },  // PERSIST_KEY_ANIMATION
+  { offsetof( S_PERSIST, u32RuntimeMs ),     sizeof( U32 ) },  // PERSIST_KEY_RUNTIME
+#if ( PROFILE_ENABLED == 1 )
+  { offsetof( S_PERSIST, u32ProfileISR ),    sizeof( U32 ) },  // PERSIST_KEY_PROFILE_ISR
+  { offsetof( S_PERSIST, u32ProfileHealth ), sizeof( U32 ) },  // PERSIST_KEY_PROFILE_HEALTH
+#endif
+};
 
 
 /***************************************< Global variables >**************************************/
 DATA S_PERSIST       gsPersistentData;  //!< Globally accessible persistent data structure
-IDATA S_PERSIST CODE* gpsNextSaveSlot;  //!< Address of the next persistent save slot
+// RAM index of the log
+static IDATA U32 gau32StoredValue[ PERSIST_KEYS_NUM ];  //!< Latest value stored in EEPROM for each key
+static IDATA U8  gau8StoredPage[ PERSIST_KEYS_NUM ];    //!< Page of the latest record of each key
+static IDATA U32 gu32PageSequence;                      //!< Sequence number of the page being written
+static IDATA U8  gu8WritePage;                          //!< Page being written
+static IDATA U8  gu8WriteSlot;                          //!< Next free record slot in the page being written
+// Job queue of the incremental writer
+static IDATA S_PERSIST_RECORD gsJobRecord;  //!< The record being written
+static IDATA U8  gu8JobIndex;               //!< Index of the next byte of the record to be programmed
+static IDATA U8  gu8ErasePage;              //!< Page scheduled for erasing
+static IDATA U8  gu8CarryKeys;              //!< Bitmask of keys to be carried forward before the erase
+static IDATA U16 gu16EraseScheduledMs;      //!< Time when the erase was scheduled
+static BIT gbJobActive;                     //!< A record is being written byte by byte
+static BIT gbSavePending;                   //!< A save has been requested, but not yet finished
+static BIT gbErasePending;                  //!< A page erase is scheduled
+static BIT gbEraseOverdue;                  //!< No dark frame came for the scheduled erase, an idle gap will do
 
 
 /***************************************< Static function definitions >**************************************/
-static BOOL IsSaveBlockEmpty( S_PERSIST* psLocalCopy, S_PERSIST CODE* psSaveBlock );
-static BOOL SearchForLatestSave( S_PERSIST CODE** ppsNextEmpty );
-static void IAP_Write( U16 u16Address, U8* pu8Data, U8 u8DataLength );
-static void IAP_Erase( U16 u16Address );
-static void IAP_Read( U16 u16Address, U8* pu8Data, U8 u8DataLength );
+static U32  GetField( U8 u8Key );
+static void SetField( U8 u8Key, U32 u32Value );
+static BOOL IsRecordValid( S_PERSIST_RECORD* psRecord );
+static BOOL IsRecordEmpty( S_PERSIST_RECORD* psRecord );
+static BOOL IsPageEmpty( U8 u8Page );
+static void ReplayPage( U8 u8Page );
+static void ScheduleEraseAhead( U8 u8Page );
+static void StartRecord( U8 u8Key, U32 u32Value );
+static void CommitRecord( void );
 
 
 /***************************************< Private functions >**************************************/
 //----------------------------------------------------------------------------
-//! \brief  Check if given block is empty in the EEPROM
-//! \param  psTemp: pointer to a temporary storage
-//! \param  psSaveBlock: pointer to the block in EEPROM
-//! \return TRUE if the block is empty; FALSE if not
+//! \brief  Reads a field of the persistent data structure
+//! \param  u8Key: key of the field (E_PERSIST_KEY)
+//! \return Value of the field
+//! \global gsPersistentData
+//-----------------------------------------------------------------------------
+static U32 GetField( U8 u8Key )
+{
+  U32 u32Value;
+  U8* pu8Field = (U8*)&gsPersistentData + gcasPersistKeys[ u8Key ].u8Offset;
+  
+  switch( gcasPersistKeys[ u8Key ].u8Size )
+  {
+    case sizeof( U8 ):
+      u32Value = *pu8Field;
+      break;
+    
+    case sizeof( U16 ):
+      u32Value = *(U16*)pu8Field;
+      break;
+    
+    default:
+      u32Value = *(U32*)pu8Field;
+      break;
+  }
+  return u32Value;
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Writes a field of the persistent data structure
+//! \param  u8Key: key of the field (E_PERSIST_KEY)
+//! \param  u32Value: new value of the field
+//! \return -
+//! \global gsPersistentData
+//-----------------------------------------------------------------------------
+static void SetField( U8 u8Key, U32 u32Value )
+{
+  U8* pu8Field = (U8*)&gsPersistentData + gcasPersistKeys[ u8Key ].u8Offset;
+  
+  switch( gcasPersistKeys[ u8Key ].u8Size )
+  {
+    case sizeof( U8 ):
+      *pu8Field = (U8)u32Value;
+      break;
+    
+    case sizeof( U16 ):
+      *(U16*)pu8Field = (U16)u32Value;
+      break;
+    
+    default:
+      *(U32*)pu8Field = u32Value;
+      break;
+  }
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Check if the given record is intact and belongs to the current schema
+//! \param  psRecord: pointer to the record
+//! \return TRUE if the record can be used
+//! \global -
+//-----------------------------------------------------------------------------
+static BOOL IsRecordValid( S_PERSIST_RECORD* psRecord )
+{
+  BOOL bValid = FALSE;
+  
+  if( ( PERSIST_SCHEMA_VERSION == psRecord->u8Version ) &&
+      ( psRecord->u16CRC == Util_CRC16( (U8*)psRecord, sizeof( S_PERSIST_RECORD ) - sizeof( U16 ) ) ) )
+  {
+    bValid = TRUE;
+  }
+  return bValid;
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Check if the given record is empty
+//! \param  psRecord: pointer to the record
+//! \return TRUE if every byte of the record is 0xFF
 //! \global -
 //-----------------------------------------------------------------------------
-static BOOL IsSaveBlockEmpty( S_PERSIST* psTemp, S_PERSIST CODE* psSaveBlock )
+static BOOL IsRecordEmpty( S_PERSIST_RECORD* psRecord )
 {
   BOOL bEmpty = TRUE;
-  U8  u8ByteIndex;
+  U8   u8ByteIndex;
 
-  IAP_Read( (U16)psSaveBlock, (U8*)psTemp, sizeof( S_PERSIST ) );
-  for( u8ByteIndex = 0u; u8ByteIndex < sizeof( S_PERSIST ); u8ByteIndex++ )
+  for( u8ByteIndex = 0u; u8ByteIndex < sizeof( S_PERSIST_RECORD ); u8ByteIndex++ )
   {
-    if( 0xFFu != ((U8*)psTemp)[ u8ByteIndex ] )
+    if( 0xFFu != ((U8*)psRecord)[ u8ByteIndex ] )
     {
       bEmpty = FALSE;
     }
@@ -68,146 +204,129 @@ static BOOL IsSaveBlockEmpty( S_PERSIST* psTemp, S_PERSIST CODE* psSaveBlock )
 }
 
 //----------------------------------------------------------------------------
-//! \brief  Search for the latest save in EEPROM
-//! \param  ppsNextEmpty: address of the next empty block for writing
-//! \return TRUE, if it found a correct save; FALSE if not
-//! \global gsPersistentData
-//! \note   Takes some time, should only be called in init block.
+//! \brief  Check if a whole EEPROM page is empty
+//! \param  u8Page: index of the page
+//! \return TRUE if every byte of the page is 0xFF
+//! \global -
+//! \note   Reads the page record by record to keep the interrupt-disabled periods short.
 //-----------------------------------------------------------------------------
-static BOOL SearchForLatestSave( S_PERSIST CODE** ppsNextEmpty )
+static BOOL IsPageEmpty( U8 u8Page )
 {
-  BOOL bEmpty;
-  U16 u16SaveIndex;
-  BOOL bReturn = FALSE;
-  S_PERSIST CODE* psSave = (S_PERSIST CODE*)EEPROM_BASEADDRESS;
-  S_PERSIST  sLocalCopy;
+  BOOL bEmpty = TRUE;
+  U8   u8Slot;
+  S_PERSIST_RECORD sRecord;
   
-  for( u16SaveIndex = 0u; u16SaveIndex < ( EEPROM_SIZE / sizeof( S_PERSIST ) ); u16SaveIndex++ )
+  for( u8Slot = 0u; u8Slot < SLOTS_PER_PAGE; u8Slot++ )
   {
-    IAP_Read( (U16)psSave, (U8*)&sLocalCopy, sizeof( S_PERSIST ) );
-    if( sLocalCopy.u16CRC == Util_CRC16( (U8*)&sLocalCopy, sizeof( S_PERSIST ) - sizeof( U16 ) ) )
-    {
-      memcpy( &gsPersistentData, &sLocalCopy, sizeof( S_PERSIST ) );
-      bReturn = TRUE;
-    }
-    else  // bad CRC
+    IAP_Read( RECORD_ADDRESS( u8Page, u8Slot ), (U8*)&sRecord, sizeof( S_PERSIST_RECORD ) );
+    if( FALSE == IsRecordEmpty( &sRecord ) )
     {
-      // Check if this block is empty
-      bEmpty = IsSaveBlockEmpty( &sLocalCopy, psSave );
-      if( ( TRUE == bReturn ) && ( TRUE == bEmpty ) )
-      {
-        *ppsNextEmpty = psSave;
-        break;
-      }
+      bEmpty = FALSE;
+      break;
     }
-    psSave++;
   }
-#warning "What happens if it rolls over?"
-  
-  return bReturn;
+  return bEmpty;
 }
+
 //----------------------------------------------------------------------------
-//! \brief  Write data block to EEPROM from a given address
-//! \param  u16Address: Start address to be written. Only lower 12 bits are used.
-//! \param  pu8Data: pointer to the data to be written
-//! \param  u8DataLength: write length
+//! \brief  Loads the records of a page into the RAM index
+//! \param  u8Page: index of the page
 //! \return -
-//! \global -
-//! \note   Stalls the CPU.
+//! \global gau32StoredValue[], gau8StoredPage[], gu8WriteSlot
+//! \note   Pages must be replayed from the oldest to the newest. Torn records are skipped.
+//!         gu8WriteSlot is set after the last used slot of the page.
 //-----------------------------------------------------------------------------
-static void IAP_Write( U16 u16Address, U8* pu8Data, U8 u8DataLength )
+static void ReplayPage( U8 u8Page )
 {
-  U8 u8Index;
-
-  DISABLE_IT;
+  U8 u8Slot;
+  S_PERSIST_RECORD sRecord;
   
-  IAP_CONTR = 0x80u;  // EEPROM is enabled
-  IAP_TPS = SYSTEM_CLOCK_MHZ;
-  IAP_CMD = 0x02u;  // Write operation
-  for( u8Index = 0u; u8Index < u8DataLength; u8Index++ )
+  gu8WriteSlot = 1u;
+  for( u8Slot = 1u; u8Slot < SLOTS_PER_PAGE; u8Slot++ )
   {
-    IAP_ADDRL = u16Address;
-    IAP_ADDRH = (u16Address>>8u) & 0x0Fu;  // only lower 12 bits are used
-    IAP_DATA = pu8Data[ u8Index ];
-    // Initiate command by magic code sequence
-    IAP_TRIG = 0x5Au;
-    IAP_TRIG = 0xA5u;
-    NOP();
-    NOP();
-    u16Address++;
+    IAP_Read( RECORD_ADDRESS( u8Page, u8Slot ), (U8*)&sRecord, sizeof( S_PERSIST_RECORD ) );
+    if( TRUE == IsRecordEmpty( &sRecord ) )  // end of the log in this page
+    {
+      break;
+    }
+    gu8WriteSlot = u8Slot + 1u;
+    if( ( TRUE == IsRecordValid( &sRecord ) ) && ( sRecord.u8Key < PERSIST_KEYS_NUM ) )
+    {
+      gau32StoredValue[ sRecord.u8Key ] = sRecord.u32Value;
+      gau8StoredPage[ sRecord.u8Key ] = u8Page;
+    }
   }
-  IAP_CONTR = 0x00u;  // Clear flags, EEPROM is disabled
-  IAP_CMD   = 0u;
-  IAP_TRIG  = 0u;
-
-  ENABLE_IT;
 }
 
 //----------------------------------------------------------------------------
-//! \brief  Erases one page in EEPROM
-//! \param  u16Address: Address of page, the lower 9 bits are discarded
+//! \brief  Schedules erasing of a page, carrying forward the keys that live there
+//! \param  u8Page: index of the page
 //! \return -
-//! \global -
-//! \note   Stalls the CPU.
+//! \global gu8ErasePage, gu8CarryKeys, gbErasePending, gbEraseOverdue, gu16EraseScheduledMs
+//! \note   The erase itself is executed later by Persist_Task().
 //-----------------------------------------------------------------------------
-static void IAP_Erase( U16 u16Address )
+static void ScheduleEraseAhead( U8 u8Page )
 {
-  DISABLE_IT;
+  U8 u8Key;
   
-  IAP_CONTR = 0x80u;  // EEPROM is enabled
-  IAP_TPS = SYSTEM_CLOCK_MHZ;
-  IAP_CMD = 0x03u;  // Erase operation
-  IAP_ADDRL = u16Address;  // NOTE: lower 9 bits are automatically discarded
-  IAP_ADDRH = (u16Address>>8u) & 0x0Fu;  // only lower 12 bits are used
-  // Initiate command by magic code sequence
-  IAP_TRIG = 0x5Au;
-  IAP_TRIG = 0xA5u;
-  NOP();
-  NOP();
-  // Clear flags and registers
-  IAP_CONTR = 0x00u;  // Clear flags, EEPROM is disabled
-  IAP_CMD   = 0u;
-  IAP_TRIG  = 0u;
-  
-  ENABLE_IT;
+  // NOTE: keys still waiting to be carried forward are kept
+  for( u8Key = 0u; u8Key < PERSIST_KEYS_NUM; u8Key++ )
+  {
+    if( u8Page == gau8StoredPage[ u8Key ] )
+    {
+      gu8CarryKeys |= (U8)( 1u << u8Key );
+    }
+  }
+  gu8ErasePage = u8Page;
+  gbErasePending = TRUE;
+  gbEraseOverdue = FALSE;
+  gu16EraseScheduledMs = Util_GetTimerMs();
 }
 
 //----------------------------------------------------------------------------
-//! \brief  Reads given number of bytes from EEPROM
-//! \param  u16Address: Start address to be read. Only lower 12 bits are used.
-//! \param  pu8Data: data read from EEPROM are written here
-//! \param  u8DataLength: read length
+//! \brief  Starts writing a new record to the next free slot
+//! \param  u8Key: key of the record
+//! \param  u32Value: value of the record
 //! \return -
-//! \global -
-//! \note   Stalls the CPU.
+//! \global gsJobRecord, gu8JobIndex, gbJobActive
 //-----------------------------------------------------------------------------
-static void IAP_Read( U16 u16Address, U8* pu8Data, U8 u8DataLength )
+static void StartRecord( U8 u8Key, U32 u32Value )
 {
-  U8 u8Index;
+  gsJobRecord.u8Key = u8Key;
+  gsJobRecord.u8Version = PERSIST_SCHEMA_VERSION;
+  gsJobRecord.u32Value = u32Value;
+  gsJobRecord.u16CRC = Util_CRC16( (U8*)&gsJobRecord, sizeof( S_PERSIST_RECORD ) - sizeof( U16 ) );
+  gu8JobIndex = 0u;
+  gbJobActive = TRUE;
+}
 
-  DISABLE_IT;
-  
-  IAP_CONTR = 0x80u;  // EEPROM is enabled
-  IAP_TPS = SYSTEM_CLOCK_MHZ;
-  IAP_CMD = 0x01u;  // Read operation
-  for( u8Index = 0u; u8Index < u8DataLength; u8Index++ )
+//----------------------------------------------------------------------------
+//! \brief  Updates the RAM index after a record has been completely written
+//! \param  -
+//! \return -
+//! \global All globals from this module
+//-----------------------------------------------------------------------------
+static void CommitRecord( void )
+{
+  gbJobActive = FALSE;
+  if( PAGE_HEADER_KEY == gsJobRecord.u8Key )  // A new page has been opened
   {
-    IAP_ADDRL = u16Address;
-    IAP_ADDRH = (u16Address>>8u) & 0x0Fu;  // only lower 12 bits are used
-    // Initiate command by magic code sequence
-    IAP_TRIG = 0x5Au;
-    IAP_TRIG = 0xA5u;
-    NOP();
-    NOP();
-    // Output
-    pu8Data[ u8Index ] = IAP_DATA;
-    u16Address++;
+    // Erased-ahead invariant: the page after this one has to be blank
+    ScheduleEraseAhead( ( gu8WritePage + 1u ) % PERSIST_PAGES_NUM );
+  }
+  else
+  {
+    gau32StoredValue[ gsJobRecord.u8Key ] = gsJobRecord.u32Value;
+    gau8StoredPage[ gsJobRecord.u8Key ] = gu8WritePage;
+    gu8CarryKeys &= (U8)~( 1u << gsJobRecord.u8Key );
+  }
+  // Step to the next slot
+  gu8WriteSlot++;
+  if( gu8WriteSlot >= SLOTS_PER_PAGE )
+  {
+    gu8WriteSlot = 0u;
+    gu8WritePage = ( gu8WritePage + 1u ) % PERSIST_PAGES_NUM;
   }
-  IAP_CONTR = 0x00u;  // Clear flags, EEPROM is disabled
-  IAP_CMD   = 0u;
-  IAP_TRIG  = 0u;
-
-  ENABLE_IT;
 }
 
 
@@ -221,59 +340,212 @@ static void IAP_Read( U16 u16Address, U8* pu8Data, U8 u8DataLength )
 //-----------------------------------------------------------------------------
 void Persist_Init( void )
 {
+  S_PERSIST_RECORD sRecord;
+  U8   u8Page;
+  U8   u8Key;
+  BOOL bFound = FALSE;
+  
   // Enable EEPROM
-  IAP_CONTR = 0x80u;
-  IAP_TPS = SYSTEM_CLOCK_MHZ;
-  IAP_CMD = 0x01u;  // Read operation
-
-  // Find latest save and load it
-  if( TRUE == SearchForLatestSave( &gpsNextSaveSlot ) )
+  HAL_IAP_OPEN( HAL_IAP_READ );
+  
+  // Job queue is empty
+  gbJobActive = FALSE;
+  gbSavePending = FALSE;
+  gbErasePending = FALSE;
+  gbEraseOverdue = FALSE;
+  gu8JobIndex = 0u;
+  gu8CarryKeys = 0u;
+  gu8ErasePage = 0u;
+  // RAM index is empty
+  for( u8Key = 0u; u8Key < PERSIST_KEYS_NUM; u8Key++ )
   {
-    // persistent data are loaded to memory
+    gau32StoredValue[ u8Key ] = 0u;
+    gau8StoredPage[ u8Key ] = NO_PAGE;
   }
-  else  // Default values
+  gu32PageSequence = 0u;
+  gu8WritePage = 0u;
+  gu8WriteSlot = 0u;
+  
+  // Find the newest page by its header
+  for( u8Page = 0u; u8Page < PERSIST_PAGES_NUM; u8Page++ )
   {
-    memset( &gsPersistentData, 0, sizeof( S_PERSIST ) );
-    gpsNextSaveSlot = (S_PERSIST CODE*)EEPROM_BASEADDRESS;
+    IAP_Read( RECORD_ADDRESS( u8Page, 0u ), (U8*)&sRecord, sizeof( S_PERSIST_RECORD ) );
+    if( ( TRUE == IsRecordValid( &sRecord ) ) && ( PAGE_HEADER_KEY == sRecord.u8Key ) &&
+        ( ( FALSE == bFound ) || ( sRecord.u32Value > gu32PageSequence ) ) )
+    {
+      gu32PageSequence = sRecord.u32Value;
+      gu8WritePage = u8Page;
+      bFound = TRUE;
+    }
+  }
+  
+  if( TRUE == bFound )
+  {
+    // Replay the ring from the oldest page to the newest one
+    u8Page = gu8WritePage;
+    do
+    {
+      u8Page = ( u8Page + 1u ) % PERSIST_PAGES_NUM;
+      IAP_Read( RECORD_ADDRESS( u8Page, 0u ), (U8*)&sRecord, sizeof( S_PERSIST_RECORD ) );
+      if( ( TRUE == IsRecordValid( &sRecord ) ) && ( PAGE_HEADER_KEY == sRecord.u8Key ) )
+      {
+        ReplayPage( u8Page );  // the last call sets the write slot in the newest page
+      }
+    } while( u8Page != gu8WritePage );
+    
+    if( gu8WriteSlot >= SLOTS_PER_PAGE )  // Newest page is full, the next one needs a header
+    {
+      gu8WriteSlot = 0u;
+      gu8WritePage = ( gu8WritePage + 1u ) % PERSIST_PAGES_NUM;
+      if( FALSE == IsPageEmpty( gu8WritePage ) )
+      {
+        ScheduleEraseAhead( gu8WritePage );
+      }
+    }
+    else if( FALSE == IsPageEmpty( ( gu8WritePage + 1u ) % PERSIST_PAGES_NUM ) )
+    {
+      // Erase-ahead was interrupted by a power loss
+      ScheduleEraseAhead( ( gu8WritePage + 1u ) % PERSIST_PAGES_NUM );
+    }
+  }
+  else if( FALSE == IsPageEmpty( 0u ) )  // No valid log, but garbage or an older format is there
+  {
+    ScheduleEraseAhead( 0u );
+  }
+  
+  // Load the persistent data from the RAM index
+  memset( &gsPersistentData, 0, sizeof( S_PERSIST ) );
+  for( u8Key = 0u; u8Key < PERSIST_KEYS_NUM; u8Key++ )
+  {
+    if( NO_PAGE != gau8StoredPage[ u8Key ] )
+    {
+      SetField( u8Key, gau32StoredValue[ u8Key ] );
+    }
   }
 }
 
 //----------------------------------------------------------------------------
-//! \brief  Saves the current persistent data structure
+//! \brief  Requests saving the current persistent data structure
 //! \param  -
 //! \return -
-//! \global -
-//! \note   Disables interrupt for a short time. Stalls the CPU during writing.
+//! \global gbSavePending
+//! \note   Non-blocking. Only the changed keys are appended later by Persist_Task().
 //-----------------------------------------------------------------------------
 void Persist_Save( void )
 {
-  S_PERSIST sLocalCopy;
-  U16       u16PrevSaveAddress = (U16)gpsNextSaveSlot;
+  gbSavePending = TRUE;
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Advances the EEPROM writer by one step
+//! \param  bDark: TRUE if nothing is lit, a page erase can't be seen
+//! \param  bIdleGap: TRUE if the LEDs don't change for PERSIST_ERASE_GAP_MS, used after PERSIST_ERASE_WAIT_MS
+//! \return -
+//! \global All globals from this module
+//! \note   Should be called from main cycle. Programs at most one byte or erases one page per call.
+//!         Saves take precedence over the erase-ahead, so they only cost the byte programs.
+//!         An erase in an idle gap freezes the lit LEDs for one erase time.
+//-----------------------------------------------------------------------------
+void Persist_Task( BOOL bDark, BOOL bIdleGap )
+{
+  U8   u8Key;
+  BOOL bEraseAllowed;
+  
+  if( ( TRUE == gbErasePending ) && ( FALSE == gbEraseOverdue )
+   && ( (U16)( Util_GetTimerMs() - gu16EraseScheduledMs ) >= PERSIST_ERASE_WAIT_MS ) )
+  {
+    gbEraseOverdue = TRUE;
+  }
+  bEraseAllowed = ( bDark || ( bIdleGap && gbEraseOverdue ) );
   
-  // Assuming that the gpsNextSaveSlot pointer is correct...
-  DISABLE_IT;
-  memcpy( &sLocalCopy, &gsPersistentData, sizeof( S_PERSIST ) );
-  ENABLE_IT;
-  // Calculate CRC
-  sLocalCopy.u16CRC = Util_CRC16( (U8*)&sLocalCopy, sizeof( S_PERSIST ) - sizeof( U16 ) );
-  // Write EEPROM
-  IAP_Write( (U16)gpsNextSaveSlot, (U8*)&sLocalCopy, sizeof( S_PERSIST ) );
-  // Check if next block is empty; if not, erase
-  gpsNextSaveSlot++;
-  if( FALSE == IsSaveBlockEmpty( &sLocalCopy, gpsNextSaveSlot ) )
+  if( TRUE == gbJobActive )  // Record is being written
+  {
+    IAP_WriteByte( RECORD_ADDRESS( gu8WritePage, gu8WriteSlot ) + gu8JobIndex, ((U8*)&gsJobRecord)[ gu8JobIndex ] );
+    gu8JobIndex++;
+    if( gu8JobIndex >= sizeof( S_PERSIST_RECORD ) )  // Record is complete
+    {
+      CommitRecord();
+    }
+  }
+  else if( ( TRUE == gbErasePending ) && ( gu8ErasePage == gu8WritePage ) )  // The page to be opened is not blank yet
   {
-    // If the page boundary is inside the save slot
-    if( ((U16)gpsNextSaveSlot & 0xFE00u) < u16PrevSaveAddress )
+    if( TRUE == bEraseAllowed )
     {
-      IAP_Erase( ((U16)gpsNextSaveSlot) + sizeof( S_PERSIST ) );
+      IAP_Erase( RECORD_ADDRESS( gu8ErasePage, 0u ) );
+      gbErasePending = FALSE;
     }
-    else
+  }
+  else if( ( 0u == gu8WriteSlot ) && ( ( TRUE == gbSavePending ) || ( 0u != gu8CarryKeys ) ) )  // Open a new page
+  {
+    gu32PageSequence++;
+    StartRecord( PAGE_HEADER_KEY, gu32PageSequence );
+  }
+  else if( 0u != gu8CarryKeys )  // Carry forward the keys of the page to be erased
+  {
+    u8Key = 0u;
+    while( 0u == ( gu8CarryKeys & (U8)( 1u << u8Key ) ) )
+    {
+      u8Key++;
+    }
+    StartRecord( u8Key, GetField( u8Key ) );
+  }
+  else if( TRUE == gbSavePending )  // Append the first changed key
+  {
+    for( u8Key = 0u; u8Key < PERSIST_KEYS_NUM; u8Key++ )
+    {
+      if( ( NO_PAGE == gau8StoredPage[ u8Key ] ) || ( GetField( u8Key ) != gau32StoredValue[ u8Key ] ) )
+      {
+        break;
+      }
+    }
+    if( u8Key < PERSIST_KEYS_NUM )
+    {
+      StartRecord( u8Key, GetField( u8Key ) );
+    }
+    else  // Everything is stored
+    {
+      gbSavePending = FALSE;
+    }
+  }
+  else if( TRUE == gbErasePending )  // Background erase, only when it can't be seen
+  {
+    if( TRUE == bEraseAllowed )
     {
-      IAP_Erase( (U16)gpsNextSaveSlot );
+      IAP_Erase( RECORD_ADDRESS( gu8ErasePage, 0u ) );
+      gbErasePending = FALSE;
     }
   }
 }
 
-#warning "Test this module!"
+//----------------------------------------------------------------------------
+//! \brief  Returns the state of the EEPROM writer
+//! \param  -
+//! \return TRUE if there is unfinished EEPROM work
+//! \global gbJobActive, gbSavePending, gbErasePending, gu8CarryKeys
+//-----------------------------------------------------------------------------
+BOOL Persist_Busy( void )
+{
+  return ( gbJobActive || gbSavePending || gbErasePending || ( 0u != gu8CarryKeys ) );
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Finishes all pending EEPROM work
+//! \param  -
+//! \return -
+//! \global -
+//! \note   Blocking, erases are allowed. Should be called right before power-down.
+//-----------------------------------------------------------------------------
+void Persist_Flush( void )
+{
+  while( TRUE == Persist_Busy() )
+  {
+    Persist_Task( TRUE, TRUE );
+  }
+}
+
+
+/***************************************< Static assertions >**************************************/
+STATIC_ASSERT( sizeof( S_PERSIST_RECORD ) == 8u );  // Records must tile the pages
+
 
 /***************************************< End of file >**************************************/
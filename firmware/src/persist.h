@@ -16,16 +16,46 @@
 
 
 /***************************************< Definitions >**************************************/
+#define PERSIST_ERASE_GAP_MS    (20u)  //!< Minimum animation idle gap, in which a page erase (~5 ms stall) can be hidden
+#define PERSIST_ERASE_WAIT_MS (10000u)  //!< Wait for a dark frame, before a page erase falls back to a lit idle gap
+#define PERSIST_SCHEMA_VERSION   (1u)  //!< Version of the record format; records of other versions are ignored
 
 
 /***************************************< Types >**************************************/
-//! \brief Structure for persistent data
-typedef PACKED struct
+//! \brief Keys of the persistent data fields
+//! \note  At most 8 keys are supported. Never reorder them, only append new ones.
+typedef enum
+{
+  PERSIST_KEY_ANIMATION = 0u,  //!< u8AnimationIndex
+  PERSIST_KEY_RUNTIME,         //!< u32RuntimeMs
+#if ( PROFILE_ENABLED == 1 )
+  PERSIST_KEY_PROFILE_ISR,     //!< u32ProfileISR
+  PERSIST_KEY_PROFILE_HEALTH,  //!< u32ProfileHealth
+#endif
+  PERSIST_KEYS_NUM             //!< Number of keys
+} E_PERSIST_KEY;
+
+//! \brief Structure for persistent data, every field is stored under its own key
+typedef struct
 {
   U8  u8AnimationIndex;             //!< Index of the last played animation
-  U16 u16CRC;                       //!< CRC for protecting structure against bit errors
+  U32 u32RuntimeMs;                 //!< Accumulated runtime of the device
+#if ( PROFILE_ENABLED == 1 )
+  U32 u32ProfileISR;                //!< Timer 0 interrupt: average cycles (bits 31..16), maximum cycles (bits 15..0)
+  U32 u32ProfileHealth;             //!< Lost ticks (bits 31..16), longest main cycle in ms (15..8), free stack bytes (7..0)
+#endif
 } S_PERSIST;
 
+//! \brief Record of the key-value log in the EEPROM
+//! \note  Fields are naturally aligned, so the layout is the same on the host simulation. CRC must be the last.
+typedef PACKED struct
+{
+  U32 u32Value;                     //!< Value of the field, or sequence number of the page
+  U8  u8Key;                        //!< Key of the record (E_PERSIST_KEY) or page header
+  U8  u8Version;                    //!< Schema version of the record
+  U16 u16CRC;                       //!< CRC for protecting the record against bit errors and torn writes
+} S_PERSIST_RECORD;
+
 
 /***************************************< Constants >**************************************/
 
@@ -37,6 +67,9 @@ extern DATA S_PERSIST gsPersistentData;
 /***************************************< Public functions >**************************************/
 void Persist_Init( void );
 void Persist_Save( void );
+void Persist_Task( BOOL bDark, BOOL bIdleGap );
+BOOL Persist_Busy( void );
+void Persist_Flush( void );
 
 
 #endif /* PERSIST_H */
@@ -3,7 +3,7 @@
 *
 * \file platform.h
 *
-* \brief Compiler-specific directives
+* \brief Target selection and compiler-specific directives
 *
 * \author Hekk_Elek
 *
@@ -14,6 +14,20 @@
 /***************************************< Includes >**************************************/
 
 /***************************************< Definitions >**************************************/
+// Target microcontrollers
+#define MCU_STC8G  (0)  //!< STC8G1K08: every LED is driven by soft-PWM from the timer 0 interrupt
+#define MCU_STC8H  (1)  //!< STC8H1K08: the LEDs on PWMA/PWMB outputs are driven by the hardware PWM
+
+#ifndef MCU_TYPE  // May be given on the command line, e.g. -DMCU_TYPE=1 (C51: Options for Target, Define)
+#define MCU_TYPE  MCU_STC8G  //!< Selected target, the SFR definitions in stc8g.h follow it
+#endif
+
+#if ( MCU_TYPE == MCU_STC8H ) && ( defined( __IAR_SYSTEMS_ICC__ ) || defined( HOST_BUILD ) )
+#error "The STC8H target is supported with Keil C51 and SDCC only, the host simulation emulates the STC8G"
+#endif
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////
 #ifdef __IAR_SYSTEMS_ICC__
 // Include intrinsic functions
 #include <intrinsics.h>
@@ -35,7 +49,10 @@
 #define IT_PRE     __interrupt
 #define ITVECTOR0  
 #define ITVECTOR1  
+#define ITVECTOR4  
+#define ITVECTOR5  
 #define ITVECTOR10  
+#define REGBANK1     //NOTE: bank switching is not used with this compiler
 
 //NOTE: In IAR 8051 everything is packed by default
 #define PACKED 
@@ -44,6 +61,70 @@
 #define STATIC_ASSERT(expr) typedef char static_assertion[(expr)?1:-1]
 
 
+/////////////////////////////////////////////////////////////////////////////////////////////
+#elif defined( HOST_BUILD )  // Host simulation, compiled as C++ (see tools/host)
+// No operation intrinsic macro
+#define NOP()
+#define _nop_()
+
+// Storage classifiers
+#define DATA
+#define IDATA
+#define XDATA
+#define CODE
+#define REENTRANT
+
+// Bit definition
+#define BIT        unsigned char
+
+// Interrupt definition
+#define IT_PRE
+#define ITVECTOR0
+#define ITVECTOR1
+#define ITVECTOR4
+#define ITVECTOR5
+#define ITVECTOR10
+#define REGBANK1
+
+//NOTE: structures stored in EEPROM are naturally aligned, so no packing is needed
+#define PACKED
+
+// Compile-time size assertion
+#define STATIC_ASSERT(expr) typedef char static_assertion[(expr)?1:-1]
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+#elif defined( __SDCC )  // SDCC, -mmcs51 (see the Makefile)
+// No operation intrinsic macro
+#define NOP()    __asm__( "nop" )
+#define _nop_()  __asm__( "nop" )
+
+// Storage classifiers
+#define DATA       __data
+#define IDATA      __idata
+#define XDATA      __xdata
+#define CODE       __code
+#define REENTRANT  __reentrant
+
+// Bit definition
+#define BIT        __bit
+
+// Interrupt definition
+#define IT_PRE
+#define ITVECTOR0   __interrupt( 0 )
+#define ITVECTOR1   __interrupt( 1 )
+#define ITVECTOR4   __interrupt( 4 )
+#define ITVECTOR5   __interrupt( 5 )
+#define ITVECTOR10  __interrupt( 10 )
+#define REGBANK1    __using( 1 )  //!< Register bank of the timer 0 interrupt, nothing else may use it
+
+//NOTE: SDCC doesn't pad the structures on the 8051
+#define PACKED
+
+// Compile-time size assertion
+#define STATIC_ASSERT(expr) _Static_assert( (expr), #expr )
+
+
 /////////////////////////////////////////////////////////////////////////////////////////////
 #else  // Keil C51
 // Include intrinsic functions
@@ -66,7 +147,10 @@
 #define IT_PRE     
 #define ITVECTOR0   interrupt 0
 #define ITVECTOR1   interrupt 1
+#define ITVECTOR4   interrupt 4
+#define ITVECTOR5   interrupt 5
 #define ITVECTOR10  interrupt 10
+#define REGBANK1    using 1  //!< Register bank of the timer 0 interrupt, nothing else may use it
 
 //NOTE: In Keil C51 everything is packed by default
 #define PACKED
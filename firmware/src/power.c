@@ -0,0 +1,276 @@
+/*! *******************************************************************************************************
+* Copyright (c) 2022 Hekk_Elek
+*
+* \file power.c
+*
+* \brief Power manager: clock governor, idle sleep and tickless power-down during dark animation phases
+*
+* \author Hekk_Elek
+*
+**********************************************************************************************************/
+
+/*----------------------------------------------------------------------------------------
+How it works
+============
+Normally the main loop sleeps in idle mode, and timer 0 wakes it up 10000 times per second.
+If nothing is lit and the animation will not change anything for a while, this is a waste:
+timer 0 is stopped instead, and the MCU is put to power-down mode. The power-down wake-up
+timer (WKT) wakes it up when the next animation instruction is due, and the global
+millisecond timer is advanced by the time spent in power-down, so all the timers of the
+firmware stay consistent. The button (INT2) wakes the MCU up too; then the internal counter
+of the WKT, which stops at the wake-up and can be read at WKTCL/WKTCH, tells the time spent.
+The INT2 interrupt advances the timer by it, before the button driver takes the time of the
+edge; whichever of the interrupt and the main cycle comes first does the advance.
+An edge between the check of the button in the main cycle and the power-down would be
+slept through: with the interrupts masked, the button is checked again right before it.
+
+When the device is turned off, everything is stopped, and only the button can wake it up.
+In that case INT2 resets the MCU, so it starts up as if it was just powered.
+
+While the MCU is awake, most of the time it only does the soft-PWM of the normal LEDs, which
+needs a small fraction of the 24 MHz clock. The clock governor divides the system clock by
+2^CLOCK_SHIFT_LOW in this case, and switches back to full speed when the RGB LED is lit (its
+current pulses are timed by busy loops in the interrupt) or EEPROM work is pending. The tick
+period, the pulse lengths and the IAP wait states follow the divider (see Util_SetClockShift).
+----------------------------------------------------------------------------------------*/
+
+/***************************************< Includes >**************************************/
+// Own includes
+#include "hal.h"
+#include "types.h"
+#include "util.h"
+#include "led.h"
+#include "rgbled.h"
+#include "animation.h"
+#include "persist.h"
+#include "telemetry.h"
+#include "button.h"
+#include "power.h"
+
+
+/***************************************< Definitions >**************************************/
+#define WKT_FREQUENCY_ADDRESS   (0xF8u)  //!< IDATA address of the factory-measured WKT frequency (Hz, big-endian)
+#define WKT_FREQUENCY_NOMINAL  (32000u)  //!< Nominal WKT frequency, if the factory value is not available
+#define WKT_FREQUENCY_MIN      (20000u)  //!< Lowest plausible WKT frequency
+#define WKT_FREQUENCY_MAX      (45000u)  //!< Highest plausible WKT frequency
+#define WKT_COUNT_MAX         (0x7FFFu)  //!< The WKT counter has 15 bits
+#define WKTCH_WKTEN             (0x80u)  //!< Wake-up timer enable bit
+
+
+/***************************************< Types >**************************************/
+
+
+/***************************************< Constants >**************************************/
+
+
+/***************************************< Global variables >**************************************/
+static U16 gu16WKTCountsPerMs;  //!< WKT counts per millisecond, 8.8 fixed-point
+static U8  gu8WKTMsPerCount;    //!< Milliseconds per WKT count, 0.8 fixed-point
+static BIT gbTicklessSleep;     //!< Set while in tickless power-down
+static BIT gbButtonWakeUp;      //!< Set if the button ended the tickless power-down
+static BIT gbPoweredDown;       //!< Set from the power-down until the timer is advanced by the time spent in it
+static BIT gbTurnedOff;         //!< Set if the device is turned off, waking up means reset
+
+
+/***************************************< Static function definitions >**************************************/
+static U16 WKTElapsedMs( void );
+
+
+/***************************************< Private functions >**************************************/
+//----------------------------------------------------------------------------
+//! \brief  Time spent in the last power-down, from the internal counter of the WKT
+//! \param  -
+//! \return Milliseconds
+//! \global gu8WKTMsPerCount
+//! \note   Called from the INT2 interrupt only. 8x8 bit multiplications only (MUL AB), so no
+//!         arithmetic library routine is shared with the main cycle.
+//-----------------------------------------------------------------------------
+static U16 WKTElapsedMs( void )
+{
+  U8 u8CountsLow = WKTCL;  // The counter stopped at the wake-up, it can be read in any order
+  U8 u8CountsHigh = WKTCH & 0x7Fu;
+
+  // ( counts * ms/count ) >> 8 = high * ms/count + ( ( low * ms/count ) >> 8 )
+  return (U16)( (U16)u8CountsHigh * gu8WKTMsPerCount ) + (U8)( ( (U16)u8CountsLow * gu8WKTMsPerCount ) >> 8u );
+}
+
+
+/***************************************< Public functions >**************************************/
+//----------------------------------------------------------------------------
+//! \brief  Initializes the power manager
+//! \param  -
+//! \return -
+//! \global gu16WKTCountsPerMs, gu8WKTMsPerCount, gbTicklessSleep, gbButtonWakeUp, gbPoweredDown, gbTurnedOff
+//! \note   Should be called from init block, before the stack could overwrite the top of IDATA.
+//-----------------------------------------------------------------------------
+void Power_Init( void )
+{
+  U16 u16Frequency;
+
+  // The ISP tool stores the measured frequency of the WKT oscillator at the top of IDATA
+  u16Frequency = ( (U16)( *(U8 IDATA*)WKT_FREQUENCY_ADDRESS ) << 8u ) | *(U8 IDATA*)( WKT_FREQUENCY_ADDRESS + 1u );
+  if( ( u16Frequency < WKT_FREQUENCY_MIN ) || ( u16Frequency > WKT_FREQUENCY_MAX ) )
+  {
+    u16Frequency = WKT_FREQUENCY_NOMINAL;
+  }
+  // The WKT counts once every 16 clocks: counts/ms = f/16000 = f*0.016 ~= f*131/8192 (0.06% error, no division)
+  // In 8.8 fixed-point: f*131*256/8192 = f*131/32
+  gu16WKTCountsPerMs = (U16)( ( (U32)u16Frequency * 131u ) >> 5u );
+  // The other way round, for a wake-up by the button: ms/count = 16000/f, in 0.8 fixed-point (91..204)
+  gu8WKTMsPerCount = (U8)( ( 16000UL << 8u ) / u16Frequency );
+  gbTicklessSleep = FALSE;
+  gbButtonWakeUp = FALSE;
+  gbPoweredDown = FALSE;
+  gbTurnedOff = FALSE;
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Selects the system clock for the current workload
+//! \param  -
+//! \return -
+//! \global -
+//! \note   Should be called from main cycle.
+//-----------------------------------------------------------------------------
+void Power_ClockGovernor( void )
+{
+  U8 u8Color;
+  U8 u8ClockShift = CLOCK_SHIFT_LOW;
+
+  if( TRUE == Persist_Busy() )
+  {
+    u8ClockShift = 0u;
+  }
+  for( u8Color = 0u; u8Color < NUM_RGBLED_COLORS; u8Color++ )
+  {
+    if( 0u != gau8RGBLEDs[ u8Color ] )
+    {
+      u8ClockShift = 0u;
+    }
+  }
+  // The UART baud rate depends on the clock: it's changed only between telemetry frames
+  if( FALSE == TELEMETRY_BUSY() )
+  {
+    Util_SetClockShift( u8ClockShift );
+  }
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Sleeps until the next interrupt, or until the next deadline if nothing is lit
+//! \param  u16IdleGapMs: milliseconds until the next deadline (animation change or software timer)
+//! \param  bTicklessAllowed: FALSE if some other activity (e.g. button polling) needs the timer
+//! \return -
+//! \global gbTicklessSleep, gbButtonWakeUp, gbPoweredDown, gu16WKTCountsPerMs
+//! \note   Should be called at the end of the main cycle.
+//-----------------------------------------------------------------------------
+void Power_Sleep( U16 u16IdleGapMs, BOOL bTicklessAllowed )
+{
+  U16 u16Counts;
+
+  if( ( TRUE == bTicklessAllowed )
+   && ( u16IdleGapMs >= POWER_TICKLESS_MIN_MS )
+   && ( TRUE == Animation_IsDark() )
+   && ( FALSE == Persist_Busy() )
+   && ( FALSE == HAL_ADC_POWERED() ) )  // No battery measurement in progress
+  {
+    if( u16IdleGapMs > POWER_TICKLESS_MAX_MS )
+    {
+      u16IdleGapMs = POWER_TICKLESS_MAX_MS;
+    }
+    u16Counts = (U16)( ( (U32)u16IdleGapMs * gu16WKTCountsPerMs ) >> 8u );
+    if( u16Counts > WKT_COUNT_MAX )
+    {
+      u16Counts = WKT_COUNT_MAX;
+    }
+    // Stop the 10 kHz tick, every output is off anyway
+    HAL_TIMER0_STOP();
+    gbButtonWakeUp = FALSE;
+    gbTicklessSleep = TRUE;
+    // Wake up after ( WKTC + 1 ) counts
+    WKTCL = (U8)( u16Counts - 1u );
+    WKTCH = WKTCH_WKTEN | (U8)( ( u16Counts - 1u ) >> 8u );
+    // The button (INT2) wakes up too. An edge since the main cycle checked it is in the queue or
+    // pending, from now on it also sets gbButtonWakeUp: then the power-down is skipped. After
+    // writing IE the 8051 executes one more instruction before an interrupt, so no edge can be
+    // served between EA = 1 and the power-down.
+    EA = 0;
+    if( ( TRUE == Button_Idle() ) && ( FALSE == gbButtonWakeUp ) )
+    {
+      gbPoweredDown = TRUE;
+      EA = 1;
+      HAL_POWER_DOWN();
+      NOP();
+      NOP();
+      // Woken up; if the INT2 interrupt hasn't advanced the timer, the wake-up timer has expired
+      EA = 0;
+      if( TRUE == gbPoweredDown )
+      {
+        gbPoweredDown = FALSE;
+        Util_AdvanceTimerMs( u16IdleGapMs );
+      }
+    }
+    EA = 1;
+    WKTCH = 0x00u;
+    gbTicklessSleep = FALSE;
+    HAL_TIMER0_START();
+  }
+  else
+  {
+    // Sleep until next interrupt
+    HAL_IDLE();
+  }
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Turns the device off: power-down until the button is pressed
+//! \param  -
+//! \return -
+//! \global gbTurnedOff
+//! \note   Persistent data should be saved before. Doesn't return, the button press resets the MCU.
+//-----------------------------------------------------------------------------
+void Power_Off( void )
+{
+  EA = 0;   // Disable all interrupts
+  HAL_TIMER0_STOP();
+  ET0 = 0;  // Disable Timer 0 interrupt
+  EADC = 0;  // Stop battery monitoring
+  HAL_ADC_POWER_DOWN();
+  LED_STOP();  // The pins follow the latches, not the hardware PWM
+  P1 = 0xFFu;  // Set all pins to 1
+  P3 = 0xFFu;
+  P5 = 0x3Fu;
+  P1M0 = 0x00u;  // All pins must be bidirectional
+  P1M1 = 0x00u;
+  P3M0 = 0x00u;
+  P3M1 = 0x00u;
+  P5M0 = 0x00u;
+  P5M1 = 0x00u;
+  gbTurnedOff = TRUE;  // INT2 stays enabled, it resets the MCU
+  EA = 1;  // Enable all interrupts
+  HAL_POWER_DOWN();
+  while( TRUE );  // This should not be reached...
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Handles the INT2 (button) interrupt
+//! \param  -
+//! \return TRUE, if the device was turned off and should be reset; FALSE, if it's running
+//! \global gbTicklessSleep, gbButtonWakeUp, gbPoweredDown, gbTurnedOff, gu16TimerMS
+//! \note   Should be called from the INT2 interrupt routine, before the button driver.
+//-----------------------------------------------------------------------------
+BOOL Power_Interrupt( void )
+{
+  if( TRUE == gbTicklessSleep )
+  {
+    gbButtonWakeUp = TRUE;
+  }
+  if( TRUE == gbPoweredDown )
+  {
+    // Woken up from the tickless power-down: timer 0 is stopped, the time spent is added here
+    gbPoweredDown = FALSE;
+    gu16TimerMS += WKTElapsedMs();
+  }
+  return gbTurnedOff;
+}
+
+
+/***************************************< End of file >**************************************/
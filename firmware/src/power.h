@@ -0,0 +1,42 @@
+/*! *******************************************************************************************************
+* Copyright (c) 2022 Hekk_Elek
+*
+* \file power.h
+*
+* \brief Power manager: clock governor, idle sleep and tickless power-down during dark animation phases
+*
+* \author Hekk_Elek
+*
+**********************************************************************************************************/
+#ifndef POWER_H
+#define POWER_H
+
+/***************************************< Includes >**************************************/
+#include "types.h"
+
+
+/***************************************< Definitions >**************************************/
+#define POWER_TICKLESS_MIN_MS    (20u)  //!< Shortest dark phase worth a power-down instead of idle
+#define POWER_TICKLESS_MAX_MS (10000u)  //!< Longest power-down, limited by the 15-bit wake-up timer
+
+
+/***************************************< Types >**************************************/
+
+
+/***************************************< Constants >**************************************/
+
+
+/***************************************< Global variables >**************************************/
+
+
+/***************************************< Public functions >**************************************/
+void Power_Init( void );
+void Power_ClockGovernor( void );
+void Power_Sleep( U16 u16IdleGapMs, BOOL bTicklessAllowed );
+void Power_Off( void );
+BOOL Power_Interrupt( void );
+
+
+#endif /* POWER_H */
+
+/***************************************< End of file >**************************************/
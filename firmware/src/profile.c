@@ -0,0 +1,170 @@
+/*! *******************************************************************************************************
+* Copyright (c) 2022 Hekk_Elek
+*
+* \file profile.c
+*
+* \brief Optional runtime instrumentation: timer 0 interrupt duration and overruns, main cycle
+*        latency, stack high-water mark
+*
+* \author Hekk_Elek
+*
+**********************************************************************************************************/
+
+/*----------------------------------------------------------------------------------------
+How it works
+============
+Enabled by PROFILE_ENABLED in config.h; otherwise the hooks expand to nothing.
+
+Timer 1 runs freely in 1T mode, so it counts system clock cycles; it wraps around in 2.7 ms
+at 24 MHz, which is much longer than the 100 us tick. The timer 0 interrupt reads it at its
+beginning and its end (PROFILE_ISR_ENTRY/EXIT), and keeps the maximum and a running average
+of the difference. The entry and exit code of the compiler (register saving) is not included.
+If TF0 is set again at the end of the interrupt, the next tick is already due, and clearing
+the flag drops it: this is counted as an overrun.
+
+The main cycle latency is the time from the time snapshot of the cycle until it goes to
+sleep, in ms. Sleeping is excluded, as a power-down may last for seconds by design.
+
+At init, the unused part of the stack (from SP up to the end of the internal RAM) is painted
+with PROFILE_STACK_PATTERN. The deepest point the stack ever reached is found by searching
+for the first overwritten byte from the top.
+
+The counters are written to the persistent data at shutdown (PERSIST_KEY_PROFILE_*), so they
+can be read out from the EEPROM with the ISP tool.
+----------------------------------------------------------------------------------------*/
+
+/***************************************< Includes >**************************************/
+// Own includes
+#include "hal.h"
+#include "types.h"
+#include "util.h"
+#include "persist.h"
+#include "profile.h"
+
+#if ( PROFILE_ENABLED == 1 )
+
+/***************************************< Definitions >**************************************/
+#define STACK_TOP          (0xFFu)  //!< Last byte of the internal RAM
+#define AUXR_T1X12         (0x40u)  //!< Timer 1 runs in 1T mode
+#define TMOD_T1_MASK       (0xF0u)  //!< Timer 1 bits of TMOD; 0: 16-bit auto-reload timer
+
+
+/***************************************< Types >**************************************/
+
+
+/***************************************< Constants >**************************************/
+
+
+/***************************************< Global variables >**************************************/
+DATA U16 gu16ProfileISRStart;  //!< Cycle counter at the start of the current interrupt
+DATA U16 gu16ProfileISRMax;    //!< Longest timer 0 interrupt (cycles)
+DATA U16 gu16ProfileISRAvg16;  //!< Running average of the timer 0 interrupt length (cycles * 16)
+DATA U16 gu16ProfileOverruns;  //!< Number of lost ticks, saturated
+static U8 gu8LoopMaxMs;        //!< Longest main cycle without sleeping (ms), saturated
+
+
+/***************************************< Static function definitions >**************************************/
+
+
+/***************************************< Private functions >**************************************/
+
+
+/***************************************< Public functions >**************************************/
+//----------------------------------------------------------------------------
+//! \brief  Starts the cycle counter and paints the stack
+//! \param  -
+//! \return -
+//! \global All globals in this module
+//! \note   Should be called from init block, before enabling interrupts. The painting overwrites the
+//!         factory data at the end of the internal RAM, so it must be after Power_Init().
+//-----------------------------------------------------------------------------
+void Profile_Init( void )
+{
+  U8 IDATA* pu8Stack;
+
+  gu16ProfileISRStart = 0u;
+  gu16ProfileISRMax = 0u;
+  gu16ProfileISRAvg16 = 0u;
+  gu16ProfileOverruns = 0u;
+  gu8LoopMaxMs = 0u;
+
+  // Timer 1: free-running 16-bit counter of the system clock, without interrupt
+  TR1 = 0;
+  ET1 = 0;
+  AUXR |= AUXR_T1X12;
+  TMOD &= (U8)~TMOD_T1_MASK;
+  TL1 = 0u;  // Reload value is 0 too, as the timer is stopped
+  TH1 = 0u;
+  TF1 = 0;
+  TR1 = 1;
+
+  // Paint the unused stack, up to and including the last byte
+  pu8Stack = (U8 IDATA*)SP;
+  do
+  {
+    pu8Stack++;
+    *pu8Stack = PROFILE_STACK_PATTERN;
+  } while( pu8Stack != (U8 IDATA*)STACK_TOP );
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Measures the busy part of the main cycle
+//! \param  -
+//! \return -
+//! \global gu8LoopMaxMs
+//! \note   Should be called from main cycle, right before going to sleep.
+//-----------------------------------------------------------------------------
+void Profile_LoopEnd( void )
+{
+  U16 u16BusyMs = Util_GetTimerMs() - gu16TimeSnapshotMs;
+
+  if( u16BusyMs > 0xFFu )
+  {
+    u16BusyMs = 0xFFu;
+  }
+  if( (U8)u16BusyMs > gu8LoopMaxMs )
+  {
+    gu8LoopMaxMs = (U8)u16BusyMs;
+  }
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Gives the stack space that has never been used
+//! \param  -
+//! \return Number of bytes between the stack high-water mark and the end of the internal RAM
+//! \global -
+//-----------------------------------------------------------------------------
+U8 Profile_StackFree( void )
+{
+  U8 IDATA* pu8Stack = (U8 IDATA*)STACK_TOP;
+  U8 u8Free = 0u;
+
+  while( ( PROFILE_STACK_PATTERN == *pu8Stack ) && ( pu8Stack > (U8 IDATA*)SP ) )
+  {
+    pu8Stack--;
+    u8Free++;
+  }
+
+  return u8Free;
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Copies the counters to the persistent data
+//! \param  -
+//! \return -
+//! \global All globals in this module, gsPersistentData
+//! \note   Should be called before the last Persist_Save() at shutdown.
+//-----------------------------------------------------------------------------
+void Profile_Report( void )
+{
+  DISABLE_IT;  // The interrupt counters are read in one go
+  gsPersistentData.u32ProfileISR = ( (U32)( gu16ProfileISRAvg16 >> 4u ) << 16u ) | gu16ProfileISRMax;
+  gsPersistentData.u32ProfileHealth = ( (U32)gu16ProfileOverruns << 16u ) | ( (U16)gu8LoopMaxMs << 8u );
+  ENABLE_IT;
+  gsPersistentData.u32ProfileHealth |= Profile_StackFree();
+}
+
+#endif /* PROFILE_ENABLED */
+
+
+/***************************************< End of file >**************************************/
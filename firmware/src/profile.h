@@ -0,0 +1,100 @@
+/*! *******************************************************************************************************
+* Copyright (c) 2022 Hekk_Elek
+*
+* \file profile.h
+*
+* \brief Optional runtime instrumentation: timer 0 interrupt duration and overruns, main cycle
+*        latency, stack high-water mark
+*
+* \author Hekk_Elek
+*
+**********************************************************************************************************/
+#ifndef PROFILE_H
+#define PROFILE_H
+
+/***************************************< Includes >**************************************/
+#include "types.h"
+#include "config.h"
+
+
+/***************************************< Definitions >**************************************/
+#define PROFILE_STACK_PATTERN  (0xA5u)  //!< Unused stack bytes are painted with this value
+
+
+/***************************************< Macros >**************************************/
+#if ( PROFILE_ENABLED == 1 )
+//! \brief Reads timer 1, the cycle counter (high, low, then high again, in case the low byte overflowed)
+#define PROFILE_READ_CYCLES( u16Dest ) \
+  do \
+  { \
+    U8 u8High; \
+    U8 u8Low; \
+    do \
+    { \
+      u8High = TH1; \
+      u8Low = TL1; \
+    } while( u8High != TH1 ); \
+    (u16Dest) = ( (U16)u8High << 8u ) | u8Low; \
+  } while( 0 )
+
+//! \brief Start of the measured part of the timer 0 interrupt
+#define PROFILE_ISR_ENTRY()  PROFILE_READ_CYCLES( gu16ProfileISRStart )
+
+//! \brief End of the measured part of the timer 0 interrupt, before clearing TF0
+//! \note  TF0 is cleared by the hardware when the interrupt starts: if it's set again, a tick is lost
+#define PROFILE_ISR_EXIT() \
+  do \
+  { \
+    U16 u16Cycles; \
+    PROFILE_READ_CYCLES( u16Cycles ); \
+    u16Cycles -= gu16ProfileISRStart; \
+    if( u16Cycles > gu16ProfileISRMax ) \
+    { \
+      gu16ProfileISRMax = u16Cycles; \
+    } \
+    gu16ProfileISRAvg16 += u16Cycles - ( gu16ProfileISRAvg16 >> 4u ); \
+    if( ( 1 == TF0 ) && ( 0xFFFFu != gu16ProfileOverruns ) ) \
+    { \
+      gu16ProfileOverruns++; \
+    } \
+  } while( 0 )
+
+#define PROFILE_INIT()      Profile_Init()
+#define PROFILE_LOOP_END()  Profile_LoopEnd()
+#define PROFILE_REPORT()    Profile_Report()
+#else
+#define PROFILE_ISR_ENTRY()
+#define PROFILE_ISR_EXIT()
+#define PROFILE_INIT()
+#define PROFILE_LOOP_END()
+#define PROFILE_REPORT()
+#endif
+
+
+/***************************************< Types >**************************************/
+
+
+/***************************************< Constants >**************************************/
+
+
+/***************************************< Global variables >**************************************/
+#if ( PROFILE_ENABLED == 1 )
+extern DATA U16 gu16ProfileISRStart;
+extern DATA U16 gu16ProfileISRMax;
+extern DATA U16 gu16ProfileISRAvg16;
+extern DATA U16 gu16ProfileOverruns;
+#endif
+
+
+/***************************************< Public functions >**************************************/
+#if ( PROFILE_ENABLED == 1 )
+void Profile_Init( void );
+void Profile_LoopEnd( void );
+U8   Profile_StackFree( void );
+void Profile_Report( void );
+#endif
+
+
+#endif /* PROFILE_H */
+
+/***************************************< End of file >**************************************/
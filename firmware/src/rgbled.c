@@ -10,105 +10,58 @@
 **********************************************************************************************************/
 
 /***************************************< Includes >**************************************/
-#include "stc8g.h"
+#include "hal.h"
 #include <string.h>
 
 // Own includes
 #include "types.h"
+#include "util.h"
+#include "led.h"
 #include "rgbled.h"
 
 
 /***************************************< Definitions >**************************************/
-#define COLOR_LEVELS   (16u)  //!< Number of brightness levels per color
-#define PIN_S          (P55)  //!< GPIO pin for "S" LEDs
-#define PIN_E          (P54)  //!< GPIO pin for "E" LEDs
-#define PIN_1          (P37)  //!< GPIO pin for "1" LEDs
-#define PIN_5          (P33)  //!< GPIO pin for "5" LEDs
 
 
 /***************************************< Types >**************************************/
 
 
 /***************************************< Constants >**************************************/
+#if ( HAL_HARDWARE_PWM == 1 )
+//! \brief Pulse width for a share of the pulse cycle, in 1/256 of the full pulse: 256 * sqrt( index / 64 )
+//! \note  The energy of a pulse grows with the square of its width (the inductor current rises linearly),
+//!        so one narrower pulse in every PWM period gives the same light as a share of full pulses.
+static CODE const U8 gcau8RGBLEDWidth[ RGBLED_WIDTH_STEPS + 1u ] =
+{
+    0,  32,  45,  55,  64,  72,  78,  85,  91,  96, 101, 106, 111, 115, 120, 124,
+  128, 132, 136, 139, 143, 147, 150, 153, 157, 160, 163, 166, 169, 172, 175, 178,
+  181, 184, 187, 189, 192, 195, 197, 200, 202, 205, 207, 210, 212, 215, 217, 219,
+  222, 224, 226, 229, 231, 233, 235, 237, 239, 242, 244, 246, 248, 250, 252, 254,
+  255
+};
+#endif
 
 
 /***************************************< Global variables >**************************************/
 //! \brief Global array for RGB LED color values
-//! \note  Value set is between [0; COLOR_LEVELS)
-volatile U8 gau8RGBLEDs[ NUM_RGBLED_COLORS ];
+//! \note  Value set is between [0; RGBLED_COLOR_LEVELS)
+volatile DATA U8 gau8RGBLEDs[ NUM_RGBLED_COLORS ];
+//! \brief Length of the pulse cycle, set by the brightness governor
+//! \note  Longer than RGBLED_COLOR_LEVELS dims all colors, shorter brightens them
+DATA U8 gu8RGBLEDCycleLength;
+DATA U8 gu8RGBLEDCounter;  //!< Position in the pulse cycle
+#if ( HAL_HARDWARE_PWM == 1 )
+// What the hardware PWM was last set from, RGBLED_Update() writes the registers only on a change
+static IDATA U8 gau8PWMColors[ 2 ];   //!< Green ("E") and blue ("5") in the compare registers
+static IDATA U8 gu8PWMCycleLength;    //!< gu8RGBLEDCycleLength of the compare registers
+static IDATA U8 gu8PWMClockShift;     //!< gu8ClockShift of the compare registers
+#endif
 
 
 /***************************************< Static function definitions >**************************************/
-static void SPulseDelay( void );
-static void EPulseDelay( void );
-static void OnePulseDelay( void );
-static void FivePulseDelay( void );
 
 
 /***************************************< Private functions >**************************************/
-//----------------------------------------------------------------------------
-//! \brief  Delay for generating current pulse for red LED
-//! \param  -
-//! \return -
-//! \global -
-//! \note   Assumes 24 MHz clock!
-//-----------------------------------------------------------------------------
-static void SPulseDelay( void )
-{
-  // Wait for 3 usec
-	unsigned char i;
-
-	i = 22 + 100;
-	while (--i);
-}
-
-//----------------------------------------------------------------------------
-//! \brief  Delay for generating current pulse for green LED
-//! \param  -
-//! \return -
-//! \global -
-//! \note   Assumes 24 MHz clock!
-//-----------------------------------------------------------------------------
-static void EPulseDelay( void )
-{
-  // Wait for 1 usec
-	unsigned char i;
-
-	i = 22 + 100;
-	while (--i);
-}
-
-//----------------------------------------------------------------------------
-//! \brief  Delay for generating current pulse for blue LED
-//! \param  -
-//! \return -
-//! \global -
-//! \note   Assumes 24 MHz clock!
-//-----------------------------------------------------------------------------
-static void OnePulseDelay( void )
-{
-  // Wait for 1 usec
-	unsigned char i;
-
-	i = 60;
-	while (--i);
-}
-
-//----------------------------------------------------------------------------
-//! \brief  Delay for generating current pulse for blue LED
-//! \param  -
-//! \return -
-//! \global -
-//! \note   Assumes 24 MHz clock!
-//-----------------------------------------------------------------------------
-static void FivePulseDelay( void )
-{
-  // Wait for 1 usec
-	unsigned char i;
-
-	i = 22 + 100;
-	while (--i);
-}
 
 
 /***************************************< Public functions >**************************************/
@@ -120,7 +73,15 @@ static void FivePulseDelay( void )
 //-----------------------------------------------------------------------------
 void RGBLED_Init( void )
 {
-  memset( gau8RGBLEDs, 0, NUM_RGBLED_COLORS );
+  memset( (void*)gau8RGBLEDs, 0, NUM_RGBLED_COLORS );
+  gu8RGBLEDCycleLength = RGBLED_COLOR_LEVELS;
+  gu8RGBLEDCounter = 0u;
+#if ( HAL_HARDWARE_PWM == 1 )
+  gau8PWMColors[ 0 ] = 0u;
+  gau8PWMColors[ 1 ] = 0u;
+  gu8PWMCycleLength = 0u;  // No such cycle length, the first RGBLED_Update() sets the compare registers
+  gu8PWMClockShift = 0u;
+#endif
   
   // Initialize GPIO pins
 	// NOTE: Pin modes are set by PxM0 and PxM1 registers
@@ -132,58 +93,91 @@ void RGBLED_Init( void )
 	//          1  |   1  | Open-drain
 	// ------------+------+---------------
   // Red and green LEDs (P5.4, P5.5)
-  PIN_S = 1;
-  PIN_E = 1;
-  P5M0 |=  (1u<<4u) |  (1u<<5u);  // push-pull
-  P5M1 &= ~(1u<<4u) & ~(1u<<5u);
+  RGBLED_PIN_S = 1;
+  RGBLED_PIN_E = 1;
+  HAL_PINS_PUSHPULL( 5, (1u<<4u) | (1u<<5u) );
   // Blue LED (P3.3, P3.7)
-  PIN_1 = 1;
-  PIN_5 = 1;
-  P3M0 |=  (1u<<3u) |  (1u<<7u);  // push-pull
-  P3M1 &= ~(1u<<3u) & ~(1u<<7u);
+  RGBLED_PIN_1 = 1;
+  RGBLED_PIN_5 = 1;
+  HAL_PINS_PUSHPULL( 3, (1u<<3u) | (1u<<7u) );
+
+#if ( HAL_HARDWARE_PWM == 1 )
+  // Hardware PWM on the PWMB counter, started by LED_Init(); the pulses are at the end of each period,
+  // away from LED0 and LED5 at the start
+  HAL_XSFR_BEGIN();
+  PWMB_CCMR2 = HAL_PWM_MODE2;
+  PWMB_CCMR3 = HAL_PWM_MODE2;
+  PWMB_CCR6  = LED_PWM_PERIOD;  // Beyond the period: no pulse
+  PWMB_CCR7  = LED_PWM_PERIOD;
+  PWMB_CCER1 |= 0x30u;  // CC6E, CC6P: enabled, active low
+  PWMB_CCER2 |= 0x03u;  // CC7E, CC7P
+  PWMB_PS    |= 0x14u;  // PWM6 on P5.4, PWM7 on P3.3
+  PWMB_ENO   |= 0x14u;  // ENO6P, ENO7P
+  HAL_XSFR_END();
+#endif
 }
 
 //----------------------------------------------------------------------------
 //! \brief  Interrupt routine for pulse-controlled RGB LED driver
 //! \param  -
 //! \return -
-//! \global gau8RGBLEDs
+//! \global gau8RGBLEDs, gu8RGBLEDCycleLength, gu8RGBLEDCounter
 //! \note   Should be called from periodic timer interrupt routine.
 //-----------------------------------------------------------------------------
 void RGBLED_Interrupt( void )
 {
-  static volatile u8Cnt = 0u;
+  RGBLED_INTERRUPT_BODY();
+}
+
+#if ( HAL_HARDWARE_PWM == 1 )
+//----------------------------------------------------------------------------
+//! \brief  Copies the colors on hardware PWM outputs into the compare registers
+//! \param  -
+//! \return -
+//! \global gau8RGBLEDs, gu8RGBLEDCycleLength, gu8ClockShift, gau8PWMColors, gu8PWMCycleLength, gu8PWMClockShift
+//! \note   Should be called from the main loop, after LED_Update(), which sets the period.
+//!         Instead of brightness pulses per gu8RGBLEDCycleLength interrupts, there is a pulse in every PWM
+//!         period, shortened so that it carries the same energy (see gcau8RGBLEDWidth[]).
+//!         Nothing is computed or written if none of these changed since the last call. The new values are
+//!         preloaded, they take effect at the end of the current period.
+//-----------------------------------------------------------------------------
+void RGBLED_Update( void )
+{
+  U16 u16Period;
+  U16 au16Width[ 2 ];
+  U8  au8Pulses[ 2 ];
+  U8  u8Index;
   
-  if( gau8RGBLEDs[ 0 ] > u8Cnt )  // Red
-  {
-    PIN_S = 0;
-    SPulseDelay();
-    PIN_S = 1;
-  }
-  if( gau8RGBLEDs[ 1 ] > u8Cnt )  // Green
-  {
-    PIN_E = 0;
-    EPulseDelay();
-    PIN_E = 1;
-  }
-  if( gau8RGBLEDs[ 2 ] > u8Cnt )  // Blue
-  {
-    PIN_1 = 0;
-    OnePulseDelay();
-    PIN_1 = 1;
-  }
-  if( gau8RGBLEDs[ 3 ] > u8Cnt )  // Blue
-  {
-    PIN_5 = 0;
-    FivePulseDelay();
-    PIN_5 = 1;
-  }
-  u8Cnt++;
-  if( COLOR_LEVELS <= u8Cnt )
+  if( ( gau8RGBLEDs[ 1u ] != gau8PWMColors[ 0 ] ) || ( gau8RGBLEDs[ 3u ] != gau8PWMColors[ 1 ] )
+   || ( gu8RGBLEDCycleLength != gu8PWMCycleLength ) || ( gu8ClockShift != gu8PWMClockShift ) )
   {
-    u8Cnt = 0u;
+    gau8PWMColors[ 0 ] = gau8RGBLEDs[ 1u ];  // Green, "E"
+    gau8PWMColors[ 1 ] = gau8RGBLEDs[ 3u ];  // Blue, "5"
+    gu8PWMCycleLength = gu8RGBLEDCycleLength;
+    gu8PWMClockShift = gu8ClockShift;
+    
+    u16Period = (U16)( LED_PWM_PERIOD >> gu8ClockShift );
+    au16Width[ 0 ] = RGBLED_PULSE_COUNTS( E_PULSE_LOOPS );
+    au16Width[ 1 ] = RGBLED_PULSE_COUNTS( FIVE_PULSE_LOOPS );
+    for( u8Index = 0u; u8Index < 2u; u8Index++ )
+    {
+      au8Pulses[ u8Index ] = gau8PWMColors[ u8Index ];
+      // The soft pulses can't be more than one per interrupt either
+      if( au8Pulses[ u8Index ] > gu8RGBLEDCycleLength )
+      {
+        au8Pulses[ u8Index ] = gu8RGBLEDCycleLength;
+      }
+      au16Width[ u8Index ] = (U16)( ( (U32)au16Width[ u8Index ]
+        * gcau8RGBLEDWidth[ ( (U16)au8Pulses[ u8Index ] * RGBLED_WIDTH_STEPS ) / gu8RGBLEDCycleLength ] ) >> 8u );
+    }
+    
+    HAL_XSFR_BEGIN();
+    PWMB_CCR6 = u16Period - au16Width[ 0 ];
+    PWMB_CCR7 = u16Period - au16Width[ 1 ];
+    HAL_XSFR_END();
   }
 }
+#endif
 
 
 /***************************************< End of file >**************************************/
@@ -13,10 +13,104 @@
 
 /***************************************< Includes >**************************************/
 #include "types.h"
+#include "config.h"
+#include "hal.h"
 
 
 /***************************************< Definitions >**************************************/
 #define NUM_RGBLED_COLORS   (4u)  //!< Number of colors the RGB LED array has
+#define RGBLED_COLOR_LEVELS (16u)  //!< Nominal length of the pulse cycle, i.e. number of brightness levels per color
+
+// Pin definitions
+#define RGBLED_PIN_S        (P55)  //!< GPIO pin for "S" LEDs
+#define RGBLED_PIN_E        (P54)  //!< GPIO pin for "E" LEDs
+#define RGBLED_PIN_1        (P37)  //!< GPIO pin for "1" LEDs
+#define RGBLED_PIN_5        (P33)  //!< GPIO pin for "5" LEDs
+
+// Length of the current pulses in delay loop iterations at full system clock (calibrated at 24 MHz)
+#define S_PULSE_LOOPS     ( (U8)( ( 122u * SYSTEM_CLOCK_MHZ ) / 24u ) )  //!< Pulse length for "S" LEDs
+#define E_PULSE_LOOPS     ( (U8)( ( 122u * SYSTEM_CLOCK_MHZ ) / 24u ) )  //!< Pulse length for "E" LEDs
+#define ONE_PULSE_LOOPS   ( (U8)(  ( 60u * SYSTEM_CLOCK_MHZ ) / 24u ) )  //!< Pulse length for "1" LEDs
+#define FIVE_PULSE_LOOPS  ( (U8)( ( 122u * SYSTEM_CLOCK_MHZ ) / 24u ) )  //!< Pulse length for "5" LEDs
+
+#if ( HAL_HARDWARE_PWM == 1 )
+// Hardware PWM: "E" on PWM6 (P5.4), "5" on PWM7 (P3.3), sharing the PWMB counter with LED0 and LED5 (see led.h).
+// "S" (P5.5) and "1" (P3.7) have no PWM output, they stay on the pulses of the timer 0 interrupt.
+#define RGBLED_WIDTH_STEPS  (64u)  //!< Entries of the pulse width table, minus one
+#endif
+
+
+/***************************************< Macros >**************************************/
+//! \brief Drives one current pulse: the pin is low for the delay loop, scaled to the clock divider
+#define RGBLED_PULSE( pin, u8Loops ) \
+  do \
+  { \
+    U8 u8Delay; \
+    pin = 0; \
+    u8Delay = (U8)( (u8Loops) >> gu8ClockShift ); \
+    HAL_DELAY_LOOP( u8Delay ); \
+    pin = 1; \
+  } while( 0 )
+
+//! \brief Shift of the pulse window of a color in the pulse cycle
+#define RGBLED_PHASE( u8Color )  ( (U8)( (u8Color) * RGBLED_PHASE_STEP ) )
+
+//! \brief Drives the pulse of a color if its position in the cycle is within its brightness
+//! \note  The position is the cycle counter shifted by RGBLED_PHASE(), so every color still gets as many
+//!        pulses per cycle as its brightness, but the colors don't all start in the same interrupt
+#define RGBLED_COLOR( pin, u8Color, u8Loops ) \
+  do \
+  { \
+    U8 u8Position = (U8)( gu8RGBLEDCounter + RGBLED_PHASE( u8Color ) ); \
+    if( u8Position >= gu8RGBLEDCycleLength ) \
+    { \
+      u8Position -= gu8RGBLEDCycleLength; \
+    } \
+    if( gau8RGBLEDs[ u8Color ] > u8Position ) \
+    { \
+      RGBLED_PULSE( pin, u8Loops ); \
+    } \
+  } while( 0 )
+
+#if ( HAL_HARDWARE_PWM == 1 )
+//! \brief Length of a current pulse of the delay loop, in counts of the hardware PWM
+#define RGBLED_PULSE_COUNTS( u8Loops )  ( (U16)( ( 3u * (U16)(u8Loops) ) >> gu8ClockShift ) )
+
+//! \brief Drives the colors without a hardware PWM output, see RGBLED_Update() for the others
+#define RGBLED_SOFT_COLORS() \
+  do \
+  { \
+    RGBLED_COLOR( RGBLED_PIN_S, 0u, S_PULSE_LOOPS );     /* Red */ \
+    RGBLED_COLOR( RGBLED_PIN_1, 2u, ONE_PULSE_LOOPS );   /* Blue */ \
+  } while( 0 )
+
+#define RGBLED_UPDATE()  RGBLED_Update()  //!< Hook: copies the colors into the hardware PWM
+#else
+//! \brief Drives all colors
+#define RGBLED_SOFT_COLORS() \
+  do \
+  { \
+    RGBLED_COLOR( RGBLED_PIN_S, 0u, S_PULSE_LOOPS );     /* Red */ \
+    RGBLED_COLOR( RGBLED_PIN_E, 1u, E_PULSE_LOOPS );     /* Green */ \
+    RGBLED_COLOR( RGBLED_PIN_1, 2u, ONE_PULSE_LOOPS );   /* Blue */ \
+    RGBLED_COLOR( RGBLED_PIN_5, 3u, FIVE_PULSE_LOOPS );  /* Blue */ \
+  } while( 0 )
+
+#define RGBLED_UPDATE()  // Hook: the pulses read the colors themselves
+#endif
+
+//! \brief Timer 0 interrupt work of this module, expanded in place in the flattened interrupt routine
+//! \note  Needs util.h for gu8ClockShift
+#define RGBLED_INTERRUPT_BODY() \
+  do \
+  { \
+    RGBLED_SOFT_COLORS(); \
+    gu8RGBLEDCounter++; \
+    if( gu8RGBLEDCycleLength <= gu8RGBLEDCounter ) \
+    { \
+      gu8RGBLEDCounter = 0u; \
+    } \
+  } while( 0 )
 
 
 /***************************************< Types >**************************************/
@@ -26,12 +120,17 @@
 
 
 /***************************************< Global variables >**************************************/
-extern volatile U8 gau8RGBLEDs[ NUM_RGBLED_COLORS ];
+extern volatile DATA U8 gau8RGBLEDs[ NUM_RGBLED_COLORS ];
+extern DATA U8 gu8RGBLEDCycleLength;
+extern DATA U8 gu8RGBLEDCounter;
 
 
 /***************************************< Public functions >**************************************/
 void RGBLED_Init( void );
 void RGBLED_Interrupt( void );
+#if ( HAL_HARDWARE_PWM == 1 )
+void RGBLED_Update( void );
+#endif
 
 
 #endif /* RGBLED_H */
@@ -1,9 +1,26 @@
 #ifndef     __STC8G_H__
 #define     __STC8G_H__
 
+#include "platform.h"  // MCU_TYPE
+
+/////////////////////////////////////////////////
+
+#if defined( HOST_BUILD )  // Host simulation, see tools/host
+
+#include "host_stc8g.h"
+
 /////////////////////////////////////////////////
+#elif defined( __SDCC )  // SDCC: the Keil definitions of the target, converted by the Makefile
 
-#ifndef __IAR_SYSTEMS_ICC__
+#include "sfr_sdcc.h"
+
+/////////////////////////////////////////////////
+#elif ( MCU_TYPE == MCU_STC8H )  // STC8H1K08, selected in platform.h
+
+#include "stc8h.h"
+
+/////////////////////////////////////////////////
+#elif !defined( __IAR_SYSTEMS_ICC__ )
 
 //ͷļ,ٰ"REG51.H"
 
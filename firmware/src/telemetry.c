@@ -0,0 +1,298 @@
+/*! *******************************************************************************************************
+* Copyright (c) 2022 Hekk_Elek
+*
+* \file telemetry.c
+*
+* \brief Telemetry frames on the ISP UART, sent by interrupt from a ring buffer
+*
+* \author Hekk_Elek
+*
+**********************************************************************************************************/
+
+/*----------------------------------------------------------------------------------------
+How it works
+============
+Enabled by TELEMETRY_ENABLED in config.h. P3.0/P3.1 are only used by the ISP tool at power
+up, so the firmware can use UART1 afterwards; connect a USB-serial adapter to P3.1 (TXD)
+and GND, and run tools/telemetry_decoder.
+
+Every TELEMETRY_PERIOD_MS the main cycle puts a frame (see telemetry.h) into a ring buffer
+in XDATA, and the UART interrupt sends it byte by byte. The UART interrupt has low priority,
+so it never delays the timer 0 interrupt. If the ring buffer is full, the frame is dropped,
+the sequence number shows the gap.
+
+The baud rate comes from timer 2, so it depends on the system clock. The clock governor
+doesn't change the clock while a frame is being sent, and the reload value is adapted to
+the current clock before the next frame is queued. No tickless power-down is done while
+sending either, as the UART stops in power-down mode.
+
+With ANIMATION_UPLOAD_ENABLED, the receiver is turned on too, and the received bytes are
+passed to upload.c. Its responses are sent through the same ring buffer (Telemetry_Send()),
+and the frames are paused while an upload is in progress.
+----------------------------------------------------------------------------------------*/
+
+/***************************************< Includes >**************************************/
+// Own includes
+#include "hal.h"
+#include "types.h"
+#include "util.h"
+#include "led.h"
+#include "rgbled.h"
+#include "animation.h"
+#include "persist.h"
+#include "batterylevel.h"
+#include "profile.h"
+#include "upload.h"
+#include "telemetry.h"
+
+#if ( TELEMETRY_ENABLED == 1 )
+
+/***************************************< Definitions >**************************************/
+#define TX_RING_SIZE           (64u)  //!< Size of the transmit ring buffer, must be a power of 2
+#define SCON_MODE1           (0x40u)  //!< 8-bit UART, variable baud rate, receiver disabled
+#define SCON_REN             (0x10u)  //!< Receiver enabled
+#define AUXR_T2R             (0x10u)  //!< Timer 2 run
+#define AUXR_T2X12           (0x04u)  //!< Timer 2 runs in 1T mode
+#define AUXR_S1ST2           (0x01u)  //!< UART1 baud rate comes from timer 2
+#define P_SW1_S1_MASK        (0xC0u)  //!< UART1 pin selection; 0: P3.0/P3.1
+//! \brief Timer 2 reload value of the baud rate at a given clock divider (rounded)
+#define BAUD_RELOAD( u8ClockShift )  ( (U16)( 65536UL - ( ( SYSTEM_CLOCK_HZ >> (u8ClockShift) ) + 2UL * TELEMETRY_BAUD_RATE ) / ( 4UL * TELEMETRY_BAUD_RATE ) ) )
+
+
+/***************************************< Types >**************************************/
+
+
+/***************************************< Constants >**************************************/
+//! \brief Timer 2 reload values, indexed by the clock divider
+static CODE const U16 gcau16BaudReload[ CLOCK_SHIFT_MAX + 1u ] =
+{
+  BAUD_RELOAD( 0u ), BAUD_RELOAD( 1u ), BAUD_RELOAD( 2u ), BAUD_RELOAD( 3u )
+};
+
+
+/***************************************< Global variables >**************************************/
+static XDATA U8 gau8TxRing[ TX_RING_SIZE ];      //!< Transmit ring buffer
+static XDATA U8 gau8Frame[ TELEMETRY_FRAME_LENGTH ];  //!< Frame being assembled
+static volatile U8 gu8TxWrite;     //!< Ring write index, incremented by the main cycle only
+static volatile U8 gu8TxRead;      //!< Ring read index, incremented by the interrupt only
+static volatile BIT gbTxBusy;      //!< The interrupt is sending the ring buffer
+static U8 gu8Sequence;             //!< Sequence number of the next frame
+static U8 gu8BaudClockShift;       //!< Clock divider the baud rate is set for
+
+
+/***************************************< Static function definitions >**************************************/
+static void PutU16( U8 u8Offset, U16 u16Value );
+static void BuildFrame( void );
+
+
+/***************************************< Private functions >**************************************/
+//----------------------------------------------------------------------------
+//! \brief  Writes a big-endian U16 field into the payload of the frame
+//! \param  u8Offset: offset of the field in the payload
+//! \param  u16Value: value of the field
+//! \return -
+//! \global gau8Frame
+//-----------------------------------------------------------------------------
+static void PutU16( U8 u8Offset, U16 u16Value )
+{
+  gau8Frame[ TELEMETRY_HEADER_LENGTH + u8Offset ] = (U8)( u16Value >> 8u );
+  gau8Frame[ TELEMETRY_HEADER_LENGTH + u8Offset + 1u ] = (U8)u16Value;
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Assembles a frame of the current state
+//! \param  -
+//! \return -
+//! \global gau8Frame, gu8Sequence
+//-----------------------------------------------------------------------------
+static void BuildFrame( void )
+{
+  U8  u8Nibble;
+  U8  u8Level;
+  U16 u16CRC;
+
+  gau8Frame[ 0u ] = TELEMETRY_SYNC;
+  gau8Frame[ 1u ] = TELEMETRY_PAYLOAD_LENGTH;
+  gau8Frame[ 2u ] = gu8Sequence;
+  gu8Sequence++;
+
+  PutU16( TELEMETRY_OFS_TIME, gu16TimeSnapshotMs );
+  gau8Frame[ TELEMETRY_HEADER_LENGTH + TELEMETRY_OFS_ANIMATION ] = gsPersistentData.u8AnimationIndex;
+  gau8Frame[ TELEMETRY_HEADER_LENGTH + TELEMETRY_OFS_INSTRUCTION ] = Animation_GetInstruction();
+  gau8Frame[ TELEMETRY_HEADER_LENGTH + TELEMETRY_OFS_INSTRUCTION_RGB ] = Animation_GetInstructionRGB();
+  gau8Frame[ TELEMETRY_HEADER_LENGTH + TELEMETRY_OFS_CLOCK_SHIFT ] = gu8ClockShift;
+
+  // Frame buffer: the LEDs, then the RGB colors, packed by nibbles
+  for( u8Nibble = 0u; u8Nibble < ( LEDS_NUM + NUM_RGBLED_COLORS ); u8Nibble++ )
+  {
+    if( u8Nibble < LEDS_NUM )
+    {
+      u8Level = gau8LEDBrightness[ u8Nibble ] & 0x0Fu;
+    }
+    else
+    {
+      u8Level = gau8RGBLEDs[ u8Nibble - LEDS_NUM ] & 0x0Fu;
+    }
+    if( 0u == ( u8Nibble & 1u ) )
+    {
+      gau8Frame[ TELEMETRY_HEADER_LENGTH + TELEMETRY_OFS_FRAME_BUFFER + ( u8Nibble >> 1u ) ] = (U8)( u8Level << 4u );
+    }
+    else
+    {
+      gau8Frame[ TELEMETRY_HEADER_LENGTH + TELEMETRY_OFS_FRAME_BUFFER + ( u8Nibble >> 1u ) ] |= u8Level;
+    }
+  }
+
+  PutU16( TELEMETRY_OFS_BATTERY_ADC, BatteryLevel_GetADC() );
+#if ( PROFILE_ENABLED == 1 )
+  // Torn reads are possible, but they only make one sample of the plot wrong
+  PutU16( TELEMETRY_OFS_ISR_MAX, gu16ProfileISRMax );
+  PutU16( TELEMETRY_OFS_ISR_AVG, gu16ProfileISRAvg16 >> 4u );
+  PutU16( TELEMETRY_OFS_ISR_OVERRUNS, gu16ProfileOverruns );
+#else
+  PutU16( TELEMETRY_OFS_ISR_MAX, 0u );
+  PutU16( TELEMETRY_OFS_ISR_AVG, 0u );
+  PutU16( TELEMETRY_OFS_ISR_OVERRUNS, 0u );
+#endif
+
+  u16CRC = Util_CRC16( &gau8Frame[ 2u ], 1u + TELEMETRY_PAYLOAD_LENGTH );
+  gau8Frame[ TELEMETRY_FRAME_LENGTH - 2u ] = (U8)( u16CRC >> 8u );
+  gau8Frame[ TELEMETRY_FRAME_LENGTH - 1u ] = (U8)u16CRC;
+}
+
+
+/***************************************< Public functions >**************************************/
+//----------------------------------------------------------------------------
+//! \brief  Initializes UART1 and its baud rate generator
+//! \param  -
+//! \return -
+//! \global All globals in this module
+//! \note   Should be called from init block, after Util_Init().
+//-----------------------------------------------------------------------------
+void Telemetry_Init( void )
+{
+  gu8TxWrite = 0u;
+  gu8TxRead = 0u;
+  gbTxBusy = FALSE;
+  gu8Sequence = 0u;
+  gu8BaudClockShift = gu8ClockShift;
+
+  P_SW1 &= (U8)~P_SW1_S1_MASK;  // RXD/TXD on P3.0/P3.1
+#if ( ANIMATION_UPLOAD_ENABLED == 1 )
+  SCON = SCON_MODE1 | SCON_REN;
+#else
+  SCON = SCON_MODE1;
+#endif
+  // Timer 2: baud rate generator in 1T mode
+  T2L = (U8)gcau16BaudReload[ gu8BaudClockShift ];
+  T2H = (U8)( gcau16BaudReload[ gu8BaudClockShift ] >> 8u );
+  AUXR |= AUXR_T2X12 | AUXR_S1ST2;
+  AUXR |= AUXR_T2R;
+  PS = 0;  // Low priority, the timer 0 interrupt may interrupt it
+  ES = 1;
+
+  Util_TimerStart( UTIL_TIMER_TELEMETRY, TELEMETRY_PERIOD_MS, TELEMETRY_PERIOD_MS );
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Queues a frame periodically
+//! \param  -
+//! \return -
+//! \global All globals in this module
+//! \note   Should be called from main cycle, after Animation_Cycle().
+//-----------------------------------------------------------------------------
+void Telemetry_Task( void )
+{
+  // The clock only changes between frames: follow it with the baud rate
+  if( ( FALSE == gbTxBusy ) && ( gu8BaudClockShift != gu8ClockShift ) )
+  {
+    gu8BaudClockShift = gu8ClockShift;
+    T2L = (U8)gcau16BaudReload[ gu8BaudClockShift ];
+    T2H = (U8)( gcau16BaudReload[ gu8BaudClockShift ] >> 8u );
+  }
+
+  // No frames during an upload, the uploader waits for its responses
+  if( ( TRUE == Util_TimerExpired( UTIL_TIMER_TELEMETRY ) ) && ( FALSE == UPLOAD_BUSY() ) )
+  {
+    BuildFrame();
+    Telemetry_Send( gau8Frame, TELEMETRY_FRAME_LENGTH );
+  }
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Puts bytes into the ring buffer, and starts sending them
+//! \param  pu8Data: bytes to be sent
+//! \param  u8Length: number of bytes, less than the size of the ring buffer
+//! \return TRUE if the bytes were queued; FALSE if they didn't fit, and nothing was queued
+//! \global gau8TxRing, gu8TxWrite, gbTxBusy
+//! \note   Should be called from main cycle only.
+//-----------------------------------------------------------------------------
+BOOL Telemetry_Send( U8* pu8Data, U8 u8Length )
+{
+  BOOL bQueued = FALSE;
+  U8   u8Index;
+
+  // Free space of the ring buffer; one byte is kept empty to tell a full ring from an empty one
+  if( (U8)( ( gu8TxRead - gu8TxWrite - 1u ) & ( TX_RING_SIZE - 1u ) ) >= u8Length )
+  {
+    for( u8Index = 0u; u8Index < u8Length; u8Index++ )
+    {
+      gau8TxRing[ gu8TxWrite ] = pu8Data[ u8Index ];
+      gu8TxWrite = ( gu8TxWrite + 1u ) & ( TX_RING_SIZE - 1u );
+    }
+    if( FALSE == gbTxBusy )
+    {
+      // Nothing is being sent, so the interrupt can't run: start it by software
+      gbTxBusy = TRUE;
+      TI = 1;
+    }
+    bQueued = TRUE;
+  }
+  return bQueued;
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Tells whether the UART is in use
+//! \param  -
+//! \return TRUE, if a frame is being sent or an upload is in progress: the UART needs the current
+//!         clock and must not be stopped
+//! \global gbTxBusy
+//-----------------------------------------------------------------------------
+BOOL Telemetry_Busy( void )
+{
+  return ( gbTxBusy || UPLOAD_BUSY() );
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Sends the next byte of the ring buffer, and passes on the received byte
+//! \param  -
+//! \return -
+//! \global gau8TxRing, gu8TxRead, gbTxBusy
+//! \note   Should be called from the UART1 interrupt routine.
+//-----------------------------------------------------------------------------
+void Telemetry_Interrupt( void )
+{
+  if( 1 == RI )
+  {
+    RI = 0;
+    UPLOAD_RX_BYTE( SBUF );
+  }
+  if( 1 == TI )
+  {
+    TI = 0;
+    if( gu8TxRead != gu8TxWrite )
+    {
+      SBUF = gau8TxRing[ gu8TxRead ];
+      gu8TxRead = ( gu8TxRead + 1u ) & ( TX_RING_SIZE - 1u );
+    }
+    else
+    {
+      gbTxBusy = FALSE;
+    }
+  }
+}
+
+#endif /* TELEMETRY_ENABLED */
+
+
+/***************************************< End of file >**************************************/
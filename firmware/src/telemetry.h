@@ -0,0 +1,75 @@
+/*! *******************************************************************************************************
+* Copyright (c) 2022 Hekk_Elek
+*
+* \file telemetry.h
+*
+* \brief Telemetry frames on the ISP UART, sent by interrupt from a ring buffer
+*
+* \author Hekk_Elek
+*
+**********************************************************************************************************/
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+/***************************************< Includes >**************************************/
+#include "types.h"
+#include "config.h"
+
+
+/***************************************< Definitions >**************************************/
+#define TELEMETRY_BAUD_RATE       (57600UL)  //!< Exact enough (<0.3% error) at every clock divider
+#define TELEMETRY_PERIOD_MS         (100u)  //!< Time between two frames
+
+// Frame: SYNC, LENGTH, SEQUENCE, payload (LENGTH bytes), CRC-16F/3 of SEQUENCE and the payload (big-endian)
+#define TELEMETRY_SYNC             (0xA5u)  //!< First byte of every frame
+#define TELEMETRY_HEADER_LENGTH       (3u)  //!< Sync, length and sequence number
+#define TELEMETRY_PAYLOAD_LENGTH     (20u)  //!< Length of the payload
+#define TELEMETRY_FRAME_LENGTH  ( TELEMETRY_HEADER_LENGTH + TELEMETRY_PAYLOAD_LENGTH + 2u )  //!< Length of a whole frame
+
+// Payload fields; multi-byte values are big-endian
+#define TELEMETRY_OFS_TIME            (0u)  //!< U16: millisecond timer
+#define TELEMETRY_OFS_ANIMATION       (2u)  //!< U8: index of the animation
+#define TELEMETRY_OFS_INSTRUCTION     (3u)  //!< U8: instruction index of the normal LED animation
+#define TELEMETRY_OFS_INSTRUCTION_RGB (4u)  //!< U8: instruction index of the RGB LED animation
+#define TELEMETRY_OFS_CLOCK_SHIFT     (5u)  //!< U8: system clock divider is 2^value
+#define TELEMETRY_OFS_FRAME_BUFFER    (6u)  //!< 6 bytes: brightness of the LEDs, then the RGB colors, 2 nibbles per byte (high first)
+#define TELEMETRY_OFS_BATTERY_ADC    (12u)  //!< U16: filtered battery measurement (1.19 V * 1024 / ADC value)
+#define TELEMETRY_OFS_ISR_MAX        (14u)  //!< U16: longest timer 0 interrupt (cycles); 0 without PROFILE_ENABLED
+#define TELEMETRY_OFS_ISR_AVG        (16u)  //!< U16: average timer 0 interrupt (cycles); 0 without PROFILE_ENABLED
+#define TELEMETRY_OFS_ISR_OVERRUNS   (18u)  //!< U16: lost ticks; 0 without PROFILE_ENABLED
+
+
+/***************************************< Macros >**************************************/
+#if ( TELEMETRY_ENABLED == 1 )
+#define TELEMETRY_INIT()  Telemetry_Init()
+#define TELEMETRY_TASK()  Telemetry_Task()
+#define TELEMETRY_BUSY()  Telemetry_Busy()
+#else
+#define TELEMETRY_INIT()
+#define TELEMETRY_TASK()
+#define TELEMETRY_BUSY()  ( FALSE )
+#endif
+
+
+/***************************************< Types >**************************************/
+
+
+/***************************************< Constants >**************************************/
+
+
+/***************************************< Global variables >**************************************/
+
+
+/***************************************< Public functions >**************************************/
+#if ( TELEMETRY_ENABLED == 1 )
+void Telemetry_Init( void );
+void Telemetry_Task( void );
+BOOL Telemetry_Send( U8* pu8Data, U8 u8Length );
+BOOL Telemetry_Busy( void );
+void Telemetry_Interrupt( void );
+#endif
+
+
+#endif /* TELEMETRY_H */
+
+/***************************************< End of file >**************************************/
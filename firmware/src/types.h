@@ -19,6 +19,15 @@
 
 
 /***************************************< Types >**************************************/
+#ifdef HOST_BUILD  // long is 64-bit on most hosts
+typedef unsigned char      U8;
+typedef unsigned short int U16;
+typedef unsigned int       U32;
+
+typedef signed char        I8;
+typedef signed short int   I16;
+typedef signed int         I32;
+#else
 typedef unsigned char      U8;
 typedef unsigned short int U16;
 typedef unsigned long int  U32;
@@ -26,6 +35,7 @@ typedef unsigned long int  U32;
 typedef signed char        I8;
 typedef signed short int   I16;
 typedef signed long int    I32;
+#endif
 
 //! \brief Boolean type
 typedef BIT BOOL;
@@ -0,0 +1,369 @@
+/*! *******************************************************************************************************
+* Copyright (c) 2022 Hekk_Elek
+*
+* \file upload.c
+*
+* \brief Uploading animations into the EEPROM on the ISP UART
+*
+* \author Hekk_Elek
+*
+**********************************************************************************************************/
+
+/*----------------------------------------------------------------------------------------
+How it works
+============
+Enabled by ANIMATION_UPLOAD_ENABLED in config.h. The UART is set up by telemetry.c; this
+module receives on P3.0 (RXD), and sends its responses through the transmit ring buffer of
+telemetry.c. Run tools/anim_uploader on the PC.
+
+The UART interrupt only puts the received bytes into a ring buffer; the packets (see
+upload.h) are parsed and executed by the main cycle. Packets with a bad CRC are dropped
+without a response. The uploader waits for the response of every packet and sends it again
+if it doesn't come, so the protocol works over a lossy line, and nothing is received while
+the CPU is stalled by an EEPROM erase. Every command can be repeated without harm: a block
+programmed again with the same data doesn't change.
+
+An upload is BEGIN (erases the slot), DATA blocks (programmed and read back), then COMMIT,
+which writes the header of the slot. The first byte of the header, the magic, is programmed
+at the very end, so a slot which was interrupted by a power loss is never played.
+During the upload the dark animation is shown: the slot may be the one being played, and
+erasing would freeze the LEDs anyway.
+
+From the first byte received until UPLOAD_SESSION_TIMEOUT_MS of silence, the session is
+active: telemetry frames are paused, and neither the clock governor nor the tickless sleep
+may stop the UART. While the MCU is powered down, the first packet is lost; the uploader
+repeats it.
+----------------------------------------------------------------------------------------*/
+
+/***************************************< Includes >**************************************/
+// Own includes
+#include "types.h"
+#include "util.h"
+#include "iap.h"
+#include "animation.h"
+#include "persist.h"
+#include "telemetry.h"
+#include "upload.h"
+
+#if ( ANIMATION_UPLOAD_ENABLED == 1 )
+
+/***************************************< Definitions >**************************************/
+#define RX_RING_SIZE      (64u)  //!< Size of the receive ring buffer, must be a power of 2
+#define NO_SLOT         (0xFFu)  //!< gu8Slot: no BEGIN received yet
+#define BLOCKS_NUM  ( ( ANIMATION_SLOT_IMAGE_MAX + UPLOAD_BLOCK_SIZE - 1u ) / UPLOAD_BLOCK_SIZE )  //!< Blocks in a slot
+
+
+/***************************************< Types >**************************************/
+
+
+/***************************************< Constants >**************************************/
+
+
+/***************************************< Global variables >**************************************/
+static XDATA U8 gau8RxRing[ RX_RING_SIZE ];       //!< Receive ring buffer
+static XDATA U8 gau8Packet[ UPLOAD_PACKET_MAX ];  //!< Packet being received
+static volatile U8 gu8RxWrite;       //!< Ring write index, incremented by the interrupt only
+static volatile U8 gu8RxRead;        //!< Ring read index, incremented by the main cycle only
+static volatile BIT gbSessionActive;  //!< Set by the interrupt, cleared by the session timeout
+static U8  gu8PacketIndex;           //!< Number of bytes of the packet received so far
+static U8  gu8Slot;                  //!< Slot being uploaded
+static U16 gu16WrittenBlocks;        //!< Bitmask of the blocks programmed since BEGIN
+static U16 gu16WrittenEnd;           //!< End of the highest block programmed since BEGIN
+
+
+/***************************************< Static function definitions >**************************************/
+static BOOL Program( U16 u16Address, U8* pu8Data, U8 u8Length );
+static U8   CommitSlot( void );
+static U8   ExecutePacket( void );
+static void ParseByte( U8 u8Byte );
+
+
+/***************************************< Private functions >**************************************/
+//----------------------------------------------------------------------------
+//! \brief  Programs bytes into the EEPROM and reads them back
+//! \param  u16Address: address of the first byte
+//! \param  pu8Data: bytes to be programmed
+//! \param  u8Length: number of bytes
+//! \return TRUE if the EEPROM holds the given bytes
+//! \global -
+//! \note   The area must be erased, or hold the same bytes already.
+//-----------------------------------------------------------------------------
+static BOOL Program( U16 u16Address, U8* pu8Data, U8 u8Length )
+{
+  BOOL bVerified = TRUE;
+  U8   u8Index;
+  U8   u8Byte;
+
+  for( u8Index = 0u; u8Index < u8Length; u8Index++ )
+  {
+    IAP_WriteByte( u16Address + u8Index, pu8Data[ u8Index ] );
+  }
+  for( u8Index = 0u; u8Index < u8Length; u8Index++ )
+  {
+    IAP_Read( u16Address + u8Index, &u8Byte, 1u );
+    if( u8Byte != pu8Data[ u8Index ] )
+    {
+      bVerified = FALSE;
+    }
+  }
+  return bVerified;
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Checks the COMMIT packet, and writes the header of the slot
+//! \param  -
+//! \return UPLOAD_STATUS_*
+//! \global gau8Packet, gu8Slot, gu16WrittenBlocks, gu16WrittenEnd
+//-----------------------------------------------------------------------------
+static U8 CommitSlot( void )
+{
+  U8  u8Status = UPLOAD_STATUS_OK;
+  U8  au8Header[ ANIMATION_SLOT_HEADER_LENGTH ];
+  U8  u8LengthNormal = gau8Packet[ UPLOAD_HEADER_LENGTH ];
+  U8  u8LengthRGB = gau8Packet[ UPLOAD_HEADER_LENGTH + 1u ];
+  U16 u16ImageLength;
+  U16 u16CRC;
+  U16 u16NeededBlocks;
+
+  u16ImageLength = ( (U16)u8LengthNormal * ANIMATION_INSTRUCTION_NORMAL_LENGTH )
+                 + ( (U16)u8LengthRGB * ANIMATION_INSTRUCTION_RGB_LENGTH );
+  if( ( gu8Slot != gau8Packet[ UPLOAD_OFS_ARGUMENT ] ) || ( 2u != gau8Packet[ UPLOAD_OFS_LENGTH ] )
+   || ( 0u == u8LengthNormal ) || ( 0u == u8LengthRGB ) || ( u16ImageLength > ANIMATION_SLOT_IMAGE_MAX ) )
+  {
+    u8Status = UPLOAD_STATUS_BAD_ARGUMENT;
+  }
+  else
+  {
+    u16NeededBlocks = (U16)( ( 1UL << ( ( u16ImageLength + UPLOAD_BLOCK_SIZE - 1u ) / UPLOAD_BLOCK_SIZE ) ) - 1u );
+    if( ( u16NeededBlocks != ( gu16WrittenBlocks & u16NeededBlocks ) ) || ( gu16WrittenEnd < u16ImageLength ) )
+    {
+      u8Status = UPLOAD_STATUS_INCOMPLETE;
+    }
+    else
+    {
+      au8Header[ ANIMATION_SLOT_OFS_MAGIC ] = ANIMATION_SLOT_MAGIC;
+      au8Header[ ANIMATION_SLOT_OFS_FORMAT ] = ANIMATION_SLOT_FORMAT;
+      au8Header[ ANIMATION_SLOT_OFS_LENGTH_NORMAL ] = u8LengthNormal;
+      au8Header[ ANIMATION_SLOT_OFS_LENGTH_RGB ] = u8LengthRGB;
+      au8Header[ ANIMATION_SLOT_OFS_LENGTH_RGB + 1u ] = 0xFFu;
+      au8Header[ ANIMATION_SLOT_OFS_LENGTH_RGB + 2u ] = 0xFFu;
+      u16CRC = Util_CRC16( au8Header, ANIMATION_SLOT_OFS_CRC );
+      au8Header[ ANIMATION_SLOT_OFS_CRC ] = (U8)( u16CRC >> 8u );
+      au8Header[ ANIMATION_SLOT_OFS_CRC + 1u ] = (U8)u16CRC;
+      // The magic goes last: it makes the slot valid
+      if( ( FALSE == Program( ANIMATION_SLOT_ADDRESS( gu8Slot ) + 1u, &au8Header[ 1u ], ANIMATION_SLOT_HEADER_LENGTH - 1u ) )
+       || ( FALSE == Program( ANIMATION_SLOT_ADDRESS( gu8Slot ), au8Header, 1u ) ) )
+      {
+        u8Status = UPLOAD_STATUS_VERIFY_FAILED;
+      }
+    }
+  }
+  return u8Status;
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Executes the received packet
+//! \param  -
+//! \return UPLOAD_STATUS_*
+//! \global gau8Packet, gu8Slot, gu16WrittenBlocks, gu16WrittenEnd
+//-----------------------------------------------------------------------------
+static U8 ExecutePacket( void )
+{
+  U8  u8Status = UPLOAD_STATUS_OK;
+  U8  u8Argument = gau8Packet[ UPLOAD_OFS_ARGUMENT ];
+  U8  u8Length = gau8Packet[ UPLOAD_OFS_LENGTH ];
+  U16 u16Offset;
+
+  switch( gau8Packet[ UPLOAD_OFS_COMMAND ] )
+  {
+    case UPLOAD_CMD_BEGIN:
+      if( u8Argument >= ANIMATION_SLOTS_NUM )
+      {
+        u8Status = UPLOAD_STATUS_BAD_ARGUMENT;
+      }
+      else
+      {
+        Animation_Set( ANIMATION_BLACKNESS, FALSE );
+        IAP_Erase( ANIMATION_SLOT_ADDRESS( u8Argument ) );
+        gu8Slot = u8Argument;
+        gu16WrittenBlocks = 0u;
+        gu16WrittenEnd = 0u;
+      }
+      break;
+
+    case UPLOAD_CMD_DATA:
+      u16Offset = (U16)u8Argument * UPLOAD_BLOCK_SIZE;
+      if( NO_SLOT == gu8Slot )
+      {
+        u8Status = UPLOAD_STATUS_BAD_COMMAND;
+      }
+      else if( ( u8Argument >= BLOCKS_NUM ) || ( 0u == u8Length ) || ( ( u16Offset + u8Length ) > ANIMATION_SLOT_IMAGE_MAX ) )
+      {
+        u8Status = UPLOAD_STATUS_BAD_ARGUMENT;
+      }
+      else if( FALSE == Program( ANIMATION_SLOT_ADDRESS( gu8Slot ) + ANIMATION_SLOT_HEADER_LENGTH + u16Offset,
+                                 &gau8Packet[ UPLOAD_HEADER_LENGTH ], u8Length ) )
+      {
+        u8Status = UPLOAD_STATUS_VERIFY_FAILED;
+      }
+      else
+      {
+        gu16WrittenBlocks |= (U16)( 1u << u8Argument );
+        if( ( u16Offset + u8Length ) > gu16WrittenEnd )
+        {
+          gu16WrittenEnd = u16Offset + u8Length;
+        }
+      }
+      break;
+
+    case UPLOAD_CMD_COMMIT:
+      if( NO_SLOT == gu8Slot )
+      {
+        u8Status = UPLOAD_STATUS_BAD_COMMAND;
+      }
+      else
+      {
+        u8Status = CommitSlot();
+        if( UPLOAD_STATUS_OK == u8Status )
+        {
+          // Play the new animation, and keep it after a restart
+          Animation_Set( ANIMATION_FIRST_SLOT + gu8Slot, TRUE );
+          Persist_Save();
+        }
+      }
+      break;
+
+    default:
+      u8Status = UPLOAD_STATUS_BAD_COMMAND;
+      break;
+  }
+  return u8Status;
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Collects the bytes of a packet, and executes and answers it when complete
+//! \param  u8Byte: the received byte
+//! \return -
+//! \global gau8Packet, gu8PacketIndex
+//-----------------------------------------------------------------------------
+static void ParseByte( U8 u8Byte )
+{
+  U8  au8Response[ UPLOAD_RESPONSE_LENGTH ];
+  U16 u16CRC;
+
+  // Bytes before a sync byte are ignored
+  if( ( 0u != gu8PacketIndex ) || ( UPLOAD_SYNC == u8Byte ) )
+  {
+    gau8Packet[ gu8PacketIndex ] = u8Byte;
+    gu8PacketIndex++;
+    if( gu8PacketIndex >= UPLOAD_HEADER_LENGTH )
+    {
+      if( gau8Packet[ UPLOAD_OFS_LENGTH ] > UPLOAD_BLOCK_SIZE )  // Not a packet, hunt for the next sync byte
+      {
+        gu8PacketIndex = 0u;
+      }
+      else if( gu8PacketIndex == ( UPLOAD_HEADER_LENGTH + gau8Packet[ UPLOAD_OFS_LENGTH ] + 2u ) )  // Complete
+      {
+        u16CRC = Util_CRC16( &gau8Packet[ UPLOAD_OFS_COMMAND ], ( UPLOAD_HEADER_LENGTH - 1u ) + gau8Packet[ UPLOAD_OFS_LENGTH ] );
+        if( ( (U8)( u16CRC >> 8u ) == gau8Packet[ gu8PacketIndex - 2u ] ) && ( (U8)u16CRC == gau8Packet[ gu8PacketIndex - 1u ] ) )
+        {
+          au8Response[ 0u ] = UPLOAD_SYNC;
+          au8Response[ UPLOAD_OFS_COMMAND ] = gau8Packet[ UPLOAD_OFS_COMMAND ] | UPLOAD_RESPONSE_FLAG;
+          au8Response[ UPLOAD_OFS_ARGUMENT ] = gau8Packet[ UPLOAD_OFS_ARGUMENT ];
+          au8Response[ UPLOAD_OFS_STATUS ] = ExecutePacket();
+          u16CRC = Util_CRC16( &au8Response[ UPLOAD_OFS_COMMAND ], UPLOAD_RESPONSE_LENGTH - 3u );
+          au8Response[ UPLOAD_RESPONSE_LENGTH - 2u ] = (U8)( u16CRC >> 8u );
+          au8Response[ UPLOAD_RESPONSE_LENGTH - 1u ] = (U8)u16CRC;
+          Telemetry_Send( au8Response, UPLOAD_RESPONSE_LENGTH );  // If it doesn't fit, the uploader asks again
+        }
+        gu8PacketIndex = 0u;
+      }
+    }
+  }
+}
+
+
+/***************************************< Public functions >**************************************/
+//----------------------------------------------------------------------------
+//! \brief  Initializes the receiver
+//! \param  -
+//! \return -
+//! \global All globals in this module
+//! \note   Should be called from init block, after Telemetry_Init().
+//-----------------------------------------------------------------------------
+void Upload_Init( void )
+{
+  gu8RxWrite = 0u;
+  gu8RxRead = 0u;
+  gbSessionActive = FALSE;
+  gu8PacketIndex = 0u;
+  gu8Slot = NO_SLOT;
+  gu16WrittenBlocks = 0u;
+  gu16WrittenEnd = 0u;
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Processes the received bytes, and ends the session after a silence
+//! \param  -
+//! \return -
+//! \global All globals in this module
+//! \note   Should be called from main cycle, before Telemetry_Task().
+//-----------------------------------------------------------------------------
+void Upload_Task( void )
+{
+  BOOL bReceived = FALSE;
+
+  while( gu8RxRead != gu8RxWrite )
+  {
+    ParseByte( gau8RxRing[ gu8RxRead ] );
+    gu8RxRead = ( gu8RxRead + 1u ) & ( RX_RING_SIZE - 1u );
+    bReceived = TRUE;
+  }
+
+  if( TRUE == bReceived )
+  {
+    Util_TimerStart( UTIL_TIMER_UPLOAD, UPLOAD_SESSION_TIMEOUT_MS, 0u );
+  }
+  else if( TRUE == Util_TimerExpired( UTIL_TIMER_UPLOAD ) )
+  {
+    gbSessionActive = FALSE;
+    gu8PacketIndex = 0u;  // Drop the partial packet
+    gu8Slot = NO_SLOT;
+  }
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Tells whether an upload session is active
+//! \param  -
+//! \return TRUE, if the UART must keep receiving
+//! \global gbSessionActive, gu8RxRead, gu8RxWrite
+//-----------------------------------------------------------------------------
+BOOL Upload_Busy( void )
+{
+  return ( gbSessionActive || ( gu8RxRead != gu8RxWrite ) );
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Stores a received byte
+//! \param  u8Byte: the received byte
+//! \return -
+//! \global gau8RxRing, gu8RxWrite, gbSessionActive
+//! \note   Should be called from the UART1 interrupt routine. If the ring buffer is full, the byte
+//!         is dropped; the packet is then dropped by its CRC.
+//-----------------------------------------------------------------------------
+void Upload_ReceiveByte( U8 u8Byte )
+{
+  U8 u8Next = ( gu8RxWrite + 1u ) & ( RX_RING_SIZE - 1u );
+
+  if( u8Next != gu8RxRead )
+  {
+    gau8RxRing[ gu8RxWrite ] = u8Byte;
+    gu8RxWrite = u8Next;
+  }
+  gbSessionActive = TRUE;
+}
+
+#endif /* ANIMATION_UPLOAD_ENABLED */
+
+
+/***************************************< End of file >**************************************/
@@ -0,0 +1,83 @@
+/*! *******************************************************************************************************
+* Copyright (c) 2022 Hekk_Elek
+*
+* \file upload.h
+*
+* \brief Uploading animations into the EEPROM on the ISP UART
+*
+* \author Hekk_Elek
+*
+**********************************************************************************************************/
+#ifndef UPLOAD_H
+#define UPLOAD_H
+
+/***************************************< Includes >**************************************/
+#include "types.h"
+#include "config.h"
+
+
+/***************************************< Definitions >**************************************/
+#define UPLOAD_SESSION_TIMEOUT_MS  (1000u)  //!< The session ends if nothing is received for this long
+#define UPLOAD_BLOCK_SIZE            (32u)  //!< Longest data of a packet
+
+// Packet: SYNC, COMMAND, ARGUMENT, LENGTH, data (LENGTH bytes), CRC-16F/3 of COMMAND..data (big-endian)
+#define UPLOAD_SYNC                (0x5Au)  //!< First byte of every packet and response
+#define UPLOAD_HEADER_LENGTH          (4u)  //!< Sync, command, argument and length
+#define UPLOAD_PACKET_MAX  ( UPLOAD_HEADER_LENGTH + UPLOAD_BLOCK_SIZE + 2u )  //!< Length of the longest packet
+#define UPLOAD_OFS_COMMAND            (1u)  //!< Offset of the command in packets and responses
+#define UPLOAD_OFS_ARGUMENT           (2u)  //!< Offset of the argument in packets and responses
+#define UPLOAD_OFS_LENGTH             (3u)  //!< Offset of the data length in packets
+#define UPLOAD_OFS_STATUS             (3u)  //!< Offset of the status in responses
+
+// Response: SYNC, COMMAND | UPLOAD_RESPONSE_FLAG, ARGUMENT, STATUS, CRC-16F/3 of COMMAND..STATUS (big-endian)
+#define UPLOAD_RESPONSE_FLAG       (0x80u)  //!< Set in the command byte of the responses
+#define UPLOAD_RESPONSE_LENGTH        (6u)  //!< Length of a response
+
+// Commands
+#define UPLOAD_CMD_BEGIN           (0x01u)  //!< ARGUMENT: slot. No data. Erases the slot
+#define UPLOAD_CMD_DATA            (0x02u)  //!< ARGUMENT: block index. Data: the instructions at ( index * UPLOAD_BLOCK_SIZE )
+#define UPLOAD_CMD_COMMIT          (0x03u)  //!< ARGUMENT: slot. Data: number of normal LED, then RGB LED instructions. Writes the header and plays the slot
+
+// Status of the responses
+#define UPLOAD_STATUS_OK              (0u)  //!< Done
+#define UPLOAD_STATUS_BAD_COMMAND     (1u)  //!< Unknown command, or no BEGIN before it
+#define UPLOAD_STATUS_BAD_ARGUMENT    (2u)  //!< Slot, block or length out of range
+#define UPLOAD_STATUS_INCOMPLETE      (3u)  //!< COMMIT before every block of the instructions was written
+#define UPLOAD_STATUS_VERIFY_FAILED   (4u)  //!< The EEPROM doesn't hold what was written
+
+
+/***************************************< Macros >**************************************/
+#if ( ANIMATION_UPLOAD_ENABLED == 1 )
+#define UPLOAD_INIT()             Upload_Init()
+#define UPLOAD_TASK()             Upload_Task()
+#define UPLOAD_BUSY()             Upload_Busy()
+#define UPLOAD_RX_BYTE( u8Byte )  Upload_ReceiveByte( u8Byte )
+#else
+#define UPLOAD_INIT()
+#define UPLOAD_TASK()
+#define UPLOAD_BUSY()             ( FALSE )
+#define UPLOAD_RX_BYTE( u8Byte )
+#endif
+
+
+/***************************************< Types >**************************************/
+
+
+/***************************************< Constants >**************************************/
+
+
+/***************************************< Global variables >**************************************/
+
+
+/***************************************< Public functions >**************************************/
+#if ( ANIMATION_UPLOAD_ENABLED == 1 )
+void Upload_Init( void );
+void Upload_Task( void );
+BOOL Upload_Busy( void );
+void Upload_ReceiveByte( U8 u8Byte );
+#endif
+
+
+#endif /* UPLOAD_H */
+
+/***************************************< End of file >**************************************/
@@ -8,15 +8,30 @@
 * \author Hekk_Elek
 *
 **********************************************************************************************************/
+/*----------------------------------------------------------------------------------------
+Software timers
+===============
+The timers are identified by E_UTIL_TIMER, each one has a deadline and an optional period.
+The running ones are kept in a list sorted by deadline, so the earliest deadline (i.e. how
+long the system may sleep) is always the first one. The millisecond timer wraps around, so
+deadlines are compared by their signed difference: this is correct as long as they are
+within UTIL_TIMER_MAX_MS of each other and of the current time.
+A periodic timer keeps its phase: if the main cycle was late (e.g. woken up late from a
+power-down), it expires once, and the missed periods are skipped.
+----------------------------------------------------------------------------------------*/
 /*
-TODOs in this module:
--- CRC calculation may need optimization in assembly, as it is a computation-extensive function.
+NOTE: CRC calculation has three implementations, selected by CRC16_IMPLEMENTATION in config.h.
+      The assembly one is in crc16.A51. See tools/crc_bench for their comparison.
+      Only crc16.A51 has been measured in the emulator (27 cycles per byte on DATA/IDATA, 11 per
+      call). The cycles and the code size of the two C ones depend on the compiler and are not
+      known yet: "make crc-bench" gives them from an SDCC build. Until then the default is the
+      256-entry table, as the assembly loop runs on it, not because it was measured faster.
 */
 
 
 /***************************************< Includes >**************************************/
 // Own includes
-#include "stc8g.h"
+#include "hal.h"
 #include "types.h"
 #include "util.h"
 
@@ -26,10 +41,31 @@ TODOs in this module:
 
 
 /***************************************< Types >**************************************/
+//! \brief Software timer
+typedef struct
+{
+  U16 u16Deadline;  //!< Time of expiry (ms)
+  U16 u16Period;    //!< Period (ms), 0 for one-shot timers
+} S_UTIL_TIMER;
 
 
 /***************************************< Constants >**************************************/
+//! \brief Timer 0 reload values for each clock divider, so the tick stays TICK_PERIOD_US long
+static CODE const U16 gcau16Timer0Reload[ CLOCK_SHIFT_MAX + 1u ] =
+{
+  TIMER0_RELOAD( 0u ), TIMER0_RELOAD( 1u ), TIMER0_RELOAD( 2u ), TIMER0_RELOAD( 3u )
+};
+
+#if ( CRC16_IMPLEMENTATION == CRC16_NIBBLE )
+//! \brief Table for calculating CRC-16F/3 by nibbles
+CODE const U16 gcau16CRC16F3NibbleTable[ 16u ] =
+{
+  0x0000u, 0x1B2Bu, 0x3656u, 0x2D7Du, 0x6CACu, 0x7787u, 0x5AFAu, 0x41D1u,
+  0xD958u, 0xC273u, 0xEF0Eu, 0xF425u, 0xB5F4u, 0xAEDFu, 0x83A2u, 0x9889u
+};
+#else
 //! \brief Table for calculating CRC-16F/3
+//! \note  Also used by the assembly implementation, so its layout (big-endian U16) must not change.
 CODE const U16 gcau16CRC16F3Table[] =
 {
   0x0000u, 0x1B2Bu, 0x3656u, 0x2D7Du, 0x6CACu, 0x7787u, 0x5AFAu, 0x41D1u,
@@ -65,18 +101,87 @@ CODE const U16 gcau16CRC16F3Table[] =
   0x4AE3u, 0x51C8u, 0x7CB5u, 0x679Eu, 0x264Fu, 0x3D64u, 0x1019u, 0x0B32u,
   0x93BBu, 0x8890u, 0xA5EDu, 0xBEC6u, 0xFF17u, 0xE43Cu, 0xC941u, 0xD26Au
 };
+#endif
 
 
 /***************************************< Global variables >**************************************/
 //! \brief Globally accessible timer with millisecond resolution. IDATA for fast access.
-DATA U16 gu16TimerMS;
+volatile DATA U16 gu16TimerMS;
+DATA U16 gu16TimeSnapshotMs;  //!< Time of the current main cycle (ms), see Util_TakeTimeSnapshot()
 DATA U8  gu8Prescaler;  //!< Prescaler for the global timer. IDATA for fast access.
+DATA U8  gu8ClockShift; //!< System clock is divided by 2^gu8ClockShift
+static IDATA S_UTIL_TIMER gasTimers[ UTIL_TIMERS_NUM ];  //!< Software timers
+static IDATA U8 gau8TimerOrder[ UTIL_TIMERS_NUM ];       //!< Running timers, sorted by deadline
+static U8 gu8TimersRunning;                              //!< Number of running timers
 
 
 /***************************************< Static function definitions >**************************************/
+static BOOL IsBefore( U16 u16TimeA, U16 u16TimeB );
+static void TimerRemove( U8 u8Timer );
+static void TimerInsert( U8 u8Timer );
 
 
 /***************************************< Private functions >**************************************/
+//----------------------------------------------------------------------------
+//! \brief  Wrap-safe comparison of two times
+//! \param  u16TimeA: first time (ms)
+//! \param  u16TimeB: second time (ms)
+//! \return TRUE, if u16TimeA is earlier than u16TimeB
+//! \global -
+//-----------------------------------------------------------------------------
+static BOOL IsBefore( U16 u16TimeA, U16 u16TimeB )
+{
+  return ( (I16)( u16TimeA - u16TimeB ) < 0 );
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Removes a timer from the sorted list, if it's running
+//! \param  u8Timer: timer (E_UTIL_TIMER)
+//! \return -
+//! \global gau8TimerOrder, gu8TimersRunning
+//-----------------------------------------------------------------------------
+static void TimerRemove( U8 u8Timer )
+{
+  U8 u8Index;
+  BOOL bFound = FALSE;
+
+  for( u8Index = 0u; u8Index < gu8TimersRunning; u8Index++ )
+  {
+    if( gau8TimerOrder[ u8Index ] == u8Timer )
+    {
+      bFound = TRUE;
+    }
+    if( ( TRUE == bFound ) && ( ( u8Index + 1u ) < gu8TimersRunning ) )
+    {
+      gau8TimerOrder[ u8Index ] = gau8TimerOrder[ u8Index + 1u ];
+    }
+  }
+  if( TRUE == bFound )
+  {
+    gu8TimersRunning--;
+  }
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Inserts a timer to the sorted list by its deadline
+//! \param  u8Timer: timer (E_UTIL_TIMER), must not be in the list
+//! \return -
+//! \global gau8TimerOrder, gu8TimersRunning
+//-----------------------------------------------------------------------------
+static void TimerInsert( U8 u8Timer )
+{
+  U8 u8Index = gu8TimersRunning;
+
+  // Shift the later timers backwards, an equal deadline goes after the existing ones
+  while( ( u8Index > 0u )
+      && IsBefore( gasTimers[ u8Timer ].u16Deadline, gasTimers[ gau8TimerOrder[ u8Index - 1u ] ].u16Deadline ) )
+  {
+    gau8TimerOrder[ u8Index ] = gau8TimerOrder[ u8Index - 1u ];
+    u8Index--;
+  }
+  gau8TimerOrder[ u8Index ] = u8Timer;
+  gu8TimersRunning++;
+}
 
 
 /***************************************< Public functions >**************************************/
@@ -119,12 +224,7 @@ char CODE* Util_Get_UID_ptr( void )
 //-----------------------------------------------------------------------------
 void Util_Interrupt( void )
 {
-  gu8Prescaler++;
-  if( gu8Prescaler >= 10u )
-  {
-    gu16TimerMS++;
-    gu8Prescaler = 0u;
-  }
+  UTIL_INTERRUPT_BODY();
 }
 
 //----------------------------------------------------------------------------
@@ -138,6 +238,9 @@ void Util_Init( void )
 {
   gu8Prescaler = 0u;
   gu16TimerMS = 0u;
+  gu16TimeSnapshotMs = 0u;
+  gu8ClockShift = 0u;
+  gu8TimersRunning = 0u;
 }
 
 //----------------------------------------------------------------------------
@@ -145,19 +248,182 @@ void Util_Init( void )
 //! \param  -
 //! \return Timer value
 //! \global Global timer (ms)
-//! \note   Should be called from main program only!
+//! \note   Lock-free: the two bytes are read again if the timer interrupt changed them in between.
+//!         Main cycle only: not reentrant, the interrupts read gu16TimerMS inline.
 //-----------------------------------------------------------------------------
 U16 Util_GetTimerMs( void )
 {
   U16 u16Ret;
   
-  DISABLE_IT;
-  u16Ret = gu16TimerMS;
-  ENABLE_IT;
+  // The timer changes once in a millisecond, so this repeats at most once
+  do
+  {
+    u16Ret = gu16TimerMS;
+  } while( u16Ret != gu16TimerMS );
   
   return u16Ret;
 }
 
+//----------------------------------------------------------------------------
+//! \brief  Takes the time of the current main cycle
+//! \param  -
+//! \return Timer value (ms)
+//! \global gu16TimeSnapshotMs
+//! \note   Should be called at the beginning of the main cycle. The software timers and the
+//!         animation use this snapshot, so everything in a cycle sees the same time.
+//-----------------------------------------------------------------------------
+U16 Util_TakeTimeSnapshot( void )
+{
+  gu16TimeSnapshotMs = Util_GetTimerMs();
+  
+  return gu16TimeSnapshotMs;
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Advance global timer (ms)
+//! \param  u16Ms: milliseconds to add
+//! \return -
+//! \global Global timer (ms)
+//! \note   Used after timer 0 was stopped, e.g. in power-down mode or in an EEPROM page erase.
+//!         No locking is needed, as the timer interrupt doesn't run then (interrupts are disabled).
+//-----------------------------------------------------------------------------
+void Util_AdvanceTimerMs( U16 u16Ms )
+{
+  gu16TimerMS += u16Ms;
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Sets the system clock divider and the timer 0 reload value accordingly
+//! \param  u8ClockShift: system clock is divided by 2^u8ClockShift (0..CLOCK_SHIFT_MAX)
+//! \return -
+//! \global gu8ClockShift
+//! \note   The tick period stays the same. Timing loops must scale themselves by gu8ClockShift.
+//!         Interrupts stay enabled: gu8ClockShift is updated on the side where a timing loop
+//!         running in between gets shorter, never longer.
+//-----------------------------------------------------------------------------
+void Util_SetClockShift( U8 u8ClockShift )
+{
+  if( ( u8ClockShift != gu8ClockShift ) && ( u8ClockShift <= CLOCK_SHIFT_MAX ) )
+  {
+    if( u8ClockShift > gu8ClockShift )  // Slowing down: shorten the loops first
+    {
+      gu8ClockShift = u8ClockShift;
+    }
+    HAL_CLOCK_DIVIDER( 1u << u8ClockShift );
+    gu8ClockShift = u8ClockShift;  // Speeding up: lengthen the loops after the clock
+    // Timer 0 is running, so these set only the reload value: the current tick finishes at the old rate
+    HAL_TIMER0_RELOAD( gcau16Timer0Reload[ u8ClockShift ] );
+  }
+}
+
+//----------------------------------------------------------------------------
+//! \brief  (Re)starts a software timer with an absolute deadline
+//! \param  u8Timer: timer (E_UTIL_TIMER)
+//! \param  u16DeadlineMs: time of the first expiry, may be in the past (max. UTIL_TIMER_MAX_MS)
+//! \param  u16PeriodMs: period after the first expiry, 0 for a one-shot timer (max. UTIL_TIMER_MAX_MS)
+//! \return -
+//! \global Software timers
+//! \note   Should be called from main program only!
+//-----------------------------------------------------------------------------
+void Util_TimerSetDeadline( U8 u8Timer, U16 u16DeadlineMs, U16 u16PeriodMs )
+{
+  if( u8Timer < UTIL_TIMERS_NUM )
+  {
+    TimerRemove( u8Timer );
+    gasTimers[ u8Timer ].u16Deadline = u16DeadlineMs;
+    gasTimers[ u8Timer ].u16Period = u16PeriodMs;
+    TimerInsert( u8Timer );
+  }
+}
+
+//----------------------------------------------------------------------------
+//! \brief  (Re)starts a software timer
+//! \param  u8Timer: timer (E_UTIL_TIMER)
+//! \param  u16DelayMs: time from the current time snapshot until the first expiry (max. UTIL_TIMER_MAX_MS)
+//! \param  u16PeriodMs: period after the first expiry, 0 for a one-shot timer (max. UTIL_TIMER_MAX_MS)
+//! \return -
+//! \global Software timers
+//! \note   Should be called from main program only!
+//-----------------------------------------------------------------------------
+void Util_TimerStart( U8 u8Timer, U16 u16DelayMs, U16 u16PeriodMs )
+{
+  Util_TimerSetDeadline( u8Timer, gu16TimeSnapshotMs + u16DelayMs, u16PeriodMs );
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Stops a software timer
+//! \param  u8Timer: timer (E_UTIL_TIMER)
+//! \return -
+//! \global Software timers
+//! \note   Should be called from main program only!
+//-----------------------------------------------------------------------------
+void Util_TimerStop( U8 u8Timer )
+{
+  TimerRemove( u8Timer );
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Checks whether a software timer has expired
+//! \param  u8Timer: timer (E_UTIL_TIMER)
+//! \return TRUE once for every expiry; FALSE if it's not due yet, or not running
+//! \global Software timers
+//! \note   A one-shot timer stops, a periodic one is rescheduled. Should be called from main program only!
+//-----------------------------------------------------------------------------
+BOOL Util_TimerExpired( U8 u8Timer )
+{
+  BOOL bExpired = FALSE;
+  U16  u16Now = gu16TimeSnapshotMs;
+  U8   u8Index;
+
+  for( u8Index = 0u; u8Index < gu8TimersRunning; u8Index++ )
+  {
+    if( ( gau8TimerOrder[ u8Index ] == u8Timer ) && ( FALSE == IsBefore( u16Now, gasTimers[ u8Timer ].u16Deadline ) ) )
+    {
+      bExpired = TRUE;
+    }
+  }
+  if( TRUE == bExpired )
+  {
+    TimerRemove( u8Timer );
+    if( 0u != gasTimers[ u8Timer ].u16Period )
+    {
+      // Next period; skip the missed ones
+      do
+      {
+        gasTimers[ u8Timer ].u16Deadline += gasTimers[ u8Timer ].u16Period;
+      } while( FALSE == IsBefore( u16Now, gasTimers[ u8Timer ].u16Deadline ) );
+      TimerInsert( u8Timer );
+    }
+  }
+
+  return bExpired;
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Gives the time until the earliest deadline of the software timers
+//! \param  -
+//! \return Milliseconds until the first timer expires (0 if it's already due), UTIL_TIMER_NONE if none is running
+//! \global Software timers
+//! \note   Should be called from main program only!
+//-----------------------------------------------------------------------------
+U16 Util_TimerNextDeadline( void )
+{
+  U16 u16Remaining = UTIL_TIMER_NONE;
+  U16 u16Now = Util_GetTimerMs();
+
+  if( 0u != gu8TimersRunning )
+  {
+    u16Remaining = 0u;
+    if( IsBefore( u16Now, gasTimers[ gau8TimerOrder[ 0u ] ].u16Deadline ) )
+    {
+      u16Remaining = gasTimers[ gau8TimerOrder[ 0u ] ].u16Deadline - u16Now;
+    }
+  }
+
+  return u16Remaining;
+}
+
+#if ( CRC16_IMPLEMENTATION == CRC16_TABLE256 )
 //----------------------------------------------------------------------------
 //! \brief  Calculates CRC16 of given buffer
 //! \param  *pu8Buffer: given buffer
@@ -165,7 +431,7 @@ U16 Util_GetTimerMs( void )
 //! \return CRC16 value
 //! \global -
 //-----------------------------------------------------------------------------
-U16 Util_CRC16( U8* pu8Buffer, U8 u8Length ) REENTRANT
+U16 Util_CRC16( U8* pu8Buffer, U8 u8Length )
 {
   U16 u16Crc;
   U8  u8Idx;
@@ -179,5 +445,39 @@ U16 Util_CRC16( U8* pu8Buffer, U8 u8Length ) REENTRANT
   return u16Crc;
 }
 
+#elif ( CRC16_IMPLEMENTATION == CRC16_NIBBLE )
+//----------------------------------------------------------------------------
+//! \brief  Calculates CRC16 of given buffer, processing it by nibbles
+//! \param  *pu8Buffer: given buffer
+//! \param  u8Length: length of the buffer
+//! \return CRC16 value
+//! \global -
+//! \note   Slower than the 256-entry table, but needs 480 bytes less flash.
+//-----------------------------------------------------------------------------
+U16 Util_CRC16( U8* pu8Buffer, U8 u8Length )
+{
+  U16 u16Crc;
+  U8  u8Idx;
+
+  u16Crc = CRC16_PRECONDITION;
+  for( u8Idx = 0; u8Idx != u8Length; u8Idx++ )
+  {
+    u16Crc = (U16)( u16Crc << 4u ) ^ gcau16CRC16F3NibbleTable[ (U8)( u16Crc >> 12u ) ^ (U8)( pu8Buffer[ u8Idx ] >> 4u ) ];
+    u16Crc = (U16)( u16Crc << 4u ) ^ gcau16CRC16F3NibbleTable[ (U8)( u16Crc >> 12u ) ^ (U8)( pu8Buffer[ u8Idx ] & 0x0Fu ) ];
+  }
+
+  return u16Crc;
+}
+
+#elif ( CRC16_IMPLEMENTATION == CRC16_ASM )
+#if defined( HOST_BUILD ) || defined( __SDCC )
+#error "The assembly CRC16 implementation is written for Keil A51, it can't be used in the host simulation or with SDCC"
+#endif
+// Util_CRC16() is implemented in crc16.A51
+
+#else
+#error "Unknown CRC16_IMPLEMENTATION"
+#endif
+
 
 /***************************************< End of file >**************************************/
@@ -12,28 +12,63 @@
 #define UTIL_H
 
 /***************************************< Includes >**************************************/
-#include "stc8g.h"
+#include "hal.h"
 #include "platform.h"
+#include "config.h"
 
 
 /***************************************< Definitions >**************************************/
 #define UID_LENGTH        (7u)  //!< Length of the unique ID of the MCU
-#define SYSTEM_CLOCK_MHZ (24u)  //!< System clock in MHz, rounded to integers
+#define TICK_PERIOD_US  (100u)  //!< Period of the timer 0 interrupt
+#define TICKS_PER_MS    ( 1000u / TICK_PERIOD_US )  //!< Timer 0 interrupts in a millisecond
+//! \brief Timer 0 reload value of the tick at a given clock divider (1T mode)
+#define TIMER0_RELOAD( u8ClockShift )  ( (U16)( 65536UL - ( ( SYSTEM_CLOCK_HZ >> (u8ClockShift) ) / ( 1000000UL / TICK_PERIOD_US ) ) ) )
+#define CURRENT_CLOCK_MHZ  ( (U8)( SYSTEM_CLOCK_MHZ >> gu8ClockShift ) )  //!< System clock in MHz with the current divider
+#define UTIL_TIMER_NONE  (0xFFFFu)  //!< Util_TimerNextDeadline(): no timer is running
+#define UTIL_TIMER_MAX_MS (32767u)  //!< Longest delay or period of a software timer (wrap-safe comparison limit)
 
 
 /***************************************< Macros >**************************************/
 #define DISABLE_IT     EA = 0;NOP();  //!< Global interrupt disable
 #define ENABLE_IT      EA = 1;NOP();  //!< Global interrupt enable
+//! \brief Timer 0 interrupt work of this module, expanded in place in the flattened interrupt routine
+#define UTIL_INTERRUPT_BODY() \
+  do \
+  { \
+    gu8Prescaler++; \
+    if( gu8Prescaler >= TICKS_PER_MS ) \
+    { \
+      gu16TimerMS++; \
+      gu8Prescaler = 0u; \
+    } \
+  } while( 0 )
 
 
 /***************************************< Types >**************************************/
+//! \brief Software timers
+//! \note  Each user has its own timer, add new ones before UTIL_TIMERS_NUM
+typedef enum
+{
+  UTIL_TIMER_BUTTON,        //!< Button debouncing and long press detection
+  UTIL_TIMER_BATTERYLEVEL,  //!< Battery level gauge steps and background measurements
+#if ( TELEMETRY_ENABLED == 1 )
+  UTIL_TIMER_TELEMETRY,     //!< Telemetry frame period
+#endif
+#if ( ANIMATION_UPLOAD_ENABLED == 1 )
+  UTIL_TIMER_UPLOAD,        //!< End of the animation upload session
+#endif
+  UTIL_TIMERS_NUM           //!< Number of software timers
+} E_UTIL_TIMER;
 
 
 /***************************************< Constants >**************************************/
 
 
 /***************************************< Global variables >**************************************/
-extern DATA U16 gu16TimerMS;
+extern volatile DATA U16 gu16TimerMS;
+extern DATA U8  gu8Prescaler;
+extern DATA U16 gu16TimeSnapshotMs;
+extern DATA U8  gu8ClockShift;
 
 
 /***************************************< Public functions >**************************************/
@@ -42,7 +77,15 @@ void Util_Get_UID( U8* pu8Dest );
 void Util_Interrupt( void );
 void Util_Init( void );
 U16 Util_GetTimerMs( void );
-U16 Util_CRC16( U8* pu8Buffer, U8 u8Length ) REENTRANT;
+U16 Util_TakeTimeSnapshot( void );
+void Util_AdvanceTimerMs( U16 u16Ms );
+void Util_SetClockShift( U8 u8ClockShift );
+void Util_TimerStart( U8 u8Timer, U16 u16DelayMs, U16 u16PeriodMs );
+void Util_TimerSetDeadline( U8 u8Timer, U16 u16DeadlineMs, U16 u16PeriodMs );
+void Util_TimerStop( U8 u8Timer );
+BOOL Util_TimerExpired( U8 u8Timer );
+U16 Util_TimerNextDeadline( void );
+U16 Util_CRC16( U8* pu8Buffer, U8 u8Length );
 
 
 #endif /* UTIL_H */
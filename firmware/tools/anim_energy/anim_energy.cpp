@@ -0,0 +1,754 @@
+/*! *******************************************************************************************************
+* Copyright (c) 2022 Hekk_Elek
+*
+* \file anim_energy.cpp
+*
+* \brief Supply current and CR2032 battery life of each built-in animation, from the netlist
+*
+* \author Hekk_Elek
+*
+**********************************************************************************************************/
+
+/*----------------------------------------------------------------------------------------
+How it works
+============
+The KiCad netlist (SEM15.xml) is read to find what each pin of the microcontroller drives:
+  - normal LED pins sink the cathodes of one or two LEDs, whose anodes are pulled up by a
+    common resistor: the pin current is ( Vbat - Vf - pin drop ) / R while the pin is low
+  - RGB pins drive the gate of a P-MOSFET, which connects an inductor to the battery for
+    the length of the pulse; when it's switched off the inductor discharges through the
+    LEDs on its drain. The battery gives Vbat * t^2 / ( 2 * L ) charge per pulse, up to a
+    peak current of Vbat * t / L, regardless of the number of LEDs.
+The forward voltage comes from the value of the LED (the colour, see gasLEDTypes); the
+inductance isn't in the netlist, so it's an option (1 mH, see SEM15_BOM_terv.csv).
+
+util.c, led.c, rgbled.c and animation.c are included in this file and compiled for the host,
+on top of the simulated registers (tools/host), with the default driver parameters. Every
+animation of gasAnimations is played: the bodies of the flattened timer 0 interrupt run
+in every 100 us tick and Animation_Cycle() in every millisecond. The pins are sampled after
+every tick, the RGB pulses are caught by the SFR write hook, and the length of the pulses
+and of the interrupt comes from the cycle model of tools/host/isr_model.h.
+
+The mean current is the LED current, the RGB pulse charge and the microcontroller (idle,
+plus the interrupt load at the active current). The peak is the largest sum within a tick:
+the lit LED pins, the end of the longest pulse and the active microcontroller. The runtime
+is the capacity of the cell divided by the mean current; the firmware turns itself off
+after 5 hours, so the number of such sessions is printed too. The voltage sag is the peak
+current on the internal resistance of the cell. The firmware may power down while nothing
+is lit, so mostly dark animations are estimated pessimistically.
+
+Build (from this directory):
+  g++ -O2 -DHOST_BUILD -I../../src -I../host anim_energy.cpp -x c++ ../../src/persist.c ../../src/iap.c \
+      -x none ../host/host_stc8g.cpp -o anim_energy
+Run:
+  ./anim_energy [--netlist ../../../SEM15.xml] [--time seconds] [--vbat volts] [--capacity mAh]
+                [--rint ohms] [--inductance mH] [--vf value=volts]...
+----------------------------------------------------------------------------------------*/
+
+/***************************************< Includes >**************************************/
+// Standard C libraries
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Own includes
+#include "types.h"
+#include "host_stc8g.h"
+#include "isr_model.h"
+
+// The firmware under test
+#include "util.c"
+#include "led.c"
+#include "rgbled.c"
+#include "animation.c"
+
+
+/***************************************< Definitions >**************************************/
+#define DEFAULT_NETLIST   "../../../SEM15.xml"  //!< Netlist of the board, relative to this directory
+#define DEFAULT_TIME_S                  (60u)  //!< Simulated time of an animation
+#define DEFAULT_VBAT                    (3.0)  //!< Battery voltage (V), a CR2032 for most of its life
+#define DEFAULT_CAPACITY_MAH          (225.0)  //!< Nominal capacity of a CR2032
+#define DEFAULT_RINT_OHMS              (15.0)  //!< Internal resistance of a fresh CR2032
+#define DEFAULT_INDUCTANCE_MH           (1.0)  //!< The netlist says only "L"; 1 mH in SEM15_BOM_terv.csv
+#define PIN_DROP_V                      (0.1)  //!< Voltage of a GPIO sinking a few mA
+#define SESSION_HOURS                   (5.0)  //!< The firmware turns itself off after this
+
+#define COMPS_MAX                      (128u)  //!< Maximum number of components in the netlist
+#define NODES_MAX                      (512u)  //!< Maximum number of connections in the netlist
+#define LOADS_MAX                       (16u)  //!< Maximum number of pins driving LEDs
+#define NAME_LENGTH                     (24u)  //!< Maximum length of a reference, value or pin function
+
+// Kinds of loads
+#define LOAD_RESISTOR                    (0u)  //!< LEDs with a pull-up resistor, sunk by the pin
+#define LOAD_INDUCTOR                    (1u)  //!< Inductor switched by a P-MOSFET, discharged into LEDs
+
+
+/***************************************< Types >**************************************/
+//! \brief A component of the netlist
+typedef struct
+{
+  char acRef[ NAME_LENGTH ];    //!< Reference, e.g. "D11"
+  char acValue[ NAME_LENGTH ];  //!< Value, e.g. "LED_G"
+} S_COMP;
+
+//! \brief A connection of the netlist
+typedef struct
+{
+  char acRef[ NAME_LENGTH ];       //!< Reference of the component
+  char acFunction[ NAME_LENGTH ];  //!< Pin function, e.g. "K" or "P1.7"; empty if none
+  U16  u16Net;                     //!< Number of the net (in the order of the file)
+} S_NODE;
+
+//! \brief Colour and forward voltage of an LED value
+typedef struct
+{
+  char   acValue[ NAME_LENGTH ];  //!< Value in the netlist
+  char   acColour[ NAME_LENGTH ]; //!< Colour
+  double dVf;                     //!< Forward voltage (V) at a few mA
+} S_LED_TYPE;
+
+//! \brief What a pin of the microcontroller drives
+typedef struct
+{
+  char   acPin[ NAME_LENGTH ];  //!< Pin function, e.g. "P1.7"
+  U8     u8Address;             //!< SFR address of the port
+  U8     u8Mask;                //!< Mask of the pin
+  U8     u8Kind;                //!< LOAD_*
+  U8     u8LEDs;                //!< Number of LEDs
+  char   acColour[ NAME_LENGTH ];  //!< Colour of the LEDs
+  double dValue;                //!< Resistance (ohm) or inductance (H)
+  double dCurrentMa;            //!< Current while the pin is low; peak current of a pulse
+  double dChargeUc;             //!< Charge of a pulse (uC)
+  U8     u8Loops;               //!< Delay loops of a pulse
+} S_LOAD;
+
+//! \brief Result of an animation
+typedef struct
+{
+  U8     u8Animation;  //!< Index in gasAnimations
+  double dLEDMa;       //!< Mean current of the normal LEDs
+  double dRGBMa;       //!< Mean current of the RGB pulses
+  double dMCUMa;       //!< Mean current of the microcontroller
+  double dMeanMa;      //!< Mean supply current
+  double dPeakMa;      //!< Peak supply current
+} S_RESULT;
+
+//! \brief RGB pin and the pulse delay loops used for it
+typedef struct
+{
+  U8 u8Address;  //!< SFR address of the port
+  U8 u8Mask;     //!< Mask of the pin
+  U8 u8Loops;    //!< *_PULSE_LOOPS
+} S_PULSE_PIN;
+
+
+/***************************************< Constants >**************************************/
+//! \brief Port numbers to SFR addresses
+static const U8 gcau8PortAddress[ 8u ] = { 0x80u, 0x90u, 0xA0u, 0xB0u, 0xC0u, 0xC8u, 0xE8u, 0xF8u };
+
+//! \brief Pulse lengths of the RGB pins (see rgbled.h)
+static const S_PULSE_PIN gcasPulsePins[ NUM_RGBLED_COLORS ] =
+{
+  { 0xC8u, 0x20u, S_PULSE_LOOPS }, { 0xC8u, 0x10u, E_PULSE_LOOPS },  // P5.5 "S", P5.4 "E"
+  { 0xB0u, 0x80u, ONE_PULSE_LOOPS }, { 0xB0u, 0x08u, FIVE_PULSE_LOOPS }  // P3.7 "1", P3.3 "5"
+};
+
+
+/***************************************< Global variables >**************************************/
+//! \brief Known LED values; typical forward voltages, may be changed with --vf
+static S_LED_TYPE gasLEDTypes[ 8u ] =
+{
+  { "LED",   "white", 2.9 },  // C34499
+  { "LED_G", "green", 2.1 },  // C2297
+};
+static U8       gu8LEDTypes = 2u;                 //!< Number of entries in gasLEDTypes
+static S_COMP   gasComps[ COMPS_MAX ];            //!< Components of the netlist
+static U16      gu16Comps;
+static S_NODE   gasNodes[ NODES_MAX ];            //!< Connections of the netlist
+static U16      gu16Nodes;
+static S_LOAD   gasLoads[ LOADS_MAX ];            //!< What the pins drive
+static U8       gu8Loads;
+static double   gdVbat = DEFAULT_VBAT;            //!< Battery voltage (V)
+static double   gdInductance = DEFAULT_INDUCTANCE_MH * 1e-3;  //!< Inductance, if the netlist has no value (H)
+static U8       gau8PortShadow[ 256u ];           //!< Previous value of the ports
+static U8       gu8TickPulses;                    //!< Bit mask of the loads pulsed in the current tick
+
+
+/***************************************< Static function definitions >**************************************/
+static BOOL ParseValue( const char* pcText, double* pdValue );
+static BOOL GetAttribute( const char* pcTag, const char* pcName, char* pcValue );
+static BOOL ReadNetlist( const char* pcFileName );
+static const char* FindValue( const char* pcRef );
+static U16  FindNode( const char* pcRef, const char* pcFunction );
+static U16  FindOnNet( U16 u16Net, char cPrefix, const char* pcFunction, U16 u16From );
+static BOOL AddLEDs( S_LOAD* psLoad, U16 u16Net );
+static void BuildLoads( void );
+static void SfrHook( U8 u8Address, U8 u8Value );
+static void Run( U8 u8Animation, U32 u32TimeS, S_RESULT* psResult );
+static int  CompareMean( const void* pvA, const void* pvB );
+
+
+/***************************************< Private functions >**************************************/
+//----------------------------------------------------------------------------
+//! \brief  Parses a component value with an SI prefix, e.g. "510", "1k", "1mH"
+//! \param  pcText: the value
+//! \param  pdValue: the number is written here
+//! \return TRUE if it starts with a number
+//-----------------------------------------------------------------------------
+static BOOL ParseValue( const char* pcText, double* pdValue )
+{
+  BOOL  bResult = FALSE;
+  char* pcEnd;
+
+  *pdValue = strtod( pcText, &pcEnd );
+  if( pcEnd != pcText )
+  {
+    bResult = TRUE;
+    switch( *pcEnd )
+    {
+      case 'M': *pdValue *= 1e6;  break;
+      case 'k': *pdValue *= 1e3;  break;
+      case 'm': *pdValue *= 1e-3; break;
+      case 'u': *pdValue *= 1e-6; break;
+      case 'n': *pdValue *= 1e-9; break;
+      default:                    break;
+    }
+  }
+  return bResult;
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Reads an attribute of an XML tag
+//! \param  pcTag: start of the tag
+//! \param  pcName: name of the attribute with the equal sign and the quote, e.g. "ref=\""
+//! \param  pcValue: the value is written here (NAME_LENGTH bytes), empty if not found
+//! \return TRUE if the attribute was found
+//-----------------------------------------------------------------------------
+static BOOL GetAttribute( const char* pcTag, const char* pcName, char* pcValue )
+{
+  BOOL        bResult = FALSE;
+  const char* pcEnd = strchr( pcTag, '>' );
+  const char* pcStart = strstr( pcTag, pcName );
+  U8          u8Length = 0u;
+
+  if( ( 0 != pcStart ) && ( ( 0 == pcEnd ) || ( pcStart < pcEnd ) ) )
+  {
+    pcStart += strlen( pcName );
+    while( ( '"' != pcStart[ u8Length ] ) && ( '\0' != pcStart[ u8Length ] ) && ( u8Length < ( NAME_LENGTH - 1u ) ) )
+    {
+      pcValue[ u8Length ] = pcStart[ u8Length ];
+      u8Length++;
+    }
+    bResult = TRUE;
+  }
+  pcValue[ u8Length ] = '\0';
+  return bResult;
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Reads the components and the nets of a KiCad XML netlist
+//! \param  pcFileName: the netlist
+//! \return TRUE if it was read
+//! \global gasComps[], gasNodes[]
+//-----------------------------------------------------------------------------
+static BOOL ReadNetlist( const char* pcFileName )
+{
+  BOOL        bResult = FALSE;
+  FILE*       psFile = fopen( pcFileName, "rb" );
+  char*       pcText = 0;
+  const char* pcPos;
+  const char* pcValue;
+  const char* pcNextComp;
+  long        iLength;
+  U16         u16Net = 0u;
+  U8          u8Length;
+
+  if( 0 != psFile )
+  {
+    fseek( psFile, 0, SEEK_END );
+    iLength = ftell( psFile );
+    fseek( psFile, 0, SEEK_SET );
+    pcText = (char*)malloc( (size_t)iLength + 1u );
+    if( ( 0 != pcText ) && ( (size_t)iLength == fread( pcText, 1u, (size_t)iLength, psFile ) ) )
+    {
+      pcText[ iLength ] = '\0';
+      bResult = TRUE;
+    }
+    fclose( psFile );
+  }
+
+  // Components: <comp ref="D1"> ... <value>LED</value>
+  pcPos = ( TRUE == bResult ) ? strstr( pcText, "<comp " ) : 0;
+  while( ( 0 != pcPos ) && ( gu16Comps < COMPS_MAX ) )
+  {
+    GetAttribute( pcPos, "ref=\"", gasComps[ gu16Comps ].acRef );
+    pcNextComp = strstr( pcPos + 1, "<comp " );
+    pcValue = strstr( pcPos, "<value>" );
+    u8Length = 0u;
+    if( ( 0 != pcValue ) && ( ( 0 == pcNextComp ) || ( pcValue < pcNextComp ) ) )
+    {
+      pcValue += strlen( "<value>" );
+      while( ( '<' != pcValue[ u8Length ] ) && ( '\0' != pcValue[ u8Length ] ) && ( u8Length < ( NAME_LENGTH - 1u ) ) )
+      {
+        gasComps[ gu16Comps ].acValue[ u8Length ] = pcValue[ u8Length ];
+        u8Length++;
+      }
+    }
+    gasComps[ gu16Comps ].acValue[ u8Length ] = '\0';
+    gu16Comps++;
+    pcPos = pcNextComp;
+  }
+
+  // Nets: <net ...> <node ref="D1" pin="1" pinfunction="K" .../> ... </net>
+  pcPos = ( TRUE == bResult ) ? strstr( pcText, "<nets>" ) : 0;
+  while( ( 0 != pcPos ) && ( gu16Nodes < NODES_MAX ) )
+  {
+    pcPos = strchr( pcPos + 1, '<' );
+    if( 0 != pcPos )
+    {
+      if( 0 == strncmp( pcPos, "<net ", 5u ) )
+      {
+        u16Net++;
+      }
+      else if( 0 == strncmp( pcPos, "<node ", 6u ) )
+      {
+        GetAttribute( pcPos, "ref=\"", gasNodes[ gu16Nodes ].acRef );
+        GetAttribute( pcPos, "pinfunction=\"", gasNodes[ gu16Nodes ].acFunction );
+        gasNodes[ gu16Nodes ].u16Net = u16Net;
+        gu16Nodes++;
+      }
+      else if( 0 == strncmp( pcPos, "</nets>", 7u ) )
+      {
+        pcPos = 0;
+      }
+    }
+  }
+  free( pcText );
+  return ( bResult && ( 0u != gu16Comps ) && ( 0u != gu16Nodes ) );
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Finds the value of a component
+//! \param  pcRef: reference
+//! \return Value, empty string if not found
+//-----------------------------------------------------------------------------
+static const char* FindValue( const char* pcRef )
+{
+  const char* pcValue = "";
+  U16         u16Index;
+
+  for( u16Index = 0u; u16Index < gu16Comps; u16Index++ )
+  {
+    if( 0 == strcmp( gasComps[ u16Index ].acRef, pcRef ) )
+    {
+      pcValue = gasComps[ u16Index ].acValue;
+    }
+  }
+  return pcValue;
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Finds a pin of a component
+//! \param  pcRef: reference
+//! \param  pcFunction: pin function
+//! \return Index in gasNodes, gu16Nodes if not found
+//-----------------------------------------------------------------------------
+static U16 FindNode( const char* pcRef, const char* pcFunction )
+{
+  U16 u16Found = gu16Nodes;
+  U16 u16Index;
+
+  for( u16Index = 0u; ( u16Index < gu16Nodes ) && ( u16Found == gu16Nodes ); u16Index++ )
+  {
+    if( ( 0 == strcmp( gasNodes[ u16Index ].acRef, pcRef ) ) && ( 0 == strcmp( gasNodes[ u16Index ].acFunction, pcFunction ) ) )
+    {
+      u16Found = u16Index;
+    }
+  }
+  return u16Found;
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Finds a connection on a net
+//! \param  u16Net: the net
+//! \param  cPrefix: first letter of the reference, e.g. 'D'
+//! \param  pcFunction: pin function, 0 for any
+//! \param  u16From: first index of gasNodes to check
+//! \return Index in gasNodes, gu16Nodes if not found
+//-----------------------------------------------------------------------------
+static U16 FindOnNet( U16 u16Net, char cPrefix, const char* pcFunction, U16 u16From )
+{
+  U16 u16Found = gu16Nodes;
+  U16 u16Index;
+
+  for( u16Index = u16From; ( u16Index < gu16Nodes ) && ( u16Found == gu16Nodes ); u16Index++ )
+  {
+    if( ( gasNodes[ u16Index ].u16Net == u16Net ) && ( cPrefix == gasNodes[ u16Index ].acRef[ 0u ] )
+     && ( ( 0 == pcFunction ) || ( 0 == strcmp( gasNodes[ u16Index ].acFunction, pcFunction ) ) ) )
+    {
+      u16Found = u16Index;
+    }
+  }
+  return u16Found;
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Counts the LEDs whose cathode is on a net, takes their colour
+//! \param  psLoad: the load
+//! \param  u16Net: the net
+//! \return TRUE if there's at least one LED
+//-----------------------------------------------------------------------------
+static BOOL AddLEDs( S_LOAD* psLoad, U16 u16Net )
+{
+  U16         u16Node = FindOnNet( u16Net, 'D', "K", 0u );
+  const char* pcValue;
+  U8          u8Type;
+
+  psLoad->u8LEDs = 0u;
+  strcpy( psLoad->acColour, "?" );
+  while( u16Node < gu16Nodes )
+  {
+    pcValue = FindValue( gasNodes[ u16Node ].acRef );
+    for( u8Type = 0u; u8Type < gu8LEDTypes; u8Type++ )
+    {
+      if( 0 == strcmp( gasLEDTypes[ u8Type ].acValue, pcValue ) )
+      {
+        strcpy( psLoad->acColour, gasLEDTypes[ u8Type ].acColour );
+      }
+    }
+    psLoad->u8LEDs++;
+    u16Node = FindOnNet( u16Net, 'D', "K", u16Node + 1u );
+  }
+  return ( 0u != psLoad->u8LEDs );
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Finds what each port pin of the microcontroller drives, calculates the currents
+//! \param  -
+//! \return -
+//! \global gasLoads[]
+//-----------------------------------------------------------------------------
+static void BuildLoads( void )
+{
+  U16         u16Index;
+  U16         u16Node;
+  U8          u8Pulse;
+  double      dVf;
+  double      dSeconds;
+  S_LOAD*     psLoad;
+  const char* pcFunction;
+  const char* pcValue;
+  U8          u8Type;
+
+  for( u16Index = 0u; ( u16Index < gu16Nodes ) && ( gu8Loads < LOADS_MAX ); u16Index++ )
+  {
+    pcFunction = gasNodes[ u16Index ].acFunction;
+    if( ( 'U' == gasNodes[ u16Index ].acRef[ 0u ] ) && ( 'P' == pcFunction[ 0u ] ) && ( '.' == pcFunction[ 2u ] )
+     && ( pcFunction[ 1u ] >= '0' ) && ( pcFunction[ 1u ] <= '7' ) && ( pcFunction[ 3u ] >= '0' ) && ( pcFunction[ 3u ] <= '7' ) )
+    {
+      psLoad = &gasLoads[ gu8Loads ];
+      memset( psLoad, 0, sizeof( S_LOAD ) );
+      strcpy( psLoad->acPin, pcFunction );
+      psLoad->u8Address = gcau8PortAddress[ pcFunction[ 1u ] - '0' ];
+      psLoad->u8Mask = (U8)( 1u << ( pcFunction[ 3u ] - '0' ) );
+
+      // LED cathodes on the pin, pulled up by a resistor
+      if( TRUE == AddLEDs( psLoad, gasNodes[ u16Index ].u16Net ) )
+      {
+        u16Node = FindOnNet( gasNodes[ u16Index ].u16Net, 'D', "K", 0u );
+        u16Node = FindNode( gasNodes[ u16Node ].acRef, "A" );
+        if( u16Node < gu16Nodes )
+        {
+          u16Node = FindOnNet( gasNodes[ u16Node ].u16Net, 'R', 0, 0u );
+        }
+        pcValue = FindValue( gasNodes[ FindOnNet( gasNodes[ u16Index ].u16Net, 'D', "K", 0u ) ].acRef );
+        dVf = 2.0;
+        for( u8Type = 0u; u8Type < gu8LEDTypes; u8Type++ )
+        {
+          if( 0 == strcmp( gasLEDTypes[ u8Type ].acValue, pcValue ) )
+          {
+            dVf = gasLEDTypes[ u8Type ].dVf;
+          }
+        }
+        if( ( u16Node < gu16Nodes ) && ( TRUE == ParseValue( FindValue( gasNodes[ u16Node ].acRef ), &psLoad->dValue ) ) )
+        {
+          psLoad->u8Kind = LOAD_RESISTOR;
+          psLoad->dCurrentMa = 1000.0 * ( gdVbat - dVf - PIN_DROP_V ) / psLoad->dValue;
+          if( psLoad->dCurrentMa < 0.0 )
+          {
+            psLoad->dCurrentMa = 0.0;
+          }
+          gu8Loads++;
+        }
+      }
+      // Gate of a P-MOSFET switching an inductor, LEDs on the drain
+      else if( FindOnNet( gasNodes[ u16Index ].u16Net, 'Q', "G", 0u ) < gu16Nodes )
+      {
+        u16Node = FindNode( gasNodes[ FindOnNet( gasNodes[ u16Index ].u16Net, 'Q', "G", 0u ) ].acRef, "D" );
+        if( ( u16Node < gu16Nodes ) && ( TRUE == AddLEDs( psLoad, gasNodes[ u16Node ].u16Net ) ) )
+        {
+          psLoad->u8Kind = LOAD_INDUCTOR;
+          u16Node = FindOnNet( gasNodes[ u16Node ].u16Net, 'L', 0, 0u );
+          if( ( u16Node >= gu16Nodes ) || ( FALSE == ParseValue( FindValue( gasNodes[ u16Node ].acRef ), &psLoad->dValue ) ) )
+          {
+            psLoad->dValue = gdInductance;
+          }
+          for( u8Pulse = 0u; u8Pulse < NUM_RGBLED_COLORS; u8Pulse++ )
+          {
+            if( ( gcasPulsePins[ u8Pulse ].u8Address == psLoad->u8Address ) && ( gcasPulsePins[ u8Pulse ].u8Mask == psLoad->u8Mask ) )
+            {
+              psLoad->u8Loops = gcasPulsePins[ u8Pulse ].u8Loops;
+            }
+          }
+          dSeconds = (double)ISR_CYCLES_PULSE( psLoad->u8Loops ) / (double)SYSTEM_CLOCK_HZ;
+          psLoad->dCurrentMa = 1000.0 * gdVbat * dSeconds / psLoad->dValue;
+          psLoad->dChargeUc = 1e6 * gdVbat * dSeconds * dSeconds / ( 2.0 * psLoad->dValue );
+          gu8Loads++;
+        }
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Called after every SFR write: catches the falling edges of the inductor loads
+//! \param  u8Address: address of the register
+//! \param  u8Value: value written
+//! \return -
+//! \global gau8PortShadow[], gu8TickPulses
+//-----------------------------------------------------------------------------
+static void SfrHook( U8 u8Address, U8 u8Value )
+{
+  U8 u8Load;
+
+  for( u8Load = 0u; u8Load < gu8Loads; u8Load++ )
+  {
+    if( ( LOAD_INDUCTOR == gasLoads[ u8Load ].u8Kind ) && ( gasLoads[ u8Load ].u8Address == u8Address )
+     && ( 0u != ( gau8PortShadow[ u8Address ] & gasLoads[ u8Load ].u8Mask ) )
+     && ( 0u == ( u8Value & gasLoads[ u8Load ].u8Mask ) ) )
+    {
+      gu8TickPulses |= (U8)( 1u << u8Load );
+    }
+  }
+  gau8PortShadow[ u8Address ] = u8Value;
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Plays an animation and calculates its currents
+//! \param  u8Animation: index in gasAnimations
+//! \param  u32TimeS: simulated time
+//! \param  psResult: the result is written here
+//! \return -
+//-----------------------------------------------------------------------------
+static void Run( U8 u8Animation, U32 u32TimeS, S_RESULT* psResult )
+{
+  double   dLEDCharge = 0.0;   // mA * ticks
+  double   dRGBCharge = 0.0;   // uC
+  double   dTickMa;
+  double   dPulseMa;
+  uint64_t u64IsrCycles = 0u;
+  U32      u32Ticks = u32TimeS * 1000u * TICKS_PER_MS;
+  U32      u32Tick;
+  U8       u8Load;
+
+  Host_Reset();
+  memcpy( gau8PortShadow, gau8HostSfr, sizeof( gau8PortShadow ) );
+  gpfHostSfrHook = SfrHook;
+  Util_Init();
+  LED_Init();
+  RGBLED_Init();
+  Animation_Init();
+  Animation_Set( u8Animation, TRUE );
+  psResult->u8Animation = u8Animation;
+  psResult->dPeakMa = 0.0;
+
+  for( u32Tick = 0u; u32Tick < u32Ticks; u32Tick++ )
+  {
+    // Main loop, once in a millisecond
+    if( 0u == ( u32Tick % TICKS_PER_MS ) )
+    {
+      Util_TakeTimeSnapshot();
+      Animation_Cycle();
+    }
+
+    // Timer 0 interrupt, as in the flattened timer0_isr() of main.c
+    gu8TickPulses = 0u;
+    UTIL_INTERRUPT_BODY();
+    LED_INTERRUPT_BODY();
+    RGBLED_INTERRUPT_BODY();
+    u64IsrCycles += ISR_CYCLES_FIXED + ( NUM_RGBLED_COLORS * ISR_CYCLES_RGB_TEST )
+                  + ( ( 0u == gu8LEDDriveCounter ) ? ISR_CYCLES_LED_DRIVE : ISR_CYCLES_LED_OFF );
+
+    // Currents of the tick
+    dTickMa = MCU_ACTIVE_MA;
+    dPulseMa = 0.0;
+    for( u8Load = 0u; u8Load < gu8Loads; u8Load++ )
+    {
+      if( LOAD_RESISTOR == gasLoads[ u8Load ].u8Kind )
+      {
+        if( 0u == ( gau8HostSfr[ gasLoads[ u8Load ].u8Address ] & gasLoads[ u8Load ].u8Mask ) )
+        {
+          dLEDCharge += gasLoads[ u8Load ].dCurrentMa;
+          dTickMa += gasLoads[ u8Load ].dCurrentMa;
+        }
+      }
+      else if( 0u != ( gu8TickPulses & ( 1u << u8Load ) ) )
+      {
+        dRGBCharge += gasLoads[ u8Load ].dChargeUc;
+        u64IsrCycles += ISR_CYCLES_PULSE( gasLoads[ u8Load ].u8Loops );
+        if( gasLoads[ u8Load ].dCurrentMa > dPulseMa )  // The pulses follow each other
+        {
+          dPulseMa = gasLoads[ u8Load ].dCurrentMa;
+        }
+      }
+    }
+    if( ( dTickMa + dPulseMa ) > psResult->dPeakMa )
+    {
+      psResult->dPeakMa = dTickMa + dPulseMa;
+    }
+  }
+  gpfHostSfrHook = 0;
+
+  psResult->dLEDMa = dLEDCharge / (double)u32Ticks;
+  psResult->dRGBMa = 1e-3 * dRGBCharge / (double)u32TimeS;
+  psResult->dMCUMa = MCU_IDLE_MA + ( ( MCU_ACTIVE_MA - MCU_IDLE_MA ) * (double)u64IsrCycles / ( (double)u32Ticks * ISR_CYCLES_PER_TICK ) );
+  psResult->dMeanMa = psResult->dLEDMa + psResult->dRGBMa + psResult->dMCUMa;
+}
+
+//----------------------------------------------------------------------------
+//! \brief  qsort() comparator: by mean current
+//! \param  pvA, pvB: results
+//! \return Order
+//-----------------------------------------------------------------------------
+static int CompareMean( const void* pvA, const void* pvB )
+{
+  const S_RESULT* psA = (const S_RESULT*)pvA;
+  const S_RESULT* psB = (const S_RESULT*)pvB;
+
+  return ( psA->dMeanMa > psB->dMeanMa ) - ( psA->dMeanMa < psB->dMeanMa );
+}
+
+
+/***************************************< Public functions >**************************************/
+//----------------------------------------------------------------------------
+//! \brief  Entry point
+//! \param  argc, argv: options, see the header
+//! \return EXIT_SUCCESS if the netlist could be read
+//-----------------------------------------------------------------------------
+int main( int argc, char* argv[] )
+{
+  const char* pcNetlist = DEFAULT_NETLIST;
+  U32         u32TimeS = DEFAULT_TIME_S;
+  double      dCapacity = DEFAULT_CAPACITY_MAH;
+  double      dRint = DEFAULT_RINT_OHMS;
+  S_RESULT    asResults[ NUM_ANIMATIONS ];
+  BOOL        bValid = TRUE;
+  char*       pcEqual;
+  double      dHours;
+  int         iArg;
+  U8          u8Index;
+
+  // Options
+  for( iArg = 1; ( TRUE == bValid ) && ( ( iArg + 1 ) < argc ); iArg += 2 )
+  {
+    if( 0 == strcmp( argv[ iArg ], "--netlist" ) )
+    {
+      pcNetlist = argv[ iArg + 1 ];
+    }
+    else if( 0 == strcmp( argv[ iArg ], "--time" ) )
+    {
+      u32TimeS = (U32)strtoul( argv[ iArg + 1 ], 0, 0 );
+      bValid = ( 0u != u32TimeS );
+    }
+    else if( 0 == strcmp( argv[ iArg ], "--vbat" ) )
+    {
+      gdVbat = atof( argv[ iArg + 1 ] );
+    }
+    else if( 0 == strcmp( argv[ iArg ], "--capacity" ) )
+    {
+      dCapacity = atof( argv[ iArg + 1 ] );
+    }
+    else if( 0 == strcmp( argv[ iArg ], "--rint" ) )
+    {
+      dRint = atof( argv[ iArg + 1 ] );
+    }
+    else if( 0 == strcmp( argv[ iArg ], "--inductance" ) )
+    {
+      gdInductance = atof( argv[ iArg + 1 ] ) * 1e-3;
+      bValid = ( gdInductance > 0.0 );
+    }
+    else if( ( 0 == strcmp( argv[ iArg ], "--vf" ) ) && ( 0 != ( pcEqual = strchr( argv[ iArg + 1 ], '=' ) ) )
+          && ( ( pcEqual - argv[ iArg + 1 ] ) < (int)NAME_LENGTH ) )
+    {
+      // Overrides an LED type, or adds a new one
+      for( u8Index = 0u; ( u8Index < gu8LEDTypes )
+           && ( 0 != strncmp( gasLEDTypes[ u8Index ].acValue, argv[ iArg + 1 ], (size_t)( pcEqual - argv[ iArg + 1 ] ) ) ); u8Index++ )
+      {
+      }
+      if( u8Index < ( sizeof( gasLEDTypes ) / sizeof( gasLEDTypes[ 0u ] ) ) )
+      {
+        if( u8Index == gu8LEDTypes )
+        {
+          memcpy( gasLEDTypes[ u8Index ].acValue, argv[ iArg + 1 ], (size_t)( pcEqual - argv[ iArg + 1 ] ) );
+          gasLEDTypes[ u8Index ].acValue[ pcEqual - argv[ iArg + 1 ] ] = '\0';
+          strcpy( gasLEDTypes[ u8Index ].acColour, gasLEDTypes[ u8Index ].acValue );
+          gu8LEDTypes++;
+        }
+        gasLEDTypes[ u8Index ].dVf = atof( pcEqual + 1 );
+      }
+    }
+    else
+    {
+      bValid = FALSE;
+    }
+  }
+  if( ( FALSE == bValid ) || ( iArg < argc ) )
+  {
+    fprintf( stderr, "Usage: %s [--netlist file] [--time seconds] [--vbat volts] [--capacity mAh] [--rint ohms]\n"
+                     "       [--inductance mH] [--vf value=volts]...\n", argv[ 0 ] );
+    return EXIT_FAILURE;
+  }
+  if( FALSE == ReadNetlist( pcNetlist ) )
+  {
+    fprintf( stderr, "Can't read the netlist %s\n", pcNetlist );
+    return EXIT_FAILURE;
+  }
+  BuildLoads();
+
+  // What the pins drive
+  printf( "Pin   Drives                        Current (mA)  Pulse charge (uC)\n" );
+  for( u8Index = 0u; u8Index < gu8Loads; u8Index++ )
+  {
+    if( LOAD_RESISTOR == gasLoads[ u8Index ].u8Kind )
+    {
+      printf( "%-5s %u %-5s LED, %5.0f ohm          %6.2f\n", gasLoads[ u8Index ].acPin, gasLoads[ u8Index ].u8LEDs,
+              gasLoads[ u8Index ].acColour, gasLoads[ u8Index ].dValue, gasLoads[ u8Index ].dCurrentMa );
+    }
+    else
+    {
+      printf( "%-5s %u %-5s LED, %4.2f mH, %3u loops %6.2f peak    %6.3f\n", gasLoads[ u8Index ].acPin, gasLoads[ u8Index ].u8LEDs,
+              gasLoads[ u8Index ].acColour, gasLoads[ u8Index ].dValue * 1e3, gasLoads[ u8Index ].u8Loops,
+              gasLoads[ u8Index ].dCurrentMa, gasLoads[ u8Index ].dChargeUc );
+    }
+  }
+
+  // Currents of the animations, the most economic first
+  for( u8Index = 0u; u8Index < NUM_ANIMATIONS; u8Index++ )
+  {
+    Run( u8Index, u32TimeS, &asResults[ u8Index ] );
+  }
+  qsort( asResults, NUM_ANIMATIONS, sizeof( S_RESULT ), CompareMean );
+  printf( "\nVbat %.2f V, CR2032 %.0f mAh, %.0f ohm; %u s per animation\n", gdVbat, dCapacity, dRint, u32TimeS );
+  printf( "Animation  Mean mA  LEDs mA  RGB mA  MCU mA  Peak mA  Sag V  Runtime h  5 h sessions\n" );
+  for( u8Index = 0u; u8Index < NUM_ANIMATIONS; u8Index++ )
+  {
+    dHours = dCapacity / asResults[ u8Index ].dMeanMa;
+    printf( "%9u  %7.2f  %7.2f  %6.2f  %6.2f  %7.2f  %5.2f  %9.1f  %12.1f\n", asResults[ u8Index ].u8Animation,
+            asResults[ u8Index ].dMeanMa, asResults[ u8Index ].dLEDMa, asResults[ u8Index ].dRGBMa, asResults[ u8Index ].dMCUMa,
+            asResults[ u8Index ].dPeakMa, asResults[ u8Index ].dPeakMa * dRint * 1e-3, dHours, dHours / SESSION_HOURS );
+  }
+  return EXIT_SUCCESS;
+}
+
+/***************************************< End of file >**************************************/
@@ -0,0 +1,640 @@
+/*! *******************************************************************************************************
+* Copyright (c) 2022 Hekk_Elek
+*
+* \file anim_uploader.cpp
+*
+* \brief Assembles an animation and uploads it into an EEPROM slot on the UART (see upload.c)
+*
+* \author Hekk_Elek
+*
+**********************************************************************************************************/
+
+/*----------------------------------------------------------------------------------------
+How it works
+============
+The animation is written as a text file, one instruction per line, like the tables of
+animation.c:
+  N <ms> <LED0> .. <LED6> <opcodes> <operand>      normal LED instruction
+  R <ms> <color0> .. <color3> <opcodes> <operand>  RGB LED instruction
+where <opcodes> is LOAD, or opcode names joined by '|' (e.g. ADD|REPEAT). Everything after
+a '#' is a comment. See example.anim.
+
+The instructions are assembled into the layout the firmware plays in place (animation.h),
+then sent with the upload protocol (upload.h): BEGIN, DATA blocks, COMMIT. Every packet is
+sent again until its response arrives, so the first packet may wake up the device.
+
+With --loopback, no device is needed: a pseudo-terminal pair is opened, and upload.c of the
+firmware, compiled for the host on top of the simulated IAP registers (tools/host), runs on
+its other end in a thread. After the upload the simulated EEPROM is checked against the
+image. --error-rate N corrupts one of every N bytes in both directions, to exercise the
+retries.
+
+Build (from this directory):
+  g++ -O2 -DHOST_BUILD -DTELEMETRY_ENABLED=1 -DANIMATION_UPLOAD_ENABLED=1 -I../../src -I../host \
+      -x c++ ../../src/upload.c ../../src/iap.c ../../src/util.c \
+      -x none ../host/host_stc8g.cpp anim_uploader.cpp -o anim_uploader -lutil -pthread
+Run:
+  ./anim_uploader /dev/ttyUSB0 <slot> example.anim
+  ./anim_uploader --loopback [--error-rate N] <slot> example.anim
+----------------------------------------------------------------------------------------*/
+
+/***************************************< Includes >**************************************/
+// Standard C libraries
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include <termios.h>
+#include <time.h>
+#include <pty.h>
+
+// Own includes
+#include "types.h"
+#include "util.h"
+#include "led.h"
+#include "rgbled.h"
+#include "animation.h"
+#include "telemetry.h"
+#include "upload.h"
+#include "host_stc8g.h"
+
+
+/***************************************< Definitions >**************************************/
+#define RESPONSE_TIMEOUT_MS   (300)  //!< Time to wait for a response before sending the packet again
+#define RETRIES_NUM            (20)  //!< Number of attempts of a packet
+#define LINE_LENGTH           (256)  //!< Longest line of the source file
+#define TOKEN_DELIMITERS  " \t\r\n,{}"  //!< The tables of animation.c can be pasted, braces and commas are ignored
+
+
+/***************************************< Types >**************************************/
+//! \brief Assembled animation
+typedef struct
+{
+  U8  au8Image[ ANIMATION_SLOT_IMAGE_MAX ];  //!< Normal LED instructions, then RGB LED instructions
+  U16 u16Length;                             //!< Bytes of the image
+  U8  u8LengthNormal;                        //!< Number of normal LED instructions
+  U8  u8LengthRGB;                           //!< Number of RGB LED instructions
+} S_IMAGE;
+
+//! \brief Opcode name
+typedef struct
+{
+  const char* pcName;
+  U8          u8Opcode;
+} S_OPCODE_NAME;
+
+
+/***************************************< Constants >**************************************/
+static const S_OPCODE_NAME gcasOpcodes[] =
+{
+  { "LOAD", LOAD }, { "ADD", ADD }, { "RSHIFT", RSHIFT }, { "LSHIFT", LSHIFT },
+  { "DIV", DIV }, { "USOURCE", USOURCE }, { "DSOURCE", DSOURCE }, { "REPEAT", REPEAT },
+};
+
+
+/***************************************< Global variables >**************************************/
+static U32  gu32Retries;                 //!< Packets sent again
+// Simulated device of --loopback
+static int  giDeviceFd = -1;             //!< Device end of the pseudo-terminal
+static U32  gu32ErrorRate;               //!< One of this many bytes is corrupted; 0: none
+static volatile BOOL gbDeviceRunning;    //!< Cleared to stop the device thread
+static U8   gu8PlayedAnimation = 0xFFu;  //!< Last animation set by upload.c
+
+
+/***************************************< Static functions >**************************************/
+//----------------------------------------------------------------------------
+//! \brief  Milliseconds of a monotonic clock
+//! \param  -
+//! \return Time in ms
+//-----------------------------------------------------------------------------
+static U32 NowMs( void )
+{
+  struct timespec sTime;
+
+  clock_gettime( CLOCK_MONOTONIC, &sTime );
+  return (U32)( sTime.tv_sec * 1000u + sTime.tv_nsec / 1000000 );
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Corrupts a byte now and then, if --error-rate is given
+//! \param  u8Byte: byte on the line
+//! \return The byte, maybe with a flipped bit
+//-----------------------------------------------------------------------------
+static U8 Line( U8 u8Byte )
+{
+  if( ( 0u != gu32ErrorRate ) && ( 0u == ( (U32)rand() % gu32ErrorRate ) ) )
+  {
+    u8Byte ^= (U8)( 1u << ( rand() & 7 ) );
+  }
+  return u8Byte;
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Parses an opcode expression, e.g. ADD|REPEAT
+//! \param  pcText: the expression
+//! \param  pu8Opcode: the opcode is written here
+//! \return TRUE if every name is known
+//-----------------------------------------------------------------------------
+static BOOL ParseOpcode( char* pcText, U8* pu8Opcode )
+{
+  BOOL  bValid = TRUE;
+  char* pcName;
+  char* pcSave = NULL;
+  U32   u32Index;
+  BOOL  bFound;
+
+  *pu8Opcode = 0u;
+  for( pcName = strtok_r( pcText, "|", &pcSave ); NULL != pcName; pcName = strtok_r( NULL, "|", &pcSave ) )
+  {
+    bFound = FALSE;
+    for( u32Index = 0u; u32Index < sizeof( gcasOpcodes ) / sizeof( gcasOpcodes[ 0 ] ); u32Index++ )
+    {
+      if( 0 == strcmp( pcName, gcasOpcodes[ u32Index ].pcName ) )
+      {
+        *pu8Opcode |= gcasOpcodes[ u32Index ].u8Opcode;
+        bFound = TRUE;
+      }
+    }
+    bValid = bValid && bFound;
+  }
+  return bValid;
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Assembles a source file
+//! \param  pcPath: path of the source file
+//! \param  psImage: the image is built here
+//! \return TRUE on success; errors are printed
+//! \note   Normal LED instructions must come before the RGB LED ones in the image, but they can be
+//!         mixed in the source: they are collected separately.
+//-----------------------------------------------------------------------------
+static BOOL Assemble( const char* pcPath, S_IMAGE* psImage )
+{
+  BOOL  bValid = TRUE;
+  FILE* psFile = fopen( pcPath, "r" );
+  char  acLine[ LINE_LENGTH ];
+  char* apcToken[ 4u + LEDS_NUM ];
+  char* pcToken;
+  char* pcSave;
+  char* pcComment;
+  U8    au8Normal[ ANIMATION_SLOT_IMAGE_MAX ];
+  U8    au8RGB[ ANIMATION_SLOT_IMAGE_MAX ];
+  U16   u16NormalLength = 0u;
+  U16   u16RGBLength = 0u;
+  U8*   pu8Instruction;
+  U32   u32Line = 0u;
+  U32   u32Tokens;
+  U32   u32Values;
+  U32   u32Index;
+  long  lValue;
+  U8    u8Opcode;
+
+  memset( psImage, 0, sizeof( S_IMAGE ) );
+  if( NULL == psFile )
+  {
+    perror( pcPath );
+    bValid = FALSE;
+  }
+  while( ( TRUE == bValid ) && ( NULL != fgets( acLine, sizeof( acLine ), psFile ) ) )
+  {
+    u32Line++;
+    pcComment = strchr( acLine, '#' );
+    if( NULL != pcComment )
+    {
+      *pcComment = '\0';
+    }
+    u32Tokens = 0u;
+    for( pcToken = strtok_r( acLine, TOKEN_DELIMITERS, &pcSave ); NULL != pcToken; pcToken = strtok_r( NULL, TOKEN_DELIMITERS, &pcSave ) )
+    {
+      if( u32Tokens < ( 4u + LEDS_NUM ) )
+      {
+        apcToken[ u32Tokens ] = pcToken;
+      }
+      u32Tokens++;
+    }
+    if( 0u == u32Tokens )
+    {
+      continue;  // Empty line
+    }
+
+    // Line: type, timing, brightness values, opcodes, operand
+    if( ( 0 == strcmp( apcToken[ 0 ], "N" ) ) && ( ( 4u + LEDS_NUM ) == u32Tokens ) )
+    {
+      u32Values = LEDS_NUM;
+      pu8Instruction = &au8Normal[ u16NormalLength ];
+      u16NormalLength += ANIMATION_INSTRUCTION_NORMAL_LENGTH;
+      psImage->u8LengthNormal++;
+    }
+    else if( ( 0 == strcmp( apcToken[ 0 ], "R" ) ) && ( ( 4u + NUM_RGBLED_COLORS ) == u32Tokens ) )
+    {
+      u32Values = NUM_RGBLED_COLORS;
+      pu8Instruction = &au8RGB[ u16RGBLength ];
+      u16RGBLength += ANIMATION_INSTRUCTION_RGB_LENGTH;
+      psImage->u8LengthRGB++;
+    }
+    else
+    {
+      fprintf( stderr, "%s:%u: expected 'N' with %u or 'R' with %u brightness values\n", pcPath, u32Line, LEDS_NUM, NUM_RGBLED_COLORS );
+      bValid = FALSE;
+      break;
+    }
+    if( ( u16NormalLength + u16RGBLength ) > ANIMATION_SLOT_IMAGE_MAX )
+    {
+      fprintf( stderr, "%s:%u: the animation doesn't fit the %u bytes of a slot\n", pcPath, u32Line, ANIMATION_SLOT_IMAGE_MAX );
+      bValid = FALSE;
+      break;
+    }
+
+    // Timing, big-endian like Keil C51 stores it
+    lValue = strtol( apcToken[ 1 ], NULL, 0 );
+    if( ( lValue < 0 ) || ( lValue > 0xFFFF ) )
+    {
+      fprintf( stderr, "%s:%u: timing out of range\n", pcPath, u32Line );
+      bValid = FALSE;
+    }
+    pu8Instruction[ 0 ] = (U8)( lValue >> 8 );
+    pu8Instruction[ 1 ] = (U8)lValue;
+    for( u32Index = 0u; u32Index < u32Values; u32Index++ )
+    {
+      lValue = strtol( apcToken[ 2u + u32Index ], NULL, 0 );
+      if( ( lValue < -128 ) || ( lValue > 255 ) )
+      {
+        fprintf( stderr, "%s:%u: brightness out of range\n", pcPath, u32Line );
+        bValid = FALSE;
+      }
+      pu8Instruction[ 2u + u32Index ] = (U8)lValue;
+    }
+    if( FALSE == ParseOpcode( apcToken[ 2u + u32Values ], &u8Opcode ) )
+    {
+      fprintf( stderr, "%s:%u: unknown opcode\n", pcPath, u32Line );
+      bValid = FALSE;
+    }
+    pu8Instruction[ 2u + u32Values ] = u8Opcode;
+    lValue = strtol( apcToken[ 3u + u32Values ], NULL, 0 );
+    if( ( lValue < 0 ) || ( lValue > 255 ) )
+    {
+      fprintf( stderr, "%s:%u: operand out of range\n", pcPath, u32Line );
+      bValid = FALSE;
+    }
+    pu8Instruction[ 3u + u32Values ] = (U8)lValue;
+  }
+  if( NULL != psFile )
+  {
+    fclose( psFile );
+  }
+  if( ( TRUE == bValid ) && ( ( 0u == psImage->u8LengthNormal ) || ( 0u == psImage->u8LengthRGB ) ) )
+  {
+    fprintf( stderr, "%s: at least one 'N' and one 'R' instruction is needed\n", pcPath );
+    bValid = FALSE;
+  }
+  if( TRUE == bValid )
+  {
+    memcpy( psImage->au8Image, au8Normal, u16NormalLength );
+    memcpy( &psImage->au8Image[ u16NormalLength ], au8RGB, u16RGBLength );
+    psImage->u16Length = u16NormalLength + u16RGBLength;
+  }
+  return bValid;
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Sets up a serial port for the upload
+//! \param  iFd: file descriptor of the port
+//! \return -
+//-----------------------------------------------------------------------------
+static void SetupSerialPort( int iFd )
+{
+  struct termios sTermios;
+
+  if( 0 == tcgetattr( iFd, &sTermios ) )
+  {
+    cfmakeraw( &sTermios );
+    cfsetispeed( &sTermios, B57600 );
+    cfsetospeed( &sTermios, B57600 );
+    sTermios.c_cflag |= CLOCAL | CREAD;
+    sTermios.c_cc[ VMIN ] = 0;
+    sTermios.c_cc[ VTIME ] = 0;
+    tcsetattr( iFd, TCSANOW, &sTermios );
+  }
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Sends a packet and waits for its response, sending it again if needed
+//! \param  iFd: file descriptor of the port
+//! \param  u8Command: UPLOAD_CMD_*
+//! \param  u8Argument: argument of the command
+//! \param  pu8Data: data of the packet
+//! \param  u8Length: length of the data
+//! \return UPLOAD_STATUS_* of the response; -1 if no response came
+//-----------------------------------------------------------------------------
+static int Exchange( int iFd, U8 u8Command, U8 u8Argument, const U8* pu8Data, U8 u8Length )
+{
+  int   iStatus = -1;
+  U8    au8Packet[ UPLOAD_PACKET_MAX ];
+  U8    au8Response[ UPLOAD_RESPONSE_LENGTH ];
+  U32   u32Received;
+  U32   u32Attempt;
+  U32   u32Start;
+  U16   u16CRC;
+  U8    u8Byte;
+  struct pollfd sPoll;
+
+  au8Packet[ 0 ] = UPLOAD_SYNC;
+  au8Packet[ UPLOAD_OFS_COMMAND ] = u8Command;
+  au8Packet[ UPLOAD_OFS_ARGUMENT ] = u8Argument;
+  au8Packet[ UPLOAD_OFS_LENGTH ] = u8Length;
+  memcpy( &au8Packet[ UPLOAD_HEADER_LENGTH ], pu8Data, u8Length );
+  u16CRC = Util_CRC16( &au8Packet[ UPLOAD_OFS_COMMAND ], ( UPLOAD_HEADER_LENGTH - 1u ) + u8Length );
+  au8Packet[ UPLOAD_HEADER_LENGTH + u8Length ] = (U8)( u16CRC >> 8u );
+  au8Packet[ UPLOAD_HEADER_LENGTH + u8Length + 1u ] = (U8)u16CRC;
+
+  for( u32Attempt = 0u; ( u32Attempt < RETRIES_NUM ) && ( iStatus < 0 ); u32Attempt++ )
+  {
+    if( 0u != u32Attempt )
+    {
+      gu32Retries++;
+    }
+    tcflush( iFd, TCIFLUSH );  // Drop the answers of earlier attempts and the telemetry
+    if( write( iFd, au8Packet, UPLOAD_HEADER_LENGTH + u8Length + 2u ) < 0 )
+    {
+      perror( "write" );
+      break;
+    }
+    // Wait for a response with a valid CRC; other bytes (e.g. a telemetry frame) are skipped
+    u32Received = 0u;
+    u32Start = NowMs();
+    sPoll.fd = iFd;
+    sPoll.events = POLLIN;
+    while( ( iStatus < 0 ) && ( ( NowMs() - u32Start ) < RESPONSE_TIMEOUT_MS ) )
+    {
+      if( ( poll( &sPoll, 1, 10 ) > 0 ) && ( 1 == read( iFd, &u8Byte, 1 ) ) )
+      {
+        if( ( 0u != u32Received ) || ( UPLOAD_SYNC == u8Byte ) )
+        {
+          au8Response[ u32Received ] = u8Byte;
+          u32Received++;
+        }
+        if( UPLOAD_RESPONSE_LENGTH == u32Received )
+        {
+          u16CRC = Util_CRC16( &au8Response[ UPLOAD_OFS_COMMAND ], UPLOAD_RESPONSE_LENGTH - 3u );
+          if( ( au8Response[ UPLOAD_RESPONSE_LENGTH - 2u ] == (U8)( u16CRC >> 8u ) )
+           && ( au8Response[ UPLOAD_RESPONSE_LENGTH - 1u ] == (U8)u16CRC )
+           && ( au8Response[ UPLOAD_OFS_COMMAND ] == ( u8Command | UPLOAD_RESPONSE_FLAG ) )
+           && ( au8Response[ UPLOAD_OFS_ARGUMENT ] == u8Argument ) )
+          {
+            iStatus = au8Response[ UPLOAD_OFS_STATUS ];
+          }
+          else
+          {
+            // Not a response: look for the next sync byte in what was received
+            memmove( au8Response, &au8Response[ 1 ], UPLOAD_RESPONSE_LENGTH - 1u );
+            u32Received = UPLOAD_RESPONSE_LENGTH - 1u;
+            while( ( 0u != u32Received ) && ( UPLOAD_SYNC != au8Response[ 0 ] ) )
+            {
+              memmove( au8Response, &au8Response[ 1 ], u32Received - 1u );
+              u32Received--;
+            }
+          }
+        }
+      }
+    }
+  }
+  return iStatus;
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Uploads an image into a slot
+//! \param  iFd: file descriptor of the port
+//! \param  u8Slot: index of the slot
+//! \param  psImage: the assembled animation
+//! \return TRUE on success; errors are printed
+//-----------------------------------------------------------------------------
+static BOOL Upload( int iFd, U8 u8Slot, const S_IMAGE* psImage )
+{
+  int iStatus;
+  U8  u8Block;
+  U16 u16Offset;
+  U8  u8Length;
+  U8  au8Lengths[ 2 ];
+
+  iStatus = Exchange( iFd, UPLOAD_CMD_BEGIN, u8Slot, NULL, 0u );
+  for( u8Block = 0u, u16Offset = 0u; ( UPLOAD_STATUS_OK == iStatus ) && ( u16Offset < psImage->u16Length ); u8Block++ )
+  {
+    u8Length = ( (U16)( psImage->u16Length - u16Offset ) > UPLOAD_BLOCK_SIZE ) ? UPLOAD_BLOCK_SIZE : (U8)( psImage->u16Length - u16Offset );
+    iStatus = Exchange( iFd, UPLOAD_CMD_DATA, u8Block, &psImage->au8Image[ u16Offset ], u8Length );
+    u16Offset += u8Length;
+    fprintf( stderr, "\r%u / %u bytes", u16Offset, psImage->u16Length );
+  }
+  if( UPLOAD_STATUS_OK == iStatus )
+  {
+    au8Lengths[ 0 ] = psImage->u8LengthNormal;
+    au8Lengths[ 1 ] = psImage->u8LengthRGB;
+    iStatus = Exchange( iFd, UPLOAD_CMD_COMMIT, u8Slot, au8Lengths, sizeof( au8Lengths ) );
+  }
+  fprintf( stderr, "\n" );
+  if( iStatus < 0 )
+  {
+    fprintf( stderr, "No response from the device\n" );
+  }
+  else if( UPLOAD_STATUS_OK != iStatus )
+  {
+    fprintf( stderr, "The device refused the upload, status %d\n", iStatus );
+  }
+  return ( UPLOAD_STATUS_OK == iStatus );
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Simulated device of --loopback: runs upload.c on the other end of the pseudo-terminal
+//! \param  pvArgument: -
+//! \return -
+//-----------------------------------------------------------------------------
+static void* DeviceThread( void* pvArgument )
+{
+  U8  au8Buffer[ 64 ];
+  ssize_t iLength;
+  ssize_t iIndex;
+  U32 u32LastMs = NowMs();
+  U32 u32Now;
+  struct pollfd sPoll;
+
+  (void)pvArgument;
+  sPoll.fd = giDeviceFd;
+  sPoll.events = POLLIN;
+  while( TRUE == gbDeviceRunning )
+  {
+    if( poll( &sPoll, 1, 1 ) > 0 )
+    {
+      iLength = read( giDeviceFd, au8Buffer, sizeof( au8Buffer ) );
+      for( iIndex = 0; iIndex < iLength; iIndex++ )
+      {
+        Upload_ReceiveByte( Line( au8Buffer[ iIndex ] ) );  // As the UART interrupt does
+      }
+    }
+    u32Now = NowMs();
+    Util_AdvanceTimerMs( (U16)( u32Now - u32LastMs ) );
+    u32LastMs = u32Now;
+    Util_TakeTimeSnapshot();
+    Upload_Task();
+  }
+  return NULL;
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Checks the simulated EEPROM after a --loopback upload
+//! \param  u8Slot: index of the slot
+//! \param  psImage: the uploaded animation
+//! \return TRUE if the slot holds the image and a valid header
+//-----------------------------------------------------------------------------
+static BOOL CheckSlot( U8 u8Slot, const S_IMAGE* psImage )
+{
+  const U8* pu8Slot = &gau8HostEeprom[ ( ANIMATION_SLOT_ADDRESS( u8Slot ) - EEPROM_BASEADDRESS ) % HOST_EEPROM_SIZE ];
+  U16 u16CRC = Util_CRC16( (U8*)pu8Slot, ANIMATION_SLOT_OFS_CRC );
+
+  return ( ANIMATION_SLOT_MAGIC == pu8Slot[ ANIMATION_SLOT_OFS_MAGIC ] )
+      && ( ANIMATION_SLOT_FORMAT == pu8Slot[ ANIMATION_SLOT_OFS_FORMAT ] )
+      && ( psImage->u8LengthNormal == pu8Slot[ ANIMATION_SLOT_OFS_LENGTH_NORMAL ] )
+      && ( psImage->u8LengthRGB == pu8Slot[ ANIMATION_SLOT_OFS_LENGTH_RGB ] )
+      && ( (U8)( u16CRC >> 8u ) == pu8Slot[ ANIMATION_SLOT_OFS_CRC ] )
+      && ( (U8)u16CRC == pu8Slot[ ANIMATION_SLOT_OFS_CRC + 1u ] )
+      && ( 0 == memcmp( &pu8Slot[ ANIMATION_SLOT_HEADER_LENGTH ], psImage->au8Image, psImage->u16Length ) )
+      && ( ( ANIMATION_FIRST_SLOT + u8Slot ) == gu8PlayedAnimation );
+}
+
+
+/***************************************< Firmware stubs for --loopback >**************************************/
+//! \brief Responses of upload.c go back on the pseudo-terminal
+BOOL Telemetry_Send( U8* pu8Data, U8 u8Length )
+{
+  U8 u8Index;
+  U8 u8Byte;
+
+  for( u8Index = 0u; u8Index < u8Length; u8Index++ )
+  {
+    u8Byte = Line( pu8Data[ u8Index ] );
+    if( write( giDeviceFd, &u8Byte, 1 ) < 0 )
+    {
+      perror( "write" );
+    }
+  }
+  return TRUE;
+}
+
+//! \brief Records the animation selected by upload.c
+void Animation_Set( U8 u8AnimationIndex, BOOL bPersist )
+{
+  (void)bPersist;
+  gu8PlayedAnimation = u8AnimationIndex;
+}
+
+//! \brief The persistent data is not simulated
+void Persist_Save( void )
+{
+}
+
+
+/***************************************< Public functions >**************************************/
+int main( int argc, char** argv )
+{
+  BOOL bLoopback = FALSE;
+  BOOL bSuccess;
+  const char* apcArgs[ 3 ];
+  int  iArgs = 0;
+  int  iArg;
+  int  iFd;
+  U8   u8Slot;
+  S_IMAGE sImage;
+  pthread_t sDevice;
+  struct termios sTermios;
+
+  for( iArg = 1; iArg < argc; iArg++ )
+  {
+    if( 0 == strcmp( argv[ iArg ], "--loopback" ) )
+    {
+      bLoopback = TRUE;
+    }
+    else if( ( 0 == strcmp( argv[ iArg ], "--error-rate" ) ) && ( ( iArg + 1 ) < argc ) )
+    {
+      iArg++;
+      gu32ErrorRate = (U32)strtoul( argv[ iArg ], NULL, 0 );
+    }
+    else if( iArgs < 3 )
+    {
+      apcArgs[ iArgs ] = argv[ iArg ];
+      iArgs++;
+    }
+  }
+  if( iArgs != ( ( TRUE == bLoopback ) ? 2 : 3 ) )
+  {
+    fprintf( stderr, "Usage: %s <serial port> <slot> <animation file>\n"
+                     "       %s --loopback [--error-rate N] <slot> <animation file>\n", argv[ 0 ], argv[ 0 ] );
+    return 2;
+  }
+  if( TRUE == bLoopback )
+  {
+    apcArgs[ 2 ] = apcArgs[ 1 ];
+    apcArgs[ 1 ] = apcArgs[ 0 ];
+  }
+  u8Slot = (U8)strtoul( apcArgs[ 1 ], NULL, 0 );
+  if( u8Slot >= ANIMATION_SLOTS_NUM )
+  {
+    fprintf( stderr, "Slot must be 0..%u\n", ANIMATION_SLOTS_NUM - 1u );
+    return 2;
+  }
+  if( FALSE == Assemble( apcArgs[ 2 ], &sImage ) )
+  {
+    return 1;
+  }
+  fprintf( stderr, "%u normal LED and %u RGB LED instructions, %u bytes\n", sImage.u8LengthNormal, sImage.u8LengthRGB, sImage.u16Length );
+
+  if( TRUE == bLoopback )
+  {
+    if( 0 != openpty( &iFd, &giDeviceFd, NULL, NULL, NULL ) )
+    {
+      perror( "openpty" );
+      return 1;
+    }
+    tcgetattr( giDeviceFd, &sTermios );
+    cfmakeraw( &sTermios );
+    tcsetattr( giDeviceFd, TCSANOW, &sTermios );
+    // Power-up state of the simulated device: EEPROM with garbage, firmware initialized
+    Host_Reset();
+    memset( gau8HostEeprom, 0x00, sizeof( gau8HostEeprom ) );
+    Util_Init();
+    Upload_Init();
+    srand( 1u );
+    gbDeviceRunning = TRUE;
+    pthread_create( &sDevice, NULL, DeviceThread, NULL );
+  }
+  else
+  {
+    iFd = open( apcArgs[ 0 ], O_RDWR | O_NOCTTY );
+    if( iFd < 0 )
+    {
+      perror( apcArgs[ 0 ] );
+      return 1;
+    }
+  }
+  SetupSerialPort( iFd );
+
+  bSuccess = Upload( iFd, u8Slot, &sImage );
+  fprintf( stderr, "Packets sent again: %u\n", gu32Retries );
+
+  if( TRUE == bLoopback )
+  {
+    gbDeviceRunning = FALSE;
+    pthread_join( sDevice, NULL );
+    if( TRUE == bSuccess )
+    {
+      bSuccess = CheckSlot( u8Slot, &sImage );
+      fprintf( stderr, "Simulated EEPROM: %s\n", ( TRUE == bSuccess ) ? "slot verified" : "MISMATCH" );
+    }
+    close( giDeviceFd );
+  }
+  close( iFd );
+
+  return ( TRUE == bSuccess ) ? 0 : 1;
+}
+
+/***************************************< End of file >**************************************/
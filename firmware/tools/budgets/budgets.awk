@@ -0,0 +1,154 @@
+#! *******************************************************************************************************
+# Copyright (c) 2022 Hekk_Elek
+#
+# \file budgets.awk
+#
+# \brief Memory budgets of the SDCC build: checks them, derives them from a measured build, or
+#        compares builds
+#
+# \author Hekk_Elek
+#
+#*********************************************************************************************************
+
+#-----------------------------------------------------------------------------------------
+# How it works
+# ============
+# The used memory is read from the .mem file of the SDCC linker:
+#   Stack starts at: 0x9b (sp set to 0x9a) ...   ->  IRAM: everything below the stack
+#      ROM/EPROM/FLASH  0x0000 0x1c31 7218 8192  ->  CODE: the Size column
+#      EXTERNAL RAM                   0    1024  ->  XDATA: the Size column
+# check (default): every number is compared with its budget (code, iram, xdata), the exit
+# code is 1 if one is over.
+# generate: the .mem file and the output of an emu51 run with --limit (its "Cycle budgets"
+# table) are turned into budget assignments for the Makefile. Every budget is the measured
+# value plus margin percent, rounded up, but never above the hard limit given for it (code,
+# iram, xdata, isr, animation); the measured values are written into the comments.
+# report: any number of builds, each given as its .mem file and an emu51 run: one row per
+# build directory with its memory and the min/avg/max cycles of the timer 0 interrupt
+# (vector 1 of the "Interrupts" table), for comparing the variants of a change.
+#
+# Run (the Makefile does it):
+#   awk -f budgets.awk -v code=8192 -v iram=200 -v xdata=1024 karifa.mem
+#   awk -f budgets.awk -v mode=generate -v margin=10 -v code=8192 -v iram=200 -v xdata=1024 \
+#       -v isr=2400 -v animation=24000 karifa.mem cycles.txt > budgets-stc8g.mk
+#   awk -f budgets.awk -v mode=report a/karifa.mem a/cycles.txt b/karifa.mem b/cycles.txt
+#-----------------------------------------------------------------------------------------
+
+#***************************************< Functions >**************************************
+# Value of a 0x prefixed hexadecimal number; mawk has no strtonum()
+function hex( s,    i, n )
+{
+  n = 0
+  s = tolower( substr( s, 3 ) )
+  for( i = 1; i <= length( s ); i++ )
+  {
+    n = n * 16 + index( "0123456789abcdef", substr( s, i, 1 ) ) - 1
+  }
+  return n
+}
+
+# Prints a used/budget line, remembers if it's over
+function check( name, used, budget )
+{
+  printf( "%-6s %6d of %6d bytes\n", name, used, budget )
+  if( used > budget )
+  {
+    printf( "%s is over its budget by %d bytes\n", name, used - budget )
+    failed = 1
+  }
+}
+
+# Measured value plus the margin, rounded up, at most the hard limit
+function budget( used, limit,    n )
+{
+  n = int( ( used * ( 100 + margin ) + 99 ) / 100 )
+  return ( n > limit ) ? limit : n
+}
+
+# One budget assignment of the Makefile with its measurement
+function assign( variable, used, limit, unit )
+{
+  printf( "# measured %d %s, hard limit %d\n", used, unit, limit )
+  printf( "%s ?= %d\n", variable, budget( used, limit ) )
+}
+
+# One row of the report, for the build read so far; starts the next one
+function row()
+{
+  if( "" != build )
+  {
+    printf( "%-32s %6d %6d %6d %8s %8s %8s\n", build, usedCode, usedIram, usedXdata, isrMin, isrAvg, isrMax )
+  }
+  isrMin = isrAvg = isrMax = "-"
+}
+
+
+#***************************************< Rules >**************************************
+BEGIN {
+  if( "" == mode )
+  {
+    mode = "check"
+  }
+  failed = 0
+  usedIsr = -1
+  usedAnimation = -1
+  if( "report" == mode )
+  {
+    printf( "%-32s %6s %6s %6s %8s %8s %8s\n", "build", "CODE", "IRAM", "XDATA", "isr_min", "isr_avg", "isr_max" )
+    row()
+  }
+}
+
+# The .mem file of the next build in the report
+( "report" == mode ) && ( 1 == FNR ) && ( FILENAME ~ /\.mem$/ ) {
+  row()
+  build = FILENAME
+  sub( /\/[^\/]*$/, "", build )
+}
+
+# The .mem file
+/^Stack starts at:/        { usedIram = hex( $4 ) }
+/^ *ROM\/EPROM\/FLASH /     { usedCode = $(NF-1) }
+/^ *EXTERNAL RAM /         { usedXdata = $(NF-1) }
+
+# The "Cycle budgets" table of emu51: runs, max, budget, result, name
+/^Cycle budgets/           { inLimits = 1; next }
+inLimits && ( 5 == NF ) && ( $5 == "vector1" )          { usedIsr = $2 }
+inLimits && ( 5 == NF ) && ( $5 == "Animation_Cycle" )  { usedAnimation = $2 }
+
+# The "Interrupts" table of emu51: vector, address, entries, min, avg, max, latency, load
+/^vector address/          { inVectors = 1; next }
+inVectors && ( 0 == NF )   { inVectors = 0 }
+inVectors && ( $1 == "1" ) { isrMin = $4; isrAvg = $5; isrMax = $6 }
+
+END {
+  if( "generate" == mode )
+  {
+    if( ( usedIsr < 0 ) || ( usedAnimation < 0 ) )
+    {
+      print "The emu51 output has no vector1 or Animation_Cycle line" > "/dev/stderr"
+      exit 1
+    }
+    printf( "# Budgets of the SDCC build, written by \"make budgets\": the measured values plus %d %%\n", margin )
+    printf( "# Memory, in bytes\n" )
+    assign( "CODE_BUDGET", usedCode, code, "bytes" )
+    assign( "IRAM_BUDGET", usedIram, iram, "bytes" )
+    assign( "XDATA_BUDGET", usedXdata, xdata, "bytes" )
+    printf( "# Hot paths, in system clock cycles\n" )
+    assign( "ISR_CYCLES_BUDGET", usedIsr, isr, "cycles" )
+    assign( "ANIMATION_CYCLES_BUDGET", usedAnimation, animation, "cycles" )
+  }
+  else if( "report" == mode )
+  {
+    row()
+  }
+  else
+  {
+    check( "CODE", usedCode, code )
+    check( "IRAM", usedIram, iram )
+    check( "XDATA", usedXdata, xdata )
+  }
+  exit failed
+}
+
+#***************************************< End of file >**************************************
@@ -0,0 +1,866 @@
+/*! *******************************************************************************************************
+* Copyright (c) 2022 Hekk_Elek
+*
+* \file asm51.cpp
+*
+* \brief Minimal A51 assembler: just enough of the Keil syntax to run crc16.A51 in the emulator
+*
+* \author Hekk_Elek
+*
+**********************************************************************************************************/
+
+/*----------------------------------------------------------------------------------------
+How it works
+============
+No 8051 assembler is needed for the host tools, so the hand-written routines are turned
+into machine code here, the same way Keil A51 would, and run in tools/emu51. Each module is
+assembled in two passes to one fixed address (no relocation, no object files): the first
+pass only collects the addresses of the labels, the second one writes the code. The
+symbols stay defined for the later modules, so a test driver can call the routines of an
+earlier one; EXTRN symbols are given with Define() before the module is assembled.
+
+Supported:
+- labels ("name:"), "name EQU expr", macros without parameters (MACRO ... ENDM), DB;
+- the instructions used by the firmware's routines and test drivers: data moves, MOVC,
+  MOVX, arithmetic and logic on A, INC/DEC, CJNE, DJNZ, the conditional and the long
+  jumps and calls, and the bit instructions on C and on named bits (e.g. EA);
+- expressions: numbers (123, 0BDH, 0x1B, 101B), symbols, $, +, -, LOW(), HIGH(), ( ).
+The segment directives (NAME, SEGMENT, RSEG, PUBLIC, EXTRN) are accepted and ignored, and
+so are the C preprocessor lines: the module is assembled as if its #if blocks were
+selected (e.g. crc16.A51 as if CRC16_IMPLEMENTATION == CRC16_ASM).
+----------------------------------------------------------------------------------------*/
+
+/***************************************< Includes >**************************************/
+// Standard C libraries
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+// Own includes
+#include "asm51.h"
+
+
+/***************************************< Definitions >**************************************/
+#define OPERANDS_NUM  (3u)  //!< Maximum number of operands of an instruction
+
+
+/***************************************< Types >**************************************/
+//! \brief An instruction form: mnemonic, operand pattern and opcode
+//! \note  Patterns, separated by commas: literal operands (A, AB, C, DPTR, @DPTR, @A+DPTR, @A+PC),
+//!        Rn and @Ri (added to the opcode), #i (8-bit immediate), #I (16-bit immediate), d (direct
+//!        address or bit), r (relative jump target), L (16-bit address).
+typedef struct
+{
+  const char* pcMnemonic;  //!< Mnemonic, upper case
+  const char* pcOperands;  //!< Operand pattern
+  U8          u8Opcode;    //!< Opcode, register number excluded
+} S_INSTRUCTION;
+
+
+/***************************************< Constants >**************************************/
+//! \brief Supported instruction forms; the first matching one is used
+static const S_INSTRUCTION gcasInstructions[] =
+{
+  { "NOP",   "",           0x00u }, { "RET",   "",           0x22u }, { "RETI",  "",           0x32u },
+  { "LJMP",  "L",          0x02u }, { "LCALL", "L",          0x12u }, { "SJMP",  "r",          0x80u },
+  { "JC",    "r",          0x40u }, { "JNC",   "r",          0x50u }, { "JZ",    "r",          0x60u },
+  { "JNZ",   "r",          0x70u }, { "JB",    "d,r",        0x20u }, { "JNB",   "d,r",        0x30u },
+  { "INC",   "A",          0x04u }, { "INC",   "DPTR",       0xA3u }, { "INC",   "Rn",         0x08u },
+  { "INC",   "@Ri",        0x06u }, { "INC",   "d",          0x05u },
+  { "DEC",   "A",          0x14u }, { "DEC",   "Rn",         0x18u }, { "DEC",   "@Ri",        0x16u },
+  { "DEC",   "d",          0x15u },
+  { "ADD",   "A,#i",       0x24u }, { "ADD",   "A,Rn",       0x28u }, { "ADD",   "A,@Ri",      0x26u },
+  { "ADD",   "A,d",        0x25u },
+  { "ADDC",  "A,#i",       0x34u }, { "ADDC",  "A,Rn",       0x38u }, { "ADDC",  "A,@Ri",      0x36u },
+  { "ADDC",  "A,d",        0x35u },
+  { "SUBB",  "A,#i",       0x94u }, { "SUBB",  "A,Rn",       0x98u }, { "SUBB",  "A,@Ri",      0x96u },
+  { "SUBB",  "A,d",        0x95u },
+  { "ORL",   "A,#i",       0x44u }, { "ORL",   "A,Rn",       0x48u }, { "ORL",   "A,@Ri",      0x46u },
+  { "ORL",   "A,d",        0x45u }, { "ORL",   "d,A",        0x42u }, { "ORL",   "d,#i",       0x43u },
+  { "ANL",   "A,#i",       0x54u }, { "ANL",   "A,Rn",       0x58u }, { "ANL",   "A,@Ri",      0x56u },
+  { "ANL",   "A,d",        0x55u }, { "ANL",   "d,A",        0x52u }, { "ANL",   "d,#i",       0x53u },
+  { "XRL",   "A,#i",       0x64u }, { "XRL",   "A,Rn",       0x68u }, { "XRL",   "A,@Ri",      0x66u },
+  { "XRL",   "A,d",        0x65u }, { "XRL",   "d,A",        0x62u }, { "XRL",   "d,#i",       0x63u },
+  { "MOV",   "A,#i",       0x74u }, { "MOV",   "A,Rn",       0xE8u }, { "MOV",   "A,@Ri",      0xE6u },
+  { "MOV",   "A,d",        0xE5u }, { "MOV",   "Rn,A",       0xF8u }, { "MOV",   "Rn,#i",      0x78u },
+  { "MOV",   "Rn,d",       0xA8u }, { "MOV",   "@Ri,A",      0xF6u }, { "MOV",   "@Ri,#i",     0x76u },
+  { "MOV",   "@Ri,d",      0xA6u }, { "MOV",   "DPTR,#I",    0x90u }, { "MOV",   "d,A",        0xF5u },
+  { "MOV",   "d,Rn",       0x88u }, { "MOV",   "d,@Ri",      0x86u }, { "MOV",   "d,#i",       0x75u },
+  { "MOVC",  "A,@A+DPTR",  0x93u }, { "MOVC",  "A,@A+PC",    0x83u },
+  { "MOVX",  "A,@DPTR",    0xE0u }, { "MOVX",  "A,@Ri",      0xE2u }, { "MOVX",  "@DPTR,A",    0xF0u },
+  { "MOVX",  "@Ri,A",      0xF2u },
+  { "MUL",   "AB",         0xA4u }, { "DIV",   "AB",         0x84u },
+  { "CLR",   "A",          0xE4u }, { "CLR",   "C",          0xC3u }, { "CLR",   "d",          0xC2u },
+  { "SETB",  "C",          0xD3u }, { "SETB",  "d",          0xD2u }, { "CPL",   "A",          0xF4u },
+  { "CPL",   "C",          0xB3u },
+  { "SWAP",  "A",          0xC4u }, { "RL",    "A",          0x23u }, { "RR",    "A",          0x03u },
+  { "RLC",   "A",          0x33u }, { "RRC",   "A",          0x13u },
+  { "PUSH",  "d",          0xC0u }, { "POP",   "d",          0xD0u },
+  { "XCH",   "A,Rn",       0xC8u }, { "XCH",   "A,@Ri",      0xC6u }, { "XCH",   "A,d",        0xC5u },
+  { "CJNE",  "A,#i,r",     0xB4u }, { "CJNE",  "A,d,r",      0xB5u }, { "CJNE",  "Rn,#i,r",    0xB8u },
+  { "CJNE",  "@Ri,#i,r",   0xB6u },
+  { "DJNZ",  "Rn,r",       0xD8u }, { "DJNZ",  "d,r",        0xD5u },
+};
+
+//! \brief Operands that are never an expression
+static const char* gcapcReserved[] = { "A", "AB", "C", "DPTR", "R0", "R1", "R2", "R3", "R4", "R5", "R6", "R7" };
+
+//! \brief Named registers and bits, defined before the first module
+static const struct
+{
+  const char* pcName;
+  U16         u16Address;
+} gcasNamedAddresses[] =
+{
+  { "ACC", 0xE0u }, { "B", 0xF0u }, { "PSW", 0xD0u }, { "SP", 0x81u }, { "DPL", 0x82u }, { "DPH", 0x83u },
+  { "IE", 0xA8u }, { "EA", 0xAFu }, { "P1", 0x90u }, { "P3", 0xB0u }, { "P5", 0xC8u },
+};
+
+
+/***************************************< Static functions >**************************************/
+//----------------------------------------------------------------------------
+//! \brief  Skips the white space
+//! \param  pcText: text
+//! \return First other character
+//-----------------------------------------------------------------------------
+static const char* SkipSpace( const char* pcText )
+{
+  while( ( ' ' == *pcText ) || ( '\t' == *pcText ) )
+  {
+    pcText++;
+  }
+  return pcText;
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Tells if a character can be part of a name
+//! \param  cChar: character
+//! \return TRUE for letters, digits, '_' and '?'
+//-----------------------------------------------------------------------------
+static BOOL IsNameChar( char cChar )
+{
+  return ( isalnum( (unsigned char)cChar ) || ( '_' == cChar ) || ( '?' == cChar ) );
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Copies a name from the text
+//! \param  ppcText: text, moved after the name
+//! \param  pcName: the name, at most ASM51_NAME_LENGTH - 1 characters; empty if there's none
+//-----------------------------------------------------------------------------
+static void ReadName( const char** ppcText, char* pcName )
+{
+  U32 u32Length = 0u;
+  const char* pcText = SkipSpace( *ppcText );
+
+  if( !isdigit( (unsigned char)*pcText ) )
+  {
+    while( IsNameChar( *pcText ) && ( u32Length < ( ASM51_NAME_LENGTH - 1u ) ) )
+    {
+      pcName[ u32Length++ ] = *pcText++;
+    }
+  }
+  pcName[ u32Length ] = '\0';
+  *ppcText = pcText;
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Removes the white space from both ends of a string, in place
+//! \param  pcText: string
+//! \return The trimmed string
+//-----------------------------------------------------------------------------
+static char* Trim( char* pcText )
+{
+  char* pcEnd;
+
+  pcText = (char*)SkipSpace( pcText );
+  pcEnd = pcText + strlen( pcText );
+  while( ( pcEnd > pcText ) && isspace( (unsigned char)pcEnd[ -1 ] ) )
+  {
+    pcEnd--;
+  }
+  *pcEnd = '\0';
+  return pcText;
+}
+
+
+/***************************************< Private functions >**************************************/
+//----------------------------------------------------------------------------
+//! \brief  Records the first error
+//! \param  pcMessage: what's wrong
+//! \param  pcDetail: the offending text
+//! \return FALSE
+//-----------------------------------------------------------------------------
+BOOL Asm51::Fail( const char* pcMessage, const char* pcDetail )
+{
+  if( '\0' == macError[ 0 ] )
+  {
+    snprintf( macError, sizeof( macError ), "line %u: %s: %s", mu32Line + 1u, pcMessage, pcDetail );
+  }
+  return FALSE;
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Finds a symbol
+//! \param  pcName: name, any case
+//! \return The symbol, NULL if it isn't defined
+//-----------------------------------------------------------------------------
+Asm51::S_SYMBOL* Asm51::FindSymbol( const char* pcName ) const
+{
+  S_SYMBOL* psSymbol = NULL;
+  U32 u32Index;
+
+  for( u32Index = 0u; ( u32Index < mu32SymbolsNum ) && ( NULL == psSymbol ); u32Index++ )
+  {
+    if( 0 == strcasecmp( masSymbols[ u32Index ].acName, pcName ) )
+    {
+      psSymbol = (S_SYMBOL*)&masSymbols[ u32Index ];
+    }
+  }
+  return psSymbol;
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Defines a symbol of the current module, or updates it in the second pass
+//! \param  pcName: name
+//! \param  u16Value: value
+//! \return FALSE if another module has defined it, or there's no room
+//-----------------------------------------------------------------------------
+BOOL Asm51::SetSymbol( const char* pcName, U16 u16Value )
+{
+  BOOL bResult = TRUE;
+  S_SYMBOL* psSymbol = FindSymbol( pcName );
+
+  if( NULL != psSymbol )
+  {
+    if( psSymbol->u8Module != mu8Module )
+    {
+      bResult = Fail( "already defined", pcName );
+    }
+    else
+    {
+      psSymbol->u16Value = u16Value;
+    }
+  }
+  else if( mu32SymbolsNum >= ASM51_SYMBOLS_NUM )
+  {
+    bResult = Fail( "too many symbols", pcName );
+  }
+  else
+  {
+    psSymbol = &masSymbols[ mu32SymbolsNum++ ];
+    snprintf( psSymbol->acName, sizeof( psSymbol->acName ), "%s", pcName );
+    psSymbol->u16Value = u16Value;
+    psSymbol->u8Module = mu8Module;
+  }
+  return bResult;
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Evaluates a term: number, symbol, $, LOW(), HIGH(), parenthesized expression, negation
+//! \param  ppcText: text, moved after the term
+//! \param  pi32Value: value of the term
+//! \return FALSE on a syntax error, or an undefined symbol in the second pass
+//-----------------------------------------------------------------------------
+BOOL Asm51::Term( const char** ppcText, I32* pi32Value )
+{
+  BOOL  bResult = TRUE;
+  const char* pcText = SkipSpace( *ppcText );
+  char  acName[ ASM51_NAME_LENGTH ];
+  char  acNumber[ 24 ];
+  char  cSuffix;
+  U32   u32Length = 0u;
+  char* pcEnd;
+  S_SYMBOL* psSymbol;
+
+  *pi32Value = 0;
+  if( '(' == *pcText )
+  {
+    pcText++;
+    bResult = Expression( &pcText, pi32Value );
+    pcText = SkipSpace( pcText );
+    bResult = bResult && ( ( ')' == *pcText++ ) || Fail( "missing )", *ppcText ) );
+  }
+  else if( '-' == *pcText )
+  {
+    pcText++;
+    bResult = Term( &pcText, pi32Value );
+    *pi32Value = -*pi32Value;
+  }
+  else if( '$' == *pcText )
+  {
+    pcText++;
+    *pi32Value = mu16Address;
+  }
+  else if( isdigit( (unsigned char)*pcText ) )
+  {
+    while( isalnum( (unsigned char)*pcText ) && ( u32Length < ( sizeof( acNumber ) - 1u ) ) )
+    {
+      acNumber[ u32Length++ ] = (char)toupper( (unsigned char)*pcText++ );
+    }
+    acNumber[ u32Length ] = '\0';
+    cSuffix = acNumber[ u32Length - 1u ];
+    if( 'X' == acNumber[ 1 ] )  // 0x prefixed
+    {
+      *pi32Value = (I32)strtol( acNumber, &pcEnd, 16 );
+    }
+    else if( ( 'H' == cSuffix ) || ( 'B' == cSuffix ) )
+    {
+      acNumber[ u32Length - 1u ] = '\0';
+      *pi32Value = (I32)strtol( acNumber, &pcEnd, ( 'H' == cSuffix ) ? 16 : 2 );
+    }
+    else
+    {
+      *pi32Value = (I32)strtol( acNumber, &pcEnd, 10 );
+    }
+    bResult = ( '\0' == *pcEnd ) || Fail( "bad number", acNumber );
+  }
+  else
+  {
+    ReadName( &pcText, acName );
+    if( '\0' == acName[ 0 ] )
+    {
+      bResult = Fail( "expression expected", *ppcText );
+    }
+    else if( ( 0 == strcasecmp( acName, "LOW" ) ) || ( 0 == strcasecmp( acName, "HIGH" ) ) )
+    {
+      bResult = Term( &pcText, pi32Value );
+      *pi32Value = ( 0 == strcasecmp( acName, "LOW" ) ) ? ( *pi32Value & 0xFF ) : ( ( *pi32Value >> 8 ) & 0xFF );
+    }
+    else
+    {
+      psSymbol = FindSymbol( acName );
+      if( NULL != psSymbol )
+      {
+        *pi32Value = psSymbol->u16Value;
+      }
+      else if( 2u == mu8Pass )
+      {
+        bResult = Fail( "undefined symbol", acName );
+      }
+      else
+      {
+        // Labels below this line are known in the second pass
+      }
+    }
+  }
+  *ppcText = pcText;
+  return bResult;
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Evaluates an expression: terms added and subtracted
+//! \param  ppcText: text, moved after the expression
+//! \param  pi32Value: value of the expression
+//! \return FALSE on an error
+//-----------------------------------------------------------------------------
+BOOL Asm51::Expression( const char** ppcText, I32* pi32Value )
+{
+  BOOL bResult = Term( ppcText, pi32Value );
+  I32  i32Term;
+  char cOperator;
+
+  *ppcText = SkipSpace( *ppcText );
+  while( bResult && ( ( '+' == **ppcText ) || ( '-' == **ppcText ) ) )
+  {
+    cOperator = **ppcText;
+    (*ppcText)++;
+    bResult = Term( ppcText, &i32Term );
+    *pi32Value = ( '+' == cOperator ) ? ( *pi32Value + i32Term ) : ( *pi32Value - i32Term );
+    *ppcText = SkipSpace( *ppcText );
+  }
+  return bResult;
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Matches an operand with one element of an instruction pattern
+//! \param  pcPattern: the pattern element, see S_INSTRUCTION
+//! \param  pcOperand: the operand, trimmed
+//! \param  pu8Opcode: the register number is added to it
+//! \param  pau8Bytes: the operand bytes are appended to it
+//! \param  pu8Length: number of bytes in pau8Bytes[]
+//! \return TRUE if the operand matches the pattern
+//! \note   An expression that doesn't evaluate still matches; the error is recorded.
+//-----------------------------------------------------------------------------
+BOOL Asm51::Operand( const char* pcPattern, const char* pcOperand, U8* pu8Opcode, U8* pau8Bytes, U8* pu8Length )
+{
+  BOOL bMatch = FALSE;
+  BOOL bExpression = TRUE;
+  I32  i32Value = 0;
+  U32  u32Index;
+  const char* pcText = pcOperand;
+
+  for( u32Index = 0u; u32Index < ( sizeof( gcapcReserved ) / sizeof( gcapcReserved[ 0 ] ) ); u32Index++ )
+  {
+    bExpression = bExpression && ( 0 != strcasecmp( pcOperand, gcapcReserved[ u32Index ] ) );
+  }
+  bExpression = bExpression && ( '@' != pcOperand[ 0 ] ) && ( '#' != pcOperand[ 0 ] );
+
+  if( 0 == strcmp( pcPattern, "Rn" ) )
+  {
+    bMatch = ( 'R' == toupper( (unsigned char)pcOperand[ 0 ] ) ) && ( pcOperand[ 1 ] >= '0' ) && ( pcOperand[ 1 ] <= '7' )
+          && ( '\0' == pcOperand[ 2 ] );
+    *pu8Opcode = (U8)( *pu8Opcode + ( bMatch ? ( pcOperand[ 1 ] - '0' ) : 0 ) );
+  }
+  else if( 0 == strcmp( pcPattern, "@Ri" ) )
+  {
+    bMatch = ( '@' == pcOperand[ 0 ] ) && ( 'R' == toupper( (unsigned char)pcOperand[ 1 ] ) )
+          && ( ( '0' == pcOperand[ 2 ] ) || ( '1' == pcOperand[ 2 ] ) ) && ( '\0' == pcOperand[ 3 ] );
+    *pu8Opcode = (U8)( *pu8Opcode + ( bMatch ? ( pcOperand[ 2 ] - '0' ) : 0 ) );
+  }
+  else if( ( 0 == strcmp( pcPattern, "#i" ) ) || ( 0 == strcmp( pcPattern, "#I" ) ) )
+  {
+    bMatch = ( '#' == pcOperand[ 0 ] );
+    if( bMatch )
+    {
+      pcText++;
+      if( Expression( &pcText, &i32Value ) && ( '\0' != *SkipSpace( pcText ) ) )
+      {
+        (void)Fail( "bad expression", pcOperand );
+      }
+      if( 'I' == pcPattern[ 1 ] )
+      {
+        pau8Bytes[ (*pu8Length)++ ] = (U8)( i32Value >> 8 );
+      }
+      else if( ( i32Value < -128 ) || ( i32Value > 255 ) )
+      {
+        (void)Fail( "immediate out of range", pcOperand );
+      }
+      else
+      {
+        // Fits a byte
+      }
+      pau8Bytes[ (*pu8Length)++ ] = (U8)i32Value;
+    }
+  }
+  else if( ( 0 == strcmp( pcPattern, "d" ) ) || ( 0 == strcmp( pcPattern, "r" ) ) || ( 0 == strcmp( pcPattern, "L" ) ) )
+  {
+    bMatch = bExpression;
+    if( bMatch )
+    {
+      if( Expression( &pcText, &i32Value ) && ( '\0' != *SkipSpace( pcText ) ) )
+      {
+        (void)Fail( "bad expression", pcOperand );
+      }
+      if( 'L' == pcPattern[ 0 ] )
+      {
+        pau8Bytes[ (*pu8Length)++ ] = (U8)( i32Value >> 8 );
+        pau8Bytes[ (*pu8Length)++ ] = (U8)i32Value;
+      }
+      else if( 'r' == pcPattern[ 0 ] )
+      {
+        // Relative to the end of the instruction: the bytes of the operands after this one are counted too
+        i32Value -= (I32)mu16End;
+        if( ( 2u == mu8Pass ) && ( ( i32Value < -128 ) || ( i32Value > 127 ) ) )
+        {
+          (void)Fail( "jump out of range", pcOperand );
+        }
+        pau8Bytes[ (*pu8Length)++ ] = (U8)i32Value;
+      }
+      else
+      {
+        if( ( i32Value < 0 ) || ( i32Value > 255 ) )
+        {
+          (void)Fail( "address out of range", pcOperand );
+        }
+        pau8Bytes[ (*pu8Length)++ ] = (U8)i32Value;
+      }
+    }
+  }
+  else
+  {
+    bMatch = ( 0 == strcasecmp( pcPattern, pcOperand ) );  // Literal operand
+  }
+  return bMatch;
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Assembles an instruction
+//! \param  pcMnemonic: mnemonic
+//! \param  pcOperands: operands separated by commas; modified
+//! \param  pau8Code: code image, written in the second pass
+//! \return FALSE on an error
+//-----------------------------------------------------------------------------
+BOOL Asm51::Instruction( const char* pcMnemonic, char* pcOperands, U8* pau8Code )
+{
+  BOOL  bResult = FALSE;
+  BOOL  bFound = FALSE;
+  char* apcOperands[ OPERANDS_NUM ];
+  U32   u32OperandsNum = 0u;
+  U32   u32Form;
+  U32   u32Index;
+  char  acPattern[ 32 ];
+  char* apcPatterns[ OPERANDS_NUM ];
+  U32   u32PatternsNum;
+  U8    au8Bytes[ 1u + ( 2u * OPERANDS_NUM ) ];
+  U8    u8Length;
+  U8    u8Opcode;
+  U8    u8Size;
+  char* pcNext;
+
+  // Split the operands
+  pcNext = Trim( pcOperands );
+  while( ( '\0' != *pcNext ) && ( u32OperandsNum < OPERANDS_NUM ) )
+  {
+    apcOperands[ u32OperandsNum++ ] = pcNext;
+    pcNext = strchr( pcNext, ',' );
+    if( NULL == pcNext )
+    {
+      pcNext = apcOperands[ u32OperandsNum - 1u ] + strlen( apcOperands[ u32OperandsNum - 1u ] );
+    }
+    else
+    {
+      *pcNext++ = '\0';
+    }
+  }
+  for( u32Index = 0u; u32Index < u32OperandsNum; u32Index++ )
+  {
+    apcOperands[ u32Index ] = Trim( apcOperands[ u32Index ] );
+  }
+
+  for( u32Form = 0u; ( u32Form < ( sizeof( gcasInstructions ) / sizeof( gcasInstructions[ 0 ] ) ) ) && !bFound; u32Form++ )
+  {
+    const S_INSTRUCTION* pcsForm = &gcasInstructions[ u32Form ];
+    if( 0 != strcasecmp( pcsForm->pcMnemonic, pcMnemonic ) )
+    {
+      continue;
+    }
+    // Split the pattern, and count the bytes: a relative jump is relative to the end of the instruction
+    snprintf( acPattern, sizeof( acPattern ), "%s", pcsForm->pcOperands );
+    u32PatternsNum = 0u;
+    u8Size = 1u;
+    for( pcNext = strtok( acPattern, "," ); ( NULL != pcNext ) && ( u32PatternsNum < OPERANDS_NUM ); pcNext = strtok( NULL, "," ) )
+    {
+      apcPatterns[ u32PatternsNum++ ] = pcNext;
+      u8Size = (U8)( u8Size + ( ( 0 == strcmp( pcNext, "#I" ) ) || ( 0 == strcmp( pcNext, "L" ) ) ? 2u
+                              : ( ( 0 == strcmp( pcNext, "#i" ) ) || ( 0 == strcmp( pcNext, "d" ) ) || ( 0 == strcmp( pcNext, "r" ) ) ) ? 1u : 0u ) );
+    }
+    if( u32PatternsNum != u32OperandsNum )
+    {
+      continue;
+    }
+    u8Opcode = pcsForm->u8Opcode;
+    u8Length = 0u;
+    mu16End = (U16)( mu16Address + u8Size );
+    bFound = TRUE;
+    for( u32Index = 0u; ( u32Index < u32OperandsNum ) && bFound; u32Index++ )
+    {
+      bFound = Operand( apcPatterns[ u32Index ], apcOperands[ u32Index ], &u8Opcode, au8Bytes, &u8Length );
+    }
+    if( bFound )
+    {
+      bResult = ( '\0' == macError[ 0 ] );
+      if( 2u == mu8Pass )
+      {
+        pau8Code[ mu16Address ] = u8Opcode;
+        memcpy( &pau8Code[ (U16)( mu16Address + 1u ) ], au8Bytes, u8Length );
+      }
+      mu16Address = (U16)( mu16Address + u8Size );
+    }
+  }
+  if( !bFound )
+  {
+    (void)Fail( "unsupported instruction", pcMnemonic );
+  }
+  return bResult;
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Assembles one source line
+//! \param  u32Line: index of the line
+//! \param  pau8Code: code image, written in the second pass
+//! \param  pbEnd: set to TRUE by END
+//! \return FALSE on an error
+//-----------------------------------------------------------------------------
+BOOL Asm51::Line( U32 u32Line, U8* pau8Code, BOOL* pbEnd )
+{
+  BOOL  bResult = TRUE;
+  char  acLine[ 256 ];
+  char  acFirst[ ASM51_NAME_LENGTH ];
+  char  acSecond[ ASM51_NAME_LENGTH ];
+  const char* pcText;
+  const char* pcRest;
+  char* pcComment;
+  I32   i32Value;
+  U32   u32Index;
+
+  mu32Line = u32Line;
+  snprintf( acLine, sizeof( acLine ), "%s", mapcLines[ u32Line ] );
+  pcComment = strchr( acLine, ';' );
+  if( NULL != pcComment )
+  {
+    *pcComment = '\0';
+  }
+  pcText = Trim( acLine );
+  if( '#' == *pcText )  // C preprocessor: skipped like an empty line
+  {
+    pcText = "";
+  }
+
+  ReadName( &pcText, acFirst );
+  if( ':' == *pcText )  // Label
+  {
+    bResult = SetSymbol( acFirst, mu16Address );
+    pcText = SkipSpace( pcText + 1 );
+    ReadName( &pcText, acFirst );
+  }
+  pcRest = pcText;
+  ReadName( &pcRest, acSecond );
+
+  if( !bResult || ( '\0' == acFirst[ 0 ] ) )
+  {
+    bResult = bResult && ( ( '\0' == *SkipSpace( pcText ) ) || Fail( "syntax error", mapcLines[ u32Line ] ) );
+  }
+  else if( 0 == strcasecmp( acSecond, "EQU" ) )
+  {
+    bResult = Expression( &pcRest, &i32Value ) && SetSymbol( acFirst, (U16)i32Value );
+  }
+  else if( ( 0 == strcasecmp( acSecond, "SEGMENT" ) ) || ( 0 == strcasecmp( acFirst, "NAME" ) )
+        || ( 0 == strcasecmp( acFirst, "RSEG" ) ) || ( 0 == strcasecmp( acFirst, "PUBLIC" ) )
+        || ( 0 == strcasecmp( acFirst, "EXTRN" ) ) )
+  {
+    // No segments: the module is assembled to one address; the EXTRN symbols come from Define()
+  }
+  else if( 0 == strcasecmp( acFirst, "END" ) )
+  {
+    *pbEnd = TRUE;
+  }
+  else if( 0 == strcasecmp( acFirst, "DB" ) )
+  {
+    do
+    {
+      bResult = Expression( &pcText, &i32Value );
+      if( 2u == mu8Pass )
+      {
+        pau8Code[ mu16Address ] = (U8)i32Value;
+      }
+      mu16Address++;
+      pcText = SkipSpace( pcText );
+    } while( bResult && ( ',' == *pcText++ ) );
+  }
+  else
+  {
+    for( u32Index = 0u; u32Index < mu32MacrosNum; u32Index++ )
+    {
+      if( 0 == strcasecmp( masMacros[ u32Index ].acName, acFirst ) )
+      {
+        break;
+      }
+    }
+    if( u32Index < mu32MacrosNum )  // Macro: its body in place of this line
+    {
+      for( u32Line = masMacros[ u32Index ].u32First; ( u32Line < masMacros[ u32Index ].u32End ) && bResult; u32Line++ )
+      {
+        bResult = Line( u32Line, pau8Code, pbEnd );
+      }
+    }
+    else
+    {
+      bResult = Instruction( acFirst, (char*)pcText, pau8Code );
+    }
+  }
+  return bResult;
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Runs one pass over the module
+//! \param  pau8Code: code image, written in the second pass
+//! \return FALSE on an error
+//-----------------------------------------------------------------------------
+BOOL Asm51::Pass( U8* pau8Code )
+{
+  BOOL bResult = TRUE;
+  BOOL bEnd = FALSE;
+  U32  u32Line;
+  U32  u32Macro = 0u;
+
+  mu16Address = mu16Origin;
+  mu16End = mu16Origin;
+  for( u32Line = 0u; ( u32Line < mu32LinesNum ) && bResult && !bEnd; u32Line++ )
+  {
+    if( ( u32Macro < mu32MacrosNum ) && ( u32Line == ( masMacros[ u32Macro ].u32First - 1u ) ) )  // Definition: skipped
+    {
+      u32Line = masMacros[ u32Macro ].u32End;
+      u32Macro++;
+    }
+    else
+    {
+      bResult = Line( u32Line, pau8Code, &bEnd );
+    }
+  }
+  return bResult;
+}
+
+
+/***************************************< Public functions >**************************************/
+//----------------------------------------------------------------------------
+//! \brief  Constructor: only the named registers and bits are defined
+//-----------------------------------------------------------------------------
+Asm51::Asm51()
+{
+  U32 u32Index;
+
+  mu32SymbolsNum = 0u;
+  mu8Module = 0u;
+  mu16Size = 0u;
+  macError[ 0 ] = '\0';
+  for( u32Index = 0u; u32Index < ( sizeof( gcasNamedAddresses ) / sizeof( gcasNamedAddresses[ 0 ] ) ); u32Index++ )
+  {
+    (void)Define( gcasNamedAddresses[ u32Index ].pcName, gcasNamedAddresses[ u32Index ].u16Address );
+  }
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Defines a symbol for the next modules, e.g. an EXTRN of them
+//! \param  pcName: name
+//! \param  u16Value: value or address
+//! \return FALSE if it's already defined
+//-----------------------------------------------------------------------------
+BOOL Asm51::Define( const char* pcName, U16 u16Value )
+{
+  U8   u8Module = mu8Module;
+  BOOL bResult;
+
+  mu8Module = 0u;
+  bResult = ( NULL == FindSymbol( pcName ) ) && SetSymbol( pcName, u16Value );
+  mu8Module = u8Module;
+  return bResult;
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Returns the value of a symbol
+//! \param  pcName: name, any case
+//! \param  pu16Value: the value
+//! \return FALSE if it isn't defined
+//-----------------------------------------------------------------------------
+BOOL Asm51::Lookup( const char* pcName, U16* pu16Value ) const
+{
+  const S_SYMBOL* pcsSymbol = FindSymbol( pcName );
+
+  if( NULL != pcsSymbol )
+  {
+    *pu16Value = pcsSymbol->u16Value;
+  }
+  return ( NULL != pcsSymbol );
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Assembles a module from a file
+//! \param  pcFileName: source file
+//! \param  u16Origin: address of the first byte
+//! \param  pau8Code: code image of 65536 bytes
+//! \return FALSE on an error, see macError
+//-----------------------------------------------------------------------------
+BOOL Asm51::AssembleFile( const char* pcFileName, U16 u16Origin, U8* pau8Code )
+{
+  BOOL  bResult = FALSE;
+  FILE* pFile = fopen( pcFileName, "rb" );
+  char* pcText;
+  long  lLength;
+
+  if( NULL == pFile )
+  {
+    snprintf( macError, sizeof( macError ), "%s can't be opened", pcFileName );
+  }
+  else
+  {
+    fseek( pFile, 0, SEEK_END );
+    lLength = ftell( pFile );
+    fseek( pFile, 0, SEEK_SET );
+    pcText = (char*)malloc( (size_t)lLength + 1u );
+    if( ( NULL != pcText ) && ( (size_t)lLength == fread( pcText, 1u, (size_t)lLength, pFile ) ) )
+    {
+      pcText[ lLength ] = '\0';
+      bResult = AssembleText( pcText, u16Origin, pau8Code );
+    }
+    free( pcText );
+    fclose( pFile );
+  }
+  return bResult;
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Assembles a module
+//! \param  pcText: source
+//! \param  u16Origin: address of the first byte
+//! \param  pau8Code: code image of 65536 bytes
+//! \return FALSE on an error, see macError
+//-----------------------------------------------------------------------------
+BOOL Asm51::AssembleText( const char* pcText, U16 u16Origin, U8* pau8Code )
+{
+  BOOL  bResult = TRUE;
+  char* pcCopy = strdup( pcText );
+  char* pcLine = pcCopy;
+  char* pcEnd;
+  const char* pcRest;
+  char  acFirst[ ASM51_NAME_LENGTH ];
+  char  acSecond[ ASM51_NAME_LENGTH ];
+  U32   u32Line;
+
+  macError[ 0 ] = '\0';
+  mu8Module++;
+  mu16Origin = u16Origin;
+  mu16Size = 0u;
+  mu32LinesNum = 0u;
+  mu32MacrosNum = 0u;
+
+  // Lines
+  while( ( NULL != pcLine ) && bResult )
+  {
+    pcEnd = strchr( pcLine, '\n' );
+    if( NULL != pcEnd )
+    {
+      *pcEnd++ = '\0';
+    }
+    pcLine[ strcspn( pcLine, "\r" ) ] = '\0';
+    if( mu32LinesNum < ASM51_LINES_NUM )
+    {
+      mapcLines[ mu32LinesNum++ ] = pcLine;
+    }
+    else
+    {
+      bResult = Fail( "too many lines", "" );
+    }
+    pcLine = pcEnd;
+  }
+
+  // Macro definitions: "name MACRO" up to ENDM
+  for( u32Line = 0u; ( u32Line < mu32LinesNum ) && bResult; u32Line++ )
+  {
+    pcRest = mapcLines[ u32Line ];
+    ReadName( &pcRest, acFirst );
+    ReadName( &pcRest, acSecond );
+    if( 0 == strcasecmp( acSecond, "MACRO" ) )
+    {
+      if( mu32MacrosNum >= ASM51_MACROS_NUM )
+      {
+        bResult = Fail( "too many macros", acFirst );
+      }
+      else
+      {
+        snprintf( masMacros[ mu32MacrosNum ].acName, ASM51_NAME_LENGTH, "%s", acFirst );
+        masMacros[ mu32MacrosNum ].u32First = u32Line + 1u;
+        do
+        {
+          u32Line++;
+          pcRest = ( u32Line < mu32LinesNum ) ? mapcLines[ u32Line ] : "ENDM";
+          ReadName( &pcRest, acFirst );
+        } while( 0 != strcasecmp( acFirst, "ENDM" ) );
+        masMacros[ mu32MacrosNum ].u32End = u32Line;
+        mu32MacrosNum++;
+      }
+    }
+  }
+
+  // Addresses of the labels, then the code
+  mu8Pass = 1u;
+  bResult = bResult && Pass( pau8Code );
+  mu8Pass = 2u;
+  bResult = bResult && Pass( pau8Code );
+  mu16Size = (U16)( mu16Address - mu16Origin );
+  free( pcCopy );
+  return bResult;
+}
+
+/***************************************< End of file >**************************************/
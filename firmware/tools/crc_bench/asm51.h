@@ -0,0 +1,83 @@
+/*! *******************************************************************************************************
+* Copyright (c) 2022 Hekk_Elek
+*
+* \file asm51.h
+*
+* \brief Minimal A51 assembler: just enough of the Keil syntax to run crc16.A51 in the emulator
+*
+* \author Hekk_Elek
+*
+**********************************************************************************************************/
+#ifndef ASM51_H
+#define ASM51_H
+
+/***************************************< Includes >**************************************/
+#include "types.h"
+
+
+/***************************************< Definitions >**************************************/
+#define ASM51_SYMBOLS_NUM     (256u)  //!< Maximum number of symbols, over all modules
+#define ASM51_NAME_LENGTH      (40u)  //!< Longest symbol name
+#define ASM51_LINES_NUM      (1024u)  //!< Maximum number of source lines of a module
+#define ASM51_MACROS_NUM        (8u)  //!< Maximum number of macros of a module
+
+
+/***************************************< Types >**************************************/
+//! \brief Assembles modules one after the other into a code image; their symbols are shared
+class Asm51
+{
+public:
+  Asm51();
+  BOOL Define( const char* pcName, U16 u16Value );
+  BOOL Lookup( const char* pcName, U16* pu16Value ) const;
+  BOOL AssembleFile( const char* pcFileName, U16 u16Origin, U8* pau8Code );
+  BOOL AssembleText( const char* pcText, U16 u16Origin, U8* pau8Code );
+
+  U16  mu16Size;           //!< Bytes of the last assembled module
+  char macError[ 256 ];    //!< Description of the first error
+
+private:
+  //! \brief A symbol: label, EQU, or defined from the outside
+  typedef struct
+  {
+    char acName[ ASM51_NAME_LENGTH ];  //!< Name, in upper case
+    U16  u16Value;                     //!< Value or address
+    U8   u8Module;                     //!< Module that defined it, 0 for Define()
+  } S_SYMBOL;
+
+  //! \brief A macro without parameters: a range of source lines
+  typedef struct
+  {
+    char acName[ ASM51_NAME_LENGTH ];  //!< Name, in upper case
+    U32  u32First;                     //!< First line of the body
+    U32  u32End;                       //!< Line of ENDM
+  } S_MACRO;
+
+  BOOL Pass( U8* pau8Code );
+  BOOL Line( U32 u32Line, U8* pau8Code, BOOL* pbEnd );
+  BOOL Instruction( const char* pcMnemonic, char* pcOperands, U8* pau8Code );
+  BOOL Operand( const char* pcPattern, const char* pcOperand, U8* pu8Opcode, U8* pau8Bytes, U8* pu8Length );
+  BOOL Expression( const char** ppcText, I32* pi32Value );
+  BOOL Term( const char** ppcText, I32* pi32Value );
+  BOOL SetSymbol( const char* pcName, U16 u16Value );
+  S_SYMBOL* FindSymbol( const char* pcName ) const;
+  BOOL Fail( const char* pcMessage, const char* pcDetail );
+
+  S_SYMBOL masSymbols[ ASM51_SYMBOLS_NUM ];  //!< Symbols of every module
+  U32      mu32SymbolsNum;                   //!< Number of symbols
+  S_MACRO  masMacros[ ASM51_MACROS_NUM ];    //!< Macros of the current module
+  U32      mu32MacrosNum;                    //!< Number of macros
+  char*    mapcLines[ ASM51_LINES_NUM ];     //!< Lines of the current module
+  U32      mu32LinesNum;                     //!< Number of lines
+  U32      mu32Line;                         //!< Line being assembled, for the errors
+  U8       mu8Module;                        //!< Number of the current module
+  U8       mu8Pass;                          //!< 1: addresses only, 2: code
+  U16      mu16Origin;                       //!< Address of the first byte of the module
+  U16      mu16Address;                      //!< Address of the next byte ($ in the expressions)
+  U16      mu16End;                          //!< End of the instruction being assembled, the relative jumps count from it
+};
+
+
+#endif /* ASM51_H */
+
+/***************************************< End of file >**************************************/
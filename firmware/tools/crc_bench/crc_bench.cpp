@@ -0,0 +1,612 @@
+/*! *******************************************************************************************************
+* Copyright (c) 2022 Hekk_Elek
+*
+* \file crc_bench.cpp
+*
+* \brief Comparison of the CRC-16F/3 implementations of util.c
+*
+* \author Hekk_Elek
+*
+**********************************************************************************************************/
+
+/*----------------------------------------------------------------------------------------
+How it works
+============
+util.c is compiled twice for the host, once with each C implementation of Util_CRC16()
+(CRC16_TABLE256 and CRC16_NIBBLE, see config.h), in separate namespaces. Both are checked
+against a bit-by-bit reference on random buffers, then timed on the host. The host time is
+only useful to compare the two C variants with each other.
+
+--emu runs the implementations in the STC8G emulator (tools/emu51) instead, so the cycles
+and the flash bytes are the ones of the target:
+- ASM: crc16.A51 is assembled by asm51.cpp with a small driver that loads the Keil register
+  parameters and calls Util_CRC16(). It runs once with the buffers in IDATA (the fast path)
+  and once in CODE, through ?C?CLDPTR; that library routine is replaced by an equivalent
+  of the same instructions, Keil's own one isn't available here. Flash: the assembled
+  routine and the 512-byte table.
+- TABLE256, NIBBLE: the firmware built by SDCC with that implementation (make crc-bench).
+  The reset vector is redirected to a driver that sets the stack above the buffer and calls
+  Util_CRC16() with the SDCC convention: a generic pointer in DPL/DPH/B, the length in
+  _Util_CRC16_PARM_2. Flash: Util_CRC16() up to the next symbol of the map, and the table.
+Every call is checked against the reference, and measured from the call to the return.
+The cycles are fitted as call + length * per byte over buffers of 1..EMU_LENGTH_MAX bytes.
+
+Build (from this directory):
+  g++ -O2 -DHOST_BUILD -I../../src -I../host -I../emu51 crc_bench.cpp asm51.cpp ../emu51/cpu51.cpp \
+      ../host/host_stc8g.cpp -o crc_bench
+Run:
+  ./crc_bench [number of buffers]
+  ./crc_bench --emu [--asm <crc16.A51>] [--sdcc <TABLE256|NIBBLE> <build directory>]... [number of buffers]
+----------------------------------------------------------------------------------------*/
+
+/***************************************< Includes >**************************************/
+// Standard C libraries
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Own includes
+#include "types.h"
+#include "util.h"
+#include "cpu51.h"
+#include "asm51.h"
+
+// The implementations under test
+namespace Table256
+{
+#undef  CRC16_IMPLEMENTATION
+#define CRC16_IMPLEMENTATION  CRC16_TABLE256
+#include "util.c"
+}
+
+namespace Nibble
+{
+#undef  CRC16_IMPLEMENTATION
+#define CRC16_IMPLEMENTATION  CRC16_NIBBLE
+#include "util.c"
+}
+
+
+/***************************************< Definitions >**************************************/
+#define DEFAULT_BUFFERS_NUM  (200000u)  //!< Number of random buffers
+#define EMU_BUFFERS_NUM        (2000u)  //!< Number of random buffers in the emulator
+#define BUFFER_LENGTH_MAX       (255u)  //!< Maximum length of a buffer (length is a U8)
+#define CRC16_POLYNOMIAL     (0x1B2Bu)  //!< Generator polynomial of CRC-16F/3
+
+// Emulated image of crc16.A51
+#define EMU_LENGTH_MAX           (64u)  //!< Longest buffer in the emulator, it must fit the IDATA above the stack
+#define EMU_DRIVER_ADDRESS   (0x0000u)  //!< Test driver, from reset
+#define EMU_CLDPTR_ADDRESS   (0x0040u)  //!< ?C?CLDPTR equivalent
+#define EMU_CRC16_ADDRESS    (0x0100u)  //!< crc16.A51
+#define EMU_TABLE_ADDRESS    (0x0400u)  //!< gcau16CRC16F3Table
+#define EMU_CODE_BUFFER      (0x1E00u)  //!< Buffer in CODE, below the end of the flash (MOVC reads it)
+#define EMU_IDATA_BUFFER       (0x80u)  //!< Buffer in IDATA
+#define EMU_ARGUMENTS          (0x30u)  //!< R3, R2, R1, R5 of the call, read by the driver
+#define EMU_KEIL_IDATA         (0x00u)  //!< Keil generic pointer type of IDATA
+#define EMU_KEIL_CODE          (0xFFu)  //!< Keil generic pointer type of CODE
+
+// Emulated SDCC images
+#define EMU_SDCC_DRIVER      (0xF000u)  //!< Test driver, beyond the flash of the firmware
+#define EMU_SDCC_IDATA         (0x40u)  //!< SDCC generic pointer tag of DATA/IDATA
+#define EMU_STACK_DEPTH        (16u)    //!< Stack left for Util_CRC16() above the buffer
+
+#define EMU_RUN_TICKS  ( CPU51_MAIN_CLOCK_HZ / 100u )  //!< Longest run of a call: 10 ms
+#define EMU_VARIANTS_NUM          (4u)  //!< ASM in IDATA and in CODE, TABLE256, NIBBLE
+
+
+/***************************************< Types >**************************************/
+typedef U16 (*F_CRC16)( U8* pu8Buffer, U8 u8Length );
+
+//! \brief An implementation in the emulator
+typedef struct
+{
+  const char* pcName;       //!< Name in the report
+  Cpu51*      pcCpu;        //!< Emulator with the image loaded, NULL if it isn't available
+  BOOL        bSdcc;        //!< SDCC calling convention, otherwise Keil
+  U8          u8Type;       //!< Keil: generic pointer type of the buffer
+  U16         u16Buffer;    //!< Address of the buffer (IDATA, or CODE)
+  U8          u8Length;     //!< SDCC: IDATA address of the length parameter
+  U32         u32Code;      //!< Bytes of the routine
+  U32         u32Table;     //!< Bytes of the table
+  U32         u32Mismatches;  //!< Calls with a wrong result
+  double      adSums[ 5 ];  //!< Least squares sums: n, x, y, x*x, x*y (x: length, y: cycles)
+} S_EMU_VARIANT;
+
+
+/***************************************< Constants >**************************************/
+//! \brief Calls Util_CRC16() with the Keil register parameters from IDATA EMU_ARGUMENTS, then stops
+static const char gcacKeilDriver[] =
+  "        MOV     R3,EMU_ARGUMENTS\n"
+  "        MOV     R2,EMU_ARGUMENTS+1\n"
+  "        MOV     R1,EMU_ARGUMENTS+2\n"
+  "        MOV     R5,EMU_ARGUMENTS+3\n"
+  "        LCALL   _Util_CRC16\n"
+  "        SJMP    $\n";
+
+//! \brief The ?C?CLDPTR of the Keil C51 library: A = byte at the generic pointer R3:R2:R1
+static const char gcacKeilCldptr[] =
+  "?C?CLDPTR:\n"
+  "        CJNE    R3,#01H,?CLDPTR_NOT_XDATA\n"
+  "        MOV     DPL,R1\n"
+  "        MOV     DPH,R2\n"
+  "        MOVX    A,@DPTR\n"
+  "        RET\n"
+  "?CLDPTR_NOT_XDATA:\n"
+  "        JNC     ?CLDPTR_NOT_IDATA\n"
+  "        MOV     A,@R1\n"
+  "        RET\n"
+  "?CLDPTR_NOT_IDATA:\n"
+  "        CJNE    R3,#0FEH,?CLDPTR_CODE\n"
+  "        MOVX    A,@R1\n"
+  "        RET\n"
+  "?CLDPTR_CODE:\n"
+  "        MOV     DPL,R1\n"
+  "        MOV     DPH,R2\n"
+  "        CLR     A\n"
+  "        MOVC    A,@A+DPTR\n"
+  "        RET\n";
+
+//! \brief Calls Util_CRC16() with the SDCC parameters: buffer in IDATA, length set by the bench; then stops
+static const char gcacSdccDriver[] =
+  "        MOV     SP,#EMU_STACK\n"
+  "        MOV     DPL,#LOW( EMU_BUFFER )\n"
+  "        MOV     DPH,#HIGH( EMU_BUFFER )\n"
+  "        MOV     B,#EMU_TAG\n"
+  "        LCALL   _Util_CRC16\n"
+  "        SJMP    $\n";
+
+
+/***************************************< Global variables >**************************************/
+static U8  gau8Buffer[ BUFFER_LENGTH_MAX ];  //!< Buffer under test
+static S_EMU_VARIANT gasVariants[ EMU_VARIANTS_NUM ] =  //!< Implementations in the emulator
+{
+  { "ASM",        NULL, FALSE, EMU_KEIL_IDATA, EMU_IDATA_BUFFER, 0u, 0u, 0u, 0u, { 0.0 } },
+  { "ASM (CODE)", NULL, FALSE, EMU_KEIL_CODE,  EMU_CODE_BUFFER,  0u, 0u, 0u, 0u, { 0.0 } },
+  { "TABLE256",   NULL, TRUE,  0u,             0u,               0u, 0u, 0u, 0u, { 0.0 } },
+  { "NIBBLE",     NULL, TRUE,  0u,             0u,               0u, 0u, 0u, 0u, { 0.0 } },
+};
+
+
+/***************************************< Stubs >**************************************/
+//----------------------------------------------------------------------------
+//! \brief  Stub for the global declaration in util.h (the namespaced copies of util.c call it)
+//! \return Unused
+//-----------------------------------------------------------------------------
+char CODE* Util_Get_UID_ptr( void )
+{
+  return NULL;
+}
+
+
+/***************************************< Static functions >**************************************/
+//----------------------------------------------------------------------------
+//! \brief  Bit-by-bit reference CRC-16F/3
+//! \param  *pu8Buffer: given buffer
+//! \param  u8Length: length of the buffer
+//! \return CRC16 value
+//-----------------------------------------------------------------------------
+static U16 ReferenceCRC16( U8* pu8Buffer, U8 u8Length )
+{
+  U16 u16Crc = 0xBD26u;
+  U8  u8Idx;
+  U8  u8Bit;
+
+  for( u8Idx = 0; u8Idx != u8Length; u8Idx++ )
+  {
+    u16Crc ^= (U16)( pu8Buffer[ u8Idx ] << 8u );
+    for( u8Bit = 0u; u8Bit < 8u; u8Bit++ )
+    {
+      if( u16Crc & 0x8000u )
+      {
+        u16Crc = (U16)( u16Crc << 1u ) ^ CRC16_POLYNOMIAL;
+      }
+      else
+      {
+        u16Crc = (U16)( u16Crc << 1u );
+      }
+    }
+  }
+  return u16Crc;
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Measures the host time of a CRC implementation
+//! \param  pfCRC16: implementation under test
+//! \param  u32Buffers: number of buffers
+//! \return Average time of one byte in nanoseconds
+//-----------------------------------------------------------------------------
+static double MeasureNsPerByte( F_CRC16 pfCRC16, U32 u32Buffers )
+{
+  struct timespec sStart;
+  struct timespec sEnd;
+  U32 u32Idx;
+  U32 u32Bytes = 0u;
+  volatile U16 u16Sink = 0u;
+
+  clock_gettime( CLOCK_MONOTONIC, &sStart );
+  for( u32Idx = 0u; u32Idx < u32Buffers; u32Idx++ )
+  {
+    gau8Buffer[ 0 ] = (U8)u32Idx;  // Defeat hoisting the call out of the loop
+    u16Sink ^= pfCRC16( gau8Buffer, BUFFER_LENGTH_MAX );
+    u32Bytes += BUFFER_LENGTH_MAX;
+  }
+  clock_gettime( CLOCK_MONOTONIC, &sEnd );
+
+  return ( ( sEnd.tv_sec - sStart.tv_sec ) * 1e9 + ( sEnd.tv_nsec - sStart.tv_nsec ) ) / u32Bytes;
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Builds the image of crc16.A51 with its driver, the table and ?C?CLDPTR
+//! \param  pcSource: crc16.A51
+//! \return TRUE if it could be assembled
+//! \global gasVariants[] (the ASM ones)
+//-----------------------------------------------------------------------------
+static BOOL BuildAsmImage( const char* pcSource )
+{
+  Asm51  cAsm;
+  Cpu51* pcCpu = new Cpu51();
+  BOOL   bResult;
+  U16    u16Crc16 = 0u;
+  U32    u32Index;
+
+  memset( pcCpu->mau8Code, 0xFF, sizeof( pcCpu->mau8Code ) );
+  // The table as Keil lays it out: big-endian entries
+  for( u32Index = 0u; u32Index < 256u; u32Index++ )
+  {
+    pcCpu->mau8Code[ EMU_TABLE_ADDRESS + ( 2u * u32Index ) ] = (U8)( Table256::gcau16CRC16F3Table[ u32Index ] >> 8u );
+    pcCpu->mau8Code[ EMU_TABLE_ADDRESS + ( 2u * u32Index ) + 1u ] = (U8)Table256::gcau16CRC16F3Table[ u32Index ];
+  }
+  bResult = cAsm.Define( "gcau16CRC16F3Table", EMU_TABLE_ADDRESS ) && cAsm.Define( "EMU_ARGUMENTS", EMU_ARGUMENTS )
+         && cAsm.AssembleText( gcacKeilCldptr, EMU_CLDPTR_ADDRESS, pcCpu->mau8Code )
+         && cAsm.AssembleFile( pcSource, EMU_CRC16_ADDRESS, pcCpu->mau8Code );
+  for( u32Index = 0u; u32Index < 2u; u32Index++ )
+  {
+    gasVariants[ u32Index ].u32Code = cAsm.mu16Size;
+    gasVariants[ u32Index ].u32Table = sizeof( Table256::gcau16CRC16F3Table );
+  }
+  bResult = bResult && cAsm.AssembleText( gcacKeilDriver, EMU_DRIVER_ADDRESS, pcCpu->mau8Code )
+         && cAsm.Lookup( "_Util_CRC16", &u16Crc16 ) && pcCpu->Watch( u16Crc16 );
+  if( !bResult )
+  {
+    fprintf( stderr, "%s: %s\n", pcSource, ( '\0' != cAsm.macError[ 0 ] ) ? cAsm.macError : "no _Util_CRC16" );
+    delete pcCpu;
+  }
+  else
+  {
+    gasVariants[ 0 ].pcCpu = pcCpu;
+    gasVariants[ 1 ].pcCpu = pcCpu;  // Same image, the buffer is elsewhere
+  }
+  return bResult;
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Finds a symbol in an SDCC map, and the next code symbol after it
+//! \param  pcFileName: the map
+//! \param  pcName: name of the symbol
+//! \param  pu16Address: its address
+//! \param  pu16Next: address of the next code symbol, 0xFFFF if there's none
+//! \return TRUE if the symbol is there
+//! \note   "     C:   00000A5E  _Util_CRC16    util"; the data symbols may have no "C:"
+//-----------------------------------------------------------------------------
+static BOOL FindMapSymbol( const char* pcFileName, const char* pcName, U16* pu16Address, U16* pu16Next )
+{
+  BOOL  bFound = FALSE;
+  FILE* pFile = fopen( pcFileName, "r" );
+  char  acLine[ 512 ];
+  char  acName[ 64 ];
+  char  acSpace[ 2 ];
+  unsigned int uiAddress;
+  BOOL  bCode;
+
+  *pu16Next = 0xFFFFu;
+  while( ( NULL != pFile ) && ( NULL != fgets( acLine, sizeof( acLine ), pFile ) ) )
+  {
+    bCode = ( 3 == sscanf( acLine, " %1[C]: %8x %63s", acSpace, &uiAddress, acName ) );
+    if( bCode || ( 2 == sscanf( acLine, " %*1[A-Z]: %8x %63s", &uiAddress, acName ) )
+     || ( 2 == sscanf( acLine, " %8x %63s", &uiAddress, acName ) ) )
+    {
+      if( 0 == strcmp( acName, pcName ) )
+      {
+        *pu16Address = (U16)uiAddress;
+        bFound = TRUE;
+      }
+      acName[ 0 ] = '\0';
+    }
+  }
+  // The next code symbol: a second pass, the map is sorted by name or by address depending on the linker
+  if( bFound && ( NULL != pFile ) )
+  {
+    rewind( pFile );
+    while( NULL != fgets( acLine, sizeof( acLine ), pFile ) )
+    {
+      if( ( 3 == sscanf( acLine, " %1[C]: %8x %63s", acSpace, &uiAddress, acName ) )
+       && ( uiAddress > *pu16Address ) && ( uiAddress < *pu16Next ) )
+      {
+        *pu16Next = (U16)uiAddress;
+      }
+    }
+  }
+  if( NULL != pFile )
+  {
+    fclose( pFile );
+  }
+  return bFound;
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Loads the SDCC build of a C implementation, and redirects its reset vector to the driver
+//! \param  psVariant: the implementation
+//! \param  pcDirectory: build directory with karifa.hex, .map and .mem
+//! \return TRUE if it could be loaded
+//-----------------------------------------------------------------------------
+static BOOL LoadSdccImage( S_EMU_VARIANT* psVariant, const char* pcDirectory )
+{
+  Asm51  cAsm;
+  Cpu51* pcCpu = new Cpu51();
+  BOOL   bResult;
+  char   acFile[ 512 ];
+  char   acLine[ 256 ];
+  FILE*  pFile;
+  U16    u16Crc16 = 0u;
+  U16    u16Next = 0xFFFFu;
+  U16    u16Length = 0u;
+  U16    u16Unused;
+  unsigned int uiStack = 0x100u;
+
+  snprintf( acFile, sizeof( acFile ), "%s/karifa.hex", pcDirectory );
+  bResult = pcCpu->LoadHex( acFile );
+  // Stack of the firmware: the buffer goes there
+  snprintf( acFile, sizeof( acFile ), "%s/karifa.mem", pcDirectory );
+  pFile = fopen( acFile, "r" );
+  while( ( NULL != pFile ) && ( NULL != fgets( acLine, sizeof( acLine ), pFile ) ) )
+  {
+    (void)sscanf( acLine, "Stack starts at: %x", &uiStack );
+  }
+  if( NULL != pFile )
+  {
+    fclose( pFile );
+  }
+  snprintf( acFile, sizeof( acFile ), "%s/karifa.map", pcDirectory );
+  bResult = bResult && ( ( uiStack + EMU_LENGTH_MAX + EMU_STACK_DEPTH ) <= 0x100u )
+         && FindMapSymbol( acFile, "_Util_CRC16", &u16Crc16, &u16Next )
+         && FindMapSymbol( acFile, "_Util_CRC16_PARM_2", &u16Length, &u16Unused );
+  bResult = bResult && cAsm.Define( "_Util_CRC16", u16Crc16 ) && cAsm.Define( "EMU_BUFFER", (U16)uiStack )
+         && cAsm.Define( "EMU_STACK", (U16)( uiStack + EMU_LENGTH_MAX - 1u ) ) && cAsm.Define( "EMU_TAG", EMU_SDCC_IDATA )
+         && cAsm.AssembleText( gcacSdccDriver, EMU_SDCC_DRIVER, pcCpu->mau8Code ) && pcCpu->Watch( u16Crc16 );
+  if( !bResult )
+  {
+    fprintf( stderr, "%s: no SDCC build with _Util_CRC16 and room for the buffer above the stack\n", pcDirectory );
+    delete pcCpu;
+  }
+  else
+  {
+    pcCpu->mau8Code[ 0 ] = 0x02u;  // LJMP EMU_SDCC_DRIVER
+    pcCpu->mau8Code[ 1 ] = (U8)( EMU_SDCC_DRIVER >> 8u );
+    pcCpu->mau8Code[ 2 ] = (U8)EMU_SDCC_DRIVER;
+    psVariant->pcCpu = pcCpu;
+    psVariant->u16Buffer = (U16)uiStack;
+    psVariant->u8Length = (U8)u16Length;
+    psVariant->u32Code = ( 0xFFFFu != u16Next ) ? (U32)( u16Next - u16Crc16 ) : 0u;
+    psVariant->u32Table = ( psVariant == &gasVariants[ 2 ] ) ? sizeof( Table256::gcau16CRC16F3Table )
+                                                            : sizeof( Nibble::gcau16CRC16F3NibbleTable );
+  }
+  return bResult;
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Runs one call of an implementation in the emulator
+//! \param  psVariant: the implementation
+//! \param  u8Length: length of gau8Buffer[]
+//! \param  pu32Cycles: cycles from the call to the return
+//! \return The CRC, or the complement of the reference if the call didn't return
+//-----------------------------------------------------------------------------
+static U16 EmulateCRC16( S_EMU_VARIANT* psVariant, U8 u8Length, U32* pu32Cycles )
+{
+  Cpu51* pcCpu = psVariant->pcCpu;
+  U16    u16Crc;
+
+  pcCpu->Reset();
+  if( psVariant->bSdcc )
+  {
+    memcpy( &pcCpu->mau8Iram[ psVariant->u16Buffer ], gau8Buffer, u8Length );
+    pcCpu->mau8Iram[ psVariant->u8Length ] = u8Length;
+  }
+  else
+  {
+    if( EMU_KEIL_CODE == psVariant->u8Type )
+    {
+      memcpy( &pcCpu->mau8Code[ psVariant->u16Buffer ], gau8Buffer, u8Length );
+    }
+    else
+    {
+      memcpy( &pcCpu->mau8Iram[ psVariant->u16Buffer ], gau8Buffer, u8Length );
+    }
+    pcCpu->mau8Iram[ EMU_ARGUMENTS ] = psVariant->u8Type;
+    pcCpu->mau8Iram[ EMU_ARGUMENTS + 1u ] = (U8)( psVariant->u16Buffer >> 8u );
+    pcCpu->mau8Iram[ EMU_ARGUMENTS + 2u ] = (U8)psVariant->u16Buffer;
+    pcCpu->mau8Iram[ EMU_ARGUMENTS + 3u ] = u8Length;
+  }
+  if( ( CPU51_STOP_HALT == pcCpu->Run( EMU_RUN_TICKS ) ) && ( 1u == pcCpu->masWatches[ 0 ].u32Calls ) )
+  {
+    // SDCC: DPH:DPL; Keil: R6:R7 of register bank 0
+    u16Crc = psVariant->bSdcc ? (U16)( ( pcCpu->mau8Sfr[ 0x83u - 0x80u ] << 8u ) | pcCpu->mau8Sfr[ 0x82u - 0x80u ] )
+                              : (U16)( ( pcCpu->mau8Iram[ 6 ] << 8u ) | pcCpu->mau8Iram[ 7 ] );
+    *pu32Cycles = (U32)pcCpu->masWatches[ 0 ].u64Cycles;
+  }
+  else
+  {
+    u16Crc = (U16)~ReferenceCRC16( gau8Buffer, u8Length );
+    *pu32Cycles = 0u;
+  }
+  return u16Crc;
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Runs every available implementation in the emulator on random buffers, prints the report
+//! \param  u32Buffers: number of buffers
+//! \return Number of wrong results
+//! \global gasVariants[], gau8Buffer[]
+//-----------------------------------------------------------------------------
+static U32 RunEmulated( U32 u32Buffers )
+{
+  U32    u32Failures = 0u;
+  U32    u32Idx;
+  U32    u32Variant;
+  U32    u32Cycles;
+  U8     u8Length;
+  U8     u8Byte;
+  U16    u16Expected;
+  double dSlope;
+  S_EMU_VARIANT* psVariant;
+
+  for( u32Idx = 0u; u32Idx < u32Buffers; u32Idx++ )
+  {
+    u8Length = (U8)( ( u32Idx % EMU_LENGTH_MAX ) + 1u );  // Every length equally
+    for( u8Byte = 0u; u8Byte < u8Length; u8Byte++ )
+    {
+      gau8Buffer[ u8Byte ] = (U8)rand();
+    }
+    u16Expected = ReferenceCRC16( gau8Buffer, u8Length );
+    for( u32Variant = 0u; u32Variant < EMU_VARIANTS_NUM; u32Variant++ )
+    {
+      psVariant = &gasVariants[ u32Variant ];
+      if( NULL != psVariant->pcCpu )
+      {
+        if( EmulateCRC16( psVariant, u8Length, &u32Cycles ) != u16Expected )
+        {
+          psVariant->u32Mismatches++;
+          u32Failures++;
+        }
+        psVariant->adSums[ 0 ] += 1.0;
+        psVariant->adSums[ 1 ] += u8Length;
+        psVariant->adSums[ 2 ] += u32Cycles;
+        psVariant->adSums[ 3 ] += (double)u8Length * u8Length;
+        psVariant->adSums[ 4 ] += (double)u8Length * u32Cycles;
+      }
+    }
+  }
+
+  printf( "Emulated STC8G1K08 (1T timing), %u buffers of 1..%u bytes\n", u32Buffers, EMU_LENGTH_MAX );
+  printf( "%-10s %12s %13s %13s %13s %10s\n", "Variant", "Code [bytes]", "Table [bytes]", "Call [cycles]", "Byte [cycles]", "Mismatches" );
+  for( u32Variant = 0u; u32Variant < EMU_VARIANTS_NUM; u32Variant++ )
+  {
+    psVariant = &gasVariants[ u32Variant ];
+    if( NULL == psVariant->pcCpu )
+    {
+      printf( "%-10s %12s\n", psVariant->pcName, "not built (SDCC image, see make crc-bench)" );
+    }
+    else
+    {
+      const double* pcdSums = psVariant->adSums;
+      dSlope = ( ( pcdSums[ 0 ] * pcdSums[ 4 ] ) - ( pcdSums[ 1 ] * pcdSums[ 2 ] ) )
+             / ( ( pcdSums[ 0 ] * pcdSums[ 3 ] ) - ( pcdSums[ 1 ] * pcdSums[ 1 ] ) );
+      printf( "%-10s %12u %13u %13.1f %13.2f %10u\n", psVariant->pcName, psVariant->u32Code, psVariant->u32Table,
+              ( pcdSums[ 2 ] - ( dSlope * pcdSums[ 1 ] ) ) / pcdSums[ 0 ], dSlope, psVariant->u32Mismatches );
+    }
+  }
+  printf( "ASM (CODE) reads through an equivalent of ?C?CLDPTR, its bytes aren't counted\n" );
+  return u32Failures;
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Checks the C implementations on the host, and times them
+//! \param  u32Buffers: number of buffers
+//! \return Number of wrong results
+//! \global gau8Buffer[]
+//-----------------------------------------------------------------------------
+static U32 RunHost( U32 u32Buffers )
+{
+  U32 u32Idx;
+  U32 u32Failures = 0u;
+  U8  u8Length;
+  U8  u8Byte;
+  U16 u16Expected;
+
+  // Correctness: every implementation must give the reference result
+  for( u32Idx = 0u; u32Idx < u32Buffers; u32Idx++ )
+  {
+    u8Length = (U8)( rand() % ( BUFFER_LENGTH_MAX + 1u ) );
+    for( u8Byte = 0u; u8Byte < u8Length; u8Byte++ )
+    {
+      gau8Buffer[ u8Byte ] = (U8)rand();
+    }
+    u16Expected = ReferenceCRC16( gau8Buffer, u8Length );
+    if( ( Table256::Util_CRC16( gau8Buffer, u8Length ) != u16Expected )
+     || ( Nibble::Util_CRC16( gau8Buffer, u8Length ) != u16Expected ) )
+    {
+      u32Failures++;
+    }
+  }
+  printf( "Checked %u buffers, %u mismatches\n", u32Buffers, u32Failures );
+
+  // Speed and size; the target numbers come from --emu
+  printf( "%-10s %14s %16s\n", "Variant", "Table [bytes]", "Host [ns/byte]" );
+  printf( "%-10s %14u %16.2f\n", "TABLE256", (U32)sizeof( Table256::gcau16CRC16F3Table ),
+          MeasureNsPerByte( Table256::Util_CRC16, u32Buffers / 10u ) );
+  printf( "%-10s %14u %16.2f\n", "NIBBLE", (U32)sizeof( Nibble::gcau16CRC16F3NibbleTable ),
+          MeasureNsPerByte( Nibble::Util_CRC16, u32Buffers / 10u ) );
+  return u32Failures;
+}
+
+
+/***************************************< Public functions >**************************************/
+int main( int argc, char** argv )
+{
+  U32  u32Buffers = 0u;
+  U32  u32Failures;
+  BOOL bEmulated = FALSE;
+  BOOL bResult = TRUE;
+  const char* pcAsm = "../../src/crc16.A51";
+  int  iArg;
+
+  for( iArg = 1; iArg < argc; iArg++ )
+  {
+    if( 0 == strcmp( argv[ iArg ], "--emu" ) )
+    {
+      bEmulated = TRUE;
+    }
+    else if( ( 0 == strcmp( argv[ iArg ], "--asm" ) ) && ( ( iArg + 1 ) < argc ) )
+    {
+      pcAsm = argv[ ++iArg ];
+    }
+    else if( ( 0 == strcmp( argv[ iArg ], "--sdcc" ) ) && ( ( iArg + 2 ) < argc ) )
+    {
+      iArg += 2;
+      if( 0 == strcmp( argv[ iArg - 1 ], "TABLE256" ) )
+      {
+        bResult = bResult && LoadSdccImage( &gasVariants[ 2 ], argv[ iArg ] );
+      }
+      else if( 0 == strcmp( argv[ iArg - 1 ], "NIBBLE" ) )
+      {
+        bResult = bResult && LoadSdccImage( &gasVariants[ 3 ], argv[ iArg ] );
+      }
+      else
+      {
+        fprintf( stderr, "Unknown variant: %s\n", argv[ iArg - 1 ] );
+        bResult = FALSE;
+      }
+    }
+    else
+    {
+      u32Buffers = (U32)strtoul( argv[ iArg ], NULL, 0 );
+    }
+  }
+  srand( 1u );
+
+  if( !bResult )
+  {
+    u32Failures = 1u;
+  }
+  else if( bEmulated )
+  {
+    u32Failures = BuildAsmImage( pcAsm ) ? RunEmulated( ( 0u != u32Buffers ) ? u32Buffers : EMU_BUFFERS_NUM ) : 1u;
+  }
+  else
+  {
+    u32Failures = RunHost( ( 0u != u32Buffers ) ? u32Buffers : DEFAULT_BUFFERS_NUM );
+  }
+  return ( 0u == u32Failures ) ? 0 : 1;
+}
+
+/***************************************< End of file >**************************************/
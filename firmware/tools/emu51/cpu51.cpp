@@ -0,0 +1,1833 @@
+/*! *******************************************************************************************************
+* Copyright (c) 2022 Hekk_Elek
+*
+* \file cpu51.cpp
+*
+* \brief Emulation of the STC8G1K08: 8051 core with the STC 1T instruction timing and the used peripherals
+*
+* \author Hekk_Elek
+*
+**********************************************************************************************************/
+
+/*----------------------------------------------------------------------------------------
+How it works
+============
+Time is counted in ticks of the 24 MHz main clock; one instruction cycle is CLKDIV ticks.
+After each instruction the peripherals are advanced by its cycles in one go: timer 0 and
+timer 1 (16-bit auto-reload, 16-bit and 8-bit auto-reload modes, 1T or 12T), the UART1
+transmitter (only its timing, from timer 2 or timer 1), the ADC conversion and the CPU
+stalls of the IAP EEPROM. Then the interrupt flags are checked with the two priority bits
+(IP, IPH), like the hardware does.
+
+The idle mode (PCON.0) doesn't execute anything until the next event, so the emulator jumps
+there at once: to the next timer overflow, end of UART byte, end of ADC conversion or
+scheduled input change. The power-down mode (PCON.1) stops the system clock; only the
+wake-up timer (WKTCL/WKTCH, counting at mu32WktHz) and the INT2 pin (the button) can end
+it; after the wake-up, reading WKTCL/WKTCH gives the counts elapsed in it. A power-down without either of them is reported as turned off. So an hour spent in
+the low-power modes costs almost nothing, the speed of the emulation depends on the
+active cycles only.
+
+The port latches of P1, P3 and P5 are ANDed with the levels driven from the outside
+(open drain / quasi-bidirectional pins): that is what reading the port gives, and the
+read-modify-write instructions use the latch, like on the real chip. Every change of a
+pin is counted, its low time summed, and passed to the optional callback (waveforms).
+
+The watched functions (Watch()) are measured together with their callees: from the cycle
+after their LCALL/ACALL to their RET, recognized by the stack pointer. The interrupts
+served meanwhile are subtracted, so the result is the worst case of the function itself.
+
+The STC8G instruction timing table below is transcribed from the datasheet: most of the
+instructions take one cycle, conditional jumps take extra cycles when taken. The not
+emulated peripherals (PCA, SPI, I2C, comparator, watchdog, ports P0/P2/P4) are plain
+registers.
+----------------------------------------------------------------------------------------*/
+
+/***************************************< Includes >**************************************/
+// Standard C libraries
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Own includes
+#include "cpu51.h"
+
+
+/***************************************< Definitions >**************************************/
+// Special function registers, as indices of mau8Sfr[]
+#define SFR( u8Address )   ( (U8)( (u8Address) - 0x80u ) )
+#define R_SP          SFR( 0x81u )
+#define R_DPL         SFR( 0x82u )
+#define R_DPH         SFR( 0x83u )
+#define R_PCON        SFR( 0x87u )
+#define R_TCON        SFR( 0x88u )
+#define R_TMOD        SFR( 0x89u )
+#define R_TL0         SFR( 0x8Au )
+#define R_TL1         SFR( 0x8Bu )
+#define R_TH0         SFR( 0x8Cu )
+#define R_TH1         SFR( 0x8Du )
+#define R_AUXR        SFR( 0x8Eu )
+#define R_INTCLKO     SFR( 0x8Fu )
+#define R_P1          SFR( 0x90u )
+#define R_SCON        SFR( 0x98u )
+#define R_SBUF        SFR( 0x99u )
+#define R_P2          SFR( 0xA0u )
+#define R_IE          SFR( 0xA8u )
+#define R_WKTCL       SFR( 0xAAu )
+#define R_WKTCH       SFR( 0xABu )
+#define R_P3          SFR( 0xB0u )
+#define R_IPH         SFR( 0xB7u )
+#define R_IP          SFR( 0xB8u )
+#define R_P_SW2       SFR( 0xBAu )
+#define R_ADC_CONTR   SFR( 0xBCu )
+#define R_ADC_RES     SFR( 0xBDu )
+#define R_ADC_RESL    SFR( 0xBEu )
+#define R_IAP_DATA    SFR( 0xC2u )
+#define R_IAP_ADDRH   SFR( 0xC3u )
+#define R_IAP_ADDRL   SFR( 0xC4u )
+#define R_IAP_CMD     SFR( 0xC5u )
+#define R_IAP_TRIG    SFR( 0xC6u )
+#define R_IAP_CONTR   SFR( 0xC7u )
+#define R_P5          SFR( 0xC8u )
+#define R_PSW         SFR( 0xD0u )
+#define R_T2H         SFR( 0xD6u )
+#define R_T2L         SFR( 0xD7u )
+#define R_ADCCFG      SFR( 0xDEu )
+#define R_ACC         SFR( 0xE0u )
+#define R_DPS         SFR( 0xE3u )
+#define R_DPL1        SFR( 0xE4u )
+#define R_DPH1        SFR( 0xE5u )
+#define R_AUXINTIF    SFR( 0xEFu )
+#define R_B           SFR( 0xF0u )
+
+// Extended SFRs, as indices of mau8Xsfr[]
+#define XSFR_BASE     (0xFD00u)  //!< Address of the first extended SFR
+#define X_CLKDIV      (0xFE01u - XSFR_BASE)
+#define X_ADCTIM      (0xFEA8u - XSFR_BASE)
+
+// Bits
+#define PSW_CY        (0x80u)
+#define PSW_AC        (0x40u)
+#define PSW_OV        (0x04u)
+#define PSW_P         (0x01u)
+#define PCON_IDL      (0x01u)
+#define PCON_PD       (0x02u)
+#define IE_EA         (0x80u)
+#define P_SW2_EAXFR   (0x80u)
+#define WKTCH_WKTEN   (0x80u)
+#define INT2_MASK     (0x10u)  //!< EX2 in INTCLKO, INT2IF in AUXINTIF
+#define ADC_POWER     (0x80u)
+#define ADC_START     (0x40u)
+#define ADC_FLAG      (0x20u)
+#define IAP_IAPEN     (0x80u)
+#define IAP_CMD_FAIL  (0x10u)
+
+// Interrupt vectors (number = ( address - 3 ) / 8)
+#define VECTOR_TIMER0  (1u)
+#define VECTOR_TIMER1  (3u)
+#define VECTOR_UART1   (4u)
+#define VECTOR_ADC     (5u)
+#define VECTOR_INT2   (10u)
+
+// Timing
+#define CYCLES_TAKEN_JUMP    (2u)  //!< Extra cycles of a taken JZ, JNZ, JC, JNC, JB, JNB, JBC
+#define CYCLES_TAKEN_LOOP    (1u)  //!< Extra cycles of a taken CJNE, DJNZ
+#define CYCLES_INTERRUPT     (3u)  //!< Hardware call of an interrupt vector
+#define IAP_PROGRAM_US       (6u)  //!< CPU stall while programming a byte
+#define IAP_ERASE_US      (4000u)  //!< CPU stall while erasing a page
+#define IAP_READ_CYCLES      (2u)  //!< CPU stall while reading a byte
+#define ADC_CONVERSION_BITS (10u)  //!< ADC clocks of the successive approximation
+#define ADC_REFERENCE_VOLTS  (1.19)  //!< Internal reference, on ADC channel 15
+#define ADC_CHANNEL_REFERENCE (15u)  //!< ADC channel of the internal reference
+#define UART_FRAME_BITS     (10u)  //!< Start, 8 data, stop
+#define EVENT_NONE  (0x40000000u)  //!< "Never" for CyclesToNextEvent(), small enough to add to anything
+
+// Second operand of the arithmetic and logic rows (ADD, ADDC, ORL, ANL, XRL, SUBB A,src)
+#define OPERAND_NONE       (0u)  //!< Not an arithmetic or logic row
+#define OPERAND_IMMEDIATE  (1u)  //!< #data
+#define OPERAND_DIRECT     (2u)  //!< direct
+#define OPERAND_INDIRECT   (3u)  //!< @Ri
+#define OPERAND_REGISTER   (4u)  //!< Rn
+
+// Factory data
+#define IDATA_WKT_FREQUENCY  (0xF8u)   //!< Big-endian WKT frequency in Hz, measured by the factory
+#define CODE_UID         (0x1FF9u)     //!< 7-byte unique ID at the end of the program memory
+#define MAX_INPUTS       (4096u)       //!< Maximum number of scheduled input changes
+
+
+/***************************************< Constants >**************************************/
+//! \brief SFR address of each emulated port
+static const U8 gcau8PortSfr[ CPU51_PORTS_NUM ] = { R_P1, R_P3, R_P5 };
+
+
+/***************************************< Global variables >**************************************/
+static U8 gau8Cycles[ 256 ];   //!< Cycles of each opcode (not taken, for the conditional jumps)
+static U8 gau8Operand[ 256 ];  //!< Second operand of the arithmetic and logic rows, OPERAND_xx
+
+
+/***************************************< Static function definitions >**************************************/
+static void BuildTables( void );
+static U8   HexByte( const char* pcText );
+
+
+/***************************************< Static functions >**************************************/
+//----------------------------------------------------------------------------
+//! \brief  Fills the instruction timing table of the STC8G (STC-Y6 core) and the decoding table
+//! \param  -
+//! \return -
+//! \global gau8Cycles[], gau8Operand[]
+//-----------------------------------------------------------------------------
+static void BuildTables( void )
+{
+  U16 u16Op;
+  U8  u8Row;
+  U8  u8Column;
+
+  memset( gau8Cycles, 1, sizeof( gau8Cycles ) );
+  memset( gau8Operand, OPERAND_NONE, sizeof( gau8Operand ) );
+  for( u16Op = 0u; u16Op < 256u; u16Op++ )
+  {
+    u8Row = (U8)( u16Op >> 4u );
+    u8Column = (U8)( u16Op & 0x0Fu );
+    if( ( u8Column >= 4u ) && ( ( ( u8Row >= 2u ) && ( u8Row <= 6u ) ) || ( 9u == u8Row ) ) )
+    {
+      gau8Operand[ u16Op ] = ( 4u == u8Column ) ? OPERAND_IMMEDIATE
+                           : ( ( 5u == u8Column ) ? OPERAND_DIRECT
+                           : ( ( u8Column < 8u ) ? OPERAND_INDIRECT : OPERAND_REGISTER ) );
+    }
+
+    if( ( 0x01u == ( u16Op & 0x1Fu ) ) || ( 0x11u == ( u16Op & 0x1Fu ) ) )
+    {
+      gau8Cycles[ u16Op ] = 3u;  // AJMP, ACALL
+    }
+    else if( ( u16Op >= 0xB8u ) && ( u16Op <= 0xBFu ) )
+    {
+      gau8Cycles[ u16Op ] = 2u;  // CJNE Rn,#data,rel
+    }
+    else if( ( u16Op >= 0xD8u ) && ( u16Op <= 0xDFu ) )
+    {
+      gau8Cycles[ u16Op ] = 2u;  // DJNZ Rn,rel
+    }
+  }
+  gau8Cycles[ 0x02u ] = 3u;  // LJMP
+  gau8Cycles[ 0x12u ] = 3u;  // LCALL
+  gau8Cycles[ 0x22u ] = 3u;  // RET
+  gau8Cycles[ 0x32u ] = 3u;  // RETI
+  gau8Cycles[ 0x80u ] = 3u;  // SJMP
+  gau8Cycles[ 0x73u ] = 4u;  // JMP @A+DPTR
+  gau8Cycles[ 0x05u ] = 2u;  // INC direct
+  gau8Cycles[ 0x06u ] = 2u;  // INC @R0
+  gau8Cycles[ 0x07u ] = 2u;  // INC @R1
+  gau8Cycles[ 0x15u ] = 2u;  // DEC direct
+  gau8Cycles[ 0x16u ] = 2u;  // DEC @R0
+  gau8Cycles[ 0x17u ] = 2u;  // DEC @R1
+  gau8Cycles[ 0x42u ] = 2u;  // ORL direct,A
+  gau8Cycles[ 0x43u ] = 2u;  // ORL direct,#data
+  gau8Cycles[ 0x52u ] = 2u;  // ANL direct,A
+  gau8Cycles[ 0x53u ] = 2u;  // ANL direct,#data
+  gau8Cycles[ 0x62u ] = 2u;  // XRL direct,A
+  gau8Cycles[ 0x63u ] = 2u;  // XRL direct,#data
+  gau8Cycles[ 0x85u ] = 2u;  // MOV direct,direct
+  gau8Cycles[ 0x92u ] = 2u;  // MOV bit,C
+  gau8Cycles[ 0xB2u ] = 2u;  // CPL bit
+  gau8Cycles[ 0xC2u ] = 2u;  // CLR bit
+  gau8Cycles[ 0xD2u ] = 2u;  // SETB bit
+  gau8Cycles[ 0xA4u ] = 2u;  // MUL AB
+  gau8Cycles[ 0x84u ] = 6u;  // DIV AB
+  gau8Cycles[ 0xD4u ] = 3u;  // DA A
+  gau8Cycles[ 0x83u ] = 3u;  // MOVC A,@A+PC
+  gau8Cycles[ 0x93u ] = 4u;  // MOVC A,@A+DPTR
+  gau8Cycles[ 0xE0u ] = 2u;  // MOVX A,@DPTR
+  gau8Cycles[ 0xF0u ] = 2u;  // MOVX @DPTR,A
+  gau8Cycles[ 0xE2u ] = 3u;  // MOVX A,@R0
+  gau8Cycles[ 0xE3u ] = 3u;  // MOVX A,@R1
+  gau8Cycles[ 0xF2u ] = 3u;  // MOVX @R0,A
+  gau8Cycles[ 0xF3u ] = 3u;  // MOVX @R1,A
+  gau8Cycles[ 0xB5u ] = 2u;  // CJNE A,direct,rel
+  gau8Cycles[ 0xB6u ] = 2u;  // CJNE @R0,#data,rel
+  gau8Cycles[ 0xB7u ] = 2u;  // CJNE @R1,#data,rel
+  gau8Cycles[ 0xD5u ] = 2u;  // DJNZ direct,rel
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Converts two hexadecimal digits
+//! \param  pcText: the digits
+//! \return Value of the digits
+//! \global -
+//-----------------------------------------------------------------------------
+static U8 HexByte( const char* pcText )
+{
+  char acDigits[ 3 ] = { pcText[ 0 ], pcText[ 1 ], 0 };
+  return (U8)strtoul( acDigits, NULL, 16 );
+}
+
+
+/***************************************< Private functions >**************************************/
+//----------------------------------------------------------------------------
+//! \brief  Reads a byte of the program memory; the EEPROM follows the program (MOVC)
+//! \param  u16Address: address in the code space
+//! \return The byte
+//-----------------------------------------------------------------------------
+U8 Cpu51::ReadCode( U16 u16Address )
+{
+  U8 u8Value = 0xFFu;
+
+  if( u16Address < CPU51_FLASH_SIZE )
+  {
+    u8Value = mau8Code[ u16Address ];
+  }
+  else if( u16Address < ( CPU51_FLASH_SIZE + CPU51_EEPROM_SIZE ) )
+  {
+    u8Value = mau8Eeprom[ u16Address - CPU51_FLASH_SIZE ];
+  }
+  else
+  {
+    // Not implemented memory reads as erased
+  }
+  return u8Value;
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Records the change of a pin
+//! \param  u8Port: CPU51_PORT_xx
+//! \param  u8Bit: bit of the port
+//! \param  u8Level: new level
+//! \return -
+//-----------------------------------------------------------------------------
+void Cpu51::PinChange( U8 u8Port, U8 u8Bit, U8 u8Level )
+{
+  S_CPU51_PIN* psPin = &masPins[ ( u8Port * 8u ) + u8Bit ];
+
+  if( 0u != u8Level )  // It was low until now
+  {
+    psPin->u64LowTicks += mu64Time - psPin->u64LastChange;
+  }
+  psPin->u64LastChange = mu64Time;
+  psPin->u32Edges++;
+  if( NULL != mpfPinChange )
+  {
+    mpfPinChange( mpvContext, mu64Time, u8Port, u8Bit, u8Level );
+  }
+  // INT2 (P3.6) is triggered by falling edges
+  if( ( CPU51_PORT_P3 == u8Port ) && ( 6u == u8Bit ) && ( 0u == u8Level ) )
+  {
+    mau8Sfr[ R_AUXINTIF ] |= INT2_MASK;
+    mau64RaiseCycle[ VECTOR_INT2 ] = mu64Cycles;
+    mbIrqDirty = TRUE;
+  }
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Writes the latch of a port and records the changed pins
+//! \param  u8Port: CPU51_PORT_xx
+//! \param  u8Value: new latch
+//! \return -
+//-----------------------------------------------------------------------------
+void Cpu51::WritePort( U8 u8Port, U8 u8Value )
+{
+  U8 u8SfrIndex = gcau8PortSfr[ u8Port ];
+  U8 u8Old = mau8Sfr[ u8SfrIndex ] & mau8PortInput[ u8Port ];
+  U8 u8New = u8Value & mau8PortInput[ u8Port ];
+  U8 u8Changed = u8Old ^ u8New;
+  U8 u8Bit;
+
+  mau8Sfr[ u8SfrIndex ] = u8Value;
+  for( u8Bit = 0u; 0u != u8Changed; u8Bit++, u8Changed >>= 1u )
+  {
+    if( 0u != ( u8Changed & 1u ) )
+    {
+      PinChange( u8Port, u8Bit, (U8)( ( u8New >> u8Bit ) & 1u ) );
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Applies the scheduled input changes that are due
+//! \param  -
+//! \return -
+//-----------------------------------------------------------------------------
+void Cpu51::ApplyInputs( void )
+{
+  const S_CPU51_INPUT* psInput;
+  U8 u8SfrIndex;
+  U8 u8Old;
+  U8 u8New;
+
+  while( ( mu32InputsNext < mu32InputsNum ) && ( mpsInputs[ mu32InputsNext ].u64Time <= mu64Time ) )
+  {
+    psInput = &mpsInputs[ mu32InputsNext ];
+    u8SfrIndex = gcau8PortSfr[ psInput->u8Port ];
+    u8Old = mau8Sfr[ u8SfrIndex ] & mau8PortInput[ psInput->u8Port ];
+    if( 0u != psInput->u8Level )
+    {
+      mau8PortInput[ psInput->u8Port ] |= (U8)( 1u << psInput->u8Bit );
+    }
+    else
+    {
+      mau8PortInput[ psInput->u8Port ] &= (U8)~( 1u << psInput->u8Bit );
+    }
+    u8New = mau8Sfr[ u8SfrIndex ] & mau8PortInput[ psInput->u8Port ];
+    if( u8Old != u8New )
+    {
+      PinChange( psInput->u8Port, psInput->u8Bit, psInput->u8Level );
+    }
+    mu32InputsNext++;
+  }
+  mu64NextInput = ( mu32InputsNext < mu32InputsNum ) ? mpsInputs[ mu32InputsNext ].u64Time : UINT64_MAX;
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Advances a timer
+//! \param  u8Timer: 0 or 1
+//! \param  u32Cycles: elapsed system clock cycles
+//! \param  u64Base: system clock cycle at the start of the elapsed time
+//! \return -
+//-----------------------------------------------------------------------------
+void Cpu51::AdvanceTimer( U8 u8Timer, U32 u32Cycles, uint64_t u64Base )
+{
+  S_TIMER* psTimer = &masTimers[ u8Timer ];
+  U8  u8Mode = (U8)( ( mau8Sfr[ R_TMOD ] >> ( u8Timer * 4u ) ) & 0x03u );
+  U8  u8Flag = (U8)( 0x20u << ( u8Timer * 2u ) );  // TF0 or TF1
+  U32 u32Ticks = u32Cycles;
+  U32 u32Top = ( 2u == u8Mode ) ? 0x100u : 0x10000u;
+  U32 u32ToOverflow = u32Top - psTimer->u32Count;
+
+  if( 0u == ( mau8Sfr[ R_AUXR ] & ( 0x80u >> u8Timer ) ) )  // 12T mode
+  {
+    u32ToOverflow = ( u32ToOverflow * 12u ) - psTimer->u8Prescale;
+    u32Ticks = ( psTimer->u8Prescale + u32Cycles ) / 12u;
+    psTimer->u8Prescale = (U8)( ( psTimer->u8Prescale + u32Cycles ) % 12u );
+  }
+  psTimer->u32Count += u32Ticks;
+  while( psTimer->u32Count >= u32Top )
+  {
+    psTimer->u32Count -= u32Top;
+    if( 1u == u8Mode )
+    {
+      // No reload
+    }
+    else if( 2u == u8Mode )
+    {
+      psTimer->u32Count += mau8Sfr[ u8Timer ? R_TH1 : R_TH0 ];
+    }
+    else
+    {
+      psTimer->u32Count += psTimer->u16Reload;
+    }
+    if( 0u == ( mau8Sfr[ R_TCON ] & u8Flag ) )
+    {
+      mau8Sfr[ R_TCON ] |= u8Flag;
+      mau64RaiseCycle[ u8Timer ? VECTOR_TIMER1 : VECTOR_TIMER0 ] = u64Base + u32ToOverflow;
+      mbIrqDirty = TRUE;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Advances the time; the peripherals only when an event is due
+//! \param  u32Cycles: elapsed system clock cycles
+//! \return -
+//-----------------------------------------------------------------------------
+void Cpu51::Advance( U32 u32Cycles )
+{
+  mu64Cycles += u32Cycles;
+  mu64Time += (uint64_t)u32Cycles * mu8ClockDivider;
+  mu32PendingCycles += u32Cycles;
+  if( mu32PendingCycles >= mu32NextEvent )
+  {
+    Sync();
+  }
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Brings the peripherals up to the current cycle, and finds their next event
+//! \param  -
+//! \return -
+//! \note   Must be called before accessing the registers of the peripherals.
+//-----------------------------------------------------------------------------
+void Cpu51::Sync( void )
+{
+  U32      u32Cycles = mu32PendingCycles;
+  uint64_t u64Base = mu64Cycles - u32Cycles;
+
+  mu32PendingCycles = 0u;
+  if( 0u != ( mau8Sfr[ R_TCON ] & 0x10u ) )  // TR0
+  {
+    AdvanceTimer( 0u, u32Cycles, u64Base );
+  }
+  if( 0u != ( mau8Sfr[ R_TCON ] & 0x40u ) )  // TR1
+  {
+    AdvanceTimer( 1u, u32Cycles, u64Base );
+  }
+
+  if( 0u != mu32UartCycles )
+  {
+    if( mu32UartCycles <= u32Cycles )
+    {
+      mau8Sfr[ R_SCON ] |= 0x02u;  // TI
+      mau64RaiseCycle[ VECTOR_UART1 ] = u64Base + mu32UartCycles;
+      mu32UartCycles = 0u;
+      mbIrqDirty = TRUE;
+      if( NULL != mpfUartTx )
+      {
+        mpfUartTx( mpvContext, mu64Time, mu8UartByte );
+      }
+    }
+    else
+    {
+      mu32UartCycles -= u32Cycles;
+    }
+  }
+
+  if( 0u != mu32AdcCycles )
+  {
+    if( mu32AdcCycles <= u32Cycles )
+    {
+      U8  u8Channel = mau8Sfr[ R_ADC_CONTR ] & 0x0Fu;
+      U32 u32Result = 1023u;  // The pins are at the supply
+      if( ADC_CHANNEL_REFERENCE == u8Channel )
+      {
+        u32Result = (U32)( ( ADC_REFERENCE_VOLTS / mdBatteryVolts ) * 1024.0 + 0.5 );
+        u32Result = ( u32Result > 1023u ) ? 1023u : u32Result;
+      }
+      if( 0u != ( mau8Sfr[ R_ADCCFG ] & 0x20u ) )  // Right-aligned
+      {
+        mau8Sfr[ R_ADC_RES ] = (U8)( u32Result >> 8u );
+        mau8Sfr[ R_ADC_RESL ] = (U8)u32Result;
+      }
+      else
+      {
+        mau8Sfr[ R_ADC_RES ] = (U8)( u32Result >> 2u );
+        mau8Sfr[ R_ADC_RESL ] = (U8)( u32Result << 6u );
+      }
+      mau8Sfr[ R_ADC_CONTR ] = (U8)( ( mau8Sfr[ R_ADC_CONTR ] & ~ADC_START ) | ADC_FLAG );
+      mau64RaiseCycle[ VECTOR_ADC ] = u64Base + mu32AdcCycles;
+      mu32AdcCycles = 0u;
+      mbIrqDirty = TRUE;
+    }
+    else
+    {
+      mu32AdcCycles -= u32Cycles;
+    }
+  }
+  mu32NextEvent = CyclesToNextEvent();
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Calculates the time of the next event that may raise an interrupt
+//! \param  -
+//! \return System clock cycles until the event, at least 1; EVENT_NONE if nothing will happen
+//-----------------------------------------------------------------------------
+U32 Cpu51::CyclesToNextEvent( void ) const
+{
+  U32 u32Next = EVENT_NONE;
+  U32 u32Cycles;
+  U8  u8Timer;
+  U8  u8Mode;
+
+  for( u8Timer = 0u; u8Timer < 2u; u8Timer++ )
+  {
+    if( 0u != ( mau8Sfr[ R_TCON ] & ( 0x10u << ( u8Timer * 2u ) ) ) )
+    {
+      u8Mode = (U8)( ( mau8Sfr[ R_TMOD ] >> ( u8Timer * 4u ) ) & 0x03u );
+      u32Cycles = ( ( 2u == u8Mode ) ? 0x100u : 0x10000u ) - masTimers[ u8Timer ].u32Count;
+      if( 0u == ( mau8Sfr[ R_AUXR ] & ( 0x80u >> u8Timer ) ) )  // 12T mode
+      {
+        u32Cycles = ( u32Cycles * 12u ) - masTimers[ u8Timer ].u8Prescale;
+      }
+      u32Next = ( u32Cycles < u32Next ) ? u32Cycles : u32Next;
+    }
+  }
+  if( ( 0u != mu32UartCycles ) && ( mu32UartCycles < u32Next ) )
+  {
+    u32Next = mu32UartCycles;
+  }
+  if( ( 0u != mu32AdcCycles ) && ( mu32AdcCycles < u32Next ) )
+  {
+    u32Next = mu32AdcCycles;
+  }
+  if( mu32InputsNext < mu32InputsNum )
+  {
+    uint64_t u64Ticks = ( mpsInputs[ mu32InputsNext ].u64Time > mu64Time ) ? ( mpsInputs[ mu32InputsNext ].u64Time - mu64Time ) : 0u;
+    uint64_t u64Cycles = ( u64Ticks + mu8ClockDivider - 1u ) / mu8ClockDivider;
+    if( u64Cycles < u32Next )
+    {
+      u32Next = (U32)u64Cycles;
+    }
+  }
+  return ( 0u == u32Next ) ? 1u : u32Next;
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Enters the highest priority pending interrupt, if it may interrupt
+//! \param  -
+//! \return TRUE if an interrupt was entered
+//! \note   Only called when something has changed (mbIrqDirty): a flag was raised, an interrupt
+//!         register was written, or an interrupt returned.
+//-----------------------------------------------------------------------------
+BOOL Cpu51::CheckInterrupts( void )
+{
+  static const U8 cau8Vectors[] = { VECTOR_TIMER0, VECTOR_TIMER1, VECTOR_UART1, VECTOR_ADC, VECTOR_INT2 };
+  BOOL bEntered = FALSE;
+  U8   u8BestVector = 0xFFu;
+  U8   u8BestLevel = 0u;
+  U8   u8Index;
+  U8   u8Vector;
+  U8   u8Level;
+  U8   u8Mask;
+  BOOL bPending;
+
+  if( mbIrqBlocked )
+  {
+    mbIrqBlocked = FALSE;  // Checked again after the next instruction
+  }
+  else if( 0u != ( mau8Sfr[ R_IE ] & IE_EA ) )
+  {
+    for( u8Index = 0u; u8Index < sizeof( cau8Vectors ); u8Index++ )
+    {
+      u8Vector = cau8Vectors[ u8Index ];
+      switch( u8Vector )
+      {
+        case VECTOR_TIMER0:
+          u8Mask = 0x02u;  // ET0, PT0, PT0H
+          bPending = ( 0u != ( mau8Sfr[ R_TCON ] & 0x20u ) );
+          break;
+        case VECTOR_TIMER1:
+          u8Mask = 0x08u;  // ET1, PT1, PT1H
+          bPending = ( 0u != ( mau8Sfr[ R_TCON ] & 0x80u ) );
+          break;
+        case VECTOR_UART1:
+          u8Mask = 0x10u;  // ES, PS, PSH
+          bPending = ( 0u != ( mau8Sfr[ R_SCON ] & 0x03u ) );
+          break;
+        case VECTOR_ADC:
+          u8Mask = 0x20u;  // EADC, PADC, PADCH
+          bPending = ( 0u != ( mau8Sfr[ R_ADC_CONTR ] & ADC_FLAG ) );
+          break;
+        default:  // INT2: enabled in INTCLKO, fixed lowest priority
+          u8Mask = 0x00u;
+          bPending = ( 0u != ( mau8Sfr[ R_AUXINTIF ] & INT2_MASK ) ) && ( 0u != ( mau8Sfr[ R_INTCLKO ] & INT2_MASK ) );
+          break;
+      }
+      if( 0u != u8Mask )
+      {
+        bPending = bPending && ( 0u != ( mau8Sfr[ R_IE ] & u8Mask ) );
+      }
+      u8Level = (U8)( ( ( mau8Sfr[ R_IPH ] & u8Mask ) ? 2u : 0u ) | ( ( mau8Sfr[ R_IP ] & u8Mask ) ? 1u : 0u ) );
+      if( bPending && ( ( 0xFFu == u8BestVector ) || ( u8Level > u8BestLevel ) ) )
+      {
+        u8BestVector = u8Vector;
+        u8BestLevel = u8Level;
+      }
+    }
+
+    if( ( 0xFFu != u8BestVector )
+     && ( ( 0u == mu8IrqDepth ) || ( u8BestLevel > mau8IrqLevel[ mu8IrqDepth - 1u ] ) ) )
+    {
+      // The timer flags are cleared by the hardware, so is INT2IF
+      if( VECTOR_TIMER0 == u8BestVector ) { mau8Sfr[ R_TCON ] &= (U8)~0x20u; }
+      if( VECTOR_TIMER1 == u8BestVector ) { mau8Sfr[ R_TCON ] &= (U8)~0x80u; }
+      if( VECTOR_INT2 == u8BestVector )   { mau8Sfr[ R_AUXINTIF ] &= (U8)~INT2_MASK; }
+
+      U32 u32Latency = (U32)( mu64Cycles - mau64RaiseCycle[ u8BestVector ] );
+      if( ( mu64Cycles >= mau64RaiseCycle[ u8BestVector ] ) && ( u32Latency > masVectors[ u8BestVector ].u32MaxLatency ) )
+      {
+        masVectors[ u8BestVector ].u32MaxLatency = u32Latency;
+      }
+      mau8IrqLevel[ mu8IrqDepth ] = u8BestLevel;
+      mau8IrqVector[ mu8IrqDepth ] = u8BestVector;
+      mau64IrqEntry[ mu8IrqDepth ] = mu64Cycles;
+      mu8IrqDepth++;
+      Push( (U8)mu16PC );
+      Push( (U8)( mu16PC >> 8u ) );
+      mu16PC = (U16)( ( u8BestVector * 8u ) + 3u );
+      mpu64PcCycles[ mu16PC ] += CYCLES_INTERRUPT;
+      Advance( CYCLES_INTERRUPT );
+      bEntered = TRUE;
+    }
+  }
+  else
+  {
+    // Interrupts are disabled
+  }
+  if( !bEntered && !mbIrqBlocked )
+  {
+    mbIrqDirty = FALSE;  // Nothing to do until the next change
+  }
+  return bEntered;
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Stays in power-down mode until a wake-up or the end of the run
+//! \param  u64UntilTime: end of the run, in main clock ticks
+//! \return TRUE if nothing can wake up the chip
+//-----------------------------------------------------------------------------
+BOOL Cpu51::PowerDown( uint64_t u64UntilTime )
+{
+  BOOL     bOff = FALSE;
+  BOOL     bAwake = FALSE;
+  uint64_t u64Start = mu64Time;
+  uint64_t u64Next;
+  U16      u16Counts;
+
+  if( ( 0u == mu64WakeTime ) && ( 0u != ( mau8Sfr[ R_WKTCH ] & WKTCH_WKTEN ) ) )
+  {
+    u16Counts = (U16)( ( ( mau8Sfr[ R_WKTCH ] & 0x7Fu ) << 8u ) | mau8Sfr[ R_WKTCL ] );
+    mu64WakeTime = mu64Time + ( ( (uint64_t)u16Counts + 1u ) * CPU51_MAIN_CLOCK_HZ ) / mu32WktHz;
+    mu64WktStart = mu64Time;
+  }
+
+  while( !bAwake && !bOff && ( mu64Time < u64UntilTime ) )
+  {
+    u64Next = u64UntilTime;
+    if( ( 0u != mu64WakeTime ) && ( mu64WakeTime < u64Next ) )
+    {
+      u64Next = mu64WakeTime;
+    }
+    if( ( mu32InputsNext < mu32InputsNum ) && ( mpsInputs[ mu32InputsNext ].u64Time < u64Next ) )
+    {
+      u64Next = mpsInputs[ mu32InputsNext ].u64Time;
+    }
+    if( u64Next > mu64Time )
+    {
+      mu64Time = u64Next;
+    }
+    ApplyInputs();
+    if( ( 0u != mu64WakeTime ) && ( mu64Time >= mu64WakeTime ) )
+    {
+      bAwake = TRUE;
+    }
+    else if( ( 0u != ( mau8Sfr[ R_AUXINTIF ] & INT2_MASK ) ) && ( 0u != ( mau8Sfr[ R_INTCLKO ] & INT2_MASK ) ) )
+    {
+      bAwake = TRUE;
+    }
+    else if( ( 0u == mu64WakeTime ) && ( mu32InputsNext >= mu32InputsNum ) )
+    {
+      bOff = TRUE;
+    }
+    else
+    {
+      // Wait for the next event
+    }
+  }
+  mu64PowerDownTicks += mu64Time - u64Start;
+  if( bAwake )
+  {
+    if( 0u != mu64WakeTime )
+    {
+      // The internal counter stops at the wake-up, the firmware may read it
+      u64Next = ( ( mu64Time - mu64WktStart ) * mu32WktHz ) / CPU51_MAIN_CLOCK_HZ;
+      mu16WktCount = (U16)( ( u64Next > 0x7FFFu ) ? 0x7FFFu : u64Next );
+    }
+    mu64WakeTime = 0u;
+    mau8Sfr[ R_PCON ] &= (U8)~PCON_PD;
+    // The INT2 edge was seen with the system clock stopped: no latency
+    mau64RaiseCycle[ VECTOR_INT2 ] = mu64Cycles;
+    mbIrqDirty = TRUE;
+  }
+  mu32NextEvent = CyclesToNextEvent();
+  return bOff;
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Starts an ADC conversion
+//! \param  -
+//! \return -
+//-----------------------------------------------------------------------------
+void Cpu51::StartAdc( void )
+{
+  U8  u8Timing = mau8Xsfr[ X_ADCTIM ];
+  U32 u32AdcClocks = ( u8Timing & 0x1Fu ) + 1u                  // Sampling
+                   + ( ( u8Timing >> 5u ) & 0x03u ) + 1u         // Channel select hold
+                   + ( ( u8Timing >> 7u ) & 0x01u ) + 1u         // Channel select setup
+                   + ADC_CONVERSION_BITS;
+
+  mu32AdcCycles = u32AdcClocks * 2u * ( ( mau8Sfr[ R_ADCCFG ] & 0x0Fu ) + 1u );
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Executes the IAP command after the trigger sequence; the CPU stalls meanwhile
+//! \param  -
+//! \return -
+//-----------------------------------------------------------------------------
+void Cpu51::IapTrigger( void )
+{
+  U16 u16Address = (U16)( ( ( mau8Sfr[ R_IAP_ADDRH ] << 8u ) | mau8Sfr[ R_IAP_ADDRL ] ) % CPU51_EEPROM_SIZE );
+  U32 u32CyclesPerUs = ( CPU51_MAIN_CLOCK_HZ / 1000000u ) / mu8ClockDivider;
+  U32 u32Stall = 0u;
+
+  if( 0u == ( mau8Sfr[ R_IAP_CONTR ] & IAP_IAPEN ) )
+  {
+    mau8Sfr[ R_IAP_CONTR ] |= IAP_CMD_FAIL;
+  }
+  else
+  {
+    switch( mau8Sfr[ R_IAP_CMD ] & 0x03u )
+    {
+      case 1u:  // Read
+        mau8Sfr[ R_IAP_DATA ] = mau8Eeprom[ u16Address ];
+        u32Stall = IAP_READ_CYCLES;
+        break;
+      case 2u:  // Program: can only clear bits
+        mau8Eeprom[ u16Address ] &= mau8Sfr[ R_IAP_DATA ];
+        mu32IapPrograms++;
+        u32Stall = IAP_PROGRAM_US * u32CyclesPerUs;
+        break;
+      case 3u:  // Erase
+        memset( &mau8Eeprom[ u16Address & ~( CPU51_EEPROM_PAGE_SIZE - 1u ) ], 0xFF, CPU51_EEPROM_PAGE_SIZE );
+        mu32IapErases++;
+        u32Stall = IAP_ERASE_US * u32CyclesPerUs;
+        break;
+      default:  // Idle
+        break;
+    }
+  }
+  if( 0u != u32Stall )
+  {
+    Advance( u32Stall );
+  }
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Reads a directly addressed byte (DATA or SFR)
+//! \param  u8Address: direct address
+//! \param  bLatch: read-modify-write instruction; the ports give their latch
+//! \return The byte
+//-----------------------------------------------------------------------------
+U8 Cpu51::ReadDirect( U8 u8Address, BOOL bLatch )
+{
+  U8 u8Value;
+  U8 u8Index;
+  U8 u8Parity;
+
+  if( u8Address < 0x80u )
+  {
+    u8Value = mau8Iram[ u8Address ];
+  }
+  else
+  {
+    u8Index = SFR( u8Address );
+    switch( u8Index )
+    {
+      case R_TCON:
+      case R_TL0:
+      case R_TH0:
+      case R_TL1:
+      case R_TH1:
+      case R_SCON:
+      case R_ADC_CONTR:
+      case R_ADC_RES:
+      case R_ADC_RESL:
+        Sync();
+        break;
+      default:
+        break;
+    }
+    u8Value = mau8Sfr[ u8Index ];
+    switch( u8Index )
+    {
+      case R_P1:
+        u8Value &= bLatch ? 0xFFu : mau8PortInput[ CPU51_PORT_P1 ];
+        break;
+      case R_P3:
+        u8Value &= bLatch ? 0xFFu : mau8PortInput[ CPU51_PORT_P3 ];
+        break;
+      case R_P5:
+        u8Value &= bLatch ? 0xFFu : mau8PortInput[ CPU51_PORT_P5 ];
+        break;
+      case R_TL0:
+        u8Value = (U8)masTimers[ 0 ].u32Count;
+        break;
+      case R_TH0:
+        u8Value = ( 2u == ( mau8Sfr[ R_TMOD ] & 0x03u ) ) ? u8Value : (U8)( masTimers[ 0 ].u32Count >> 8u );
+        break;
+      case R_TL1:
+        u8Value = (U8)masTimers[ 1 ].u32Count;
+        break;
+      case R_TH1:
+        u8Value = ( 0x20u == ( mau8Sfr[ R_TMOD ] & 0x30u ) ) ? u8Value : (U8)( masTimers[ 1 ].u32Count >> 8u );
+        break;
+      case R_WKTCL:
+        u8Value = (U8)mu16WktCount;
+        break;
+      case R_WKTCH:
+        u8Value = (U8)( ( u8Value & WKTCH_WKTEN ) | ( mu16WktCount >> 8u ) );
+        break;
+      case R_PSW:
+        u8Parity = mau8Sfr[ R_ACC ];
+        u8Parity ^= u8Parity >> 4u;
+        u8Parity ^= u8Parity >> 2u;
+        u8Parity ^= u8Parity >> 1u;
+        u8Value = (U8)( ( u8Value & ~PSW_P ) | ( u8Parity & 1u ) );
+        break;
+      default:
+        break;
+    }
+  }
+  return u8Value;
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Writes a directly addressed byte (DATA or SFR)
+//! \param  u8Address: direct address
+//! \param  u8Value: the byte
+//! \return -
+//-----------------------------------------------------------------------------
+void Cpu51::WriteDirect( U8 u8Address, U8 u8Value )
+{
+  U8  u8Index;
+  U8  u8Timer;
+  U8  u8Temp;
+  BOOL bRunning;
+  BOOL bPeripheral;
+
+  if( u8Address < 0x80u )
+  {
+    mau8Iram[ u8Address ] = u8Value;
+  }
+  else
+  {
+    u8Index = SFR( u8Address );
+    bPeripheral = ( R_P1 != u8Index ) && ( R_P3 != u8Index ) && ( R_P5 != u8Index ) && ( R_ACC != u8Index )
+               && ( R_B != u8Index ) && ( R_PSW != u8Index ) && ( R_SP != u8Index ) && ( R_DPL != u8Index ) && ( R_DPH != u8Index );
+    if( bPeripheral )
+    {
+      Sync();
+    }
+    switch( u8Index )
+    {
+      case R_P1:
+        WritePort( CPU51_PORT_P1, u8Value );
+        break;
+      case R_P3:
+        WritePort( CPU51_PORT_P3, u8Value );
+        break;
+      case R_P5:
+        WritePort( CPU51_PORT_P5, u8Value );
+        break;
+
+      case R_TL0:
+      case R_TL1:
+      case R_TH0:
+      case R_TH1:
+        // In 16-bit auto-reload mode, a running timer only takes the reload value
+        u8Timer = ( ( R_TL1 == u8Index ) || ( R_TH1 == u8Index ) ) ? 1u : 0u;
+        bRunning = ( 0u != ( mau8Sfr[ R_TCON ] & ( 0x10u << ( u8Timer * 2u ) ) ) );
+        mau8Sfr[ u8Index ] = u8Value;
+        if( ( R_TL0 == u8Index ) || ( R_TL1 == u8Index ) )
+        {
+          masTimers[ u8Timer ].u16Reload = (U16)( ( masTimers[ u8Timer ].u16Reload & 0xFF00u ) | u8Value );
+          if( !bRunning || ( 0u != ( mau8Sfr[ R_TMOD ] & ( 0x03u << ( u8Timer * 4u ) ) ) ) )
+          {
+            masTimers[ u8Timer ].u32Count = ( masTimers[ u8Timer ].u32Count & 0xFF00u ) | u8Value;
+          }
+        }
+        else
+        {
+          masTimers[ u8Timer ].u16Reload = (U16)( ( masTimers[ u8Timer ].u16Reload & 0x00FFu ) | ( u8Value << 8u ) );
+          if( !bRunning || ( 0x01u == ( ( mau8Sfr[ R_TMOD ] >> ( u8Timer * 4u ) ) & 0x03u ) ) )
+          {
+            masTimers[ u8Timer ].u32Count = ( masTimers[ u8Timer ].u32Count & 0x00FFu ) | ( (U32)u8Value << 8u );
+          }
+        }
+        break;
+
+      case R_SBUF:
+        mau8Sfr[ u8Index ] = u8Value;
+        mu8UartByte = u8Value;
+        if( 0u != ( mau8Sfr[ R_AUXR ] & 0x01u ) )  // Baud rate from timer 2
+        {
+          mu32UartCycles = ( 0x10000u - ( ( mau8Sfr[ R_T2H ] << 8u ) | mau8Sfr[ R_T2L ] ) ) * 4u
+                         * ( ( 0u != ( mau8Sfr[ R_AUXR ] & 0x04u ) ) ? 1u : 12u );
+        }
+        else
+        {
+          mu32UartCycles = ( 0x10000u - masTimers[ 1 ].u16Reload ) * 4u
+                         * ( ( 0u != ( mau8Sfr[ R_AUXR ] & 0x40u ) ) ? 1u : 12u );
+        }
+        mu32UartCycles *= UART_FRAME_BITS;
+        break;
+
+      case R_IE:
+      case R_IP:
+      case R_IPH:
+        mau8Sfr[ u8Index ] = u8Value;
+        mbIrqBlocked = TRUE;
+        break;
+
+      case R_ADC_CONTR:
+        mau8Sfr[ u8Index ] = u8Value;
+        if( ( 0u != ( u8Value & ADC_START ) ) && ( 0u != ( u8Value & ADC_POWER ) ) && ( 0u == mu32AdcCycles ) )
+        {
+          StartAdc();
+        }
+        break;
+
+      case R_IAP_TRIG:
+        mau8Sfr[ u8Index ] = u8Value;
+        if( 0x5Au == u8Value )
+        {
+          mu8IapUnlock = 1u;
+        }
+        else if( ( 0xA5u == u8Value ) && ( 1u == mu8IapUnlock ) )
+        {
+          mu8IapUnlock = 0u;
+          IapTrigger();
+        }
+        else
+        {
+          mu8IapUnlock = 0u;
+        }
+        break;
+
+      case R_DPS:
+        if( 0u != ( ( mau8Sfr[ u8Index ] ^ u8Value ) & 0x01u ) )  // The other data pointer is selected
+        {
+          u8Temp = mau8Sfr[ R_DPL ]; mau8Sfr[ R_DPL ] = mau8Sfr[ R_DPL1 ]; mau8Sfr[ R_DPL1 ] = u8Temp;
+          u8Temp = mau8Sfr[ R_DPH ]; mau8Sfr[ R_DPH ] = mau8Sfr[ R_DPH1 ]; mau8Sfr[ R_DPH1 ] = u8Temp;
+        }
+        mau8Sfr[ u8Index ] = u8Value;
+        break;
+
+      default:
+        mau8Sfr[ u8Index ] = u8Value;
+        break;
+    }
+    if( bPeripheral )
+    {
+      // The configuration may have changed: new next event, maybe a pending interrupt
+      mu32NextEvent = CyclesToNextEvent();
+      mbIrqDirty = TRUE;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Reads a bit
+//! \param  u8BitAddress: bit address
+//! \param  bLatch: read-modify-write instruction; the ports give their latch
+//! \return 0 or 1
+//-----------------------------------------------------------------------------
+U8 Cpu51::ReadBit( U8 u8BitAddress, BOOL bLatch )
+{
+  U8 u8Address = ( u8BitAddress < 0x80u ) ? (U8)( 0x20u + ( u8BitAddress >> 3u ) ) : (U8)( u8BitAddress & 0xF8u );
+  return (U8)( ( ReadDirect( u8Address, bLatch ) >> ( u8BitAddress & 7u ) ) & 1u );
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Writes a bit (read-modify-write of its byte)
+//! \param  u8BitAddress: bit address
+//! \param  u8Value: 0 or 1
+//! \return -
+//-----------------------------------------------------------------------------
+void Cpu51::WriteBit( U8 u8BitAddress, U8 u8Value )
+{
+  U8 u8Address = ( u8BitAddress < 0x80u ) ? (U8)( 0x20u + ( u8BitAddress >> 3u ) ) : (U8)( u8BitAddress & 0xF8u );
+  U8 u8Mask = (U8)( 1u << ( u8BitAddress & 7u ) );
+  U8 u8Byte = ReadDirect( u8Address, TRUE );
+
+  u8Byte = ( 0u != u8Value ) ? (U8)( u8Byte | u8Mask ) : (U8)( u8Byte & ~u8Mask );
+  WriteDirect( u8Address, u8Byte );
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Reads XDATA; the extended SFRs are mapped in when P_SW2.EAXFR is set
+//! \param  u16Address: XDATA address
+//! \return The byte
+//-----------------------------------------------------------------------------
+U8 Cpu51::ReadX( U16 u16Address )
+{
+  U8 u8Value = mau8Xram[ u16Address ];
+
+  if( ( u16Address >= XSFR_BASE ) && ( u16Address < ( XSFR_BASE + sizeof( mau8Xsfr ) ) )
+   && ( 0u != ( mau8Sfr[ R_P_SW2 ] & P_SW2_EAXFR ) ) )
+  {
+    u8Value = mau8Xsfr[ u16Address - XSFR_BASE ];
+  }
+  return u8Value;
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Writes XDATA; the extended SFRs are mapped in when P_SW2.EAXFR is set
+//! \param  u16Address: XDATA address
+//! \param  u8Value: the byte
+//! \return -
+//-----------------------------------------------------------------------------
+void Cpu51::WriteX( U16 u16Address, U8 u8Value )
+{
+  if( ( u16Address >= XSFR_BASE ) && ( u16Address < ( XSFR_BASE + sizeof( mau8Xsfr ) ) )
+   && ( 0u != ( mau8Sfr[ R_P_SW2 ] & P_SW2_EAXFR ) ) )
+  {
+    mau8Xsfr[ u16Address - XSFR_BASE ] = u8Value;
+    if( X_CLKDIV == ( u16Address - XSFR_BASE ) )
+    {
+      mu8ClockDivider = ( 0u == u8Value ) ? 1u : u8Value;
+    }
+  }
+  else
+  {
+    mau8Xram[ u16Address ] = u8Value;
+  }
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Pushes a byte to the stack
+//! \param  u8Value: the byte
+//! \return -
+//-----------------------------------------------------------------------------
+void Cpu51::Push( U8 u8Value )
+{
+  mau8Sfr[ R_SP ]++;
+  mau8Iram[ mau8Sfr[ R_SP ] ] = u8Value;
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Pops a byte from the stack
+//! \param  -
+//! \return The byte
+//-----------------------------------------------------------------------------
+U8 Cpu51::Pop( void )
+{
+  U8 u8Value = mau8Iram[ mau8Sfr[ R_SP ] ];
+  mau8Sfr[ R_SP ]--;
+  return u8Value;
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Starts the measurement of a watched function, if the call just executed is its call
+//! \param  u32Cycles: cycles of the call instruction
+//! \return -
+//-----------------------------------------------------------------------------
+void Cpu51::WatchCall( U32 u32Cycles )
+{
+  U8 u8Index;
+
+  for( u8Index = 0u; u8Index < mu8WatchesNum; u8Index++ )
+  {
+    // A recursive call is part of the outer one
+    if( ( masWatches[ u8Index ].u16Address == mu16PC ) && ( 0u == mau8WatchSp[ u8Index ] ) )
+    {
+      mau8WatchSp[ u8Index ] = mau8Sfr[ R_SP ];
+      mau8WatchDepth[ u8Index ] = mu8IrqDepth;
+      mau64WatchEntry[ u8Index ] = mu64Cycles + u32Cycles;
+      mau64WatchIrq[ u8Index ] = mu64IrqCycles;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Ends the measurement of a watched function, if the RET to execute returns from it
+//! \param  u32Cycles: cycles of the RET
+//! \return -
+//-----------------------------------------------------------------------------
+void Cpu51::WatchReturn( U32 u32Cycles )
+{
+  S_CPU51_WATCH* psWatch;
+  U8  u8Index;
+  U32 u32Run;
+
+  for( u8Index = 0u; u8Index < mu8WatchesNum; u8Index++ )
+  {
+    if( ( 0u != mau8WatchSp[ u8Index ] ) && ( mau8Sfr[ R_SP ] == mau8WatchSp[ u8Index ] )
+     && ( mu8IrqDepth == mau8WatchDepth[ u8Index ] ) )
+    {
+      psWatch = &masWatches[ u8Index ];
+      u32Run = (U32)( ( mu64Cycles + u32Cycles - mau64WatchEntry[ u8Index ] ) - ( mu64IrqCycles - mau64WatchIrq[ u8Index ] ) );
+      psWatch->u32Calls++;
+      psWatch->u64Cycles += u32Run;
+      psWatch->u32MaxCycles = ( u32Run > psWatch->u32MaxCycles ) ? u32Run : psWatch->u32MaxCycles;
+      mau8WatchSp[ u8Index ] = 0u;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Executes one instruction and advances the peripherals by its cycles
+//! \param  -
+//! \return -
+//-----------------------------------------------------------------------------
+void Cpu51::Step( void )
+{
+#define ACC      mau8Sfr[ R_ACC ]
+#define PSW      mau8Sfr[ R_PSW ]
+#define DPTR     ( (U16)( ( mau8Sfr[ R_DPH ] << 8u ) | mau8Sfr[ R_DPL ] ) )
+#define CY       ( ( PSW & PSW_CY ) ? 1u : 0u )
+#define RN( n )  mau8Iram[ ( PSW & 0x18u ) | (n) ]
+#define IMM()    mau8Code[ mu16PC++ ]
+#define REL( u8Offset )  ( mu16PC = (U16)( mu16PC + (I8)(u8Offset) ) )
+
+  U16 u16Start = mu16PC;
+  U8  u8Op = mau8Code[ mu16PC++ ];
+  U32 u32Cycles = gau8Cycles[ u8Op ];
+  U8  u8Src = 0u;   // Second operand of the arithmetic and logic rows
+  U8  u8A;
+  U8  u8B;
+  U8  u8C;
+  U16 u16Result;
+  U16 u16Address;
+  U8  u8Rel;
+
+  // Arithmetic and logic rows with the second operand in #data, direct, @Ri or Rn
+  if( OPERAND_NONE != gau8Operand[ u8Op ] )
+  {
+    switch( gau8Operand[ u8Op ] )
+    {
+      case OPERAND_IMMEDIATE: u8Src = IMM(); break;
+      case OPERAND_DIRECT:    u8Src = ReadDirect( IMM(), FALSE ); break;
+      case OPERAND_INDIRECT:  u8Src = mau8Iram[ RN( u8Op & 1u ) ]; break;
+      default:                u8Src = RN( u8Op & 7u ); break;
+    }
+    switch( u8Op >> 4u )
+    {
+      case 0x4u: ACC |= u8Src; break;  // ORL A,src
+      case 0x5u: ACC &= u8Src; break;  // ANL A,src
+      case 0x6u: ACC ^= u8Src; break;  // XRL A,src
+      default:   // ADD, ADDC, SUBB
+        u8A = ACC;
+        u8C = ( 0x2u == ( u8Op >> 4u ) ) ? 0u : CY;
+        PSW &= (U8)~( PSW_CY | PSW_AC | PSW_OV );
+        if( 0x9u == ( u8Op >> 4u ) )
+        {
+          u16Result = (U16)( u8A - u8Src - u8C );
+          if( ( (U16)u8Src + u8C ) > u8A )                              { PSW |= PSW_CY; }
+          if( ( ( u8Src & 0x0Fu ) + u8C ) > ( u8A & 0x0Fu ) )           { PSW |= PSW_AC; }
+          if( 0u != ( ( u8A ^ u8Src ) & ( u8A ^ u16Result ) & 0x80u ) ) { PSW |= PSW_OV; }
+        }
+        else
+        {
+          u16Result = (U16)( u8A + u8Src + u8C );
+          if( u16Result > 0xFFu )                                         { PSW |= PSW_CY; }
+          if( ( ( u8A & 0x0Fu ) + ( u8Src & 0x0Fu ) + u8C ) > 0x0Fu )     { PSW |= PSW_AC; }
+          if( 0u != ( ~( u8A ^ u8Src ) & ( u8A ^ u16Result ) & 0x80u ) ) { PSW |= PSW_OV; }
+        }
+        ACC = (U8)u16Result;
+        break;
+    }
+  }
+  else if( 0x01u == ( u8Op & 0x1Fu ) )  // AJMP
+  {
+    u8A = IMM();
+    mu16PC = (U16)( ( mu16PC & 0xF800u ) | ( ( u8Op & 0xE0u ) << 3u ) | u8A );
+  }
+  else if( 0x11u == ( u8Op & 0x1Fu ) )  // ACALL
+  {
+    u8A = IMM();
+    Push( (U8)mu16PC );
+    Push( (U8)( mu16PC >> 8u ) );
+    mu16PC = (U16)( ( mu16PC & 0xF800u ) | ( ( u8Op & 0xE0u ) << 3u ) | u8A );
+    mpu32Calls[ mu16PC ]++;
+    WatchCall( u32Cycles );
+  }
+  else
+  {
+    switch( u8Op )
+    {
+      case 0x00u:  // NOP
+        break;
+      case 0x02u:  // LJMP
+        u8A = IMM();
+        mu16PC = (U16)( ( u8A << 8u ) | mau8Code[ mu16PC ] );
+        break;
+      case 0x12u:  // LCALL
+        u8A = IMM();
+        u8B = IMM();
+        Push( (U8)mu16PC );
+        Push( (U8)( mu16PC >> 8u ) );
+        mu16PC = (U16)( ( u8A << 8u ) | u8B );
+        mpu32Calls[ mu16PC ]++;
+        WatchCall( u32Cycles );
+        break;
+      case 0x22u:  // RET
+      case 0x32u:  // RETI
+        if( 0x22u == u8Op )
+        {
+          WatchReturn( u32Cycles );
+        }
+        u8A = Pop();
+        mu16PC = (U16)( ( u8A << 8u ) | Pop() );
+        if( ( 0x32u == u8Op ) && ( 0u != mu8IrqDepth ) )
+        {
+          S_CPU51_VECTOR* psVector;
+          U32 u32Run;
+          mu8IrqDepth--;
+          psVector = &masVectors[ mau8IrqVector[ mu8IrqDepth ] ];
+          u32Run = (U32)( mu64Cycles + u32Cycles - mau64IrqEntry[ mu8IrqDepth ] );
+          psVector->u32Count++;
+          psVector->u64Cycles += u32Run;
+          psVector->u32MinCycles = ( ( 1u == psVector->u32Count ) || ( u32Run < psVector->u32MinCycles ) ) ? u32Run : psVector->u32MinCycles;
+          psVector->u32MaxCycles = ( u32Run > psVector->u32MaxCycles ) ? u32Run : psVector->u32MaxCycles;
+          if( 0u == mu8IrqDepth )
+          {
+            mu64IrqCycles += u32Run;
+          }
+          mbIrqBlocked = TRUE;
+          mbIrqDirty = TRUE;
+        }
+        break;
+
+      // Rotations
+      case 0x03u: ACC = (U8)( ( ACC >> 1u ) | ( ACC << 7u ) ); break;  // RR A
+      case 0x23u: ACC = (U8)( ( ACC << 1u ) | ( ACC >> 7u ) ); break;  // RL A
+      case 0x13u:  // RRC A
+        u8A = ACC;
+        ACC = (U8)( ( u8A >> 1u ) | ( CY << 7u ) );
+        PSW = (U8)( ( PSW & ~PSW_CY ) | ( ( u8A & 1u ) << 7u ) );
+        break;
+      case 0x33u:  // RLC A
+        u8A = ACC;
+        ACC = (U8)( ( u8A << 1u ) | CY );
+        PSW = (U8)( ( PSW & ~PSW_CY ) | ( u8A & 0x80u ) );
+        break;
+
+      // INC, DEC
+      case 0x04u: ACC++; break;
+      case 0x14u: ACC--; break;
+      case 0x05u: u8A = IMM(); WriteDirect( u8A, (U8)( ReadDirect( u8A, TRUE ) + 1u ) ); break;
+      case 0x15u: u8A = IMM(); WriteDirect( u8A, (U8)( ReadDirect( u8A, TRUE ) - 1u ) ); break;
+      case 0x06u: case 0x07u: mau8Iram[ RN( u8Op & 1u ) ]++; break;
+      case 0x16u: case 0x17u: mau8Iram[ RN( u8Op & 1u ) ]--; break;
+      case 0x08u: case 0x09u: case 0x0Au: case 0x0Bu: case 0x0Cu: case 0x0Du: case 0x0Eu: case 0x0Fu:
+        RN( u8Op & 7u )++;
+        break;
+      case 0x18u: case 0x19u: case 0x1Au: case 0x1Bu: case 0x1Cu: case 0x1Du: case 0x1Eu: case 0x1Fu:
+        RN( u8Op & 7u )--;
+        break;
+      case 0xA3u:  // INC DPTR
+        u16Address = (U16)( DPTR + 1u );
+        mau8Sfr[ R_DPL ] = (U8)u16Address;
+        mau8Sfr[ R_DPH ] = (U8)( u16Address >> 8u );
+        break;
+
+      // Conditional jumps
+      case 0x10u:  // JBC bit,rel
+      case 0x20u:  // JB bit,rel
+      case 0x30u:  // JNB bit,rel
+        u8A = IMM();
+        u8Rel = IMM();
+        u8B = ReadBit( u8A, ( 0x10u == u8Op ) );
+        if( ( 0x30u == u8Op ) ? ( 0u == u8B ) : ( 0u != u8B ) )
+        {
+          if( 0x10u == u8Op )
+          {
+            WriteBit( u8A, 0u );
+          }
+          REL( u8Rel );
+          u32Cycles += CYCLES_TAKEN_JUMP;
+        }
+        break;
+      case 0x40u:  // JC
+      case 0x50u:  // JNC
+      case 0x60u:  // JZ
+      case 0x70u:  // JNZ
+        u8Rel = IMM();
+        if( ( ( 0x40u == u8Op ) && ( 0u != CY ) ) || ( ( 0x50u == u8Op ) && ( 0u == CY ) )
+         || ( ( 0x60u == u8Op ) && ( 0u == ACC ) ) || ( ( 0x70u == u8Op ) && ( 0u != ACC ) ) )
+        {
+          REL( u8Rel );
+          u32Cycles += CYCLES_TAKEN_JUMP;
+        }
+        break;
+      case 0x80u:  // SJMP
+        u8Rel = IMM();
+        REL( u8Rel );
+        if( ( 0xFEu == u8Rel ) && ( 0u == ( mau8Sfr[ R_IE ] & IE_EA ) ) )
+        {
+          mu8Stop = CPU51_STOP_HALT;
+        }
+        break;
+      case 0x73u:  // JMP @A+DPTR
+        mu16PC = (U16)( DPTR + ACC );
+        break;
+      case 0xB4u: case 0xB5u: case 0xB6u: case 0xB7u:
+      case 0xB8u: case 0xB9u: case 0xBAu: case 0xBBu: case 0xBCu: case 0xBDu: case 0xBEu: case 0xBFu:  // CJNE
+        if( 0xB4u == u8Op )      { u8A = ACC; u8B = IMM(); }
+        else if( 0xB5u == u8Op ) { u8A = ACC; u8B = ReadDirect( IMM(), FALSE ); }
+        else if( u8Op < 0xB8u )  { u8A = mau8Iram[ RN( u8Op & 1u ) ]; u8B = IMM(); }
+        else                     { u8A = RN( u8Op & 7u ); u8B = IMM(); }
+        u8Rel = IMM();
+        PSW = (U8)( ( PSW & ~PSW_CY ) | ( ( u8A < u8B ) ? PSW_CY : 0u ) );
+        if( u8A != u8B )
+        {
+          REL( u8Rel );
+          u32Cycles += CYCLES_TAKEN_LOOP;
+        }
+        break;
+      case 0xD5u:  // DJNZ direct,rel
+        u8A = IMM();
+        u8Rel = IMM();
+        u8B = (U8)( ReadDirect( u8A, TRUE ) - 1u );
+        WriteDirect( u8A, u8B );
+        if( 0u != u8B )
+        {
+          REL( u8Rel );
+          u32Cycles += CYCLES_TAKEN_LOOP;
+        }
+        break;
+      case 0xD8u: case 0xD9u: case 0xDAu: case 0xDBu: case 0xDCu: case 0xDDu: case 0xDEu: case 0xDFu:  // DJNZ Rn,rel
+        u8Rel = IMM();
+        if( 0u != --RN( u8Op & 7u ) )
+        {
+          REL( u8Rel );
+          u32Cycles += CYCLES_TAKEN_LOOP;
+        }
+        break;
+
+      // Logic to direct
+      case 0x42u: u8A = IMM(); WriteDirect( u8A, ReadDirect( u8A, TRUE ) | ACC ); break;
+      case 0x43u: u8A = IMM(); u8B = IMM(); WriteDirect( u8A, ReadDirect( u8A, TRUE ) | u8B ); break;
+      case 0x52u: u8A = IMM(); WriteDirect( u8A, ReadDirect( u8A, TRUE ) & ACC ); break;
+      case 0x53u: u8A = IMM(); u8B = IMM(); WriteDirect( u8A, ReadDirect( u8A, TRUE ) & u8B ); break;
+      case 0x62u: u8A = IMM(); WriteDirect( u8A, ReadDirect( u8A, TRUE ) ^ ACC ); break;
+      case 0x63u: u8A = IMM(); u8B = IMM(); WriteDirect( u8A, ReadDirect( u8A, TRUE ) ^ u8B ); break;
+
+      // Carry and bits
+      case 0x72u: if( ReadBit( IMM(), FALSE ) ) { PSW |= PSW_CY; } break;                    // ORL C,bit
+      case 0xA0u: if( !ReadBit( IMM(), FALSE ) ) { PSW |= PSW_CY; } break;                   // ORL C,/bit
+      case 0x82u: if( !ReadBit( IMM(), FALSE ) ) { PSW &= (U8)~PSW_CY; } break;              // ANL C,bit
+      case 0xB0u: if( ReadBit( IMM(), FALSE ) ) { PSW &= (U8)~PSW_CY; } break;               // ANL C,/bit
+      case 0xA2u: PSW = (U8)( ( PSW & ~PSW_CY ) | ( ReadBit( IMM(), FALSE ) << 7u ) ); break; // MOV C,bit
+      case 0x92u: WriteBit( IMM(), CY ); break;                                              // MOV bit,C
+      case 0xB2u: u8A = IMM(); WriteBit( u8A, (U8)( ReadBit( u8A, TRUE ) ^ 1u ) ); break;    // CPL bit
+      case 0xC2u: WriteBit( IMM(), 0u ); break;                                              // CLR bit
+      case 0xD2u: WriteBit( IMM(), 1u ); break;                                              // SETB bit
+      case 0xB3u: PSW ^= PSW_CY; break;                                                      // CPL C
+      case 0xC3u: PSW &= (U8)~PSW_CY; break;                                                 // CLR C
+      case 0xD3u: PSW |= PSW_CY; break;                                                      // SETB C
+
+      // Moves
+      case 0x74u: ACC = IMM(); break;
+      case 0x75u: u8A = IMM(); WriteDirect( u8A, IMM() ); break;
+      case 0x76u: case 0x77u: mau8Iram[ RN( u8Op & 1u ) ] = IMM(); break;
+      case 0x78u: case 0x79u: case 0x7Au: case 0x7Bu: case 0x7Cu: case 0x7Du: case 0x7Eu: case 0x7Fu:
+        RN( u8Op & 7u ) = IMM();
+        break;
+      case 0x85u: u8A = ReadDirect( IMM(), FALSE ); WriteDirect( IMM(), u8A ); break;  // MOV dst,src: source first
+      case 0x86u: case 0x87u: WriteDirect( IMM(), mau8Iram[ RN( u8Op & 1u ) ] ); break;
+      case 0x88u: case 0x89u: case 0x8Au: case 0x8Bu: case 0x8Cu: case 0x8Du: case 0x8Eu: case 0x8Fu:
+        WriteDirect( IMM(), RN( u8Op & 7u ) );
+        break;
+      case 0x90u:  // MOV DPTR,#data16
+        mau8Sfr[ R_DPH ] = IMM();
+        mau8Sfr[ R_DPL ] = IMM();
+        break;
+      case 0xA6u: case 0xA7u: mau8Iram[ RN( u8Op & 1u ) ] = ReadDirect( IMM(), FALSE ); break;
+      case 0xA8u: case 0xA9u: case 0xAAu: case 0xABu: case 0xACu: case 0xADu: case 0xAEu: case 0xAFu:
+        RN( u8Op & 7u ) = ReadDirect( IMM(), FALSE );
+        break;
+      case 0xE5u: ACC = ReadDirect( IMM(), FALSE ); break;
+      case 0xE6u: case 0xE7u: ACC = mau8Iram[ RN( u8Op & 1u ) ]; break;
+      case 0xE8u: case 0xE9u: case 0xEAu: case 0xEBu: case 0xECu: case 0xEDu: case 0xEEu: case 0xEFu:
+        ACC = RN( u8Op & 7u );
+        break;
+      case 0xF5u: WriteDirect( IMM(), ACC ); break;
+      case 0xF6u: case 0xF7u: mau8Iram[ RN( u8Op & 1u ) ] = ACC; break;
+      case 0xF8u: case 0xF9u: case 0xFAu: case 0xFBu: case 0xFCu: case 0xFDu: case 0xFEu: case 0xFFu:
+        RN( u8Op & 7u ) = ACC;
+        break;
+      case 0x83u: ACC = ReadCode( (U16)( mu16PC + ACC ) ); break;  // MOVC A,@A+PC
+      case 0x93u: ACC = ReadCode( (U16)( DPTR + ACC ) ); break;    // MOVC A,@A+DPTR
+      case 0xE0u: ACC = ReadX( DPTR ); break;
+      case 0xF0u: WriteX( DPTR, ACC ); break;
+      case 0xE2u: case 0xE3u: ACC = ReadX( (U16)( ( mau8Sfr[ R_P2 ] << 8u ) | RN( u8Op & 1u ) ) ); break;
+      case 0xF2u: case 0xF3u: WriteX( (U16)( ( mau8Sfr[ R_P2 ] << 8u ) | RN( u8Op & 1u ) ), ACC ); break;
+      case 0xC0u: Push( ReadDirect( IMM(), FALSE ) ); break;   // PUSH
+      case 0xD0u: u8A = IMM(); WriteDirect( u8A, Pop() ); break;  // POP
+
+      // Exchanges
+      case 0xC5u: u8A = IMM(); u8B = ReadDirect( u8A, TRUE ); WriteDirect( u8A, ACC ); ACC = u8B; break;
+      case 0xC6u: case 0xC7u:
+        u8A = RN( u8Op & 1u ); u8B = mau8Iram[ u8A ]; mau8Iram[ u8A ] = ACC; ACC = u8B;
+        break;
+      case 0xC8u: case 0xC9u: case 0xCAu: case 0xCBu: case 0xCCu: case 0xCDu: case 0xCEu: case 0xCFu:
+        u8B = RN( u8Op & 7u ); RN( u8Op & 7u ) = ACC; ACC = u8B;
+        break;
+      case 0xD6u: case 0xD7u:  // XCHD A,@Ri
+        u8A = RN( u8Op & 1u ); u8B = mau8Iram[ u8A ];
+        mau8Iram[ u8A ] = (U8)( ( u8B & 0xF0u ) | ( ACC & 0x0Fu ) );
+        ACC = (U8)( ( ACC & 0xF0u ) | ( u8B & 0x0Fu ) );
+        break;
+
+      // Accumulator
+      case 0xC4u: ACC = (U8)( ( ACC << 4u ) | ( ACC >> 4u ) ); break;  // SWAP A
+      case 0xE4u: ACC = 0u; break;                                      // CLR A
+      case 0xF4u: ACC = (U8)~ACC; break;                                // CPL A
+      case 0xA4u:  // MUL AB
+        u16Result = (U16)( ACC * mau8Sfr[ R_B ] );
+        ACC = (U8)u16Result;
+        mau8Sfr[ R_B ] = (U8)( u16Result >> 8u );
+        PSW = (U8)( ( PSW & ~( PSW_CY | PSW_OV ) ) | ( ( u16Result > 0xFFu ) ? PSW_OV : 0u ) );
+        break;
+      case 0x84u:  // DIV AB
+        PSW &= (U8)~( PSW_CY | PSW_OV );
+        if( 0u == mau8Sfr[ R_B ] )
+        {
+          PSW |= PSW_OV;
+        }
+        else
+        {
+          u8A = ACC;
+          ACC = (U8)( u8A / mau8Sfr[ R_B ] );
+          mau8Sfr[ R_B ] = (U8)( u8A % mau8Sfr[ R_B ] );
+        }
+        break;
+      case 0xD4u:  // DA A
+        u16Result = ACC;
+        if( ( ( u16Result & 0x0Fu ) > 9u ) || ( 0u != ( PSW & PSW_AC ) ) )
+        {
+          u16Result += 0x06u;
+        }
+        if( ( u16Result > 0x9Fu ) || ( 0u != CY ) || ( u16Result > 0xFFu ) )
+        {
+          u16Result += 0x60u;
+        }
+        if( u16Result > 0xFFu )
+        {
+          PSW |= PSW_CY;
+        }
+        ACC = (U8)u16Result;
+        break;
+
+      default:  // 0xA5
+        mu16PC = u16Start;
+        mu8Stop = CPU51_STOP_ILLEGAL;
+        break;
+    }
+  }
+
+  mpu64PcCycles[ u16Start ] += u32Cycles;
+  mu64Instructions++;
+  Advance( u32Cycles );
+
+#undef ACC
+#undef PSW
+#undef DPTR
+#undef CY
+#undef RN
+#undef IMM
+#undef REL
+}
+
+
+/***************************************< Public functions >**************************************/
+//----------------------------------------------------------------------------
+//! \brief  Constructor: allocates the profile and erases the memories
+//-----------------------------------------------------------------------------
+Cpu51::Cpu51() :
+  mdBatteryVolts( 3.0 ), mu32WktHz( CPU51_WKT_HZ ), mu32WktFactoryHz( CPU51_WKT_HZ ),
+  mpfPinChange( NULL ), mpfUartTx( NULL ), mpvContext( NULL ),
+  mu8WatchesNum( 0u ), mpsInputs( NULL ), mu32InputsNum( 0u ), mu32InputsNext( 0u )
+{
+  BuildTables();
+  mpu64PcCycles = new uint64_t[ 65536 ];
+  mpu32Calls = new U32[ 65536 ];
+  mpsInputs = new S_CPU51_INPUT[ MAX_INPUTS ];
+  memset( mau8Code, 0xFF, sizeof( mau8Code ) );
+  memset( mau8Eeprom, 0xFF, sizeof( mau8Eeprom ) );
+  Reset();
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Destructor
+//-----------------------------------------------------------------------------
+Cpu51::~Cpu51()
+{
+  delete[] mpu64PcCycles;
+  delete[] mpu32Calls;
+  delete[] mpsInputs;
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Power-on reset: registers, RAM, statistics. The memories of the program and the EEPROM are kept.
+//! \param  -
+//! \return -
+//-----------------------------------------------------------------------------
+void Cpu51::Reset( void )
+{
+  U8 u8Index;
+
+  memset( mau8Iram, 0, sizeof( mau8Iram ) );
+  memset( mau8Xram, 0, sizeof( mau8Xram ) );
+  memset( mau8Sfr, 0, sizeof( mau8Sfr ) );
+  memset( mau8Xsfr, 0, sizeof( mau8Xsfr ) );
+  memset( masTimers, 0, sizeof( masTimers ) );
+  memset( masPins, 0, sizeof( masPins ) );
+  memset( masVectors, 0, sizeof( masVectors ) );
+  memset( mau64RaiseCycle, 0, sizeof( mau64RaiseCycle ) );
+  memset( mpu64PcCycles, 0, 65536u * sizeof( uint64_t ) );
+  memset( mpu32Calls, 0, 65536u * sizeof( U32 ) );
+  memset( mau8PortInput, 0xFF, sizeof( mau8PortInput ) );
+  mau8Sfr[ R_SP ] = 0x07u;
+  mau8Sfr[ SFR( 0x80u ) ] = 0xFFu;  // P0
+  mau8Sfr[ R_P1 ] = 0xFFu;
+  mau8Sfr[ R_P2 ] = 0xFFu;
+  mau8Sfr[ R_P3 ] = 0xFFu;
+  mau8Sfr[ SFR( 0xC0u ) ] = 0xFFu;  // P4
+  mau8Sfr[ R_P5 ] = 0xFFu;
+  // Factory data in the top of the IDATA
+  mau8Iram[ IDATA_WKT_FREQUENCY ] = (U8)( mu32WktFactoryHz >> 8u );
+  mau8Iram[ IDATA_WKT_FREQUENCY + 1u ] = (U8)mu32WktFactoryHz;
+  mu16PC = 0u;
+  mu8ClockDivider = 1u;  // The ISP tool sets the main clock to the system clock
+  mu32UartCycles = 0u;
+  mu8UartByte = 0u;
+  mu32AdcCycles = 0u;
+  mu8IapUnlock = 0u;
+  mu64WakeTime = 0u;
+  mu64WktStart = 0u;
+  mu16WktCount = 0u;
+  mbIrqBlocked = FALSE;
+  mbIrqDirty = TRUE;
+  mu8IrqDepth = 0u;
+  mu64IrqCycles = 0u;
+  for( u8Index = 0u; u8Index < CPU51_WATCHES_NUM; u8Index++ )
+  {
+    masWatches[ u8Index ].u32Calls = 0u;
+    masWatches[ u8Index ].u64Cycles = 0u;
+    masWatches[ u8Index ].u32MaxCycles = 0u;
+    mau8WatchSp[ u8Index ] = 0u;
+  }
+  mu32InputsNext = 0u;
+  mu64NextInput = ( 0u != mu32InputsNum ) ? mpsInputs[ 0 ].u64Time : UINT64_MAX;
+  mu32PendingCycles = 0u;
+  mu8Stop = CPU51_STOP_TIME;
+  mu64Time = 0u;
+  mu64Cycles = 0u;
+  mu64IdleCycles = 0u;
+  mu64IdleTicks = 0u;
+  mu64PowerDownTicks = 0u;
+  mu64Instructions = 0u;
+  mu32IapErases = 0u;
+  mu32IapPrograms = 0u;
+  mu32NextEvent = CyclesToNextEvent();
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Loads an Intel HEX file (Keil OH51 or SDCC packihx output) into the program memory
+//! \param  pcFileName: name of the file
+//! \return TRUE if the file was read without errors
+//-----------------------------------------------------------------------------
+BOOL Cpu51::LoadHex( const char* pcFileName )
+{
+  static const U8 cau8Uid[ 7 ] = { 0xF7u, 0x8Au, 0x0Bu, 0x55u, 0x01u, 0x23u, 0x45u };
+  BOOL  bResult = TRUE;
+  BOOL  bEnd = FALSE;
+  FILE* pFile = fopen( pcFileName, "r" );
+  char  acLine[ 600 ];
+  U8    u8Length;
+  U8    u8Byte;
+  U8    u8Type;
+  U8    u8Sum;
+  U16   u16Address;
+  U16   u16Index;
+
+  if( NULL == pFile )
+  {
+    bResult = FALSE;
+  }
+  else
+  {
+    memset( mau8Code, 0xFF, sizeof( mau8Code ) );
+    while( bResult && !bEnd && ( NULL != fgets( acLine, sizeof( acLine ), pFile ) ) )
+    {
+      u8Length = HexByte( &acLine[ 1 ] );
+      if( ':' != acLine[ 0 ] )
+      {
+        // Not a record
+      }
+      else if( strlen( acLine ) < ( 11u + ( 2u * u8Length ) ) )
+      {
+        bResult = FALSE;
+      }
+      else
+      {
+        u16Address = (U16)( ( HexByte( &acLine[ 3 ] ) << 8u ) | HexByte( &acLine[ 5 ] ) );
+        u8Type = HexByte( &acLine[ 7 ] );
+        u8Sum = (U8)( u8Length + ( u16Address >> 8u ) + u16Address + u8Type );
+        for( u16Index = 0u; u16Index <= u8Length; u16Index++ )  // The data and the checksum
+        {
+          u8Byte = HexByte( &acLine[ 9u + ( 2u * u16Index ) ] );
+          u8Sum = (U8)( u8Sum + u8Byte );
+          if( ( 0u == u8Type ) && ( u16Index < u8Length ) )
+          {
+            mau8Code[ (U16)( u16Address + u16Index ) ] = u8Byte;
+          }
+        }
+        // The extended address records don't matter under 64 KB
+        bResult = ( 0u == u8Sum );
+        bEnd = ( 1u == u8Type );
+      }
+    }
+    fclose( pFile );
+    // The ISP tool writes the unique ID to the end of the program memory
+    if( 0xFFu == mau8Code[ CODE_UID ] )
+    {
+      memcpy( &mau8Code[ CODE_UID ], cau8Uid, sizeof( cau8Uid ) );
+    }
+  }
+  return bResult;
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Loads the EEPROM contents from a binary file
+//! \param  pcFileName: name of the file
+//! \return TRUE if the whole EEPROM was read
+//-----------------------------------------------------------------------------
+BOOL Cpu51::LoadEeprom( const char* pcFileName )
+{
+  BOOL  bResult = FALSE;
+  FILE* pFile = fopen( pcFileName, "rb" );
+
+  if( NULL != pFile )
+  {
+    bResult = ( sizeof( mau8Eeprom ) == fread( mau8Eeprom, 1u, sizeof( mau8Eeprom ), pFile ) );
+    fclose( pFile );
+  }
+  return bResult;
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Saves the EEPROM contents to a binary file
+//! \param  pcFileName: name of the file
+//! \return TRUE if the whole EEPROM was written
+//-----------------------------------------------------------------------------
+BOOL Cpu51::SaveEeprom( const char* pcFileName ) const
+{
+  BOOL  bResult = FALSE;
+  FILE* pFile = fopen( pcFileName, "wb" );
+
+  if( NULL != pFile )
+  {
+    bResult = ( sizeof( mau8Eeprom ) == fwrite( mau8Eeprom, 1u, sizeof( mau8Eeprom ), pFile ) );
+    fclose( pFile );
+  }
+  return bResult;
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Schedules a change of an input pin; the changes must be added in time order
+//! \param  u64Time: when, in main clock ticks
+//! \param  u8Port: CPU51_PORT_xx
+//! \param  u8Bit: bit of the port
+//! \param  u8Level: level driven from the outside; 1 releases the pin
+//! \return -
+//-----------------------------------------------------------------------------
+void Cpu51::AddInput( uint64_t u64Time, U8 u8Port, U8 u8Bit, U8 u8Level )
+{
+  if( mu32InputsNum < MAX_INPUTS )
+  {
+    mpsInputs[ mu32InputsNum ].u64Time = u64Time;
+    mpsInputs[ mu32InputsNum ].u8Port = u8Port;
+    mpsInputs[ mu32InputsNum ].u8Bit = u8Bit;
+    mpsInputs[ mu32InputsNum ].u8Level = u8Level;
+    mu32InputsNum++;
+    mu64NextInput = mpsInputs[ mu32InputsNext ].u64Time;
+  }
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Measures a function together with its callees from the next Reset(), see masWatches[]
+//! \param  u16Address: entry point of the function
+//! \return TRUE if there was room for it
+//-----------------------------------------------------------------------------
+BOOL Cpu51::Watch( U16 u16Address )
+{
+  BOOL bResult = FALSE;
+
+  if( mu8WatchesNum < CPU51_WATCHES_NUM )
+  {
+    masWatches[ mu8WatchesNum ].u16Address = u16Address;
+    mu8WatchesNum++;
+    bResult = TRUE;
+  }
+  return bResult;
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Runs the emulation
+//! \param  u64UntilTime: end of the run, in main clock ticks since reset
+//! \return CPU51_STOP_xx
+//-----------------------------------------------------------------------------
+U8 Cpu51::Run( uint64_t u64UntilTime )
+{
+  U32 u32Cycles;
+  uint64_t u64Left;
+
+  mu8Stop = CPU51_STOP_TIME;
+  while( ( CPU51_STOP_TIME == mu8Stop ) && ( mu64Time < u64UntilTime ) )
+  {
+    if( mu64Time >= mu64NextInput )
+    {
+      ApplyInputs();
+    }
+    if( 0u != ( mau8Sfr[ R_PCON ] & ( PCON_PD | PCON_IDL ) ) )
+    {
+      Sync();
+      if( 0u != ( mau8Sfr[ R_PCON ] & PCON_PD ) )
+      {
+        if( PowerDown( u64UntilTime ) )
+        {
+          mu8Stop = CPU51_STOP_OFF;
+        }
+      }
+      else
+      {
+        // Nothing is executed until an interrupt: jump to the next event
+        u32Cycles = mu32NextEvent;
+        u64Left = ( ( u64UntilTime - mu64Time ) + mu8ClockDivider - 1u ) / mu8ClockDivider;
+        u32Cycles = ( u64Left < u32Cycles ) ? (U32)u64Left : u32Cycles;
+        Advance( u32Cycles );
+        mu64IdleCycles += u32Cycles;
+        mu64IdleTicks += (uint64_t)u32Cycles * mu8ClockDivider;
+        if( mu64Time >= mu64NextInput )
+        {
+          ApplyInputs();
+        }
+        if( mbIrqDirty && CheckInterrupts() )
+        {
+          mau8Sfr[ R_PCON ] &= (U8)~PCON_IDL;
+        }
+      }
+    }
+    else if( !( mbIrqDirty && CheckInterrupts() ) )
+    {
+      Step();
+    }
+    else
+    {
+      // Entered an interrupt
+    }
+  }
+  Sync();
+  return mu8Stop;
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Gives the level of a pin
+//! \param  u8Port: CPU51_PORT_xx
+//! \param  u8Bit: bit of the port
+//! \return 0 or 1
+//-----------------------------------------------------------------------------
+U8 Cpu51::PinLevel( U8 u8Port, U8 u8Bit ) const
+{
+  return (U8)( ( ( mau8Sfr[ gcau8PortSfr[ u8Port ] ] & mau8PortInput[ u8Port ] ) >> u8Bit ) & 1u );
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Brings the low time of the pins up to the current time, for the reports
+//! \param  -
+//! \return -
+//-----------------------------------------------------------------------------
+void Cpu51::FlushPins( void )
+{
+  U8 u8Pin;
+
+  for( u8Pin = 0u; u8Pin < CPU51_PINS_NUM; u8Pin++ )
+  {
+    if( 0u == PinLevel( (U8)( u8Pin / 8u ), (U8)( u8Pin % 8u ) ) )
+    {
+      masPins[ u8Pin ].u64LowTicks += mu64Time - masPins[ u8Pin ].u64LastChange;
+    }
+    masPins[ u8Pin ].u64LastChange = mu64Time;
+  }
+}
+
+/***************************************< End of file >**************************************/
@@ -0,0 +1,200 @@
+/*! *******************************************************************************************************
+* Copyright (c) 2022 Hekk_Elek
+*
+* \file cpu51.h
+*
+* \brief Emulation of the STC8G1K08: 8051 core with the STC 1T instruction timing and the used peripherals
+*
+* \author Hekk_Elek
+*
+**********************************************************************************************************/
+#ifndef CPU51_H
+#define CPU51_H
+
+/***************************************< Includes >**************************************/
+#include <stdint.h>
+#include "types.h"
+
+
+/***************************************< Definitions >**************************************/
+#define CPU51_MAIN_CLOCK_HZ   (24000000u)  //!< Main clock (HIRC as set up by the ISP tool)
+#define CPU51_FLASH_SIZE          (8192u)  //!< Program memory of the STC8G1K08
+#define CPU51_EEPROM_SIZE         (4096u)  //!< EEPROM, readable with MOVC right after the program
+#define CPU51_EEPROM_PAGE_SIZE     (512u)  //!< Erasable page of the EEPROM
+#define CPU51_WKT_HZ             (32768u)  //!< Default frequency of the power-down wake-up timer
+
+#define CPU51_PORTS_NUM              (3u)  //!< Emulated ports: P1, P3, P5
+#define CPU51_PORT_P1                (0u)  //!< Index of P1
+#define CPU51_PORT_P3                (1u)  //!< Index of P3
+#define CPU51_PORT_P5                (2u)  //!< Index of P5
+#define CPU51_PINS_NUM  ( CPU51_PORTS_NUM * 8u )  //!< Number of pins with statistics
+
+#define CPU51_VECTORS_NUM           (16u)  //!< Interrupt vectors with statistics (number = ( address - 3 ) / 8)
+#define CPU51_WATCHES_NUM            (8u)  //!< Functions that can be measured together with their callees
+
+// Why Cpu51::Run() returned
+#define CPU51_STOP_TIME              (0u)  //!< The requested time has elapsed
+#define CPU51_STOP_OFF               (1u)  //!< Power-down without any wake-up source: the firmware turned itself off
+#define CPU51_STOP_HALT              (2u)  //!< Jump to itself with the interrupts disabled
+#define CPU51_STOP_ILLEGAL           (3u)  //!< Undefined opcode (0xA5)
+
+
+/***************************************< Types >**************************************/
+//! \brief Called on every change of an emulated pin; u64Time is in main clock ticks
+typedef void (*F_PIN_CHANGE)( void* pvContext, uint64_t u64Time, U8 u8Port, U8 u8Bit, U8 u8Level );
+
+//! \brief Called when UART1 finishes sending a byte
+typedef void (*F_UART_TX)( void* pvContext, uint64_t u64Time, U8 u8Byte );
+
+//! \brief Statistics of a pin
+typedef struct
+{
+  uint64_t u64LowTicks;   //!< Time spent low, in main clock ticks (the LEDs are active low)
+  uint64_t u64LastChange; //!< Time of the last change
+  U32      u32Edges;      //!< Number of changes
+} S_CPU51_PIN;
+
+//! \brief Statistics of an interrupt vector
+typedef struct
+{
+  U32      u32Count;       //!< Number of entries
+  uint64_t u64Cycles;      //!< Sum of the cycles from the entry to RETI (nested interrupts included)
+  U32      u32MinCycles;   //!< Shortest run
+  U32      u32MaxCycles;   //!< Longest run
+  U32      u32MaxLatency;  //!< Longest time from raising the flag to the entry, in cycles
+} S_CPU51_VECTOR;
+
+//! \brief A function measured together with its callees, see Cpu51::Watch()
+typedef struct
+{
+  U16      u16Address;     //!< Entry point
+  U32      u32Calls;       //!< Completed calls
+  uint64_t u64Cycles;      //!< Sum of the cycles of the calls
+  U32      u32MaxCycles;   //!< Longest call
+} S_CPU51_WATCH;
+
+//! \brief Scheduled change of an input pin (e.g. the button)
+typedef struct
+{
+  uint64_t u64Time;   //!< When, in main clock ticks
+  U8       u8Port;    //!< CPU51_PORT_xx
+  U8       u8Bit;     //!< Bit of the port
+  U8       u8Level;   //!< New level driven from the outside; 1 releases the pin
+} S_CPU51_INPUT;
+
+//! \brief The emulated microcontroller
+class Cpu51
+{
+public:
+  Cpu51();
+  ~Cpu51();
+  void Reset( void );
+  BOOL LoadHex( const char* pcFileName );
+  BOOL LoadEeprom( const char* pcFileName );
+  BOOL SaveEeprom( const char* pcFileName ) const;
+  void AddInput( uint64_t u64Time, U8 u8Port, U8 u8Bit, U8 u8Level );
+  BOOL Watch( U16 u16Address );
+  U8   Run( uint64_t u64UntilTime );
+  U8   PinLevel( U8 u8Port, U8 u8Bit ) const;
+  void FlushPins( void );
+
+  // Settings, may be changed before Reset()
+  double   mdBatteryVolts;   //!< Supply voltage, seen through the internal reference on ADC channel 15
+  U32      mu32WktHz;        //!< Real frequency of the wake-up timer
+  U32      mu32WktFactoryHz; //!< Frequency stored in IDATA 0xF8 by the factory (what the firmware believes)
+  F_PIN_CHANGE mpfPinChange; //!< Optional pin change callback
+  F_UART_TX    mpfUartTx;    //!< Optional UART transmit callback
+  void*    mpvContext;       //!< Passed to the callbacks
+
+  // State, for the reports
+  uint64_t mu64Time;         //!< Main clock ticks since reset
+  uint64_t mu64Cycles;       //!< System clock cycles since reset (idle included; power-down excluded)
+  uint64_t mu64IdleCycles;   //!< System clock cycles spent in idle mode
+  uint64_t mu64IdleTicks;    //!< Main clock ticks spent in idle mode
+  uint64_t mu64PowerDownTicks; //!< Main clock ticks spent in power-down mode
+  uint64_t mu64Instructions; //!< Executed instructions
+  U32      mu32IapErases;    //!< Number of EEPROM page erases
+  U32      mu32IapPrograms;  //!< Number of EEPROM byte programs
+  S_CPU51_PIN    masPins[ CPU51_PINS_NUM ];        //!< Pin statistics, 8 per port
+  S_CPU51_VECTOR masVectors[ CPU51_VECTORS_NUM ];  //!< Interrupt statistics
+  uint64_t* mpu64PcCycles;   //!< Cycles spent on each instruction address (65536 entries)
+  U32*      mpu32Calls;      //!< Number of calls to each address (65536 entries)
+  S_CPU51_WATCH masWatches[ CPU51_WATCHES_NUM ];  //!< Functions measured with their callees
+  U8        mu8WatchesNum;   //!< Number of used entries of masWatches[]
+
+  U8   mau8Code[ 65536 ];                  //!< Program memory
+  U8   mau8Eeprom[ CPU51_EEPROM_SIZE ];    //!< EEPROM contents
+  U8   mau8Iram[ 256 ];                    //!< Internal RAM (DATA and IDATA)
+  U8   mau8Xram[ 65536 ];                  //!< XDATA
+  U8   mau8Sfr[ 128 ];                     //!< Special function registers 0x80..0xFF
+  U8   mau8Xsfr[ 512 ];                    //!< Extended SFRs 0xFD00..0xFEFF
+
+private:
+  // Timers 0 and 1
+  typedef struct
+  {
+    U32  u32Count;    //!< Counter (TH:TL)
+    U16  u16Reload;   //!< Reload value of mode 0
+    U8   u8Prescale;  //!< Counts the system clock in 12T mode
+  } S_TIMER;
+
+  void Step( void );
+  void Advance( U32 u32Cycles );
+  void Sync( void );
+  void AdvanceTimer( U8 u8Timer, U32 u32Cycles, uint64_t u64Base );
+  U32  CyclesToNextEvent( void ) const;
+  void ApplyInputs( void );
+  BOOL CheckInterrupts( void );
+  BOOL PowerDown( uint64_t u64UntilTime );
+  U8   ReadDirect( U8 u8Address, BOOL bLatch );
+  void WriteDirect( U8 u8Address, U8 u8Value );
+  U8   ReadBit( U8 u8BitAddress, BOOL bLatch );
+  void WriteBit( U8 u8BitAddress, U8 u8Value );
+  U8   ReadX( U16 u16Address );
+  void WriteX( U16 u16Address, U8 u8Value );
+  U8   ReadCode( U16 u16Address );
+  void WritePort( U8 u8Port, U8 u8Value );
+  void PinChange( U8 u8Port, U8 u8Bit, U8 u8Level );
+  void IapTrigger( void );
+  void StartAdc( void );
+  void Push( U8 u8Value );
+  U8   Pop( void );
+  void WatchCall( U32 u32Cycles );
+  void WatchReturn( U32 u32Cycles );
+
+  U16  mu16PC;               //!< Program counter
+  U8   mu8Stop;              //!< CPU51_STOP_xx, set by Step() to end the run
+  U32  mu32PendingCycles;    //!< Cycles not yet applied to the peripherals (see Sync())
+  U32  mu32NextEvent;        //!< The peripherals need a Sync() after this many pending cycles
+  BOOL mbIrqDirty;           //!< The interrupts need to be checked
+  uint64_t mu64NextInput;    //!< Time of the next scheduled input change, UINT64_MAX if none
+  U8   mu8ClockDivider;      //!< Main clock ticks per system clock cycle
+  S_TIMER masTimers[ 2 ];    //!< Timer 0 and timer 1
+  U32  mu32UartCycles;       //!< Cycles until the byte in the UART is sent, 0 if idle
+  U8   mu8UartByte;          //!< Byte being sent
+  U32  mu32AdcCycles;        //!< Cycles until the ADC conversion is done, 0 if idle
+  U8   mau8PortInput[ CPU51_PORTS_NUM ];  //!< Levels driven from the outside
+  U8   mu8IapUnlock;         //!< Progress of the 0x5A, 0xA5 trigger sequence
+  uint64_t mu64WakeTime;     //!< End of the power-down by the wake-up timer, 0 if not running
+  uint64_t mu64WktStart;     //!< Start of the power-down with the wake-up timer
+  U16  mu16WktCount;         //!< Internal counter of the wake-up timer, read at WKTCL/WKTCH
+  BOOL mbIrqBlocked;         //!< No interrupt after RETI and after writing the interrupt registers
+  U8   mu8IrqDepth;          //!< Number of interrupts in service
+  U8   mau8IrqLevel[ 4 ];    //!< Priority of the interrupts in service
+  U8   mau8IrqVector[ 4 ];   //!< Vectors of the interrupts in service
+  uint64_t mau64IrqEntry[ 4 ];              //!< Cycle of the entries of the interrupts in service
+  uint64_t mau64RaiseCycle[ CPU51_VECTORS_NUM ];  //!< Cycle when the flag of each vector was raised
+  uint64_t mu64IrqCycles;    //!< Cycles spent in the interrupts, from the entry of the outermost one to its RETI
+  U8   mau8WatchSp[ CPU51_WATCHES_NUM ];         //!< SP after the call of each watched function, 0 if it isn't running
+  U8   mau8WatchDepth[ CPU51_WATCHES_NUM ];      //!< Interrupt depth of the call
+  uint64_t mau64WatchEntry[ CPU51_WATCHES_NUM ]; //!< Cycle of the entry
+  uint64_t mau64WatchIrq[ CPU51_WATCHES_NUM ];   //!< mu64IrqCycles at the entry
+  S_CPU51_INPUT* mpsInputs;  //!< Scheduled input changes, sorted by time
+  U32  mu32InputsNum;        //!< Number of scheduled input changes
+  U32  mu32InputsNext;       //!< Next scheduled input change to apply
+};
+
+
+#endif /* CPU51_H */
+
+/***************************************< End of file >**************************************/
@@ -0,0 +1,740 @@
+/*! *******************************************************************************************************
+* Copyright (c) 2022 Hekk_Elek
+*
+* \file emu51.cpp
+*
+* \brief Runs the compiled firmware image in the STC8G1K08 emulator: waveforms, profile and interrupt timing
+*
+* \author Hekk_Elek
+*
+**********************************************************************************************************/
+
+/*----------------------------------------------------------------------------------------
+How it works
+============
+The Intel HEX output of Keil (OH51) or SDCC is loaded into the emulated STC8G1K08 (see
+cpu51.cpp), and run from reset for the given time, or until the firmware turns itself off
+(power-down without wake-up source, e.g. the uptime auto-off). Button presses on P3.6 can
+be scheduled. The idle and power-down time costs almost nothing, so a 5-hour session takes
+as long as its active cycles need; the speed is printed at the end.
+
+The reports:
+- time spent active, idle and powered down;
+- every interrupt vector: entries, cycles from the entry to RETI (min/avg/max), the worst
+  latency from raising the flag, and the share of the awake cycles;
+- every pin of P1, P3 and P5 that moved: edges and low time (the LEDs are active low);
+- flat profile: cycles and calls of each function. The functions come from the linker
+  map (--map: Keil .M51, SDCC .map, or "address name" lines); without a map, every called
+  address and interrupt vector is a function of its own.
+The pin waveforms can be written as a VCD file for GTKWave (--vcd), optionally just a
+window of the run, and the bytes sent on the UART can be saved for telemetry_decoder.
+
+Cycle budgets (--limit) turn the run into a regression check, e.g. for the hot paths of
+an SDCC build (see the Makefile): an interrupt vector is checked with its longest run
+(nested interrupts included), a function of the map with its longest call (callees
+included, the interrupts served meanwhile excluded). The exit code is 1 if a budget is
+exceeded, or the function was never called.
+
+Build (from this directory):
+  g++ -O2 -DHOST_BUILD -I../../src cpu51.cpp emu51.cpp -o emu51
+Run:
+  ./emu51 [options] karifa.hex
+    --map <file>              symbols for the profile
+    --time <s>                length of the run (default: 18060, just over the 5-hour auto-off)
+    --press <ms>[:<ms>]       button press at the given time, for the given length (default 100 ms)
+    --battery <V>             supply voltage (default 3.0)
+    --wkt <Hz>                real frequency of the wake-up timer (factory value stays 32768)
+    --eeprom <file>           EEPROM image, loaded if it exists and saved at the end
+    --vcd <file>              pin waveforms
+    --vcd-window <ms>:<ms>    only this part of the run goes to the VCD file
+    --uart <file>             bytes sent on the UART (telemetry)
+    --top <n>                 number of functions in the profile (default 30)
+    --limit <name>:<cycles>   cycle budget of "vector<n>" or of a function of the map (repeatable)
+----------------------------------------------------------------------------------------*/
+
+/***************************************< Includes >**************************************/
+// Standard C libraries
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Own includes
+#include "types.h"
+#include "cpu51.h"
+
+
+/***************************************< Definitions >**************************************/
+#define DEFAULT_TIME_S        (18060.0)  //!< Just over the uptime auto-off
+#define DEFAULT_PRESS_MS        (100.0)  //!< Length of a button press
+#define DEFAULT_TOP               (30u)  //!< Lines of the profile
+#define MAX_SYMBOLS             (4096u)  //!< Maximum number of functions
+#define SYMBOL_NAME_LENGTH        (64u)  //!< Longest function name
+#define MAX_PRESSES              (256u)  //!< Maximum number of button presses
+#define MAX_LIMITS     CPU51_WATCHES_NUM  //!< Maximum number of cycle budgets
+#define NO_VECTOR                 (0xFFu) //!< S_LIMIT::u8Vector of a function
+#define BUTTON_PORT   CPU51_PORT_P3      //!< The button is on P3.6 (INT2)
+#define BUTTON_BIT                 (6u)
+
+//! \brief Converts seconds to main clock ticks
+#define SECONDS_TO_TICKS( dSeconds )  ( (uint64_t)( (dSeconds) * (double)CPU51_MAIN_CLOCK_HZ ) )
+
+
+/***************************************< Types >**************************************/
+//! \brief A function of the program
+typedef struct
+{
+  U16      u16Address;                      //!< Entry point
+  char     acName[ SYMBOL_NAME_LENGTH ];    //!< Name from the map, or generated
+  uint64_t u64Cycles;                       //!< Cycles spent in its body
+  U32      u32Calls;                        //!< Calls to its entry point
+} S_SYMBOL;
+
+//! \brief State of the waveform output
+typedef struct
+{
+  FILE*    pFile;        //!< VCD file, NULL if not written
+  uint64_t u64From;      //!< Start of the window, in main clock ticks
+  uint64_t u64To;        //!< End of the window
+  uint64_t u64LastTime;  //!< Last timestamp written
+  FILE*    pUartFile;    //!< UART output, NULL if not written
+} S_OUTPUT;
+
+
+//! \brief A cycle budget (--limit)
+typedef struct
+{
+  char     acName[ SYMBOL_NAME_LENGTH ];    //!< "vector<n>" or a function name
+  U32      u32Cycles;                       //!< Budget of the longest run
+  U8       u8Vector;                        //!< Interrupt vector, or NO_VECTOR
+  U8       u8Watch;                         //!< Index in Cpu51::masWatches[] of a function
+} S_LIMIT;
+
+
+/***************************************< Constants >**************************************/
+static const char* gcapcPortNames[ CPU51_PORTS_NUM ] = { "P1", "P3", "P5" };
+
+static const char* gcapcStopReasons[] =
+{
+  "time elapsed",
+  "turned off (power-down without wake-up source)",
+  "halted (jump to itself, interrupts disabled)",
+  "illegal opcode"
+};
+
+
+/***************************************< Global variables >**************************************/
+static S_SYMBOL gasSymbols[ MAX_SYMBOLS ];  //!< Functions, sorted by address
+static U32      gu32SymbolsNum;             //!< Number of functions
+static double   gadPresses[ MAX_PRESSES ][ 2 ];  //!< Button presses: time and length, in ms
+static U32      gu32PressesNum;             //!< Number of button presses
+static S_LIMIT  gasLimits[ MAX_LIMITS ];    //!< Cycle budgets
+static U32      gu32LimitsNum;              //!< Number of cycle budgets
+
+
+/***************************************< Static function definitions >**************************************/
+static void     AddSymbol( U16 u16Address, const char* pcName );
+static int      CompareSymbols( const void* pvA, const void* pvB );
+static int      CompareCycles( const void* pvA, const void* pvB );
+static int      ComparePresses( const void* pvA, const void* pvB );
+static BOOL     LoadMap( const char* pcFileName );
+static U32      FindSymbol( U16 u16Address );
+static void     OnPinChange( void* pvContext, uint64_t u64Time, U8 u8Port, U8 u8Bit, U8 u8Level );
+static void     OnUartTx( void* pvContext, uint64_t u64Time, U8 u8Byte );
+static void     WriteVcdHeader( FILE* pFile, const Cpu51* pcCpu );
+static uint64_t TicksToNs( uint64_t u64Ticks );
+static void     PrintReport( Cpu51* pcCpu, U8 u8Stop, double dWallSeconds, U32 u32Top );
+static BOOL     SetLimits( Cpu51* pcCpu );
+static BOOL     CheckLimits( const Cpu51* pcCpu );
+
+
+/***************************************< Static functions >**************************************/
+//----------------------------------------------------------------------------
+//! \brief  Adds a function, if there is room and its address is new
+//! \param  u16Address: entry point
+//! \param  pcName: name
+//! \return -
+//! \global gasSymbols[], gu32SymbolsNum
+//-----------------------------------------------------------------------------
+static void AddSymbol( U16 u16Address, const char* pcName )
+{
+  U32 u32Index;
+  BOOL bFound = FALSE;
+
+  for( u32Index = 0u; ( u32Index < gu32SymbolsNum ) && !bFound; u32Index++ )
+  {
+    bFound = ( gasSymbols[ u32Index ].u16Address == u16Address );
+  }
+  if( !bFound && ( gu32SymbolsNum < MAX_SYMBOLS ) )
+  {
+    memset( &gasSymbols[ gu32SymbolsNum ], 0, sizeof( S_SYMBOL ) );
+    gasSymbols[ gu32SymbolsNum ].u16Address = u16Address;
+    strncpy( gasSymbols[ gu32SymbolsNum ].acName, pcName, SYMBOL_NAME_LENGTH - 1u );
+    gu32SymbolsNum++;
+  }
+}
+
+//----------------------------------------------------------------------------
+//! \brief  qsort() comparator: by address
+//-----------------------------------------------------------------------------
+static int CompareSymbols( const void* pvA, const void* pvB )
+{
+  return (int)( (const S_SYMBOL*)pvA )->u16Address - (int)( (const S_SYMBOL*)pvB )->u16Address;
+}
+
+//----------------------------------------------------------------------------
+//! \brief  qsort() comparator: by cycles, descending
+//-----------------------------------------------------------------------------
+static int CompareCycles( const void* pvA, const void* pvB )
+{
+  uint64_t u64A = ( (const S_SYMBOL*)pvA )->u64Cycles;
+  uint64_t u64B = ( (const S_SYMBOL*)pvB )->u64Cycles;
+  return ( u64A < u64B ) ? 1 : ( ( u64A > u64B ) ? -1 : 0 );
+}
+
+//----------------------------------------------------------------------------
+//! \brief  qsort() comparator: button presses by time
+//-----------------------------------------------------------------------------
+static int ComparePresses( const void* pvA, const void* pvB )
+{
+  double dA = ( (const double*)pvA )[ 0 ];
+  double dB = ( (const double*)pvB )[ 0 ];
+  return ( dA < dB ) ? -1 : ( ( dA > dB ) ? 1 : 0 );
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Reads the code symbols of a linker map
+//! \param  pcFileName: Keil .M51, SDCC .map, or a list of "address name" lines
+//! \return TRUE if the file could be read
+//! \global gasSymbols[], gu32SymbolsNum
+//! \note   Keil:  "  C:0A5EH         PUBLIC        LED_Interrupt"
+//!         SDCC:  "     C:   00000A5E  _LED_Interrupt     led"
+//-----------------------------------------------------------------------------
+static BOOL LoadMap( const char* pcFileName )
+{
+  BOOL  bResult = FALSE;
+  FILE* pFile = fopen( pcFileName, "r" );
+  char  acLine[ 512 ];
+  char  acKind[ 32 ];
+  char  acName[ SYMBOL_NAME_LENGTH ];
+  char  acRest[ 8 ];
+  unsigned int uiAddress;
+
+  if( NULL != pFile )
+  {
+    bResult = TRUE;
+    while( NULL != fgets( acLine, sizeof( acLine ), pFile ) )
+    {
+      if( 3 == sscanf( acLine, " C:%4xH %31s %63s", &uiAddress, acKind, acName ) )
+      {
+        // Keil: public and static functions; labels of the compiler start with '?'
+        if( ( ( 0 == strcmp( acKind, "PUBLIC" ) ) || ( 0 == strcmp( acKind, "SYMBOL" ) ) ) && ( '?' != acName[ 0 ] ) )
+        {
+          AddSymbol( (U16)uiAddress, acName );
+        }
+      }
+      else if( 2 == sscanf( acLine, " C: %8x %63s", &uiAddress, acName ) )
+      {
+        AddSymbol( (U16)uiAddress, acName );
+      }
+      else if( ( 2 == sscanf( acLine, " %x %63s %7s", &uiAddress, acName, acRest ) ) && ( uiAddress <= 0xFFFFu ) )
+      {
+        AddSymbol( (U16)uiAddress, acName );
+      }
+      else
+      {
+        // Not a code symbol
+      }
+    }
+    fclose( pFile );
+  }
+  return bResult;
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Finds the function containing an address
+//! \param  u16Address: code address
+//! \return Index in gasSymbols[] (sorted), or MAX_SYMBOLS if it's before every function
+//! \global gasSymbols[], gu32SymbolsNum
+//-----------------------------------------------------------------------------
+static U32 FindSymbol( U16 u16Address )
+{
+  U32 u32Low = 0u;
+  U32 u32High = gu32SymbolsNum;
+  U32 u32Middle;
+
+  // Last symbol with an address <= u16Address
+  while( u32Low < u32High )
+  {
+    u32Middle = ( u32Low + u32High ) / 2u;
+    if( gasSymbols[ u32Middle ].u16Address <= u16Address )
+    {
+      u32Low = u32Middle + 1u;
+    }
+    else
+    {
+      u32High = u32Middle;
+    }
+  }
+  return ( 0u == u32Low ) ? MAX_SYMBOLS : ( u32Low - 1u );
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Time conversion for the VCD file
+//! \param  u64Ticks: main clock ticks
+//! \return Nanoseconds
+//-----------------------------------------------------------------------------
+static uint64_t TicksToNs( uint64_t u64Ticks )
+{
+  return ( u64Ticks * 1000000000ull ) / CPU51_MAIN_CLOCK_HZ;
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Pin change callback: writes the VCD file
+//! \param  pvContext: S_OUTPUT
+//! \param  u64Time: main clock ticks
+//! \param  u8Port: CPU51_PORT_xx
+//! \param  u8Bit: bit of the port
+//! \param  u8Level: new level
+//! \return -
+//-----------------------------------------------------------------------------
+static void OnPinChange( void* pvContext, uint64_t u64Time, U8 u8Port, U8 u8Bit, U8 u8Level )
+{
+  S_OUTPUT* psOutput = (S_OUTPUT*)pvContext;
+
+  if( ( NULL != psOutput->pFile ) && ( u64Time >= psOutput->u64From ) && ( u64Time <= psOutput->u64To ) )
+  {
+    if( u64Time != psOutput->u64LastTime )
+    {
+      fprintf( psOutput->pFile, "#%llu\n", (unsigned long long)TicksToNs( u64Time ) );
+      psOutput->u64LastTime = u64Time;
+    }
+    fprintf( psOutput->pFile, "%u%c\n", u8Level, (char)( '!' + ( u8Port * 8u ) + u8Bit ) );
+  }
+}
+
+//----------------------------------------------------------------------------
+//! \brief  UART callback: saves the byte
+//! \param  pvContext: S_OUTPUT
+//! \param  u64Time: main clock ticks
+//! \param  u8Byte: the byte sent
+//! \return -
+//-----------------------------------------------------------------------------
+static void OnUartTx( void* pvContext, uint64_t u64Time, U8 u8Byte )
+{
+  S_OUTPUT* psOutput = (S_OUTPUT*)pvContext;
+
+  (void)u64Time;
+  if( NULL != psOutput->pUartFile )
+  {
+    fputc( u8Byte, psOutput->pUartFile );
+  }
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Writes the VCD header and the initial levels
+//! \param  pFile: VCD file
+//! \param  pcCpu: the emulator after reset
+//! \return -
+//-----------------------------------------------------------------------------
+static void WriteVcdHeader( FILE* pFile, const Cpu51* pcCpu )
+{
+  U8 u8Port;
+  U8 u8Bit;
+
+  fprintf( pFile, "$timescale 1ns $end\n$scope module stc8g $end\n" );
+  for( u8Port = 0u; u8Port < CPU51_PORTS_NUM; u8Port++ )
+  {
+    for( u8Bit = 0u; u8Bit < 8u; u8Bit++ )
+    {
+      fprintf( pFile, "$var wire 1 %c %s_%u $end\n", (char)( '!' + ( u8Port * 8u ) + u8Bit ), gcapcPortNames[ u8Port ], u8Bit );
+    }
+  }
+  fprintf( pFile, "$upscope $end\n$enddefinitions $end\n#0\n$dumpvars\n" );
+  for( u8Port = 0u; u8Port < CPU51_PORTS_NUM; u8Port++ )
+  {
+    for( u8Bit = 0u; u8Bit < 8u; u8Bit++ )
+    {
+      fprintf( pFile, "%u%c\n", pcCpu->PinLevel( u8Port, u8Bit ), (char)( '!' + ( u8Port * 8u ) + u8Bit ) );
+    }
+  }
+  fprintf( pFile, "$end\n" );
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Prints the reports of the run
+//! \param  pcCpu: the emulator
+//! \param  u8Stop: reason of stopping (CPU51_STOP_xx)
+//! \param  dWallSeconds: host time of the run
+//! \param  u32Top: number of functions in the profile
+//! \return -
+//! \global gasSymbols[], gu32SymbolsNum
+//-----------------------------------------------------------------------------
+static void PrintReport( Cpu51* pcCpu, U8 u8Stop, double dWallSeconds, U32 u32Top )
+{
+  double   dSeconds = (double)pcCpu->mu64Time / CPU51_MAIN_CLOCK_HZ;
+  uint64_t u64Awake = pcCpu->mu64Cycles;
+  uint64_t u64Total = 0u;
+  uint64_t u64Unknown = 0u;
+  U32      u32Index;
+  U32      u32Symbol;
+  U8       u8Vector;
+  U8       u8Pin;
+  const S_CPU51_VECTOR* psVector;
+  const S_CPU51_PIN*    psPin;
+
+  printf( "Stopped: %s\n", gcapcStopReasons[ u8Stop ] );
+  printf( "Emulated time: %.3f s (active %.2f %%, idle %.2f %%, power-down %.2f %%)\n", dSeconds,
+          100.0 * (double)( pcCpu->mu64Time - pcCpu->mu64IdleTicks - pcCpu->mu64PowerDownTicks ) / (double)pcCpu->mu64Time,
+          100.0 * (double)pcCpu->mu64IdleTicks / (double)pcCpu->mu64Time,
+          100.0 * (double)pcCpu->mu64PowerDownTicks / (double)pcCpu->mu64Time );
+  printf( "Instructions: %llu, active cycles: %llu, EEPROM erases: %u, programs: %u\n",
+          (unsigned long long)pcCpu->mu64Instructions, (unsigned long long)( pcCpu->mu64Cycles - pcCpu->mu64IdleCycles ),
+          pcCpu->mu32IapErases, pcCpu->mu32IapPrograms );
+  printf( "Host time: %.2f s, %.0fx real time, %.1f million instructions/s\n\n", dWallSeconds,
+          dSeconds / dWallSeconds, (double)pcCpu->mu64Instructions / dWallSeconds / 1e6 );
+
+  printf( "Interrupts (cycles from the entry to RETI, nested ones included)\n" );
+  printf( "vector address   entries      min      avg      max  max_latency  load_%%\n" );
+  for( u8Vector = 0u; u8Vector < CPU51_VECTORS_NUM; u8Vector++ )
+  {
+    psVector = &pcCpu->masVectors[ u8Vector ];
+    if( 0u != psVector->u32Count )
+    {
+      printf( "%6u  0x%04X %9u %8u %8.1f %8u %12u %7.3f\n", u8Vector, ( u8Vector * 8u ) + 3u, psVector->u32Count,
+              psVector->u32MinCycles, (double)psVector->u64Cycles / psVector->u32Count, psVector->u32MaxCycles,
+              psVector->u32MaxLatency, ( 0u != u64Awake ) ? ( 100.0 * (double)psVector->u64Cycles / (double)u64Awake ) : 0.0 );
+    }
+  }
+
+  printf( "\nPins (low time: share of the whole run)\n" );
+  printf( "pin      edges   low_%%\n" );
+  pcCpu->FlushPins();
+  for( u8Pin = 0u; u8Pin < CPU51_PINS_NUM; u8Pin++ )
+  {
+    psPin = &pcCpu->masPins[ u8Pin ];
+    if( ( 0u != psPin->u32Edges ) || ( 0u != psPin->u64LowTicks ) )
+    {
+      printf( "%s.%u %10u %7.3f\n", gcapcPortNames[ u8Pin / 8u ], u8Pin % 8u, psPin->u32Edges,
+              100.0 * (double)psPin->u64LowTicks / (double)pcCpu->mu64Time );
+    }
+  }
+
+  // Without a map every called address and interrupt vector becomes a function
+  for( u32Index = 0u; u32Index < 65536u; u32Index++ )
+  {
+    if( ( 0u != pcCpu->mpu32Calls[ u32Index ] )
+     || ( ( 0u != pcCpu->mpu64PcCycles[ u32Index ] ) && ( 3u == ( u32Index & 7u ) ) && ( u32Index < ( CPU51_VECTORS_NUM * 8u ) ) )
+     || ( 0u == u32Index ) )
+    {
+      char acName[ 16 ];
+      snprintf( acName, sizeof( acName ), "sub_%04X", u32Index );
+      AddSymbol( (U16)u32Index, acName );
+    }
+  }
+  qsort( gasSymbols, gu32SymbolsNum, sizeof( S_SYMBOL ), CompareSymbols );
+  for( u32Index = 0u; u32Index < 65536u; u32Index++ )
+  {
+    if( 0u != pcCpu->mpu64PcCycles[ u32Index ] )
+    {
+      u32Symbol = FindSymbol( (U16)u32Index );
+      if( MAX_SYMBOLS == u32Symbol )
+      {
+        u64Unknown += pcCpu->mpu64PcCycles[ u32Index ];
+      }
+      else
+      {
+        gasSymbols[ u32Symbol ].u64Cycles += pcCpu->mpu64PcCycles[ u32Index ];
+      }
+      u64Total += pcCpu->mpu64PcCycles[ u32Index ];
+    }
+  }
+  for( u32Index = 0u; u32Index < gu32SymbolsNum; u32Index++ )
+  {
+    gasSymbols[ u32Index ].u32Calls = pcCpu->mpu32Calls[ gasSymbols[ u32Index ].u16Address ];
+  }
+  qsort( gasSymbols, gu32SymbolsNum, sizeof( S_SYMBOL ), CompareCycles );
+
+  printf( "\nProfile (cycles of the function bodies, callees excluded)\n" );
+  printf( "      cycles  share_%%      calls  cyc/call  address  function\n" );
+  for( u32Index = 0u; ( u32Index < gu32SymbolsNum ) && ( u32Index < u32Top ) && ( 0u != gasSymbols[ u32Index ].u64Cycles ); u32Index++ )
+  {
+    const S_SYMBOL* psSymbol = &gasSymbols[ u32Index ];
+    printf( "%12llu %8.3f %10u %9.1f   0x%04X  %s\n", (unsigned long long)psSymbol->u64Cycles,
+            100.0 * (double)psSymbol->u64Cycles / (double)u64Total, psSymbol->u32Calls,
+            ( 0u != psSymbol->u32Calls ) ? ( (double)psSymbol->u64Cycles / psSymbol->u32Calls ) : 0.0,
+            psSymbol->u16Address, psSymbol->acName );
+  }
+  if( 0u != u64Unknown )
+  {
+    printf( "%12llu %8.3f  (before the first function)\n", (unsigned long long)u64Unknown, 100.0 * (double)u64Unknown / (double)u64Total );
+  }
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Resolves the cycle budgets: vector number, or watched function of the map
+//! \param  pcCpu: the emulator, before its reset
+//! \return FALSE if a function isn't in the map
+//! \global gasLimits[], gu32LimitsNum, gasSymbols[], gu32SymbolsNum
+//! \note   SDCC prefixes the C names with '_', both forms are accepted.
+//-----------------------------------------------------------------------------
+static BOOL SetLimits( Cpu51* pcCpu )
+{
+  BOOL bResult = TRUE;
+  U32  u32Limit;
+  U32  u32Symbol;
+  unsigned int uiVector;
+  char cEnd;
+
+  for( u32Limit = 0u; u32Limit < gu32LimitsNum; u32Limit++ )
+  {
+    S_LIMIT* psLimit = &gasLimits[ u32Limit ];
+    if( ( 1 == sscanf( psLimit->acName, "vector%u%c", &uiVector, &cEnd ) ) && ( uiVector < CPU51_VECTORS_NUM ) )
+    {
+      psLimit->u8Vector = (U8)uiVector;
+    }
+    else
+    {
+      psLimit->u8Vector = NO_VECTOR;
+      for( u32Symbol = 0u; u32Symbol < gu32SymbolsNum; u32Symbol++ )
+      {
+        const char* pcName = gasSymbols[ u32Symbol ].acName;
+        if( ( 0 == strcmp( pcName, psLimit->acName ) ) || ( ( '_' == pcName[ 0 ] ) && ( 0 == strcmp( pcName + 1, psLimit->acName ) ) ) )
+        {
+          break;
+        }
+      }
+      if( u32Symbol < gu32SymbolsNum )
+      {
+        psLimit->u8Watch = pcCpu->mu8WatchesNum;
+        (void)pcCpu->Watch( gasSymbols[ u32Symbol ].u16Address );
+      }
+      else
+      {
+        fprintf( stderr, "%s is not in the map\n", psLimit->acName );
+        bResult = FALSE;
+      }
+    }
+  }
+  return bResult;
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Prints the cycle budgets with the measured worst cases
+//! \param  pcCpu: the emulator after the run
+//! \return TRUE if every budget is kept
+//! \global gasLimits[], gu32LimitsNum
+//-----------------------------------------------------------------------------
+static BOOL CheckLimits( const Cpu51* pcCpu )
+{
+  BOOL bResult = TRUE;
+  U32  u32Limit;
+  U32  u32Count;
+  U32  u32Max;
+  BOOL bKept;
+
+  printf( "\nCycle budgets (interrupts: nested ones included; functions: callees included, interrupts excluded)\n" );
+  printf( "      runs       max    budget  result  name\n" );
+  for( u32Limit = 0u; u32Limit < gu32LimitsNum; u32Limit++ )
+  {
+    const S_LIMIT* psLimit = &gasLimits[ u32Limit ];
+    if( NO_VECTOR != psLimit->u8Vector )
+    {
+      u32Count = pcCpu->masVectors[ psLimit->u8Vector ].u32Count;
+      u32Max = pcCpu->masVectors[ psLimit->u8Vector ].u32MaxCycles;
+    }
+    else
+    {
+      u32Count = pcCpu->masWatches[ psLimit->u8Watch ].u32Calls;
+      u32Max = pcCpu->masWatches[ psLimit->u8Watch ].u32MaxCycles;
+    }
+    bKept = ( 0u != u32Count ) && ( u32Max <= psLimit->u32Cycles );
+    printf( "%10u %9u %9u  %-6s  %s\n", u32Count, u32Max, psLimit->u32Cycles,
+            ( 0u == u32Count ) ? "unused" : ( bKept ? "ok" : "OVER" ), psLimit->acName );
+    bResult = bResult && bKept;
+  }
+  return bResult;
+}
+
+
+/***************************************< Public functions >**************************************/
+//----------------------------------------------------------------------------
+//! \brief  Main function
+//! \param  argc, argv: see the usage
+//! \return 0 on success, 1 on an error or an exceeded cycle budget, 2 on a wrong command line
+//-----------------------------------------------------------------------------
+int main( int argc, char** argv )
+{
+  static Cpu51 cCpu;  // Too large for the stack
+  S_OUTPUT    sOutput;
+  const char* pcHexFile = NULL;
+  const char* pcMapFile = NULL;
+  const char* pcEepromFile = NULL;
+  const char* pcVcdFile = NULL;
+  const char* pcUartFile = NULL;
+  double      dTime = DEFAULT_TIME_S;
+  double      dFrom = 0.0;
+  double      dTo = -1.0;
+  U32         u32Top = DEFAULT_TOP;
+  U32         u32Index;
+  U8          u8Stop;
+  struct timespec sStart;
+  struct timespec sEnd;
+  int         iArg;
+  BOOL        bUsage = FALSE;
+
+  for( iArg = 1; ( iArg < argc ) && !bUsage; iArg++ )
+  {
+    BOOL bHasValue = ( ( iArg + 1 ) < argc );
+    if( ( 0 == strcmp( argv[ iArg ], "--map" ) ) && bHasValue )
+    {
+      pcMapFile = argv[ ++iArg ];
+    }
+    else if( ( 0 == strcmp( argv[ iArg ], "--time" ) ) && bHasValue )
+    {
+      dTime = atof( argv[ ++iArg ] );
+    }
+    else if( ( 0 == strcmp( argv[ iArg ], "--press" ) ) && bHasValue && ( gu32PressesNum < MAX_PRESSES ) )
+    {
+      const char* pcLength = strchr( argv[ ++iArg ], ':' );
+      gadPresses[ gu32PressesNum ][ 0 ] = atof( argv[ iArg ] );
+      gadPresses[ gu32PressesNum ][ 1 ] = ( NULL != pcLength ) ? atof( pcLength + 1 ) : DEFAULT_PRESS_MS;
+      gu32PressesNum++;
+    }
+    else if( ( 0 == strcmp( argv[ iArg ], "--battery" ) ) && bHasValue )
+    {
+      cCpu.mdBatteryVolts = atof( argv[ ++iArg ] );
+    }
+    else if( ( 0 == strcmp( argv[ iArg ], "--wkt" ) ) && bHasValue )
+    {
+      cCpu.mu32WktHz = (U32)atoi( argv[ ++iArg ] );
+    }
+    else if( ( 0 == strcmp( argv[ iArg ], "--eeprom" ) ) && bHasValue )
+    {
+      pcEepromFile = argv[ ++iArg ];
+    }
+    else if( ( 0 == strcmp( argv[ iArg ], "--vcd" ) ) && bHasValue )
+    {
+      pcVcdFile = argv[ ++iArg ];
+    }
+    else if( ( 0 == strcmp( argv[ iArg ], "--vcd-window" ) ) && bHasValue )
+    {
+      const char* pcTo = strchr( argv[ ++iArg ], ':' );
+      dFrom = atof( argv[ iArg ] );
+      dTo = ( NULL != pcTo ) ? atof( pcTo + 1 ) : -1.0;
+    }
+    else if( ( 0 == strcmp( argv[ iArg ], "--uart" ) ) && bHasValue )
+    {
+      pcUartFile = argv[ ++iArg ];
+    }
+    else if( ( 0 == strcmp( argv[ iArg ], "--top" ) ) && bHasValue )
+    {
+      u32Top = (U32)atoi( argv[ ++iArg ] );
+    }
+    else if( ( 0 == strcmp( argv[ iArg ], "--limit" ) ) && bHasValue && ( gu32LimitsNum < MAX_LIMITS ) )
+    {
+      const char* pcCycles = strchr( argv[ ++iArg ], ':' );
+      if( ( NULL != pcCycles ) && ( pcCycles != argv[ iArg ] ) && ( (size_t)( pcCycles - argv[ iArg ] ) < SYMBOL_NAME_LENGTH ) )
+      {
+        memcpy( gasLimits[ gu32LimitsNum ].acName, argv[ iArg ], (size_t)( pcCycles - argv[ iArg ] ) );
+        gasLimits[ gu32LimitsNum ].u32Cycles = (U32)atoi( pcCycles + 1 );
+        gu32LimitsNum++;
+      }
+      else
+      {
+        bUsage = TRUE;
+      }
+    }
+    else if( ( '-' != argv[ iArg ][ 0 ] ) && ( NULL == pcHexFile ) )
+    {
+      pcHexFile = argv[ iArg ];
+    }
+    else
+    {
+      bUsage = TRUE;
+    }
+  }
+  if( bUsage || ( NULL == pcHexFile ) )
+  {
+    fprintf( stderr, "Usage: %s [--map file] [--time s] [--press ms[:ms]]... [--battery V] [--wkt Hz]\n"
+                     "       [--eeprom file] [--vcd file] [--vcd-window ms:ms] [--uart file] [--top n]\n"
+                     "       [--limit name:cycles]... <hex file>\n", argv[ 0 ] );
+    return 2;
+  }
+  if( !cCpu.LoadHex( pcHexFile ) )
+  {
+    fprintf( stderr, "Can't load %s\n", pcHexFile );
+    return 1;
+  }
+  if( ( NULL != pcMapFile ) && !LoadMap( pcMapFile ) )
+  {
+    fprintf( stderr, "Can't load %s\n", pcMapFile );
+    return 1;
+  }
+  if( ( NULL != pcEepromFile ) && !cCpu.LoadEeprom( pcEepromFile ) )
+  {
+    printf( "%s not found, starting with an erased EEPROM\n", pcEepromFile );
+  }
+  if( !SetLimits( &cCpu ) )
+  {
+    return 1;
+  }
+  cCpu.Reset();
+
+  // Button presses: P3.6 is pulled low while pressed
+  qsort( gadPresses, gu32PressesNum, sizeof( gadPresses[ 0 ] ), ComparePresses );
+  for( u32Index = 0u; u32Index < gu32PressesNum; u32Index++ )
+  {
+    cCpu.AddInput( SECONDS_TO_TICKS( gadPresses[ u32Index ][ 0 ] / 1000.0 ), BUTTON_PORT, BUTTON_BIT, 0u );
+    cCpu.AddInput( SECONDS_TO_TICKS( ( gadPresses[ u32Index ][ 0 ] + gadPresses[ u32Index ][ 1 ] ) / 1000.0 ), BUTTON_PORT, BUTTON_BIT, 1u );
+  }
+
+  memset( &sOutput, 0, sizeof( sOutput ) );
+  sOutput.u64From = SECONDS_TO_TICKS( dFrom / 1000.0 );
+  sOutput.u64To = ( dTo < 0.0 ) ? UINT64_MAX : SECONDS_TO_TICKS( dTo / 1000.0 );
+  sOutput.u64LastTime = UINT64_MAX;
+  if( NULL != pcVcdFile )
+  {
+    sOutput.pFile = fopen( pcVcdFile, "w" );
+    if( NULL == sOutput.pFile )
+    {
+      perror( pcVcdFile );
+      return 1;
+    }
+    WriteVcdHeader( sOutput.pFile, &cCpu );
+  }
+  if( NULL != pcUartFile )
+  {
+    sOutput.pUartFile = fopen( pcUartFile, "wb" );
+    if( NULL == sOutput.pUartFile )
+    {
+      perror( pcUartFile );
+      return 1;
+    }
+  }
+  cCpu.mpvContext = &sOutput;
+  cCpu.mpfPinChange = OnPinChange;
+  cCpu.mpfUartTx = OnUartTx;
+
+  clock_gettime( CLOCK_MONOTONIC, &sStart );
+  u8Stop = cCpu.Run( SECONDS_TO_TICKS( dTime ) );
+  clock_gettime( CLOCK_MONOTONIC, &sEnd );
+
+  if( NULL != sOutput.pFile )
+  {
+    fprintf( sOutput.pFile, "#%llu\n", (unsigned long long)TicksToNs( cCpu.mu64Time ) );
+    fclose( sOutput.pFile );
+  }
+  if( NULL != sOutput.pUartFile )
+  {
+    fclose( sOutput.pUartFile );
+  }
+  if( ( NULL != pcEepromFile ) && !cCpu.SaveEeprom( pcEepromFile ) )
+  {
+    perror( pcEepromFile );
+  }
+  PrintReport( &cCpu, u8Stop, (double)( sEnd.tv_sec - sStart.tv_sec ) + ( 1e-9 * (double)( sEnd.tv_nsec - sStart.tv_nsec ) ), u32Top );
+  return ( ( 0u == gu32LimitsNum ) || CheckLimits( &cCpu ) ) ? 0 : 1;
+}
+
+/***************************************< End of file >**************************************/
@@ -0,0 +1,883 @@
+/*! *******************************************************************************************************
+* Copyright (c) 2022 Hekk_Elek
+*
+* \file host_sfr_list.h
+*
+* \brief List of the STC8G special function registers for the host simulation
+*
+* \author Hekk_Elek
+*
+**********************************************************************************************************/
+// NOTE: No include guard on purpose, this is an X-macro list. Generated from the Keil part of stc8g.h.
+//       HOST_SFR( name, address )
+//       HOST_SBIT( name, address of the SFR, bit )
+//       HOST_XSFR8( name, XDATA address ) / HOST_XSFR16( name, XDATA address )
+
+HOST_SFR(   P0          , 0x80u )
+HOST_SBIT(  P00         , 0x80u, 0u )
+HOST_SBIT(  P01         , 0x80u, 1u )
+HOST_SBIT(  P02         , 0x80u, 2u )
+HOST_SBIT(  P03         , 0x80u, 3u )
+HOST_SBIT(  P04         , 0x80u, 4u )
+HOST_SBIT(  P05         , 0x80u, 5u )
+HOST_SBIT(  P06         , 0x80u, 6u )
+HOST_SBIT(  P07         , 0x80u, 7u )
+HOST_SFR(   SP          , 0x81u )
+HOST_SFR(   DPL         , 0x82u )
+HOST_SFR(   DPH         , 0x83u )
+HOST_SFR(   S4CON       , 0x84u )
+HOST_SFR(   S4BUF       , 0x85u )
+HOST_SFR(   PCON        , 0x87u )
+HOST_SFR(   TCON        , 0x88u )
+HOST_SBIT(  TF1         , 0x88u, 7u )
+HOST_SBIT(  TR1         , 0x88u, 6u )
+HOST_SBIT(  TF0         , 0x88u, 5u )
+HOST_SBIT(  TR0         , 0x88u, 4u )
+HOST_SBIT(  IE1         , 0x88u, 3u )
+HOST_SBIT(  IT1         , 0x88u, 2u )
+HOST_SBIT(  IE0         , 0x88u, 1u )
+HOST_SBIT(  IT0         , 0x88u, 0u )
+HOST_SFR(   TMOD        , 0x89u )
+HOST_SFR(   TL0         , 0x8Au )
+HOST_SFR(   TL1         , 0x8Bu )
+HOST_SFR(   TH0         , 0x8Cu )
+HOST_SFR(   TH1         , 0x8Du )
+HOST_SFR(   AUXR        , 0x8Eu )
+HOST_SFR(   INTCLKO     , 0x8Fu )
+HOST_SFR(   P1          , 0x90u )
+HOST_SBIT(  P10         , 0x90u, 0u )
+HOST_SBIT(  P11         , 0x90u, 1u )
+HOST_SBIT(  P12         , 0x90u, 2u )
+HOST_SBIT(  P13         , 0x90u, 3u )
+HOST_SBIT(  P14         , 0x90u, 4u )
+HOST_SBIT(  P15         , 0x90u, 5u )
+HOST_SBIT(  P16         , 0x90u, 6u )
+HOST_SBIT(  P17         , 0x90u, 7u )
+HOST_SFR(   P1M1        , 0x91u )
+HOST_SFR(   P1M0        , 0x92u )
+HOST_SFR(   P0M1        , 0x93u )
+HOST_SFR(   P0M0        , 0x94u )
+HOST_SFR(   P2M1        , 0x95u )
+HOST_SFR(   P2M0        , 0x96u )
+HOST_SFR(   SCON        , 0x98u )
+HOST_SBIT(  SM0         , 0x98u, 7u )
+HOST_SBIT(  SM1         , 0x98u, 6u )
+HOST_SBIT(  SM2         , 0x98u, 5u )
+HOST_SBIT(  REN         , 0x98u, 4u )
+HOST_SBIT(  TB8         , 0x98u, 3u )
+HOST_SBIT(  RB8         , 0x98u, 2u )
+HOST_SBIT(  TI          , 0x98u, 1u )
+HOST_SBIT(  RI          , 0x98u, 0u )
+HOST_SFR(   SBUF        , 0x99u )
+HOST_SFR(   S2CON       , 0x9Au )
+HOST_SFR(   S2BUF       , 0x9Bu )
+HOST_SFR(   IRCBAND     , 0x9Du )
+HOST_SFR(   LIRTRIM     , 0x9Eu )
+HOST_SFR(   IRTRIM      , 0x9Fu )
+HOST_SFR(   P2          , 0xA0u )
+HOST_SBIT(  P20         , 0xA0u, 0u )
+HOST_SBIT(  P21         , 0xA0u, 1u )
+HOST_SBIT(  P22         , 0xA0u, 2u )
+HOST_SBIT(  P23         , 0xA0u, 3u )
+HOST_SBIT(  P24         , 0xA0u, 4u )
+HOST_SBIT(  P25         , 0xA0u, 5u )
+HOST_SBIT(  P26         , 0xA0u, 6u )
+HOST_SBIT(  P27         , 0xA0u, 7u )
+HOST_SFR(   P_SW1       , 0xA2u )
+HOST_SFR(   IE          , 0xA8u )
+HOST_SBIT(  EA          , 0xA8u, 7u )
+HOST_SBIT(  ELVD        , 0xA8u, 6u )
+HOST_SBIT(  EADC        , 0xA8u, 5u )
+HOST_SBIT(  ES          , 0xA8u, 4u )
+HOST_SBIT(  ET1         , 0xA8u, 3u )
+HOST_SBIT(  EX1         , 0xA8u, 2u )
+HOST_SBIT(  ET0         , 0xA8u, 1u )
+HOST_SBIT(  EX0         , 0xA8u, 0u )
+HOST_SFR(   SADDR       , 0xA9u )
+HOST_SFR(   WKTCL       , 0xAAu )
+HOST_SFR(   WKTCH       , 0xABu )
+HOST_SFR(   S3CON       , 0xACu )
+HOST_SFR(   S3BUF       , 0xADu )
+HOST_SFR(   TA          , 0xAEu )
+HOST_SFR(   IE2         , 0xAFu )
+HOST_SFR(   P3          , 0xB0u )
+HOST_SBIT(  P30         , 0xB0u, 0u )
+HOST_SBIT(  P31         , 0xB0u, 1u )
+HOST_SBIT(  P32         , 0xB0u, 2u )
+HOST_SBIT(  P33         , 0xB0u, 3u )
+HOST_SBIT(  P34         , 0xB0u, 4u )
+HOST_SBIT(  P35         , 0xB0u, 5u )
+HOST_SBIT(  P36         , 0xB0u, 6u )
+HOST_SBIT(  P37         , 0xB0u, 7u )
+HOST_SFR(   P3M1        , 0xB1u )
+HOST_SFR(   P3M0        , 0xB2u )
+HOST_SFR(   P4M1        , 0xB3u )
+HOST_SFR(   P4M0        , 0xB4u )
+HOST_SFR(   IP2         , 0xB5u )
+HOST_SFR(   IP2H        , 0xB6u )
+HOST_SFR(   IPH         , 0xB7u )
+HOST_SFR(   IP          , 0xB8u )
+HOST_SBIT(  PPCA        , 0xB8u, 7u )
+HOST_SBIT(  PLVD        , 0xB8u, 6u )
+HOST_SBIT(  PADC        , 0xB8u, 5u )
+HOST_SBIT(  PS          , 0xB8u, 4u )
+HOST_SBIT(  PT1         , 0xB8u, 3u )
+HOST_SBIT(  PX1         , 0xB8u, 2u )
+HOST_SBIT(  PT0         , 0xB8u, 1u )
+HOST_SBIT(  PX0         , 0xB8u, 0u )
+HOST_SFR(   SADEN       , 0xB9u )
+HOST_SFR(   P_SW2       , 0xBAu )
+HOST_SFR(   ADC_CONTR   , 0xBCu )
+HOST_SFR(   ADC_RES     , 0xBDu )
+HOST_SFR(   ADC_RESL    , 0xBEu )
+HOST_SFR(   P4          , 0xC0u )
+HOST_SBIT(  P40         , 0xC0u, 0u )
+HOST_SBIT(  P41         , 0xC0u, 1u )
+HOST_SBIT(  P42         , 0xC0u, 2u )
+HOST_SBIT(  P43         , 0xC0u, 3u )
+HOST_SBIT(  P44         , 0xC0u, 4u )
+HOST_SBIT(  P45         , 0xC0u, 5u )
+HOST_SBIT(  P46         , 0xC0u, 6u )
+HOST_SBIT(  P47         , 0xC0u, 7u )
+HOST_SFR(   WDT_CONTR   , 0xC1u )
+HOST_SFR(   IAP_DATA    , 0xC2u )
+HOST_SFR(   IAP_ADDRH   , 0xC3u )
+HOST_SFR(   IAP_ADDRL   , 0xC4u )
+HOST_SFR(   IAP_CMD     , 0xC5u )
+HOST_SFR(   IAP_TRIG    , 0xC6u )
+HOST_SFR(   IAP_CONTR   , 0xC7u )
+HOST_SFR(   P5          , 0xC8u )
+HOST_SBIT(  P50         , 0xC8u, 0u )
+HOST_SBIT(  P51         , 0xC8u, 1u )
+HOST_SBIT(  P52         , 0xC8u, 2u )
+HOST_SBIT(  P53         , 0xC8u, 3u )
+HOST_SBIT(  P54         , 0xC8u, 4u )
+HOST_SBIT(  P55         , 0xC8u, 5u )
+HOST_SBIT(  P56         , 0xC8u, 6u )
+HOST_SBIT(  P57         , 0xC8u, 7u )
+HOST_SFR(   P5M1        , 0xC9u )
+HOST_SFR(   P5M0        , 0xCAu )
+HOST_SFR(   P6M1        , 0xCBu )
+HOST_SFR(   P6M0        , 0xCCu )
+HOST_SFR(   SPSTAT      , 0xCDu )
+HOST_SFR(   SPCTL       , 0xCEu )
+HOST_SFR(   SPDAT       , 0xCFu )
+HOST_SFR(   PSW         , 0xD0u )
+HOST_SBIT(  CY          , 0xD0u, 7u )
+HOST_SBIT(  AC          , 0xD0u, 6u )
+HOST_SBIT(  F0          , 0xD0u, 5u )
+HOST_SBIT(  RS1         , 0xD0u, 4u )
+HOST_SBIT(  RS0         , 0xD0u, 3u )
+HOST_SBIT(  OV          , 0xD0u, 2u )
+HOST_SBIT(  F1          , 0xD0u, 1u )
+HOST_SBIT(  P           , 0xD0u, 0u )
+HOST_SFR(   T4T3M       , 0xD1u )
+HOST_SFR(   T4H         , 0xD2u )
+HOST_SFR(   T4L         , 0xD3u )
+HOST_SFR(   T3H         , 0xD4u )
+HOST_SFR(   T3L         , 0xD5u )
+HOST_SFR(   T2H         , 0xD6u )
+HOST_SFR(   T2L         , 0xD7u )
+HOST_SFR(   CCON        , 0xD8u )
+HOST_SBIT(  CF          , 0xD8u, 7u )
+HOST_SBIT(  CR          , 0xD8u, 6u )
+HOST_SBIT(  CCF2        , 0xD8u, 2u )
+HOST_SBIT(  CCF1        , 0xD8u, 1u )
+HOST_SBIT(  CCF0        , 0xD8u, 0u )
+HOST_SFR(   CMOD        , 0xD9u )
+HOST_SFR(   CCAPM0      , 0xDAu )
+HOST_SFR(   CCAPM1      , 0xDBu )
+HOST_SFR(   CCAPM2      , 0xDCu )
+HOST_SFR(   ADCCFG      , 0xDEu )
+HOST_SFR(   IP3         , 0xDFu )
+HOST_SFR(   ACC         , 0xE0u )
+HOST_SFR(   P7M1        , 0xE1u )
+HOST_SFR(   P7M0        , 0xE2u )
+HOST_SFR(   DPS         , 0xE3u )
+HOST_SFR(   DPL1        , 0xE4u )
+HOST_SFR(   DPH1        , 0xE5u )
+HOST_SFR(   CMPCR1      , 0xE6u )
+HOST_SFR(   CMPCR2      , 0xE7u )
+HOST_SFR(   P6          , 0xE8u )
+HOST_SFR(   CL          , 0xE9u )
+HOST_SFR(   CCAP0L      , 0xEAu )
+HOST_SFR(   CCAP1L      , 0xEBu )
+HOST_SFR(   CCAP2L      , 0xECu )
+HOST_SFR(   IP3H        , 0xEEu )
+HOST_SFR(   AUXINTIF    , 0xEFu )
+HOST_SFR(   B           , 0xF0u )
+HOST_SFR(   PWMSET      , 0xF1u )
+HOST_SFR(   PCA_PWM0    , 0xF2u )
+HOST_SFR(   PCA_PWM1    , 0xF3u )
+HOST_SFR(   PCA_PWM2    , 0xF4u )
+HOST_SFR(   IAP_TPS     , 0xF5u )
+HOST_SFR(   PWMCFG01    , 0xF6u )
+HOST_SFR(   PWMCFG23    , 0xF7u )
+HOST_SFR(   P7          , 0xF8u )
+HOST_SFR(   CH          , 0xF9u )
+HOST_SFR(   CCAP0H      , 0xFAu )
+HOST_SFR(   CCAP1H      , 0xFBu )
+HOST_SFR(   CCAP2H      , 0xFCu )
+HOST_SFR(   PWMCFG45    , 0xFEu )
+HOST_SFR(   RSTCFG      , 0xFFu )
+HOST_XSFR16( PWM0C       , 0xFF00u )
+HOST_XSFR8 ( PWM0CH      , 0xFF00u )
+HOST_XSFR8 ( PWM0CL      , 0xFF01u )
+HOST_XSFR8 ( PWM0CKS     , 0xFF02u )
+HOST_XSFR16( PWM0TADC    , 0xFF03u )
+HOST_XSFR8 ( PWM0TADCH   , 0xFF03u )
+HOST_XSFR8 ( PWM0TADCL   , 0xFF04u )
+HOST_XSFR8 ( PWM0IF      , 0xFF05u )
+HOST_XSFR8 ( PWM0FDCR    , 0xFF06u )
+HOST_XSFR16( PWM00T1     , 0xFF10u )
+HOST_XSFR8 ( PWM00T1L    , 0xFF11u )
+HOST_XSFR16( PWM00T2     , 0xFF12u )
+HOST_XSFR8 ( PWM00T2H    , 0xFF12u )
+HOST_XSFR8 ( PWM00T2L    , 0xFF13u )
+HOST_XSFR8 ( PWM00CR     , 0xFF14u )
+HOST_XSFR8 ( PWM00HLD    , 0xFF15u )
+HOST_XSFR16( PWM01T1     , 0xFF18u )
+HOST_XSFR8 ( PWM01T1H    , 0xFF18u )
+HOST_XSFR8 ( PWM01T1L    , 0xFF19u )
+HOST_XSFR16( PWM01T2     , 0xFF1Au )
+HOST_XSFR8 ( PWM01T2H    , 0xFF1Au )
+HOST_XSFR8 ( PWM01T2L    , 0xFF1Bu )
+HOST_XSFR8 ( PWM01CR     , 0xFF1Cu )
+HOST_XSFR8 ( PWM01HLD    , 0xFF1Du )
+HOST_XSFR16( PWM02T1     , 0xFF20u )
+HOST_XSFR8 ( PWM02T1H    , 0xFF20u )
+HOST_XSFR8 ( PWM02T1L    , 0xFF21u )
+HOST_XSFR16( PWM02T2     , 0xFF22u )
+HOST_XSFR8 ( PWM02T2H    , 0xFF22u )
+HOST_XSFR8 ( PWM02T2L    , 0xFF23u )
+HOST_XSFR8 ( PWM02CR     , 0xFF24u )
+HOST_XSFR8 ( PWM02HLD    , 0xFF25u )
+HOST_XSFR16( PWM03T1     , 0xFF28u )
+HOST_XSFR8 ( PWM03T1H    , 0xFF28u )
+HOST_XSFR8 ( PWM03T1L    , 0xFF29u )
+HOST_XSFR16( PWM03T2     , 0xFF2Au )
+HOST_XSFR8 ( PWM03T2H    , 0xFF2Au )
+HOST_XSFR8 ( PWM03T2L    , 0xFF2Bu )
+HOST_XSFR8 ( PWM03CR     , 0xFF2Cu )
+HOST_XSFR8 ( PWM03HLD    , 0xFF2Du )
+HOST_XSFR16( PWM04T1     , 0xFF30u )
+HOST_XSFR8 ( PWM04T1H    , 0xFF30u )
+HOST_XSFR8 ( PWM04T1L    , 0xFF31u )
+HOST_XSFR16( PWM04T2     , 0xFF32u )
+HOST_XSFR8 ( PWM04T2H    , 0xFF32u )
+HOST_XSFR8 ( PWM04T2L    , 0xFF33u )
+HOST_XSFR8 ( PWM04CR     , 0xFF34u )
+HOST_XSFR8 ( PWM04HLD    , 0xFF35u )
+HOST_XSFR16( PWM05T1     , 0xFF38u )
+HOST_XSFR8 ( PWM05T1H    , 0xFF38u )
+HOST_XSFR8 ( PWM05T1L    , 0xFF39u )
+HOST_XSFR16( PWM05T2     , 0xFF3Au )
+HOST_XSFR8 ( PWM05T2H    , 0xFF3Au )
+HOST_XSFR8 ( PWM05T2L    , 0xFF3Bu )
+HOST_XSFR8 ( PWM05CR     , 0xFF3Cu )
+HOST_XSFR8 ( PWM05HLD    , 0xFF3Du )
+HOST_XSFR16( PWM06T1     , 0xFF40u )
+HOST_XSFR8 ( PWM06T1H    , 0xFF40u )
+HOST_XSFR8 ( PWM06T1L    , 0xFF41u )
+HOST_XSFR16( PWM06T2     , 0xFF42u )
+HOST_XSFR8 ( PWM06T2H    , 0xFF42u )
+HOST_XSFR8 ( PWM06T2L    , 0xFF43u )
+HOST_XSFR8 ( PWM06CR     , 0xFF44u )
+HOST_XSFR8 ( PWM06HLD    , 0xFF45u )
+HOST_XSFR16( PWM07T1     , 0xFF48u )
+HOST_XSFR8 ( PWM07T1H    , 0xFF48u )
+HOST_XSFR8 ( PWM07T1L    , 0xFF49u )
+HOST_XSFR16( PWM07T2     , 0xFF4Au )
+HOST_XSFR8 ( PWM07T2H    , 0xFF4Au )
+HOST_XSFR8 ( PWM07T2L    , 0xFF4Bu )
+HOST_XSFR8 ( PWM07CR     , 0xFF4Cu )
+HOST_XSFR8 ( PWM07HLD    , 0xFF4Du )
+HOST_XSFR16( PWM1C       , 0xFF50u )
+HOST_XSFR8 ( PWM1CH      , 0xFF50u )
+HOST_XSFR8 ( PWM1CL      , 0xFF51u )
+HOST_XSFR8 ( PWM1CKS     , 0xFF52u )
+HOST_XSFR8 ( PWM1IF      , 0xFF55u )
+HOST_XSFR8 ( PWM1FDCR    , 0xFF56u )
+HOST_XSFR16( PWM10T1     , 0xFF60u )
+HOST_XSFR8 ( PWM10T1H    , 0xFF60u )
+HOST_XSFR8 ( PWM10T1L    , 0xFF61u )
+HOST_XSFR16( PWM10T2     , 0xFF62u )
+HOST_XSFR8 ( PWM10T2H    , 0xFF62u )
+HOST_XSFR8 ( PWM10T2L    , 0xFF63u )
+HOST_XSFR8 ( PWM10CR     , 0xFF64u )
+HOST_XSFR8 ( PWM10HLD    , 0xFF65u )
+HOST_XSFR16( PWM11T1     , 0xFF68u )
+HOST_XSFR8 ( PWM11T1H    , 0xFF68u )
+HOST_XSFR8 ( PWM11T1L    , 0xFF69u )
+HOST_XSFR16( PWM11T2     , 0xFF6Au )
+HOST_XSFR8 ( PWM11T2H    , 0xFF6Au )
+HOST_XSFR8 ( PWM11T2L    , 0xFF6Bu )
+HOST_XSFR8 ( PWM11CR     , 0xFF6Cu )
+HOST_XSFR8 ( PWM11HLD    , 0xFF6Du )
+HOST_XSFR16( PWM12T1     , 0xFF70u )
+HOST_XSFR8 ( PWM12T1H    , 0xFF70u )
+HOST_XSFR8 ( PWM12T1L    , 0xFF71u )
+HOST_XSFR16( PWM12T2     , 0xFF72u )
+HOST_XSFR8 ( PWM12T2H    , 0xFF72u )
+HOST_XSFR8 ( PWM12T2L    , 0xFF73u )
+HOST_XSFR8 ( PWM12CR     , 0xFF74u )
+HOST_XSFR8 ( PWM12HLD    , 0xFF75u )
+HOST_XSFR16( PWM13T1     , 0xFF78u )
+HOST_XSFR8 ( PWM13T1H    , 0xFF78u )
+HOST_XSFR8 ( PWM13T1L    , 0xFF79u )
+HOST_XSFR16( PWM13T2     , 0xFF7Au )
+HOST_XSFR8 ( PWM13T2H    , 0xFF7Au )
+HOST_XSFR8 ( PWM13T2L    , 0xFF7Bu )
+HOST_XSFR8 ( PWM13CR     , 0xFF7Cu )
+HOST_XSFR8 ( PWM13HLD    , 0xFF7Du )
+HOST_XSFR16( PWM14T1     , 0xFF80u )
+HOST_XSFR8 ( PWM14T1H    , 0xFF80u )
+HOST_XSFR8 ( PWM14T1L    , 0xFF81u )
+HOST_XSFR16( PWM14T2     , 0xFF82u )
+HOST_XSFR8 ( PWM14T2H    , 0xFF82u )
+HOST_XSFR8 ( PWM14T2L    , 0xFF83u )
+HOST_XSFR8 ( PWM14CR     , 0xFF84u )
+HOST_XSFR8 ( PWM14HLD    , 0xFF85u )
+HOST_XSFR16( PWM15T1     , 0xFF88u )
+HOST_XSFR8 ( PWM15T1H    , 0xFF88u )
+HOST_XSFR8 ( PWM15T1L    , 0xFF89u )
+HOST_XSFR16( PWM15T2     , 0xFF8Au )
+HOST_XSFR8 ( PWM15T2H    , 0xFF8Au )
+HOST_XSFR8 ( PWM15T2L    , 0xFF8Bu )
+HOST_XSFR8 ( PWM15CR     , 0xFF8Cu )
+HOST_XSFR8 ( PWM15HLD    , 0xFF8Du )
+HOST_XSFR16( PWM16T1     , 0xFF90u )
+HOST_XSFR8 ( PWM16T1H    , 0xFF90u )
+HOST_XSFR8 ( PWM16T1L    , 0xFF91u )
+HOST_XSFR16( PWM16T2     , 0xFF92u )
+HOST_XSFR8 ( PWM16T2H    , 0xFF92u )
+HOST_XSFR8 ( PWM16T2L    , 0xFF93u )
+HOST_XSFR8 ( PWM16CR     , 0xFF94u )
+HOST_XSFR8 ( PWM16HLD    , 0xFF95u )
+HOST_XSFR16( PWM17T1     , 0xFF98u )
+HOST_XSFR8 ( PWM17T1H    , 0xFF98u )
+HOST_XSFR8 ( PWM17T1L    , 0xFF99u )
+HOST_XSFR16( PWM17T2     , 0xFF9Au )
+HOST_XSFR8 ( PWM17T2H    , 0xFF9Au )
+HOST_XSFR8 ( PWM17T2L    , 0xFF9Bu )
+HOST_XSFR8 ( PWM17CR     , 0xFF9Cu )
+HOST_XSFR8 ( PWM17HLD    , 0xFF9Du )
+HOST_XSFR16( PWM2C       , 0xFFA0u )
+HOST_XSFR8 ( PWM2CH      , 0xFFA0u )
+HOST_XSFR8 ( PWM2CL      , 0xFFA1u )
+HOST_XSFR8 ( PWM2CKS     , 0xFFA2u )
+HOST_XSFR16( PWM2TADC    , 0xFFA3u )
+HOST_XSFR8 ( PWM2TADCH   , 0xFFA3u )
+HOST_XSFR8 ( PWM2TADCL   , 0xFFA4u )
+HOST_XSFR8 ( PWM2IF      , 0xFFA5u )
+HOST_XSFR8 ( PWM2FDCR    , 0xFFA6u )
+HOST_XSFR16( PWM20T1     , 0xFFB0u )
+HOST_XSFR8 ( PWM20T1H    , 0xFFB0u )
+HOST_XSFR8 ( PWM20T1L    , 0xFFB1u )
+HOST_XSFR16( PWM20T2     , 0xFFB2u )
+HOST_XSFR8 ( PWM20T2H    , 0xFFB2u )
+HOST_XSFR8 ( PWM20T2L    , 0xFFB3u )
+HOST_XSFR8 ( PWM20CR     , 0xFFB4u )
+HOST_XSFR8 ( PWM20HLD    , 0xFFB5u )
+HOST_XSFR16( PWM21T1     , 0xFFB8u )
+HOST_XSFR8 ( PWM21T1H    , 0xFFB8u )
+HOST_XSFR8 ( PWM21T1L    , 0xFFB9u )
+HOST_XSFR16( PWM21T2     , 0xFFBAu )
+HOST_XSFR8 ( PWM21T2H    , 0xFFBAu )
+HOST_XSFR8 ( PWM21T2L    , 0xFFBBu )
+HOST_XSFR8 ( PWM21CR     , 0xFFBCu )
+HOST_XSFR8 ( PWM21HLD    , 0xFFBDu )
+HOST_XSFR16( PWM22T1     , 0xFFC0u )
+HOST_XSFR8 ( PWM22T1H    , 0xFFC0u )
+HOST_XSFR8 ( PWM22T1L    , 0xFFC1u )
+HOST_XSFR16( PWM22T2     , 0xFFC2u )
+HOST_XSFR8 ( PWM22T2H    , 0xFFC2u )
+HOST_XSFR8 ( PWM22T2L    , 0xFFC3u )
+HOST_XSFR8 ( PWM22CR     , 0xFFC4u )
+HOST_XSFR8 ( PWM22HLD    , 0xFFC5u )
+HOST_XSFR16( PWM23T1     , 0xFFC8u )
+HOST_XSFR8 ( PWM23T1H    , 0xFFC8u )
+HOST_XSFR8 ( PWM23T1L    , 0xFFC9u )
+HOST_XSFR16( PWM23T2     , 0xFFCAu )
+HOST_XSFR8 ( PWM23T2H    , 0xFFCAu )
+HOST_XSFR8 ( PWM23T2L    , 0xFFCBu )
+HOST_XSFR8 ( PWM23CR     , 0xFFCCu )
+HOST_XSFR8 ( PWM23HLD    , 0xFFCDu )
+HOST_XSFR16( PWM24T1     , 0xFFD0u )
+HOST_XSFR8 ( PWM24T1H    , 0xFFD0u )
+HOST_XSFR8 ( PWM24T1L    , 0xFFD1u )
+HOST_XSFR16( PWM24T2     , 0xFFD2u )
+HOST_XSFR8 ( PWM24T2H    , 0xFFD2u )
+HOST_XSFR8 ( PWM24T2L    , 0xFFD3u )
+HOST_XSFR8 ( PWM24CR     , 0xFFD4u )
+HOST_XSFR8 ( PWM24HLD    , 0xFFD5u )
+HOST_XSFR16( PWM25T1     , 0xFFD8u )
+HOST_XSFR8 ( PWM25T1H    , 0xFFD8u )
+HOST_XSFR8 ( PWM25T1L    , 0xFFD9u )
+HOST_XSFR16( PWM25T2     , 0xFFDAu )
+HOST_XSFR8 ( PWM25T2H    , 0xFFDAu )
+HOST_XSFR8 ( PWM25T2L    , 0xFFDBu )
+HOST_XSFR8 ( PWM25CR     , 0xFFDCu )
+HOST_XSFR8 ( PWM25HLD    , 0xFFDDu )
+HOST_XSFR16( PWM26T1     , 0xFFE0u )
+HOST_XSFR8 ( PWM26T1H    , 0xFFE0u )
+HOST_XSFR8 ( PWM26T1L    , 0xFFE1u )
+HOST_XSFR16( PWM26T2     , 0xFFE2u )
+HOST_XSFR8 ( PWM26T2H    , 0xFFE2u )
+HOST_XSFR8 ( PWM26T2L    , 0xFFE3u )
+HOST_XSFR8 ( PWM26CR     , 0xFFE4u )
+HOST_XSFR8 ( PWM26HLD    , 0xFFE5u )
+HOST_XSFR16( PWM27T1     , 0xFFE8u )
+HOST_XSFR8 ( PWM27T1H    , 0xFFE8u )
+HOST_XSFR8 ( PWM27T1L    , 0xFFE9u )
+HOST_XSFR16( PWM27T2     , 0xFFEAu )
+HOST_XSFR8 ( PWM27T2H    , 0xFFEAu )
+HOST_XSFR8 ( PWM27T2L    , 0xFFEBu )
+HOST_XSFR8 ( PWM27CR     , 0xFFECu )
+HOST_XSFR8 ( PWM27HLD    , 0xFFEDu )
+HOST_XSFR8 ( CKSEL       , 0xFE00u )
+HOST_XSFR8 ( CLKDIV      , 0xFE01u )
+HOST_XSFR8 ( HIRCCR      , 0xFE02u )
+HOST_XSFR8 ( XOSCCR      , 0xFE03u )
+HOST_XSFR8 ( IRC32KCR    , 0xFE04u )
+HOST_XSFR8 ( MCLKOCR     , 0xFE05u )
+HOST_XSFR8 ( IRCDB       , 0xFE06u )
+HOST_XSFR8 ( X32KCR      , 0xFE08u )
+HOST_XSFR8 ( P0PU        , 0xFE10u )
+HOST_XSFR8 ( P1PU        , 0xFE11u )
+HOST_XSFR8 ( P2PU        , 0xFE12u )
+HOST_XSFR8 ( P3PU        , 0xFE13u )
+HOST_XSFR8 ( P4PU        , 0xFE14u )
+HOST_XSFR8 ( P5PU        , 0xFE15u )
+HOST_XSFR8 ( P6PU        , 0xFE16u )
+HOST_XSFR8 ( P7PU        , 0xFE17u )
+HOST_XSFR8 ( P0NCS       , 0xFE18u )
+HOST_XSFR8 ( P1NCS       , 0xFE19u )
+HOST_XSFR8 ( P2NCS       , 0xFE1Au )
+HOST_XSFR8 ( P3NCS       , 0xFE1Bu )
+HOST_XSFR8 ( P4NCS       , 0xFE1Cu )
+HOST_XSFR8 ( P5NCS       , 0xFE1Du )
+HOST_XSFR8 ( P6NCS       , 0xFE1Eu )
+HOST_XSFR8 ( P7NCS       , 0xFE1Fu )
+HOST_XSFR8 ( P0SR        , 0xFE20u )
+HOST_XSFR8 ( P1SR        , 0xFE21u )
+HOST_XSFR8 ( P2SR        , 0xFE22u )
+HOST_XSFR8 ( P3SR        , 0xFE23u )
+HOST_XSFR8 ( P4SR        , 0xFE24u )
+HOST_XSFR8 ( P5SR        , 0xFE25u )
+HOST_XSFR8 ( P6SR        , 0xFE26u )
+HOST_XSFR8 ( P7SR        , 0xFE27u )
+HOST_XSFR8 ( P0DR        , 0xFE28u )
+HOST_XSFR8 ( P1DR        , 0xFE29u )
+HOST_XSFR8 ( P2DR        , 0xFE2Au )
+HOST_XSFR8 ( P3DR        , 0xFE2Bu )
+HOST_XSFR8 ( P4DR        , 0xFE2Cu )
+HOST_XSFR8 ( P5DR        , 0xFE2Du )
+HOST_XSFR8 ( P6DR        , 0xFE2Eu )
+HOST_XSFR8 ( P7DR        , 0xFE2Fu )
+HOST_XSFR8 ( P0IE        , 0xFE30u )
+HOST_XSFR8 ( P1IE        , 0xFE31u )
+HOST_XSFR8 ( P2IE        , 0xFE32u )
+HOST_XSFR8 ( P3IE        , 0xFE33u )
+HOST_XSFR8 ( P4IE        , 0xFE34u )
+HOST_XSFR8 ( P5IE        , 0xFE35u )
+HOST_XSFR8 ( P6IE        , 0xFE36u )
+HOST_XSFR8 ( P7IE        , 0xFE37u )
+HOST_XSFR8 ( RTCCR       , 0xFE60u )
+HOST_XSFR8 ( RTCCFG      , 0xFE61u )
+HOST_XSFR8 ( RTCIEN      , 0xFE62u )
+HOST_XSFR8 ( RTCIF       , 0xFE63u )
+HOST_XSFR8 ( ALAHOUR     , 0xFE64u )
+HOST_XSFR8 ( ALAMIN      , 0xFE65u )
+HOST_XSFR8 ( ALASEC      , 0xFE66u )
+HOST_XSFR8 ( ALASSEC     , 0xFE67u )
+HOST_XSFR8 ( INIYEAR     , 0xFE68u )
+HOST_XSFR8 ( INIMONTH    , 0xFE69u )
+HOST_XSFR8 ( INIDAY      , 0xFE6Au )
+HOST_XSFR8 ( INIHOUR     , 0xFE6Bu )
+HOST_XSFR8 ( INIMIN      , 0xFE6Cu )
+HOST_XSFR8 ( INISEC      , 0xFE6Du )
+HOST_XSFR8 ( INISSEC     , 0xFE6Eu )
+HOST_XSFR8 ( YEAR        , 0xFE70u )
+HOST_XSFR8 ( MONTH       , 0xFE71u )
+HOST_XSFR8 ( DAY         , 0xFE72u )
+HOST_XSFR8 ( HOUR        , 0xFE73u )
+HOST_XSFR8 ( MIN         , 0xFE74u )
+HOST_XSFR8 ( SEC         , 0xFE75u )
+HOST_XSFR8 ( SSEC        , 0xFE76u )
+HOST_XSFR8 ( I2CCFG      , 0xFE80u )
+HOST_XSFR8 ( I2CMSCR     , 0xFE81u )
+HOST_XSFR8 ( I2CMSST     , 0xFE82u )
+HOST_XSFR8 ( I2CSLCR     , 0xFE83u )
+HOST_XSFR8 ( I2CSLST     , 0xFE84u )
+HOST_XSFR8 ( I2CSLADR    , 0xFE85u )
+HOST_XSFR8 ( I2CTXD      , 0xFE86u )
+HOST_XSFR8 ( I2CRXD      , 0xFE87u )
+HOST_XSFR8 ( I2CMSAUX    , 0xFE88u )
+HOST_XSFR8 ( TM2PS       , 0xFEA2u )
+HOST_XSFR8 ( TM3PS       , 0xFEA3u )
+HOST_XSFR8 ( TM4PS       , 0xFEA4u )
+HOST_XSFR8 ( ADCTIM      , 0xFEA8u )
+HOST_XSFR8 ( T3T4PS      , 0xFEACu )
+HOST_XSFR8 ( P0INTE      , 0xFD00u )
+HOST_XSFR8 ( P1INTE      , 0xFD01u )
+HOST_XSFR8 ( P2INTE      , 0xFD02u )
+HOST_XSFR8 ( P3INTE      , 0xFD03u )
+HOST_XSFR8 ( P4INTE      , 0xFD04u )
+HOST_XSFR8 ( P5INTE      , 0xFD05u )
+HOST_XSFR8 ( P6INTE      , 0xFD06u )
+HOST_XSFR8 ( P7INTE      , 0xFD07u )
+HOST_XSFR8 ( P0INTF      , 0xFD10u )
+HOST_XSFR8 ( P1INTF      , 0xFD11u )
+HOST_XSFR8 ( P2INTF      , 0xFD12u )
+HOST_XSFR8 ( P3INTF      , 0xFD13u )
+HOST_XSFR8 ( P4INTF      , 0xFD14u )
+HOST_XSFR8 ( P5INTF      , 0xFD15u )
+HOST_XSFR8 ( P6INTF      , 0xFD16u )
+HOST_XSFR8 ( P7INTF      , 0xFD17u )
+HOST_XSFR8 ( P0IM0       , 0xFD20u )
+HOST_XSFR8 ( P1IM0       , 0xFD21u )
+HOST_XSFR8 ( P2IM0       , 0xFD22u )
+HOST_XSFR8 ( P3IM0       , 0xFD23u )
+HOST_XSFR8 ( P4IM0       , 0xFD24u )
+HOST_XSFR8 ( P5IM0       , 0xFD25u )
+HOST_XSFR8 ( P6IM0       , 0xFD26u )
+HOST_XSFR8 ( P7IM0       , 0xFD27u )
+HOST_XSFR8 ( P0IM1       , 0xFD30u )
+HOST_XSFR8 ( P1IM1       , 0xFD31u )
+HOST_XSFR8 ( P2IM1       , 0xFD32u )
+HOST_XSFR8 ( P3IM1       , 0xFD33u )
+HOST_XSFR8 ( P4IM1       , 0xFD34u )
+HOST_XSFR8 ( P5IM1       , 0xFD35u )
+HOST_XSFR8 ( P6IM1       , 0xFD36u )
+HOST_XSFR8 ( P7IM1       , 0xFD37u )
+HOST_XSFR8 ( P0WKUE      , 0xFD40u )
+HOST_XSFR8 ( P1WKUE      , 0xFD41u )
+HOST_XSFR8 ( P2WKUE      , 0xFD42u )
+HOST_XSFR8 ( P3WKUE      , 0xFD43u )
+HOST_XSFR8 ( P4WKUE      , 0xFD44u )
+HOST_XSFR8 ( P5WKUE      , 0xFD45u )
+HOST_XSFR8 ( P6WKUE      , 0xFD46u )
+HOST_XSFR8 ( P7WKUE      , 0xFD47u )
+HOST_XSFR8 ( PIN_IP      , 0xFD60u )
+HOST_XSFR8 ( PIN_IPH     , 0xFD61u )
+HOST_XSFR16( PWM3C       , 0xFC00u )
+HOST_XSFR8 ( PWM3CH      , 0xFC00u )
+HOST_XSFR8 ( PWM3CL      , 0xFC01u )
+HOST_XSFR8 ( PWM3CKS     , 0xFC02u )
+HOST_XSFR8 ( PWM3IF      , 0xFC05u )
+HOST_XSFR8 ( PWM3FDCR    , 0xFC06u )
+HOST_XSFR16( PWM30T1     , 0xFC10u )
+HOST_XSFR8 ( PWM30T1H    , 0xFC10u )
+HOST_XSFR8 ( PWM30T1L    , 0xFC11u )
+HOST_XSFR16( PWM30T2     , 0xFC12u )
+HOST_XSFR8 ( PWM30T2H    , 0xFC12u )
+HOST_XSFR8 ( PWM30T2L    , 0xFC13u )
+HOST_XSFR8 ( PWM30CR     , 0xFC14u )
+HOST_XSFR8 ( PWM30HLD    , 0xFC15u )
+HOST_XSFR16( PWM31T1     , 0xFC18u )
+HOST_XSFR8 ( PWM31T1H    , 0xFC18u )
+HOST_XSFR8 ( PWM31T1L    , 0xFC19u )
+HOST_XSFR16( PWM31T2     , 0xFC1Au )
+HOST_XSFR8 ( PWM31T2H    , 0xFC1Au )
+HOST_XSFR8 ( PWM31T2L    , 0xFC1Bu )
+HOST_XSFR8 ( PWM31CR     , 0xFC1Cu )
+HOST_XSFR8 ( PWM31HLD    , 0xFC1Du )
+HOST_XSFR16( PWM32T1     , 0xFC20u )
+HOST_XSFR8 ( PWM32T1H    , 0xFC20u )
+HOST_XSFR8 ( PWM32T1L    , 0xFC21u )
+HOST_XSFR16( PWM32T2     , 0xFC22u )
+HOST_XSFR8 ( PWM32T2H    , 0xFC22u )
+HOST_XSFR8 ( PWM32T2L    , 0xFC23u )
+HOST_XSFR8 ( PWM32CR     , 0xFC24u )
+HOST_XSFR8 ( PWM32HLD    , 0xFC25u )
+HOST_XSFR16( PWM33T1     , 0xFC28u )
+HOST_XSFR8 ( PWM33T1H    , 0xFC28u )
+HOST_XSFR8 ( PWM33T1L    , 0xFC29u )
+HOST_XSFR16( PWM33T2     , 0xFC2Au )
+HOST_XSFR8 ( PWM33T2H    , 0xFC2Au )
+HOST_XSFR8 ( PWM33T2L    , 0xFC2Bu )
+HOST_XSFR8 ( PWM33CR     , 0xFC2Cu )
+HOST_XSFR8 ( PWM33HLD    , 0xFC2Du )
+HOST_XSFR16( PWM34T1     , 0xFC30u )
+HOST_XSFR8 ( PWM34T1H    , 0xFC30u )
+HOST_XSFR8 ( PWM34T1L    , 0xFC31u )
+HOST_XSFR16( PWM34T2     , 0xFC32u )
+HOST_XSFR8 ( PWM34T2H    , 0xFC32u )
+HOST_XSFR8 ( PWM34T2L    , 0xFC33u )
+HOST_XSFR8 ( PWM34CR     , 0xFC34u )
+HOST_XSFR8 ( PWM34HLD    , 0xFC35u )
+HOST_XSFR16( PWM35T1     , 0xFC38u )
+HOST_XSFR8 ( PWM35T1H    , 0xFC38u )
+HOST_XSFR8 ( PWM35T1L    , 0xFC39u )
+HOST_XSFR16( PWM35T2     , 0xFC3Au )
+HOST_XSFR8 ( PWM35T2H    , 0xFC3Au )
+HOST_XSFR8 ( PWM35T2L    , 0xFC3Bu )
+HOST_XSFR8 ( PWM35CR     , 0xFC3Cu )
+HOST_XSFR8 ( PWM35HLD    , 0xFC3Du )
+HOST_XSFR16( PWM36T1     , 0xFC40u )
+HOST_XSFR8 ( PWM36T1H    , 0xFC40u )
+HOST_XSFR8 ( PWM36T1L    , 0xFC41u )
+HOST_XSFR16( PWM36T2     , 0xFC42u )
+HOST_XSFR8 ( PWM36T2H    , 0xFC42u )
+HOST_XSFR8 ( PWM36T2L    , 0xFC43u )
+HOST_XSFR8 ( PWM36CR     , 0xFC44u )
+HOST_XSFR8 ( PWM36HLD    , 0xFC45u )
+HOST_XSFR16( PWM37T1     , 0xFC48u )
+HOST_XSFR8 ( PWM37T1H    , 0xFC48u )
+HOST_XSFR8 ( PWM37T1L    , 0xFC49u )
+HOST_XSFR16( PWM37T2     , 0xFC4Au )
+HOST_XSFR8 ( PWM37T2H    , 0xFC4Au )
+HOST_XSFR8 ( PWM37T2L    , 0xFC4Bu )
+HOST_XSFR8 ( PWM37CR     , 0xFC4Cu )
+HOST_XSFR8 ( PWM37HLD    , 0xFC4Du )
+HOST_XSFR16( PWM4C       , 0xFC50u )
+HOST_XSFR8 ( PWM4CH      , 0xFC50u )
+HOST_XSFR8 ( PWM4CL      , 0xFC51u )
+HOST_XSFR8 ( PWM4CKS     , 0xFC52u )
+HOST_XSFR16( PWM4TADC    , 0xFC53u )
+HOST_XSFR8 ( PWM4TADCH   , 0xFC53u )
+HOST_XSFR8 ( PWM4TADCL   , 0xFC54u )
+HOST_XSFR8 ( PWM4IF      , 0xFC55u )
+HOST_XSFR8 ( PWM4FDCR    , 0xFC56u )
+HOST_XSFR16( PWM40T1     , 0xFC60u )
+HOST_XSFR8 ( PWM40T1H    , 0xFC60u )
+HOST_XSFR8 ( PWM40T1L    , 0xFC61u )
+HOST_XSFR16( PWM40T2     , 0xFC62u )
+HOST_XSFR8 ( PWM40T2H    , 0xFC62u )
+HOST_XSFR8 ( PWM40T2L    , 0xFC63u )
+HOST_XSFR8 ( PWM40CR     , 0xFC64u )
+HOST_XSFR8 ( PWM40HLD    , 0xFC65u )
+HOST_XSFR16( PWM41T1     , 0xFC68u )
+HOST_XSFR8 ( PWM41T1H    , 0xFC68u )
+HOST_XSFR8 ( PWM41T1L    , 0xFC69u )
+HOST_XSFR16( PWM41T2     , 0xFC6Au )
+HOST_XSFR8 ( PWM41T2H    , 0xFC6Au )
+HOST_XSFR8 ( PWM41T2L    , 0xFC6Bu )
+HOST_XSFR8 ( PWM41CR     , 0xFC6Cu )
+HOST_XSFR8 ( PWM41HLD    , 0xFC6Du )
+HOST_XSFR16( PWM42T1     , 0xFC70u )
+HOST_XSFR8 ( PWM42T1H    , 0xFC70u )
+HOST_XSFR8 ( PWM42T1L    , 0xFC71u )
+HOST_XSFR16( PWM42T2     , 0xFC72u )
+HOST_XSFR8 ( PWM42T2H    , 0xFC72u )
+HOST_XSFR8 ( PWM42T2L    , 0xFC73u )
+HOST_XSFR8 ( PWM42CR     , 0xFC74u )
+HOST_XSFR8 ( PWM42HLD    , 0xFC75u )
+HOST_XSFR16( PWM43T1     , 0xFC78u )
+HOST_XSFR8 ( PWM43T1H    , 0xFC78u )
+HOST_XSFR8 ( PWM43T1L    , 0xFC79u )
+HOST_XSFR16( PWM43T2     , 0xFC7Au )
+HOST_XSFR8 ( PWM43T2H    , 0xFC7Au )
+HOST_XSFR8 ( PWM43T2L    , 0xFC7Bu )
+HOST_XSFR8 ( PWM43CR     , 0xFC7Cu )
+HOST_XSFR8 ( PWM43HLD    , 0xFC7Du )
+HOST_XSFR16( PWM44T1     , 0xFC80u )
+HOST_XSFR8 ( PWM44T1H    , 0xFC80u )
+HOST_XSFR8 ( PWM44T1L    , 0xFC81u )
+HOST_XSFR16( PWM44T2     , 0xFC82u )
+HOST_XSFR8 ( PWM44T2H    , 0xFC82u )
+HOST_XSFR8 ( PWM44T2L    , 0xFC83u )
+HOST_XSFR8 ( PWM44CR     , 0xFC84u )
+HOST_XSFR8 ( PWM44HLD    , 0xFC85u )
+HOST_XSFR16( PWM45T1     , 0xFC88u )
+HOST_XSFR8 ( PWM45T1H    , 0xFC88u )
+HOST_XSFR8 ( PWM45T1L    , 0xFC89u )
+HOST_XSFR16( PWM45T2     , 0xFC8Au )
+HOST_XSFR8 ( PWM45T2H    , 0xFC8Au )
+HOST_XSFR8 ( PWM45T2L    , 0xFC8Bu )
+HOST_XSFR8 ( PWM45CR     , 0xFC8Cu )
+HOST_XSFR8 ( PWM45HLD    , 0xFC8Du )
+HOST_XSFR16( PWM46T1     , 0xFC90u )
+HOST_XSFR8 ( PWM46T1H    , 0xFC90u )
+HOST_XSFR8 ( PWM46T1L    , 0xFC91u )
+HOST_XSFR16( PWM46T2     , 0xFC92u )
+HOST_XSFR8 ( PWM46T2H    , 0xFC92u )
+HOST_XSFR8 ( PWM46T2L    , 0xFC93u )
+HOST_XSFR8 ( PWM46CR     , 0xFC94u )
+HOST_XSFR8 ( PWM46HLD    , 0xFC95u )
+HOST_XSFR16( PWM47T1     , 0xFC98u )
+HOST_XSFR8 ( PWM47T1H    , 0xFC98u )
+HOST_XSFR8 ( PWM47T1L    , 0xFC99u )
+HOST_XSFR16( PWM47T2     , 0xFC9Au )
+HOST_XSFR8 ( PWM47T2H    , 0xFC9Au )
+HOST_XSFR8 ( PWM47T2L    , 0xFC9Bu )
+HOST_XSFR8 ( PWM47CR     , 0xFC9Cu )
+HOST_XSFR8 ( PWM47HLD    , 0xFC9Du )
+HOST_XSFR16( PWM5C       , 0xFCA0u )
+HOST_XSFR8 ( PWM5CH      , 0xFCA0u )
+HOST_XSFR8 ( PWM5CL      , 0xFCA1u )
+HOST_XSFR8 ( PWM5CKS     , 0xFCA2u )
+HOST_XSFR8 ( PWM5IF      , 0xFCA5u )
+HOST_XSFR8 ( PWM5FDCR    , 0xFCA6u )
+HOST_XSFR16( PWM50T1     , 0xFCB0u )
+HOST_XSFR8 ( PWM50T1H    , 0xFCB0u )
+HOST_XSFR8 ( PWM50T1L    , 0xFCB1u )
+HOST_XSFR16( PWM50T2     , 0xFCB2u )
+HOST_XSFR8 ( PWM50T2H    , 0xFCB2u )
+HOST_XSFR8 ( PWM50T2L    , 0xFCB3u )
+HOST_XSFR8 ( PWM50CR     , 0xFCB4u )
+HOST_XSFR8 ( PWM50HLD    , 0xFCB5u )
+HOST_XSFR16( PWM51T1     , 0xFCB8u )
+HOST_XSFR8 ( PWM51T1H    , 0xFCB8u )
+HOST_XSFR8 ( PWM51T1L    , 0xFCB9u )
+HOST_XSFR16( PWM51T2     , 0xFCBAu )
+HOST_XSFR8 ( PWM51T2H    , 0xFCBAu )
+HOST_XSFR8 ( PWM51T2L    , 0xFCBBu )
+HOST_XSFR8 ( PWM51CR     , 0xFCBCu )
+HOST_XSFR8 ( PWM51HLD    , 0xFCBDu )
+HOST_XSFR16( PWM52T1     , 0xFCC0u )
+HOST_XSFR8 ( PWM52T1H    , 0xFCC0u )
+HOST_XSFR8 ( PWM52T1L    , 0xFCC1u )
+HOST_XSFR16( PWM52T2     , 0xFCC2u )
+HOST_XSFR8 ( PWM52T2H    , 0xFCC2u )
+HOST_XSFR8 ( PWM52T2L    , 0xFCC3u )
+HOST_XSFR8 ( PWM52CR     , 0xFCC4u )
+HOST_XSFR8 ( PWM52HLD    , 0xFCC5u )
+HOST_XSFR16( PWM53T1     , 0xFCC8u )
+HOST_XSFR8 ( PWM53T1H    , 0xFCC8u )
+HOST_XSFR8 ( PWM53T1L    , 0xFCC9u )
+HOST_XSFR16( PWM53T2     , 0xFCCAu )
+HOST_XSFR8 ( PWM53T2H    , 0xFCCAu )
+HOST_XSFR8 ( PWM53T2L    , 0xFCCBu )
+HOST_XSFR8 ( PWM53CR     , 0xFCCCu )
+HOST_XSFR8 ( PWM53HLD    , 0xFCCDu )
+HOST_XSFR16( PWM54T1     , 0xFCD0u )
+HOST_XSFR8 ( PWM54T1H    , 0xFCD0u )
+HOST_XSFR8 ( PWM54T1L    , 0xFCD1u )
+HOST_XSFR16( PWM54T2     , 0xFCD2u )
+HOST_XSFR8 ( PWM54T2H    , 0xFCD2u )
+HOST_XSFR8 ( PWM54T2L    , 0xFCD3u )
+HOST_XSFR8 ( PWM54CR     , 0xFCD4u )
+HOST_XSFR8 ( PWM54HLD    , 0xFCD5u )
+HOST_XSFR16( PWM55T1     , 0xFCD8u )
+HOST_XSFR8 ( PWM55T1H    , 0xFCD8u )
+HOST_XSFR8 ( PWM55T1L    , 0xFCD9u )
+HOST_XSFR16( PWM55T2     , 0xFCDAu )
+HOST_XSFR8 ( PWM55T2H    , 0xFCDAu )
+HOST_XSFR8 ( PWM55T2L    , 0xFCDBu )
+HOST_XSFR8 ( PWM55CR     , 0xFCDCu )
+HOST_XSFR8 ( PWM55HLD    , 0xFCDDu )
+HOST_XSFR16( PWM56T1     , 0xFCE0u )
+HOST_XSFR8 ( PWM56T1H    , 0xFCE0u )
+HOST_XSFR8 ( PWM56T1L    , 0xFCE1u )
+HOST_XSFR16( PWM56T2     , 0xFCE2u )
+HOST_XSFR8 ( PWM56T2H    , 0xFCE2u )
+HOST_XSFR8 ( PWM56T2L    , 0xFCE3u )
+HOST_XSFR8 ( PWM56CR     , 0xFCE4u )
+HOST_XSFR8 ( PWM56HLD    , 0xFCE5u )
+HOST_XSFR16( PWM57T1     , 0xFCE8u )
+HOST_XSFR8 ( PWM57T1H    , 0xFCE8u )
+HOST_XSFR8 ( PWM57T1L    , 0xFCE9u )
+HOST_XSFR16( PWM57T2     , 0xFCEAu )
+HOST_XSFR8 ( PWM57T2H    , 0xFCEAu )
+HOST_XSFR8 ( PWM57T2L    , 0xFCEBu )
+HOST_XSFR8 ( PWM57CR     , 0xFCECu )
+HOST_XSFR8 ( PWM57HLD    , 0xFCEDu )
+HOST_XSFR8 ( MD3         , 0xFCF0u )
+HOST_XSFR8 ( MD2         , 0xFCF1u )
+HOST_XSFR8 ( MD1         , 0xFCF2u )
+HOST_XSFR8 ( MD0         , 0xFCF3u )
+HOST_XSFR8 ( MD5         , 0xFCF4u )
+HOST_XSFR8 ( MD4         , 0xFCF5u )
+HOST_XSFR8 ( ARCON       , 0xFCF6u )
+HOST_XSFR8 ( OPCON       , 0xFCF7u )
+HOST_XSFR8 ( COMEN       , 0xFB00u )
+HOST_XSFR8 ( SEGENL      , 0xFB01u )
+HOST_XSFR8 ( SEGENH      , 0xFB02u )
+HOST_XSFR8 ( LEDCTRL     , 0xFB03u )
+HOST_XSFR8 ( LEDCKS      , 0xFB04u )
+HOST_XSFR8 ( COM0_DA_L   , 0xFB10u )
+HOST_XSFR8 ( COM1_DA_L   , 0xFB11u )
+HOST_XSFR8 ( COM2_DA_L   , 0xFB12u )
+HOST_XSFR8 ( COM3_DA_L   , 0xFB13u )
+HOST_XSFR8 ( COM4_DA_L   , 0xFB14u )
+HOST_XSFR8 ( COM5_DA_L   , 0xFB15u )
+HOST_XSFR8 ( COM6_DA_L   , 0xFB16u )
+HOST_XSFR8 ( COM7_DA_L   , 0xFB17u )
+HOST_XSFR8 ( COM0_DA_H   , 0xFB18u )
+HOST_XSFR8 ( COM1_DA_H   , 0xFB19u )
+HOST_XSFR8 ( COM2_DA_H   , 0xFB1Au )
+HOST_XSFR8 ( COM3_DA_H   , 0xFB1Bu )
+HOST_XSFR8 ( COM4_DA_H   , 0xFB1Cu )
+HOST_XSFR8 ( COM5_DA_H   , 0xFB1Du )
+HOST_XSFR8 ( COM6_DA_H   , 0xFB1Eu )
+HOST_XSFR8 ( COM7_DA_H   , 0xFB1Fu )
+HOST_XSFR8 ( COM0_DC_L   , 0xFB20u )
+HOST_XSFR8 ( COM1_DC_L   , 0xFB21u )
+HOST_XSFR8 ( COM2_DC_L   , 0xFB22u )
+HOST_XSFR8 ( COM3_DC_L   , 0xFB23u )
+HOST_XSFR8 ( COM4_DC_L   , 0xFB24u )
+HOST_XSFR8 ( COM5_DC_L   , 0xFB25u )
+HOST_XSFR8 ( COM6_DC_L   , 0xFB26u )
+HOST_XSFR8 ( COM7_DC_L   , 0xFB27u )
+HOST_XSFR8 ( COM0_DC_H   , 0xFB28u )
+HOST_XSFR8 ( COM1_DC_H   , 0xFB29u )
+HOST_XSFR8 ( COM2_DC_H   , 0xFB2Au )
+HOST_XSFR8 ( COM3_DC_H   , 0xFB2Bu )
+HOST_XSFR8 ( COM4_DC_H   , 0xFB2Cu )
+HOST_XSFR8 ( COM5_DC_H   , 0xFB2Du )
+HOST_XSFR8 ( COM6_DC_H   , 0xFB2Eu )
+HOST_XSFR8 ( COM7_DC_H   , 0xFB2Fu )
+HOST_XSFR8 ( TSCHEN1     , 0xFB40u )
+HOST_XSFR8 ( TSCHEN2     , 0xFB41u )
+HOST_XSFR8 ( TSCFG1      , 0xFB42u )
+HOST_XSFR8 ( TSCFG2      , 0xFB43u )
+HOST_XSFR8 ( TSWUTC      , 0xFB44u )
+HOST_XSFR8 ( TSCTRL      , 0xFB45u )
+HOST_XSFR8 ( TSSTA1      , 0xFB46u )
+HOST_XSFR8 ( TSSTA2      , 0xFB47u )
+HOST_XSFR8 ( TSRT        , 0xFB48u )
+HOST_XSFR16( TSDAT       , 0xFB49u )
+HOST_XSFR8 ( TSDATH      , 0xFB49u )
+HOST_XSFR8 ( TSDATL      , 0xFB4Au )
+HOST_XSFR16( TSTH00      , 0xFB50u )
+HOST_XSFR8 ( TSTH00H     , 0xFB50u )
+HOST_XSFR8 ( TSTH00L     , 0xFB51u )
+HOST_XSFR16( TSTH01      , 0xFB52u )
+HOST_XSFR8 ( TSTH01H     , 0xFB52u )
+HOST_XSFR8 ( TSTH01L     , 0xFB53u )
+HOST_XSFR16( TSTH02      , 0xFB54u )
+HOST_XSFR8 ( TSTH02H     , 0xFB54u )
+HOST_XSFR8 ( TSTH02L     , 0xFB55u )
+HOST_XSFR16( TSTH03      , 0xFB56u )
+HOST_XSFR8 ( TSTH03H     , 0xFB56u )
+HOST_XSFR8 ( TSTH03L     , 0xFB57u )
+HOST_XSFR16( TSTH04      , 0xFB58u )
+HOST_XSFR8 ( TSTH04H     , 0xFB58u )
+HOST_XSFR8 ( TSTH04L     , 0xFB59u )
+HOST_XSFR16( TSTH05      , 0xFB5Au )
+HOST_XSFR8 ( TSTH05H     , 0xFB5Au )
+HOST_XSFR8 ( TSTH05L     , 0xFB5Bu )
+HOST_XSFR16( TSTH06      , 0xFB5Cu )
+HOST_XSFR8 ( TSTH06H     , 0xFB5Cu )
+HOST_XSFR8 ( TSTH06L     , 0xFB5Du )
+HOST_XSFR16( TSTH07      , 0xFB5Eu )
+HOST_XSFR8 ( TSTH07H     , 0xFB5Eu )
+HOST_XSFR8 ( TSTH07L     , 0xFB5Fu )
+HOST_XSFR16( TSTH08      , 0xFB60u )
+HOST_XSFR8 ( TSTH08H     , 0xFB60u )
+HOST_XSFR8 ( TSTH08L     , 0xFB61u )
+HOST_XSFR16( TSTH09      , 0xFB62u )
+HOST_XSFR8 ( TSTH09H     , 0xFB62u )
+HOST_XSFR8 ( TSTH09L     , 0xFB63u )
+HOST_XSFR16( TSTH10      , 0xFB64u )
+HOST_XSFR8 ( TSTH10H     , 0xFB64u )
+HOST_XSFR8 ( TSTH10L     , 0xFB65u )
+HOST_XSFR16( TSTH11      , 0xFB66u )
+HOST_XSFR8 ( TSTH11H     , 0xFB66u )
+HOST_XSFR8 ( TSTH11L     , 0xFB67u )
+HOST_XSFR16( TSTH12      , 0xFB68u )
+HOST_XSFR8 ( TSTH12H     , 0xFB68u )
+HOST_XSFR8 ( TSTH12L     , 0xFB69u )
+HOST_XSFR16( TSTH13      , 0xFB6Au )
+HOST_XSFR8 ( TSTH13H     , 0xFB6Au )
+HOST_XSFR8 ( TSTH13L     , 0xFB6Bu )
+HOST_XSFR16( TSTH14      , 0xFB6Cu )
+HOST_XSFR8 ( TSTH14H     , 0xFB6Cu )
+HOST_XSFR8 ( TSTH14L     , 0xFB6Du )
+HOST_XSFR16( TSTH15      , 0xFB6Eu )
+HOST_XSFR8 ( TSTH15H     , 0xFB6Eu )
+HOST_XSFR8 ( TSTH15L     , 0xFB6Fu )
+
+/***************************************< End of file >**************************************/
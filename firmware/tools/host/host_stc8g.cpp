@@ -0,0 +1,197 @@
+/*! *******************************************************************************************************
+* Copyright (c) 2022 Hekk_Elek
+*
+* \file host_stc8g.cpp
+*
+* \brief Host simulation of the STC8G special function registers, IAP EEPROM and ADC
+*
+* \author Hekk_Elek
+*
+**********************************************************************************************************/
+
+/***************************************< Includes >**************************************/
+// Standard C libraries
+#include <string.h>
+
+// Own includes
+#include "host_stc8g.h"
+
+
+/***************************************< Definitions >**************************************/
+// Addresses of the registers with side effects
+#define SFR_ADC_CONTR     (0xBCu)
+#define SFR_ADC_RES       (0xBDu)
+#define SFR_ADC_RESL      (0xBEu)
+#define SFR_IAP_DATA      (0xC2u)
+#define SFR_IAP_ADDRH     (0xC3u)
+#define SFR_IAP_ADDRL     (0xC4u)
+#define SFR_IAP_CMD       (0xC5u)
+#define SFR_IAP_TRIG      (0xC6u)
+#define SFR_IAP_CONTR     (0xC7u)
+
+
+/***************************************< Global variables >**************************************/
+unsigned char  gau8HostSfr[ 256u ];
+unsigned char  gau8HostXdata[ 0x10000u ];
+unsigned char  gau8HostEeprom[ HOST_EEPROM_SIZE ];
+unsigned long  gu32HostIapReads;
+unsigned long  gu32HostIapPrograms;
+unsigned long  gu32HostIapErases;
+unsigned short gu16HostAdcResult = 512u;
+HOST_IAP_HOOK  gpfHostIapHook;
+HOST_SFR_HOOK  gpfHostSfrHook;
+
+static unsigned char gu8LastTrig;  //!< Previous value written to IAP_TRIG, for the magic sequence
+
+// Registers
+#define HOST_SFR( name, address )           HostSfr name( address );
+#define HOST_SBIT( name, address, bit )     HostSbit name( address, bit );
+#define HOST_XSFR8( name, address )         volatile unsigned char& name = gau8HostXdata[ address ];
+#define HOST_XSFR16( name, address )        volatile unsigned short& name = *(volatile unsigned short*)&gau8HostXdata[ address ];
+#include "host_sfr_list.h"
+#undef HOST_SFR
+#undef HOST_SBIT
+#undef HOST_XSFR8
+#undef HOST_XSFR16
+
+
+/***************************************< Static function definitions >**************************************/
+static void IAP_Trigger( void );
+
+
+/***************************************< Private functions >**************************************/
+//----------------------------------------------------------------------------
+//! \brief  Executes the IAP command set up in the IAP registers
+//! \param  -
+//! \return -
+//! \global gau8HostEeprom[], IAP statistics
+//-----------------------------------------------------------------------------
+static void IAP_Trigger( void )
+{
+  unsigned short u16Address;
+  unsigned char  u8Command = gau8HostSfr[ SFR_IAP_CMD ] & 0x03u;
+  
+  if( 0u != ( gau8HostSfr[ SFR_IAP_CONTR ] & 0x80u ) )  // EEPROM is enabled
+  {
+    u16Address = ( ( (unsigned short)gau8HostSfr[ SFR_IAP_ADDRH ] << 8u ) | gau8HostSfr[ SFR_IAP_ADDRL ] ) % HOST_EEPROM_SIZE;
+    switch( u8Command )
+    {
+      case HOST_IAP_READ:
+        gau8HostSfr[ SFR_IAP_DATA ] = gau8HostEeprom[ u16Address ];
+        gu32HostIapReads++;
+        break;
+      
+      case HOST_IAP_PROGRAM:
+        if( 0 != gpfHostIapHook )
+        {
+          gpfHostIapHook( u8Command, u16Address, gau8HostSfr[ SFR_IAP_DATA ] );
+        }
+        gau8HostEeprom[ u16Address ] &= gau8HostSfr[ SFR_IAP_DATA ];  // programming can only clear bits
+        gu32HostIapPrograms++;
+        break;
+      
+      case HOST_IAP_ERASE:
+        u16Address &= ~( HOST_EEPROM_PAGE_SIZE - 1u );
+        if( 0 != gpfHostIapHook )
+        {
+          gpfHostIapHook( u8Command, u16Address, 0xFFu );
+        }
+        memset( &gau8HostEeprom[ u16Address ], 0xFF, HOST_EEPROM_PAGE_SIZE );
+        gu32HostIapErases++;
+        break;
+      
+      default:  // Idle
+        break;
+    }
+  }
+}
+
+
+/***************************************< Public functions >**************************************/
+HostSfr::HostSfr( unsigned char u8Address ) : mu8Address( u8Address ) {}
+HostSfr::operator unsigned char() const { return gau8HostSfr[ mu8Address ]; }
+HostSfr& HostSfr::operator=( unsigned char u8Value ) { Host_SfrWrite( mu8Address, u8Value ); return *this; }
+HostSfr& HostSfr::operator=( const HostSfr& rcOther ) { return *this = (unsigned char)rcOther; }
+HostSfr& HostSfr::operator|=( unsigned char u8Value ) { return *this = (unsigned char)( *this | u8Value ); }
+HostSfr& HostSfr::operator&=( unsigned char u8Value ) { return *this = (unsigned char)( *this & u8Value ); }
+HostSfr& HostSfr::operator^=( unsigned char u8Value ) { return *this = (unsigned char)( *this ^ u8Value ); }
+HostSfr& HostSfr::operator+=( unsigned char u8Value ) { return *this = (unsigned char)( *this + u8Value ); }
+HostSfr& HostSfr::operator-=( unsigned char u8Value ) { return *this = (unsigned char)( *this - u8Value ); }
+HostSfr& HostSfr::operator++() { return *this += 1u; }
+HostSfr& HostSfr::operator--() { return *this -= 1u; }
+
+HostSbit::HostSbit( unsigned char u8Address, unsigned char u8Bit ) : mu8Address( u8Address ), mu8Mask( (unsigned char)( 1u << u8Bit ) ) {}
+HostSbit::operator unsigned char() const { return ( 0u != ( gau8HostSfr[ mu8Address ] & mu8Mask ) ) ? 1u : 0u; }
+HostSbit& HostSbit::operator=( const HostSbit& rcOther ) { return *this = (unsigned char)rcOther; }
+HostSbit& HostSbit::operator=( unsigned char u8Value )
+{
+  if( 0u != u8Value )
+  {
+    Host_SfrWrite( mu8Address, gau8HostSfr[ mu8Address ] | mu8Mask );
+  }
+  else
+  {
+    Host_SfrWrite( mu8Address, gau8HostSfr[ mu8Address ] & (unsigned char)~mu8Mask );
+  }
+  return *this;
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Resets the registers; the EEPROM keeps its contents
+//! \param  -
+//! \return -
+//! \global gau8HostSfr[], gau8HostXdata[]
+//-----------------------------------------------------------------------------
+void Host_Reset( void )
+{
+  memset( gau8HostSfr, 0, sizeof( gau8HostSfr ) );
+  memset( gau8HostXdata, 0, sizeof( gau8HostXdata ) );
+  // Ports are high after reset
+  gau8HostSfr[ 0x80u ] = 0xFFu;  // P0
+  gau8HostSfr[ 0x90u ] = 0xFFu;  // P1
+  gau8HostSfr[ 0xA0u ] = 0xFFu;  // P2
+  gau8HostSfr[ 0xB0u ] = 0xFFu;  // P3
+  gau8HostSfr[ 0xC0u ] = 0xFFu;  // P4
+  gau8HostSfr[ 0xC8u ] = 0xFFu;  // P5
+  gu8LastTrig = 0u;
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Writes a special function register, simulating its side effects
+//! \param  u8Address: address of the register
+//! \param  u8Value: value to be written
+//! \return -
+//! \global gau8HostSfr[], gpfHostSfrHook
+//-----------------------------------------------------------------------------
+void Host_SfrWrite( unsigned char u8Address, unsigned char u8Value )
+{
+  gau8HostSfr[ u8Address ] = u8Value;
+  switch( u8Address )
+  {
+    case SFR_IAP_TRIG:  // Magic sequence: 0x5A then 0xA5
+      if( ( 0x5Au == gu8LastTrig ) && ( 0xA5u == u8Value ) )
+      {
+        IAP_Trigger();
+      }
+      gu8LastTrig = u8Value;
+      break;
+    
+    case SFR_ADC_CONTR:  // Conversions complete immediately
+      if( 0u != ( u8Value & 0x40u ) )
+      {
+        gau8HostSfr[ SFR_ADC_RES ] = (unsigned char)( gu16HostAdcResult >> 8u );
+        gau8HostSfr[ SFR_ADC_RESL ] = (unsigned char)gu16HostAdcResult;
+        gau8HostSfr[ SFR_ADC_CONTR ] = ( u8Value & (unsigned char)~0x40u ) | 0x20u;  // ADC_FLAG
+      }
+      break;
+    
+    default:
+      break;
+  }
+  if( 0 != gpfHostSfrHook )
+  {
+    gpfHostSfrHook( u8Address, u8Value );
+  }
+}
+
+/***************************************< End of file >**************************************/
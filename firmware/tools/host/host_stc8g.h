@@ -0,0 +1,102 @@
+/*! *******************************************************************************************************
+* Copyright (c) 2022 Hekk_Elek
+*
+* \file host_stc8g.h
+*
+* \brief Host simulation of the STC8G special function registers, IAP EEPROM and ADC
+*
+* \author Hekk_Elek
+*
+**********************************************************************************************************/
+#ifndef HOST_STC8G_H
+#define HOST_STC8G_H
+
+#ifndef __cplusplus
+#error "The host simulation of the SFRs needs to be compiled as C++ (writing a register has side effects)"
+#endif
+
+/***************************************< Includes >**************************************/
+
+
+/***************************************< Definitions >**************************************/
+#define HOST_EEPROM_SIZE        (4096u)  //!< Size of the simulated EEPROM
+#define HOST_EEPROM_PAGE_SIZE    (512u)  //!< Size of an erasable EEPROM page
+
+// IAP commands, as written to IAP_CMD
+#define HOST_IAP_IDLE              (0u)  //!< No operation
+#define HOST_IAP_READ              (1u)  //!< Read one byte
+#define HOST_IAP_PROGRAM           (2u)  //!< Program one byte (can only clear bits)
+#define HOST_IAP_ERASE             (3u)  //!< Erase one page (sets every byte to 0xFF)
+
+
+/***************************************< Types >**************************************/
+//! \brief Special function register: writes go through Host_SfrWrite(), so they can have side effects
+class HostSfr
+{
+public:
+  explicit HostSfr( unsigned char u8Address );
+  operator unsigned char() const;
+  HostSfr& operator=( unsigned char u8Value );
+  HostSfr& operator=( const HostSfr& rcOther );
+  HostSfr& operator|=( unsigned char u8Value );
+  HostSfr& operator&=( unsigned char u8Value );
+  HostSfr& operator^=( unsigned char u8Value );
+  HostSfr& operator+=( unsigned char u8Value );
+  HostSfr& operator-=( unsigned char u8Value );
+  HostSfr& operator++();
+  HostSfr& operator--();
+private:
+  unsigned char mu8Address;  //!< Address of the register in the SFR space
+};
+
+//! \brief Bit of a bit-addressable special function register
+class HostSbit
+{
+public:
+  HostSbit( unsigned char u8Address, unsigned char u8Bit );
+  operator unsigned char() const;
+  HostSbit& operator=( unsigned char u8Value );
+  HostSbit& operator=( const HostSbit& rcOther );
+private:
+  unsigned char mu8Address;  //!< Address of the register in the SFR space
+  unsigned char mu8Mask;     //!< Mask of the bit
+};
+
+//! \brief Callback before every EEPROM program or erase, e.g. for fault injection
+typedef void (*HOST_IAP_HOOK)( unsigned char u8Command, unsigned short u16Address, unsigned char u8Data );
+
+//! \brief Callback after every SFR write, e.g. for watching the port pins
+typedef void (*HOST_SFR_HOOK)( unsigned char u8Address, unsigned char u8Value );
+
+
+/***************************************< Global variables >**************************************/
+extern unsigned char  gau8HostSfr[ 256u ];                   //!< SFR space
+extern unsigned char  gau8HostXdata[ 0x10000u ];             //!< XDATA space, including the extended SFRs
+extern unsigned char  gau8HostEeprom[ HOST_EEPROM_SIZE ];    //!< Contents of the EEPROM
+extern unsigned long  gu32HostIapReads;                      //!< Number of EEPROM byte reads
+extern unsigned long  gu32HostIapPrograms;                   //!< Number of EEPROM byte programs
+extern unsigned long  gu32HostIapErases;                     //!< Number of EEPROM page erases
+extern unsigned short gu16HostAdcResult;                     //!< Result of the next ADC conversion
+extern HOST_IAP_HOOK  gpfHostIapHook;                        //!< Called before every program and erase
+extern HOST_SFR_HOOK  gpfHostSfrHook;                        //!< Called after every SFR write
+
+// Registers
+#define HOST_SFR( name, address )           extern HostSfr name;
+#define HOST_SBIT( name, address, bit )     extern HostSbit name;
+#define HOST_XSFR8( name, address )         extern volatile unsigned char& name;
+#define HOST_XSFR16( name, address )        extern volatile unsigned short& name;
+#include "host_sfr_list.h"
+#undef HOST_SFR
+#undef HOST_SBIT
+#undef HOST_XSFR8
+#undef HOST_XSFR16
+
+
+/***************************************< Public functions >**************************************/
+void Host_Reset( void );
+void Host_SfrWrite( unsigned char u8Address, unsigned char u8Value );
+
+
+#endif /* HOST_STC8G_H */
+
+/***************************************< End of file >**************************************/
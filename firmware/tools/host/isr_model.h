@@ -0,0 +1,38 @@
+/*! *******************************************************************************************************
+* Copyright (c) 2022 Hekk_Elek
+*
+* \file isr_model.h
+*
+* \brief Cycle and supply current model of the timer 0 interrupt, for the host simulations
+*
+* \author Hekk_Elek
+*
+**********************************************************************************************************/
+#ifndef ISR_MODEL_H
+#define ISR_MODEL_H
+
+/***************************************< Includes >**************************************/
+
+
+/***************************************< Definitions >**************************************/
+//NOTE: the host simulation has no instruction timing; these are estimated from the STC8G1K08
+//      instruction timing of the flattened timer0_isr() (Keil C51, register bank 1).
+//      tools/emu51 --top shows the real numbers of a build.
+#define ISR_CYCLES_PER_TICK  ( SYSTEM_CLOCK_MHZ * TICK_PERIOD_US )  //!< System clock cycles in a timer 0 period
+#define ISR_CYCLES_FIXED          (38u)  //!< Entry, saving ACC and PSW, ms timer, counters, TF0, RETI
+#define ISR_CYCLES_LED_DRIVE      (47u)  //!< First tick of a soft-PWM step: PWM counter, seven LEDs
+#define ISR_CYCLES_LED_OFF        (32u)  //!< Other ticks: the LEDs of the tick compared, the rest set high
+#define ISR_CYCLES_RGB_TEST        (9u)  //!< Shifted position of one RGB color, compared with its brightness
+#define ISR_CYCLES_PULSE_OVERHEAD  (6u)  //!< Pin low and high, loading and scaling the delay counter
+#define ISR_CYCLES_DELAY( u8Loops )  ( 3u * (U32)(u8Loops) - 1u )  //!< while( --u8Delay ) is DJNZ: 2 cycles, +1 when taken
+//! \brief Cycles of an RGB current pulse, the pin is low for about this long
+#define ISR_CYCLES_PULSE( u8Loops )  ( ISR_CYCLES_PULSE_OVERHEAD + ISR_CYCLES_DELAY( u8Loops ) )
+
+// Supply current of the microcontroller (STC8G1K08 datasheet, typical, 3 V)
+#define MCU_ACTIVE_MA              (4.0)  //!< Running at 24 MHz
+#define MCU_IDLE_MA                (1.5)  //!< Idle mode, waiting for the next interrupt
+
+
+#endif /* ISR_MODEL_H */
+
+/***************************************< End of file >**************************************/
@@ -0,0 +1,392 @@
+/*! *******************************************************************************************************
+* Copyright (c) 2022 Hekk_Elek
+*
+* \file persist_sim.cpp
+*
+* \brief Power-loss fault injection for the EEPROM log of persist.c
+*
+* \author Hekk_Elek
+*
+**********************************************************************************************************/
+
+/*----------------------------------------------------------------------------------------
+How it works
+============
+persist.c and util.c are compiled for the host, on top of the simulated IAP registers
+(tools/host). A long sequence of saves is executed, wrapping the EEPROM ring several times.
+Before every byte program and every page erase the process forks, and the child simulates
+a power loss at that point: either the operation is lost completely, or it is torn (a byte
+program clears only some of its bits, a page erase sets only some of the bytes to 0xFF).
+The child then boots (Persist_Init) and checks that every key holds its last committed
+value, or the value that was being saved when the power was lost. It also checks that
+the log can be written again after the recovery. The number of EEPROM reads spent by the
+boot scan is reported.
+Finally the turn-off of main.c is replayed with animation.c: an animation is selected and
+saved, a long press plays the blackness, the release saves and flushes the log; after the
+next boot the selected animation must be the saved one, not the blackness.
+
+Build (from this directory):
+  g++ -O2 -DHOST_BUILD -I../../src -I../host -x c++ ../../src/persist.c ../../src/iap.c ../../src/util.c \
+      ../../src/animation.c ../../src/led.c ../../src/rgbled.c -x none ../host/host_stc8g.cpp persist_sim.cpp -o persist_sim
+Run:
+  ./persist_sim [number of saves]
+----------------------------------------------------------------------------------------*/
+
+/***************************************< Includes >**************************************/
+// Standard C libraries
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+// Own includes
+#include "types.h"
+#include "persist.h"
+#include "animation.h"
+#include "host_stc8g.h"
+
+
+/***************************************< Definitions >**************************************/
+#define DEFAULT_SAVES_NUM   (2000u)  //!< Enough saves to wrap the EEPROM ring a few times
+#define ALLOWED_VALUES_MAX    (64u)  //!< Maximum number of values a key may hold after a power loss
+
+// Result of a simulated power loss
+#define RESULT_OK              (0u)  //!< Last committed value was recovered
+#define RESULT_WRONG_VALUE     (1u)  //!< A key holds a value which was never committed
+#define RESULT_DEAD_LOG        (2u)  //!< The log can't be written after the recovery
+
+// Fault modes
+#define FAULT_LOST             (0u)  //!< The operation is not executed at all
+#define FAULT_TORN             (1u)  //!< The operation is executed partially
+#define FAULT_MODES_NUM        (2u)
+
+#define POWER_OFF_ANIMATION      (3u)  //!< Animation selected before the long press
+
+
+/***************************************< Types >**************************************/
+//! \brief Report of a child process to the parent
+typedef struct
+{
+  U8            u8Result;      //!< RESULT_*
+  unsigned long u32BootReads;  //!< EEPROM byte reads of the boot scan
+} S_REPORT;
+
+
+/***************************************< Global variables >**************************************/
+static U32           gau32Allowed[ PERSIST_KEYS_NUM ][ ALLOWED_VALUES_MAX ];  //!< Values a key may hold after a power loss
+static U8            gau8AllowedNum[ PERSIST_KEYS_NUM ];                     //!< Number of allowed values per key
+static int           gaiPipe[ 2u ];                                          //!< Reports of the children
+static unsigned long gu32Operations;                                         //!< Number of program and erase operations so far
+static unsigned long gu32Failures;                                           //!< Number of failed recoveries
+static unsigned long gu32BootReadsMin = ~0ul;                                //!< Boot scan statistics
+static unsigned long gu32BootReadsMax;
+static unsigned long long gu64BootReadsSum;
+static unsigned long gu32Cuts;                                               //!< Number of simulated power losses
+
+
+/***************************************< Static function definitions >**************************************/
+static U32  GetKey( U8 u8Key );
+static void AllowCurrentValues( void );
+static void Commit( void );
+static void InjectFault( U8 u8Mode, U8 u8Command, U16 u16Address, U8 u8Data );
+static U8   Recover( S_REPORT* psReport );
+static void PowerLossHook( U8 u8Command, U16 u16Address, U8 u8Data );
+static BOOL CheckPowerOff( void );
+
+
+/***************************************< Private functions >**************************************/
+//----------------------------------------------------------------------------
+//! \brief  Reads a key from the persistent data structure
+//! \param  u8Key: key (E_PERSIST_KEY)
+//! \return Value of the key
+//-----------------------------------------------------------------------------
+static U32 GetKey( U8 u8Key )
+{
+  U32 u32Value;
+  
+  switch( u8Key )
+  {
+    case PERSIST_KEY_ANIMATION:
+      u32Value = gsPersistentData.u8AnimationIndex;
+      break;
+    
+    default:  // PERSIST_KEY_RUNTIME
+      u32Value = gsPersistentData.u32RuntimeMs;
+      break;
+  }
+  return u32Value;
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Adds the current values to the values allowed after a power loss
+//! \param  -
+//! \return -
+//-----------------------------------------------------------------------------
+static void AllowCurrentValues( void )
+{
+  U8 u8Key;
+  
+  for( u8Key = 0u; u8Key < PERSIST_KEYS_NUM; u8Key++ )
+  {
+    if( gau8AllowedNum[ u8Key ] >= ALLOWED_VALUES_MAX )
+    {
+      fprintf( stderr, "The writer didn't get idle for too long\n" );
+      exit( EXIT_FAILURE );
+    }
+    gau32Allowed[ u8Key ][ gau8AllowedNum[ u8Key ] ] = GetKey( u8Key );
+    gau8AllowedNum[ u8Key ]++;
+  }
+}
+
+//----------------------------------------------------------------------------
+//! \brief  The writer is idle: every current value is committed
+//! \param  -
+//! \return -
+//-----------------------------------------------------------------------------
+static void Commit( void )
+{
+  memset( gau8AllowedNum, 0, sizeof( gau8AllowedNum ) );
+  AllowCurrentValues();
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Applies the effect of a power loss during an EEPROM operation
+//! \param  u8Mode: FAULT_LOST or FAULT_TORN
+//! \param  u8Command: HOST_IAP_PROGRAM or HOST_IAP_ERASE
+//! \param  u16Address: address of the byte or the page
+//! \param  u8Data: byte to be programmed
+//! \return -
+//-----------------------------------------------------------------------------
+static void InjectFault( U8 u8Mode, U8 u8Command, U16 u16Address, U8 u8Data )
+{
+  U16 u16Index;
+  
+  if( FAULT_TORN == u8Mode )
+  {
+    srand( (unsigned int)gu32Operations );
+    if( HOST_IAP_PROGRAM == u8Command )  // Only some of the bits got cleared
+    {
+      gau8HostEeprom[ u16Address ] &= (U8)( u8Data | rand() );
+    }
+    else  // Only some of the bytes got erased
+    {
+      for( u16Index = 0u; u16Index < HOST_EEPROM_PAGE_SIZE; u16Index++ )
+      {
+        if( 0 != ( rand() & 1 ) )
+        {
+          gau8HostEeprom[ u16Address + u16Index ] = 0xFFu;
+        }
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Boots after a power loss and checks the recovered values
+//! \param  psReport: statistics of the boot are written here
+//! \return RESULT_*
+//-----------------------------------------------------------------------------
+static U8 Recover( S_REPORT* psReport )
+{
+  U8  u8Result = RESULT_OK;
+  U8  u8Key;
+  U8  u8Index;
+  
+  gpfHostIapHook = 0;
+  Host_Reset();
+  gu32HostIapReads = 0u;
+  Persist_Init();
+  psReport->u32BootReads = gu32HostIapReads;
+  
+  for( u8Key = 0u; u8Key < PERSIST_KEYS_NUM; u8Key++ )
+  {
+    for( u8Index = 0u; u8Index < gau8AllowedNum[ u8Key ]; u8Index++ )
+    {
+      if( GetKey( u8Key ) == gau32Allowed[ u8Key ][ u8Index ] )
+      {
+        break;
+      }
+    }
+    if( u8Index >= gau8AllowedNum[ u8Key ] )
+    {
+      u8Result = RESULT_WRONG_VALUE;
+    }
+  }
+  
+  // The log must still work
+  if( RESULT_OK == u8Result )
+  {
+    gsPersistentData.u8AnimationIndex = 0xA5u;
+    gsPersistentData.u32RuntimeMs = 0xC0FFEEu;
+    Persist_Save();
+    Persist_Flush();
+    Persist_Init();
+    if( ( 0xA5u != gsPersistentData.u8AnimationIndex ) || ( 0xC0FFEEu != gsPersistentData.u32RuntimeMs ) )
+    {
+      u8Result = RESULT_DEAD_LOG;
+    }
+  }
+  return u8Result;
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Called before every EEPROM program and erase: simulates a power loss in a child process
+//! \param  u8Command: HOST_IAP_PROGRAM or HOST_IAP_ERASE
+//! \param  u16Address: address of the byte or the page
+//! \param  u8Data: byte to be programmed
+//! \return -
+//-----------------------------------------------------------------------------
+static void PowerLossHook( U8 u8Command, U16 u16Address, U8 u8Data )
+{
+  U8       u8Mode;
+  pid_t    iChild;
+  S_REPORT sReport;
+  
+  gu32Operations++;
+  for( u8Mode = 0u; u8Mode < FAULT_MODES_NUM; u8Mode++ )
+  {
+    iChild = fork();
+    if( 0 == iChild )  // Power is lost here; the call stack of the child is abandoned
+    {
+      InjectFault( u8Mode, u8Command, u16Address, u8Data );
+      sReport.u8Result = Recover( &sReport );
+      if( sizeof( sReport ) != write( gaiPipe[ 1u ], &sReport, sizeof( sReport ) ) )
+      {
+        _exit( EXIT_FAILURE );
+      }
+      _exit( EXIT_SUCCESS );
+    }
+    waitpid( iChild, 0, 0 );
+    if( sizeof( sReport ) != read( gaiPipe[ 0u ], &sReport, sizeof( sReport ) ) )
+    {
+      fprintf( stderr, "Child process died at operation %lu\n", gu32Operations );
+      exit( EXIT_FAILURE );
+    }
+    gu32Cuts++;
+    if( RESULT_OK != sReport.u8Result )
+    {
+      gu32Failures++;
+      printf( "FAIL: %s %s at operation %lu (address 0x%03X): %s\n",
+              ( FAULT_LOST == u8Mode ) ? "lost" : "torn",
+              ( HOST_IAP_PROGRAM == u8Command ) ? "program" : "erase",
+              gu32Operations, u16Address,
+              ( RESULT_WRONG_VALUE == sReport.u8Result ) ? "wrong value recovered" : "log is dead after recovery" );
+    }
+    if( sReport.u32BootReads < gu32BootReadsMin )
+    {
+      gu32BootReadsMin = sReport.u32BootReads;
+    }
+    if( sReport.u32BootReads > gu32BootReadsMax )
+    {
+      gu32BootReadsMax = sReport.u32BootReads;
+    }
+    gu64BootReadsSum += sReport.u32BootReads;
+  }
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Replays the turn-off by a long press (main.c), then boots again
+//! \param  -
+//! \return TRUE if the animation selected before the long press is restored
+//-----------------------------------------------------------------------------
+static BOOL CheckPowerOff( void )
+{
+  gpfHostIapHook = 0;
+  memset( gau8HostEeprom, 0xFF, sizeof( gau8HostEeprom ) );
+  Host_Reset();
+  Animation_Init();
+  Persist_Init();
+  // Short press: select and save an animation
+  Animation_Set( POWER_OFF_ANIMATION, TRUE );
+  Persist_Save();
+  Persist_Flush();
+  // Long press: the blackness is played; release: saved and turned off
+  Animation_Set( ANIMATION_BLACKNESS, FALSE );
+  Persist_Save();
+  Persist_Flush();
+  // Next power-up
+  Host_Reset();
+  memset( &gsPersistentData, 0, sizeof( gsPersistentData ) );
+  Animation_Init();
+  Persist_Init();
+  return ( POWER_OFF_ANIMATION == gsPersistentData.u8AnimationIndex ) ? TRUE : FALSE;
+}
+
+
+/***************************************< Public functions >**************************************/
+//----------------------------------------------------------------------------
+//! \brief  Entry point
+//! \param  argc, argv: optional number of saves
+//! \return EXIT_SUCCESS if every power loss was recovered
+//-----------------------------------------------------------------------------
+int main( int argc, char* argv[] )
+{
+  unsigned long u32Saves = DEFAULT_SAVES_NUM;
+  unsigned long u32Save;
+  unsigned long u32Call;
+  unsigned long u32Calls;
+  
+  if( argc > 1 )
+  {
+    u32Saves = strtoul( argv[ 1 ], 0, 0 );
+  }
+  if( 0 != pipe( gaiPipe ) )
+  {
+    perror( "pipe" );
+    return EXIT_FAILURE;
+  }
+  
+  // Blank EEPROM, first boot
+  memset( gau8HostEeprom, 0xFF, sizeof( gau8HostEeprom ) );
+  Host_Reset();
+  Persist_Init();
+  Commit();
+  gpfHostIapHook = PowerLossHook;
+  
+  // Long save sequence; the main loop is simulated by a varying number of writer steps between saves
+  for( u32Save = 0u; u32Save < u32Saves; u32Save++ )
+  {
+    gsPersistentData.u8AnimationIndex = (U8)( u32Save % 7u );
+    if( 0u == ( u32Save % 700u ) )  // rarely changed key, it has to be carried forward around the ring
+    {
+      gsPersistentData.u32RuntimeMs += 1000u + u32Save;
+    }
+    AllowCurrentValues();
+    Persist_Save();
+    u32Calls = 4u + ( u32Save % 24u );
+    for( u32Call = 0u; u32Call < u32Calls; u32Call++ )
+    {
+      Persist_Task( 3u == ( u32Call % 4u ), FALSE );  // every 4th pass is dark, erase is allowed
+    }
+    if( FALSE == Persist_Busy() )
+    {
+      Commit();
+    }
+  }
+  Persist_Flush();
+  Commit();
+  
+  printf( "Saves:                  %lu\n", u32Saves );
+  printf( "Byte programs:          %lu\n", gu32HostIapPrograms );
+  printf( "Page erases:            %lu\n", gu32HostIapErases );
+  printf( "Simulated power losses: %lu\n", gu32Cuts );
+  printf( "Failed recoveries:      %lu\n", gu32Failures );
+  if( TRUE == CheckPowerOff() )
+  {
+    printf( "Long press turn-off:    saved animation kept\n" );
+  }
+  else
+  {
+    printf( "Long press turn-off:    saved animation lost\n" );
+    gu32Failures++;
+  }
+  if( 0u != gu32Cuts )
+  {
+    printf( "Boot scan reads:        min %lu, avg %llu, max %lu bytes\n",
+            gu32BootReadsMin, gu64BootReadsSum / gu32Cuts, gu32BootReadsMax );
+  }
+  return ( 0u == gu32Failures ) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/***************************************< End of file >**************************************/
@@ -0,0 +1,90 @@
+#! *******************************************************************************************************
+# Copyright (c) 2022 Hekk_Elek
+#
+# \file sfr2sdcc.awk
+#
+# \brief Converts the Keil C51 SFR definitions of stc8g.h or stc8h.h to SDCC syntax
+#
+# \author Hekk_Elek
+#
+#*********************************************************************************************************
+
+#-----------------------------------------------------------------------------------------
+# How it works
+# ============
+# The register headers of the targets are written for Keil C51; SDCC needs the address of
+# every register and bit at its declaration:
+#   sfr  P1  = 0x90;        ->  __sfr  __at( 0x90 ) P1;
+#   sbit P10 = P1^0;        ->  __sbit __at( 0x90 ) P10;   (bit address of an SFR bit)
+#   ... volatile xdata *)   ->  ... volatile __xdata *)    (extended SFRs, macros)
+# The addresses of the sfr lines are remembered for the sbit lines below them. Only the
+# Keil block is converted: from the first sfr line to the next #else/#elif/#endif (stc8g.h
+# continues with the IAR definitions), or to the end of the file (stc8h.h). Everything else
+# is left out, so the output is a plain list, included by stc8g.h when __SDCC is defined.
+#
+# Run (the Makefile does it):
+#   awk -f sfr2sdcc.awk ../../src/stc8g.h > sfr_sdcc.h
+#-----------------------------------------------------------------------------------------
+
+#***************************************< Functions >**************************************
+# Value of a 0x prefixed hexadecimal number; mawk has no strtonum()
+function hex( s,    i, n )
+{
+  n = 0
+  s = tolower( substr( s, 3 ) )
+  for( i = 1; i <= length( s ); i++ )
+  {
+    n = n * 16 + index( "0123456789abcdef", substr( s, i, 1 ) ) - 1
+  }
+  return n
+}
+
+
+#***************************************< Conversion >**************************************
+BEGIN {
+  state = 0  # 0: before the Keil block, 1: in it, 2: after it
+  printf( "/* Generated from %s by sfr2sdcc.awk, don't edit */\n", ARGV[ 1 ] )
+  printf( "#ifndef SFR_SDCC_H\n#define SFR_SDCC_H\n\n" )
+}
+
+( state == 1 ) && /^#[ \t]*(else|elif|endif)/ { state = 2 }
+
+( state < 2 ) && /^sfr[ \t]/ {
+  state = 1
+  line = $0
+  sub( /;.*/, "", line )
+  split( line, field, /[ \t=]+/ )
+  address[ field[ 2 ] ] = hex( field[ 3 ] )
+  printf( "__sfr  __at( 0x%02X ) %s;\n", address[ field[ 2 ] ], field[ 2 ] )
+  next
+}
+
+( state == 1 ) && /^sbit[ \t]/ {
+  line = $0
+  sub( /;.*/, "", line )
+  split( line, field, /[ \t=^]+/ )
+  if( !( field[ 3 ] in address ) )
+  {
+    printf( "sfr2sdcc.awk: %s: unknown register %s\n", FILENAME, field[ 3 ] ) > "/dev/stderr"
+    failed = 1
+    exit 1
+  }
+  printf( "__sbit __at( 0x%02X ) %s;\n", address[ field[ 3 ] ] + field[ 4 ], field[ 2 ] )
+  next
+}
+
+( state == 1 ) && /^#define[ \t].*[ \t]xdata[ \t]/ {
+  line = $0
+  gsub( /[ \t]xdata[ \t]/, " __xdata ", line )
+  print line
+  next
+}
+
+END {
+  if( !failed )
+  {
+    printf( "\n#endif /* SFR_SDCC_H */\n" )
+  }
+}
+
+#***************************************< End of file >**************************************
@@ -0,0 +1,540 @@
+/*! *******************************************************************************************************
+* Copyright (c) 2022 Hekk_Elek
+*
+* \file sim_farm.cpp
+*
+* \brief Parallel sweep of every built-in animation across the LED driver parameters
+*
+* \author Hekk_Elek
+*
+**********************************************************************************************************/
+
+/*----------------------------------------------------------------------------------------
+How it works
+============
+util.c, led.c, rgbled.c and animation.c are included in this file and compiled for the host,
+on top of the simulated registers (tools/host). PWM_LEVELS is replaced with a variable, the
+drive divider and the RGB pulse cycle are variables of the firmware anyway (they are set
+by the battery level governor), so one binary can run every point of the parameter grid.
+
+A run plays one animation of gasAnimations with one set of parameters: the bodies of the
+flattened timer 0 interrupt are called for every 100 us tick, Animation_Cycle() once in
+every millisecond, just like in the main loop. After every tick the normal LED pins are
+sampled; the falling edges of the RGB pins are caught with the SFR write hook of the host
+simulation, these are the current pulses.
+
+On the host the delay loop of a pulse takes no time, so the length of the ISR comes from a
+cycle model (tools/host/isr_model.h), estimated from the STC8G1K08 instruction timing of
+the generated code. The pulse delay
+only changes the timing, not the behaviour, so every pulse setting is evaluated from the
+same run. The current is a rough estimate from the pin duty cycles.
+
+Each run is executed in its own child process, as many at a time as there are processors;
+the children put their results into shared memory. The table is printed as CSV:
+  animation          index in gasAnimations
+  pwm_levels         PWM_LEVELS
+  drive_divider      gu8LEDDriveDivider: interrupts per soft-PWM step
+  rgb_cycle          gu8RGBLEDCycleLength: interrupts per RGB pulse cycle
+  pulse_pct          RGB pulse delay loops, in percent of the calibrated *_PULSE_LOOPS
+  isr_load_pct       average time spent in the timer 0 interrupt
+  isr_max_cycles     longest timer 0 interrupt
+  isr_overruns       ticks where the interrupt took longer than the tick period
+  led_duty_pct       average duty cycle of the normal LED pins
+  rgb_duty_pct       average duty cycle of the RGB pins (pulse time)
+  current_ma         estimated average supply current
+  pwm_hz, rgb_hz     refresh rate of the soft-PWM and of the RGB pulse cycle
+  anim_steps_per_s   LED changes made by the animation per second
+  flicker_pct        share of the lit LED time at a partial brightness refreshed slower than FLICKER_LIMIT_HZ
+
+Build (from this directory):
+  g++ -O2 -DHOST_BUILD -I../../src -I../host sim_farm.cpp -x c++ ../../src/persist.c ../../src/iap.c \
+      -x none ../host/host_stc8g.cpp -o sim_farm
+Run:
+  ./sim_farm [--pwm list] [--divider list] [--cycle list] [--pulse list] [--time seconds] [--jobs n] > farm.csv
+  Lists are comma separated, e.g. --pwm 8,16,32
+----------------------------------------------------------------------------------------*/
+
+/***************************************< Includes >**************************************/
+// Standard C libraries
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+// Own includes
+#include "types.h"
+#include "host_stc8g.h"
+#include "isr_model.h"
+
+// Parameter of the grid point, read by the firmware sources below
+static U8 gu8FarmPWMLevels;
+#define PWM_LEVELS  gu8FarmPWMLevels
+
+// The firmware under test
+#include "util.c"
+#include "led.c"
+#include "rgbled.c"
+#include "animation.c"
+
+
+/***************************************< Definitions >**************************************/
+#define LIST_MAX                  (16u)  //!< Maximum number of values of a parameter
+#define DEFAULT_TIME_S            (30u)  //!< Simulated time of a run
+#define FLICKER_LIMIT_HZ         (100u)  //!< Partial brightness refreshed slower than this is considered flickering
+
+// Rough current model of the pins
+#define LED_PIN_MA              (3.0)  //!< One normal LED pin while it's low
+#define RGB_PIN_MA             (15.0)  //!< One RGB pin during a current pulse
+
+#define RGB_PINS_NUM  NUM_RGBLED_COLORS  //!< One pin per RGB color
+
+
+/***************************************< Types >**************************************/
+//! \brief A list of values of a parameter
+typedef struct
+{
+  U8 au8Values[ LIST_MAX ];  //!< Values
+  U8 u8Num;                  //!< Number of values
+} S_LIST;
+
+//! \brief Result of a run for one pulse setting; a row of the table
+typedef struct
+{
+  double dIsrLoadPct;        //!< Average time spent in the timer 0 interrupt
+  U32    u32IsrMaxCycles;    //!< Longest timer 0 interrupt
+  U32    u32IsrOverruns;     //!< Ticks where the interrupt was longer than the tick period
+  double dLEDDutyPct;        //!< Average duty cycle of the normal LED pins
+  double dRGBDutyPct;        //!< Average duty cycle of the RGB pins
+  double dCurrentMa;         //!< Estimated supply current
+  double dAnimStepsPerS;     //!< LED changes made by the animation per second
+  double dFlickerPct;        //!< Lit time at a partial brightness with a slow refresh
+  BOOL   bDone;              //!< Written by the child process
+} S_RESULT;
+
+//! \brief Pin of the port space of the host simulation
+typedef struct
+{
+  U8 u8Address;  //!< SFR address of the port
+  U8 u8Mask;     //!< Mask of the pin
+} S_PIN;
+
+
+/***************************************< Constants >**************************************/
+//! \brief Normal LED pins, in the order of gau8LEDBrightness (see led.h)
+static const S_PIN gcasLEDPins[ LEDS_NUM ] =
+{
+  { 0x90u, 0x80u }, { 0x90u, 0x40u }, { 0x90u, 0x02u }, { 0x90u, 0x01u },  // P1.7, P1.6, P1.1, P1.0
+  { 0xB0u, 0x20u }, { 0xB0u, 0x10u }, { 0xB0u, 0x04u }                     // P3.5, P3.4, P3.2
+};
+
+//! \brief RGB pins, in the order of gau8RGBLEDs (see rgbled.h)
+static const S_PIN gcasRGBPins[ RGB_PINS_NUM ] =
+{
+  { 0xC8u, 0x20u }, { 0xC8u, 0x10u }, { 0xB0u, 0x80u }, { 0xB0u, 0x08u }   // P5.5 "S", P5.4 "E", P3.7 "1", P3.3 "5"
+};
+
+//! \brief Calibrated pulse delay loops of the RGB pins
+static const U8 gcau8PulseLoops[ RGB_PINS_NUM ] = { S_PULSE_LOOPS, E_PULSE_LOOPS, ONE_PULSE_LOOPS, FIVE_PULSE_LOOPS };
+
+
+/***************************************< Global variables >**************************************/
+static S_LIST    gsPWMLevels    = { { 8u, 16u, 32u }, 3u };                 //!< Grid: PWM_LEVELS
+static S_LIST    gsDividers     = { { 3u, 4u, 5u, 6u, 7u }, 5u };           //!< Grid: drive divider
+static S_LIST    gsCycles       = { { 10u, 13u, 16u, 19u, 22u }, 5u };      //!< Grid: RGB pulse cycle
+static S_LIST    gsPulses       = { { 50u, 75u, 100u, 125u }, 4u };         //!< Grid: pulse delay (%)
+static U32       gu32TimeS      = DEFAULT_TIME_S;                          //!< Simulated time of a run
+static S_RESULT* gpsResults;                                               //!< Table, shared with the children
+static U8        gau8PortShadow[ 256u ];                                   //!< Previous value of the ports
+static U8        gu8TickPulses;                                            //!< Bit mask of the RGB pins pulsed in the current tick
+
+
+/***************************************< Static function definitions >**************************************/
+static BOOL ParseList( const char* pcText, S_LIST* psList );
+static void SfrHook( U8 u8Address, U8 u8Value );
+static void Tick( void );
+static void Run( U8 u8Animation, U8 u8PWMLevels, U8 u8Divider, U8 u8Cycle, S_RESULT* psResults );
+static void PrintTable( void );
+
+
+/***************************************< Private functions >**************************************/
+//----------------------------------------------------------------------------
+//! \brief  Parses a comma separated list of values
+//! \param  pcText: the list, e.g. "8,16,32"
+//! \param  psList: the values are written here
+//! \return TRUE if the list is valid
+//-----------------------------------------------------------------------------
+static BOOL ParseList( const char* pcText, S_LIST* psList )
+{
+  BOOL          bResult = TRUE;
+  char*         pcEnd;
+  unsigned long u32Value;
+
+  psList->u8Num = 0u;
+  while( ( TRUE == bResult ) && ( '\0' != *pcText ) )
+  {
+    u32Value = strtoul( pcText, &pcEnd, 0 );
+    if( ( pcEnd == pcText ) || ( 0u == u32Value ) || ( u32Value > 255u ) || ( psList->u8Num >= LIST_MAX )
+     || ( ( ',' != *pcEnd ) && ( '\0' != *pcEnd ) ) )
+    {
+      bResult = FALSE;
+    }
+    else
+    {
+      psList->au8Values[ psList->u8Num ] = (U8)u32Value;
+      psList->u8Num++;
+      pcText = ( ',' == *pcEnd ) ? ( pcEnd + 1 ) : pcEnd;
+    }
+  }
+  if( 0u == psList->u8Num )
+  {
+    bResult = FALSE;
+  }
+  return bResult;
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Called after every SFR write: catches the falling edges of the RGB pins
+//! \param  u8Address: address of the register
+//! \param  u8Value: value written
+//! \return -
+//! \global gau8PortShadow[], gu8TickPulses
+//-----------------------------------------------------------------------------
+static void SfrHook( U8 u8Address, U8 u8Value )
+{
+  U8 u8Pin;
+
+  for( u8Pin = 0u; u8Pin < RGB_PINS_NUM; u8Pin++ )
+  {
+    if( ( gcasRGBPins[ u8Pin ].u8Address == u8Address )
+     && ( 0u != ( gau8PortShadow[ u8Address ] & gcasRGBPins[ u8Pin ].u8Mask ) )
+     && ( 0u == ( u8Value & gcasRGBPins[ u8Pin ].u8Mask ) ) )
+    {
+      gu8TickPulses |= (U8)( 1u << u8Pin );
+    }
+  }
+  gau8PortShadow[ u8Address ] = u8Value;
+}
+
+//----------------------------------------------------------------------------
+//! \brief  One timer 0 interrupt, as in the flattened timer0_isr() of main.c
+//! \param  -
+//! \return -
+//-----------------------------------------------------------------------------
+static void Tick( void )
+{
+  UTIL_INTERRUPT_BODY();
+  LED_INTERRUPT_BODY();
+  RGBLED_INTERRUPT_BODY();
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Plays an animation with the given parameters, evaluates every pulse setting
+//! \param  u8Animation: index in gasAnimations
+//! \param  u8PWMLevels: PWM_LEVELS
+//! \param  u8Divider: interrupts per soft-PWM step
+//! \param  u8Cycle: interrupts per RGB pulse cycle
+//! \param  psResults: results, one per value of gsPulses
+//! \return -
+//-----------------------------------------------------------------------------
+static void Run( U8 u8Animation, U8 u8PWMLevels, U8 u8Divider, U8 u8Cycle, S_RESULT* psResults )
+{
+  U32      au32PulseCycles[ LIST_MAX ][ RGB_PINS_NUM ];  // Cycles of a pulse of each pin for each setting
+  U32      au32IsrCycles[ LIST_MAX ];                    // Length of the current interrupt for each setting
+  uint64_t au64IsrCyclesSum[ LIST_MAX ];
+  uint64_t au64PulseCyclesSum[ LIST_MAX ];
+  uint64_t u64LEDLowTicks = 0u;
+  uint64_t u64LitTime = 0u;       // LED * ms, lit
+  uint64_t u64FlickerTime = 0u;   // LED * ms, lit at a partial brightness with a slow refresh
+  U32      u32Steps = 0u;
+  U32      u32Ticks;
+  U32      u32Tick;
+  U32      u32Fixed;
+  U8       au8LastLEDs[ LEDS_NUM ];
+  U8       au8LastRGB[ NUM_RGBLED_COLORS ];
+  U8       u8Pulse, u8Pin, u8Loops, u8Led;
+  BOOL     bSlowPWM, bSlowRGB;
+  double   dSeconds, dLoad, dLEDDuty, dRGBDuty;
+
+  // Pulse lengths of each setting
+  for( u8Pulse = 0u; u8Pulse < gsPulses.u8Num; u8Pulse++ )
+  {
+    for( u8Pin = 0u; u8Pin < RGB_PINS_NUM; u8Pin++ )
+    {
+      u32Fixed = ( (U32)gcau8PulseLoops[ u8Pin ] * gsPulses.au8Values[ u8Pulse ] + 50u ) / 100u;
+      u8Loops = (U8)( ( u32Fixed > 255u ) ? 255u : ( ( 0u == u32Fixed ) ? 1u : u32Fixed ) );
+      au32PulseCycles[ u8Pulse ][ u8Pin ] = ISR_CYCLES_PULSE( u8Loops );
+    }
+    au64IsrCyclesSum[ u8Pulse ] = 0u;
+    au64PulseCyclesSum[ u8Pulse ] = 0u;
+    psResults[ u8Pulse ].u32IsrMaxCycles = 0u;
+    psResults[ u8Pulse ].u32IsrOverruns = 0u;
+  }
+
+  // Power on, as in main()
+  Host_Reset();
+  memcpy( gau8PortShadow, gau8HostSfr, sizeof( gau8PortShadow ) );
+  gpfHostSfrHook = SfrHook;
+  gu8FarmPWMLevels = u8PWMLevels;
+  Util_Init();
+  LED_Init();
+  RGBLED_Init();
+  Animation_Init();
+  gu8LEDDriveDivider = u8Divider;
+  gu8RGBLEDCycleLength = u8Cycle;
+  Animation_Set( u8Animation, TRUE );
+  memcpy( au8LastLEDs, gau8LEDBrightness, LEDS_NUM );
+  memcpy( au8LastRGB, (const void*)gau8RGBLEDs, NUM_RGBLED_COLORS );
+  bSlowPWM = ( ( 1000000u / TICK_PERIOD_US ) < ( FLICKER_LIMIT_HZ * u8Divider * u8PWMLevels ) );
+  bSlowRGB = ( ( 1000000u / TICK_PERIOD_US ) < ( FLICKER_LIMIT_HZ * u8Cycle ) );
+
+  u32Ticks = gu32TimeS * 1000u * TICKS_PER_MS;
+  for( u32Tick = 0u; u32Tick < u32Ticks; u32Tick++ )
+  {
+    // Main loop, once in a millisecond
+    if( 0u == ( u32Tick % TICKS_PER_MS ) )
+    {
+      Util_TakeTimeSnapshot();
+      Animation_Cycle();
+      if( ( 0 != memcmp( au8LastLEDs, gau8LEDBrightness, LEDS_NUM ) )
+       || ( 0 != memcmp( au8LastRGB, (const void*)gau8RGBLEDs, NUM_RGBLED_COLORS ) ) )
+      {
+        u32Steps++;
+        memcpy( au8LastLEDs, gau8LEDBrightness, LEDS_NUM );
+        memcpy( au8LastRGB, (const void*)gau8RGBLEDs, NUM_RGBLED_COLORS );
+      }
+      for( u8Led = 0u; u8Led < LEDS_NUM; u8Led++ )
+      {
+        if( 0u != gau8LEDBrightness[ u8Led ] )
+        {
+          u64LitTime++;
+          if( bSlowPWM && ( gau8LEDBrightness[ u8Led ] < u8PWMLevels ) )
+          {
+            u64FlickerTime++;
+          }
+        }
+      }
+      for( u8Pin = 0u; u8Pin < NUM_RGBLED_COLORS; u8Pin++ )
+      {
+        if( 0u != gau8RGBLEDs[ u8Pin ] )
+        {
+          u64LitTime++;
+          if( bSlowRGB && ( gau8RGBLEDs[ u8Pin ] < u8Cycle ) )
+          {
+            u64FlickerTime++;
+          }
+        }
+      }
+    }
+
+    // Timer 0 interrupt
+    gu8TickPulses = 0u;
+    Tick();
+    u32Fixed = ISR_CYCLES_FIXED + ( NUM_RGBLED_COLORS * ISR_CYCLES_RGB_TEST )
+             + ( ( 0u == gu8LEDDriveCounter ) ? ISR_CYCLES_LED_DRIVE : ISR_CYCLES_LED_OFF );
+    for( u8Led = 0u; u8Led < LEDS_NUM; u8Led++ )
+    {
+      if( 0u == ( gau8HostSfr[ gcasLEDPins[ u8Led ].u8Address ] & gcasLEDPins[ u8Led ].u8Mask ) )
+      {
+        u64LEDLowTicks++;
+      }
+    }
+    for( u8Pulse = 0u; u8Pulse < gsPulses.u8Num; u8Pulse++ )
+    {
+      au32IsrCycles[ u8Pulse ] = u32Fixed;
+      for( u8Pin = 0u; u8Pin < RGB_PINS_NUM; u8Pin++ )
+      {
+        if( 0u != ( gu8TickPulses & ( 1u << u8Pin ) ) )
+        {
+          au32IsrCycles[ u8Pulse ] += au32PulseCycles[ u8Pulse ][ u8Pin ];
+          au64PulseCyclesSum[ u8Pulse ] += au32PulseCycles[ u8Pulse ][ u8Pin ];
+        }
+      }
+      au64IsrCyclesSum[ u8Pulse ] += au32IsrCycles[ u8Pulse ];
+      if( au32IsrCycles[ u8Pulse ] > psResults[ u8Pulse ].u32IsrMaxCycles )
+      {
+        psResults[ u8Pulse ].u32IsrMaxCycles = au32IsrCycles[ u8Pulse ];
+      }
+      if( au32IsrCycles[ u8Pulse ] > ISR_CYCLES_PER_TICK )
+      {
+        psResults[ u8Pulse ].u32IsrOverruns++;
+      }
+    }
+  }
+  gpfHostSfrHook = 0;
+
+  // Summary of each pulse setting
+  dSeconds = (double)gu32TimeS;
+  dLEDDuty = (double)u64LEDLowTicks / ( (double)u32Ticks * LEDS_NUM );
+  for( u8Pulse = 0u; u8Pulse < gsPulses.u8Num; u8Pulse++ )
+  {
+    dLoad = (double)au64IsrCyclesSum[ u8Pulse ] / ( (double)u32Ticks * ISR_CYCLES_PER_TICK );
+    dRGBDuty = (double)au64PulseCyclesSum[ u8Pulse ] / ( (double)u32Ticks * ISR_CYCLES_PER_TICK * RGB_PINS_NUM );
+    psResults[ u8Pulse ].dIsrLoadPct = 100.0 * dLoad;
+    psResults[ u8Pulse ].dLEDDutyPct = 100.0 * dLEDDuty;
+    psResults[ u8Pulse ].dRGBDutyPct = 100.0 * dRGBDuty;
+    psResults[ u8Pulse ].dCurrentMa = MCU_IDLE_MA + ( dLoad * ( MCU_ACTIVE_MA - MCU_IDLE_MA ) )
+                                    + ( dLEDDuty * LEDS_NUM * LED_PIN_MA ) + ( dRGBDuty * RGB_PINS_NUM * RGB_PIN_MA );
+    psResults[ u8Pulse ].dAnimStepsPerS = (double)u32Steps / dSeconds;
+    psResults[ u8Pulse ].dFlickerPct = ( 0u == u64LitTime ) ? 0.0 : ( 100.0 * (double)u64FlickerTime / (double)u64LitTime );
+    psResults[ u8Pulse ].bDone = TRUE;
+  }
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Prints the results as CSV, in the order of the grid
+//! \param  -
+//! \return -
+//-----------------------------------------------------------------------------
+static void PrintTable( void )
+{
+  U32       u32Row = 0u;
+  U8        u8Animation, u8PWM, u8Divider, u8Cycle, u8Pulse;
+  S_RESULT* psResult;
+
+  printf( "animation,pwm_levels,drive_divider,rgb_cycle,pulse_pct,isr_load_pct,isr_max_cycles,isr_overruns,"
+          "led_duty_pct,rgb_duty_pct,current_ma,pwm_hz,rgb_hz,anim_steps_per_s,flicker_pct\n" );
+  for( u8Animation = 0u; u8Animation < NUM_ANIMATIONS; u8Animation++ )
+  {
+    for( u8PWM = 0u; u8PWM < gsPWMLevels.u8Num; u8PWM++ )
+    {
+      for( u8Divider = 0u; u8Divider < gsDividers.u8Num; u8Divider++ )
+      {
+        for( u8Cycle = 0u; u8Cycle < gsCycles.u8Num; u8Cycle++ )
+        {
+          for( u8Pulse = 0u; u8Pulse < gsPulses.u8Num; u8Pulse++ )
+          {
+            psResult = &gpsResults[ u32Row ];
+            printf( "%u,%u,%u,%u,%u,%.2f,%u,%u,%.2f,%.2f,%.3f,%.1f,%.1f,%.2f,%.1f\n",
+                    u8Animation, gsPWMLevels.au8Values[ u8PWM ], gsDividers.au8Values[ u8Divider ],
+                    gsCycles.au8Values[ u8Cycle ], gsPulses.au8Values[ u8Pulse ],
+                    psResult->dIsrLoadPct, psResult->u32IsrMaxCycles, psResult->u32IsrOverruns,
+                    psResult->dLEDDutyPct, psResult->dRGBDutyPct, psResult->dCurrentMa,
+                    ( 1000000.0 / TICK_PERIOD_US ) / ( gsDividers.au8Values[ u8Divider ] * gsPWMLevels.au8Values[ u8PWM ] ),
+                    ( 1000000.0 / TICK_PERIOD_US ) / gsCycles.au8Values[ u8Cycle ],
+                    psResult->dAnimStepsPerS, psResult->dFlickerPct );
+            u32Row++;
+          }
+        }
+      }
+    }
+  }
+}
+
+
+/***************************************< Public functions >**************************************/
+//----------------------------------------------------------------------------
+//! \brief  Entry point
+//! \param  argc, argv: options, see the header
+//! \return EXIT_SUCCESS if every run finished
+//-----------------------------------------------------------------------------
+int main( int argc, char* argv[] )
+{
+  int   iResult = EXIT_SUCCESS;
+  long  iWorkers = sysconf( _SC_NPROCESSORS_ONLN );
+  long  iRunning = 0;
+  int   iStatus;
+  int   iArg;
+  U32   u32Runs, u32Run, u32Index;
+  BOOL  bValid = TRUE;
+
+  // Options
+  for( iArg = 1; ( TRUE == bValid ) && ( ( iArg + 1 ) < argc ); iArg += 2 )
+  {
+    if( 0 == strcmp( argv[ iArg ], "--pwm" ) )
+    {
+      bValid = ParseList( argv[ iArg + 1 ], &gsPWMLevels );
+    }
+    else if( 0 == strcmp( argv[ iArg ], "--divider" ) )
+    {
+      bValid = ParseList( argv[ iArg + 1 ], &gsDividers );
+    }
+    else if( 0 == strcmp( argv[ iArg ], "--cycle" ) )
+    {
+      bValid = ParseList( argv[ iArg + 1 ], &gsCycles );
+    }
+    else if( 0 == strcmp( argv[ iArg ], "--pulse" ) )
+    {
+      bValid = ParseList( argv[ iArg + 1 ], &gsPulses );
+    }
+    else if( 0 == strcmp( argv[ iArg ], "--time" ) )
+    {
+      gu32TimeS = (U32)strtoul( argv[ iArg + 1 ], 0, 0 );
+      bValid = ( 0u != gu32TimeS );
+    }
+    else if( 0 == strcmp( argv[ iArg ], "--jobs" ) )
+    {
+      iWorkers = strtol( argv[ iArg + 1 ], 0, 0 );
+    }
+    else
+    {
+      bValid = FALSE;
+    }
+  }
+  if( ( FALSE == bValid ) || ( iArg < argc ) )
+  {
+    fprintf( stderr, "Usage: %s [--pwm list] [--divider list] [--cycle list] [--pulse list] [--time seconds] [--jobs n]\n", argv[ 0 ] );
+    return EXIT_FAILURE;
+  }
+  if( iWorkers < 1 )
+  {
+    iWorkers = 1;
+  }
+
+  // Table in shared memory, filled by the children
+  u32Runs = NUM_ANIMATIONS * gsPWMLevels.u8Num * gsDividers.u8Num * gsCycles.u8Num;
+  gpsResults = (S_RESULT*)mmap( 0, sizeof( S_RESULT ) * u32Runs * gsPulses.u8Num, PROT_READ | PROT_WRITE,
+                                MAP_SHARED | MAP_ANONYMOUS, -1, 0 );
+  if( MAP_FAILED == gpsResults )
+  {
+    perror( "mmap" );
+    return EXIT_FAILURE;
+  }
+  fprintf( stderr, "%u runs of %u s on %ld processes\n", u32Runs, gu32TimeS, iWorkers );
+
+  // One child per run, at most iWorkers at a time
+  for( u32Run = 0u; u32Run < u32Runs; u32Run++ )
+  {
+    if( iRunning >= iWorkers )
+    {
+      wait( 0 );
+      iRunning--;
+    }
+    if( 0 == fork() )
+    {
+      u32Index = u32Run;
+      Run( (U8)( u32Index / ( gsPWMLevels.u8Num * gsDividers.u8Num * gsCycles.u8Num ) ),
+           gsPWMLevels.au8Values[ ( u32Index / ( gsDividers.u8Num * gsCycles.u8Num ) ) % gsPWMLevels.u8Num ],
+           gsDividers.au8Values[ ( u32Index / gsCycles.u8Num ) % gsDividers.u8Num ],
+           gsCycles.au8Values[ u32Index % gsCycles.u8Num ],
+           &gpsResults[ u32Run * gsPulses.u8Num ] );
+      _exit( EXIT_SUCCESS );
+    }
+    iRunning++;
+  }
+  while( wait( &iStatus ) > 0 )
+  {
+  }
+
+  // Every run must have finished
+  for( u32Index = 0u; u32Index < ( u32Runs * gsPulses.u8Num ); u32Index++ )
+  {
+    if( TRUE != gpsResults[ u32Index ].bDone )
+    {
+      iResult = EXIT_FAILURE;
+    }
+  }
+  if( EXIT_SUCCESS == iResult )
+  {
+    PrintTable();
+  }
+  else
+  {
+    fprintf( stderr, "Some of the runs failed\n" );
+  }
+  return iResult;
+}
+
+/***************************************< End of file >**************************************/
@@ -0,0 +1,378 @@
+/*! *******************************************************************************************************
+* Copyright (c) 2022 Hekk_Elek
+*
+* \file telemetry_decoder.cpp
+*
+* \brief Decoder of the UART telemetry stream (see telemetry.c), with CSV output and a live plot
+*
+* \author Hekk_Elek
+*
+**********************************************************************************************************/
+
+/*----------------------------------------------------------------------------------------
+How it works
+============
+The stream is read from a serial port (set to TELEMETRY_BAUD_RATE, 8N1, raw) or from a file
+recorded earlier; "-" reads the standard input. Frames are found by the sync byte, checked
+by their length and CRC (util.c is compiled in, so the CRC is the firmware's own), and every
+valid frame is printed as a CSV line. The sequence numbers show the frames that were
+dropped by the firmware or corrupted on the line.
+
+With --plot, the terminal is redrawn at every frame instead: the LEDs as a bar graph, the
+battery voltage, and the history of the timer 0 interrupt load (average interrupt length
+relative to the tick length at the current clock; needs PROFILE_ENABLED in the firmware).
+
+Build (from this directory):
+  g++ -O2 -DHOST_BUILD -I../../src -I../host -x c++ ../../src/util.c \
+      -x none ../host/host_stc8g.cpp telemetry_decoder.cpp -o telemetry_decoder
+Run:
+  ./telemetry_decoder /dev/ttyUSB0 > log.csv
+  ./telemetry_decoder --plot /dev/ttyUSB0
+----------------------------------------------------------------------------------------*/
+
+/***************************************< Includes >**************************************/
+// Standard C libraries
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+
+// Own includes
+#include "types.h"
+#include "util.h"
+#include "led.h"
+#include "rgbled.h"
+#include "telemetry.h"
+
+
+/***************************************< Definitions >**************************************/
+#define HISTORY_LENGTH       (64u)  //!< Number of samples in the plotted history
+#define BAR_WIDTH            (32u)  //!< Width of the bars of the plot
+#define FRAME_BUFFER_NIBBLES ( LEDS_NUM + NUM_RGBLED_COLORS )  //!< Brightness values in a frame
+#define TICK_CYCLES( u8ClockShift )  ( ( SYSTEM_CLOCK_HZ >> (u8ClockShift) ) / ( 1000000UL / TICK_PERIOD_US ) )  //!< Cycles in a tick
+
+
+/***************************************< Types >**************************************/
+//! \brief Decoded frame
+typedef struct
+{
+  U8  u8Sequence;
+  U16 u16TimeMs;
+  U8  u8Animation;
+  U8  u8Instruction;
+  U8  u8InstructionRGB;
+  U8  u8ClockShift;
+  U8  au8Levels[ FRAME_BUFFER_NIBBLES ];
+  U16 u16BatteryADC;
+  U16 u16ISRMax;
+  U16 u16ISRAvg;
+  U16 u16ISROverruns;
+} S_FRAME;
+
+
+/***************************************< Global variables >**************************************/
+static U8  gau8Frame[ TELEMETRY_FRAME_LENGTH ];  //!< Frame being received
+static U32 gu32FrameIndex;                       //!< Bytes of the frame received
+static U32 gu32Frames;                           //!< Valid frames
+static U32 gu32Lost;                             //!< Frames missing from the sequence
+static U32 gu32Errors;                           //!< Frames with wrong length or CRC
+static double gadISRLoad[ HISTORY_LENGTH ];      //!< History of the interrupt load (%)
+static U32 gu32HistoryIndex;                     //!< Next sample of the history
+
+STATIC_ASSERT( TELEMETRY_BAUD_RATE == 57600UL );  // See SetupSerialPort()
+
+
+/***************************************< Static functions >**************************************/
+//----------------------------------------------------------------------------
+//! \brief  Reads a big-endian U16 field of the payload
+//! \param  u8Offset: offset of the field in the payload
+//! \return Value of the field
+//-----------------------------------------------------------------------------
+static U16 GetU16( U8 u8Offset )
+{
+  return (U16)( ( gau8Frame[ TELEMETRY_HEADER_LENGTH + u8Offset ] << 8u ) | gau8Frame[ TELEMETRY_HEADER_LENGTH + u8Offset + 1u ] );
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Decodes the received frame
+//! \param  *psFrame: destination
+//! \return -
+//-----------------------------------------------------------------------------
+static void DecodeFrame( S_FRAME* psFrame )
+{
+  U8 u8Index;
+  U8 u8Byte;
+
+  psFrame->u8Sequence = gau8Frame[ 2u ];
+  psFrame->u16TimeMs = GetU16( TELEMETRY_OFS_TIME );
+  psFrame->u8Animation = gau8Frame[ TELEMETRY_HEADER_LENGTH + TELEMETRY_OFS_ANIMATION ];
+  psFrame->u8Instruction = gau8Frame[ TELEMETRY_HEADER_LENGTH + TELEMETRY_OFS_INSTRUCTION ];
+  psFrame->u8InstructionRGB = gau8Frame[ TELEMETRY_HEADER_LENGTH + TELEMETRY_OFS_INSTRUCTION_RGB ];
+  psFrame->u8ClockShift = gau8Frame[ TELEMETRY_HEADER_LENGTH + TELEMETRY_OFS_CLOCK_SHIFT ];
+  for( u8Index = 0u; u8Index < FRAME_BUFFER_NIBBLES; u8Index++ )
+  {
+    u8Byte = gau8Frame[ TELEMETRY_HEADER_LENGTH + TELEMETRY_OFS_FRAME_BUFFER + ( u8Index >> 1u ) ];
+    psFrame->au8Levels[ u8Index ] = ( u8Index & 1u ) ? ( u8Byte & 0x0Fu ) : ( u8Byte >> 4u );
+  }
+  psFrame->u16BatteryADC = GetU16( TELEMETRY_OFS_BATTERY_ADC );
+  psFrame->u16ISRMax = GetU16( TELEMETRY_OFS_ISR_MAX );
+  psFrame->u16ISRAvg = GetU16( TELEMETRY_OFS_ISR_AVG );
+  psFrame->u16ISROverruns = GetU16( TELEMETRY_OFS_ISR_OVERRUNS );
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Converts the battery measurement to volts
+//! \param  u16ADC: filtered ADC value of the internal reference
+//! \return Battery voltage, 0 before the first measurement
+//-----------------------------------------------------------------------------
+static double BatteryVoltage( U16 u16ADC )
+{
+  return ( 0u != u16ADC ) ? ( 1.19 * 1024.0 / u16ADC ) : 0.0;
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Prints a horizontal bar
+//! \param  dValue: value to show
+//! \param  dFullScale: value of the full bar
+//! \return -
+//-----------------------------------------------------------------------------
+static void PrintBar( double dValue, double dFullScale )
+{
+  U32 u32Length = ( dFullScale > 0.0 ) ? (U32)( dValue * BAR_WIDTH / dFullScale + 0.5 ) : 0u;
+  U32 u32Index;
+
+  if( u32Length > BAR_WIDTH )
+  {
+    u32Length = BAR_WIDTH;
+  }
+  putchar( '|' );
+  for( u32Index = 0u; u32Index < BAR_WIDTH; u32Index++ )
+  {
+    putchar( ( u32Index < u32Length ) ? '#' : ' ' );
+  }
+  putchar( '|' );
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Prints a frame as a CSV line
+//! \param  *psFrame: decoded frame
+//! \return -
+//-----------------------------------------------------------------------------
+static void PrintCSV( const S_FRAME* psFrame )
+{
+  U8 u8Index;
+
+  printf( "%u,%u,%u,%u,%u,%u", psFrame->u8Sequence, psFrame->u16TimeMs, psFrame->u8Animation,
+          psFrame->u8Instruction, psFrame->u8InstructionRGB, psFrame->u8ClockShift );
+  for( u8Index = 0u; u8Index < FRAME_BUFFER_NIBBLES; u8Index++ )
+  {
+    printf( ",%u", psFrame->au8Levels[ u8Index ] );
+  }
+  printf( ",%u,%.3f,%u,%u,%u,%u\n", psFrame->u16BatteryADC, BatteryVoltage( psFrame->u16BatteryADC ),
+          psFrame->u16ISRMax, psFrame->u16ISRAvg, psFrame->u16ISROverruns, gu32Lost );
+  fflush( stdout );
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Redraws the live plot
+//! \param  *psFrame: decoded frame
+//! \return -
+//-----------------------------------------------------------------------------
+static void PrintPlot( const S_FRAME* psFrame )
+{
+  static const char acLevels[] = " .:-=+*#%@";
+  double dTickCycles = (double)TICK_CYCLES( psFrame->u8ClockShift );
+  U32 u32Index;
+  U8  u8Index;
+
+  gadISRLoad[ gu32HistoryIndex % HISTORY_LENGTH ] = 100.0 * psFrame->u16ISRAvg / dTickCycles;
+  gu32HistoryIndex++;
+
+  printf( "\033[H\033[2J" );
+  printf( "Time %5u ms  animation %u  instruction %3u / RGB %3u  clock /%u\n\n", psFrame->u16TimeMs,
+          psFrame->u8Animation, psFrame->u8Instruction, psFrame->u8InstructionRGB, 1u << psFrame->u8ClockShift );
+  for( u8Index = 0u; u8Index < FRAME_BUFFER_NIBBLES; u8Index++ )
+  {
+    if( u8Index < LEDS_NUM )
+    {
+      printf( "LED%u  %2u ", u8Index, psFrame->au8Levels[ u8Index ] );
+    }
+    else
+    {
+      printf( "RGB%u  %2u ", u8Index - LEDS_NUM, psFrame->au8Levels[ u8Index ] );
+    }
+    PrintBar( psFrame->au8Levels[ u8Index ], 15.0 );
+    putchar( '\n' );
+  }
+  printf( "\nBattery %.2f V (ADC %u)\n", BatteryVoltage( psFrame->u16BatteryADC ), psFrame->u16BatteryADC );
+  printf( "ISR load avg %5.1f %% ", 100.0 * psFrame->u16ISRAvg / dTickCycles );
+  PrintBar( psFrame->u16ISRAvg, dTickCycles );
+  printf( "\nISR load max %5.1f %% ", 100.0 * psFrame->u16ISRMax / dTickCycles );
+  PrintBar( psFrame->u16ISRMax, dTickCycles );
+  printf( "\nLost ticks %u\n\nISR load history (0..100 %%):\n", psFrame->u16ISROverruns );
+  for( u32Index = 0u; u32Index < HISTORY_LENGTH; u32Index++ )
+  {
+    double dLoad = 0.0;
+    if( gu32HistoryIndex >= HISTORY_LENGTH - u32Index )
+    {
+      dLoad = gadISRLoad[ ( gu32HistoryIndex + u32Index ) % HISTORY_LENGTH ];
+    }
+    u8Index = (U8)( dLoad * ( sizeof( acLevels ) - 2u ) / 100.0 + 0.5 );
+    if( u8Index > sizeof( acLevels ) - 2u )
+    {
+      u8Index = sizeof( acLevels ) - 2u;
+    }
+    putchar( acLevels[ u8Index ] );
+  }
+  printf( "\n\nFrames %u, lost %u, errors %u\n", gu32Frames, gu32Lost, gu32Errors );
+  fflush( stdout );
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Processes a received byte
+//! \param  u8Byte: received byte
+//! \return TRUE, if a valid frame is complete in gau8Frame
+//-----------------------------------------------------------------------------
+static BOOL ReceiveByte( U8 u8Byte )
+{
+  BOOL bValid = FALSE;
+
+  if( ( 0u == gu32FrameIndex ) && ( TELEMETRY_SYNC != u8Byte ) )
+  {
+    // Waiting for the start of a frame
+  }
+  else if( ( 1u == gu32FrameIndex ) && ( TELEMETRY_PAYLOAD_LENGTH != u8Byte ) )
+  {
+    // Not a frame of this version: resynchronize
+    gu32Errors++;
+    gu32FrameIndex = ( TELEMETRY_SYNC == u8Byte ) ? 1u : 0u;
+  }
+  else
+  {
+    gau8Frame[ gu32FrameIndex ] = u8Byte;
+    gu32FrameIndex++;
+    if( TELEMETRY_FRAME_LENGTH == gu32FrameIndex )
+    {
+      gu32FrameIndex = 0u;
+      if( Util_CRC16( &gau8Frame[ 2u ], 1u + TELEMETRY_PAYLOAD_LENGTH )
+          == GetU16( TELEMETRY_PAYLOAD_LENGTH ) )
+      {
+        bValid = TRUE;
+      }
+      else
+      {
+        gu32Errors++;
+      }
+    }
+  }
+
+  return bValid;
+}
+
+//----------------------------------------------------------------------------
+//! \brief  Sets up a serial port for the telemetry stream
+//! \param  iFd: file descriptor of the port
+//! \return -
+//! \note   Does nothing if it's not a terminal (e.g. a recorded file)
+//-----------------------------------------------------------------------------
+static void SetupSerialPort( int iFd )
+{
+  struct termios sTermios;
+
+  if( 0 == tcgetattr( iFd, &sTermios ) )
+  {
+    cfmakeraw( &sTermios );
+    cfsetispeed( &sTermios, B57600 );
+    cfsetospeed( &sTermios, B57600 );
+    sTermios.c_cflag |= CLOCAL | CREAD;
+    sTermios.c_cc[ VMIN ] = 1;
+    sTermios.c_cc[ VTIME ] = 0;
+    tcsetattr( iFd, TCSANOW, &sTermios );
+  }
+}
+
+
+/***************************************< Public functions >**************************************/
+int main( int argc, char** argv )
+{
+  BOOL bPlot = FALSE;
+  BOOL bFirst = TRUE;
+  const char* pcPath = NULL;
+  int iFd;
+  int iArg;
+  U8  au8Buffer[ 256 ];
+  ssize_t iLength;
+  ssize_t iIndex;
+  U8  u8ExpectedSequence = 0u;
+  S_FRAME sFrame;
+
+  for( iArg = 1; iArg < argc; iArg++ )
+  {
+    if( 0 == strcmp( argv[ iArg ], "--plot" ) )
+    {
+      bPlot = TRUE;
+    }
+    else
+    {
+      pcPath = argv[ iArg ];
+    }
+  }
+  if( NULL == pcPath )
+  {
+    fprintf( stderr, "Usage: %s [--plot] <serial port | recorded file | ->\n", argv[ 0 ] );
+    return 2;
+  }
+  iFd = ( 0 == strcmp( pcPath, "-" ) ) ? STDIN_FILENO : open( pcPath, O_RDONLY | O_NOCTTY );
+  if( iFd < 0 )
+  {
+    perror( pcPath );
+    return 1;
+  }
+  SetupSerialPort( iFd );
+
+  if( FALSE == bPlot )
+  {
+    printf( "sequence,time_ms,animation,instruction,instruction_rgb,clock_shift" );
+    for( iIndex = 0; iIndex < (ssize_t)LEDS_NUM; iIndex++ )
+    {
+      printf( ",led%d", (int)iIndex );
+    }
+    for( iIndex = 0; iIndex < (ssize_t)NUM_RGBLED_COLORS; iIndex++ )
+    {
+      printf( ",rgb%d", (int)iIndex );
+    }
+    printf( ",battery_adc,battery_v,isr_max_cycles,isr_avg_cycles,isr_overruns,frames_lost\n" );
+  }
+
+  while( ( iLength = read( iFd, au8Buffer, sizeof( au8Buffer ) ) ) > 0 )
+  {
+    for( iIndex = 0; iIndex < iLength; iIndex++ )
+    {
+      if( TRUE == ReceiveByte( au8Buffer[ iIndex ] ) )
+      {
+        DecodeFrame( &sFrame );
+        if( FALSE == bFirst )
+        {
+          gu32Lost += (U8)( sFrame.u8Sequence - u8ExpectedSequence );
+        }
+        bFirst = FALSE;
+        u8ExpectedSequence = sFrame.u8Sequence + 1u;
+        gu32Frames++;
+        if( TRUE == bPlot )
+        {
+          PrintPlot( &sFrame );
+        }
+        else
+        {
+          PrintCSV( &sFrame );
+        }
+      }
+    }
+  }
+  fprintf( stderr, "Frames %u, lost %u, errors %u\n", gu32Frames, gu32Lost, gu32Errors );
+
+  return 0;
+}
+
+/***************************************< End of file >**************************************/